@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <SFBAudioEngine/SFBPCMDecoding.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Policies for handling a reader that stops reading from an \c SFBFanOutDecoder
+typedef NS_ENUM(NSUInteger, SFBFanOutDecoderStallPolicy) {
+	/// Decoding waits indefinitely for every reader
+	SFBFanOutDecoderStallPolicyWait	= 0,
+	/// A reader that prevents decoding for longer than the stall timeout is dropped
+	SFBFanOutDecoderStallPolicyDrop	= 1
+} NS_SWIFT_NAME(FanOutDecoder.StallPolicy);
+
+/// A decoder supplying the audio decoded by an \c SFBFanOutDecoder to one output
+///
+/// Readers do not support seeking. When audio is not yet available decoding blocks until the \c SFBFanOutDecoder
+/// supplies it. A reader that has been dropped fails with \c SFBFanOutDecoderErrorReaderDropped.
+///
+/// Because decoding blocks, a reader can't be enqueued on an \c SFBAudioPlayerNode using an
+/// \c SFBAudioDecodingExecutor: a blocked reader would occupy a worker thread that another node, possibly the one
+/// feeding the slowest reader, needs in order to make progress. Such an enqueue fails with
+/// \c SFBAudioPlayerNodeErrorDecoderNotSupported.
+NS_SWIFT_NAME(FanOutReader) @interface SFBFanOutReader : NSObject <SFBPCMDecoding>
+
++ (instancetype)new NS_UNAVAILABLE;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// The number of frames of silence preceding the decoded audio
+@property (nonatomic, readonly) AVAudioFrameCount delay;
+/// Returns \c YES if the reader was dropped for stalling decoding
+@property (nonatomic, readonly) BOOL wasDropped;
+
+@end
+
+/// Decodes audio once and supplies it to several readers
+///
+/// Each reader is an \c SFBPCMDecoding object that may be enqueued on its own \c SFBAudioPlayerNode, allowing one
+/// decoding pipeline to feed several outputs such as the zones of a multi-room system. Decoded audio is held in a ring
+/// buffer in which every reader has its own read position. Decoding proceeds only as fast as the slowest reader, so a
+/// reader that stops reading eventually stops decoding for all readers; \c stallPolicy determines whether such a
+/// reader is dropped.
+///
+/// Decoding begins when any reader is first asked for audio, so readers added before then all begin with the first
+/// frame. Readers added later begin with the next frame decoded. Outputs with differing latencies may be aligned by
+/// giving readers for the lower latency outputs a delay.
+///
+/// The decoded audio is deinterleaved 32-bit floating point with the sample rate and channel count of the decoder.
+NS_SWIFT_NAME(FanOutDecoder) @interface SFBFanOutDecoder : NSObject
+
++ (instancetype)new NS_UNAVAILABLE;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns an initialized \c SFBFanOutDecoder object for the audio in \c url
+/// @param url The URL
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return An initialized \c SFBFanOutDecoder object or \c nil on failure
+- (nullable instancetype)initWithURL:(NSURL *)url error:(NSError **)error;
+/// Returns an initialized \c SFBFanOutDecoder object for the audio supplied by \c decoder
+/// @note \c decoder must not be used by the caller after this method returns
+/// @param decoder The decoder supplying the audio, which is opened if necessary
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return An initialized \c SFBFanOutDecoder object or \c nil on failure
+- (nullable instancetype)initWithDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error;
+/// Returns an initialized \c SFBFanOutDecoder object for the audio supplied by \c decoder
+/// @note \c decoder must not be used by the caller after this method returns
+/// @param decoder The decoder supplying the audio, which is opened if necessary
+/// @param ringBufferSize The desired minimum ring buffer size, in frames
+/// @param maximumReaderCount The maximum number of simultaneous readers
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return An initialized \c SFBFanOutDecoder object or \c nil on failure
+- (nullable instancetype)initWithDecoder:(id <SFBPCMDecoding>)decoder ringBufferSize:(uint32_t)ringBufferSize maximumReaderCount:(NSUInteger)maximumReaderCount error:(NSError **)error NS_DESIGNATED_INITIALIZER;
+
+/// Returns the decoder supplying the audio
+@property (nonatomic, readonly) id <SFBPCMDecoding> decoder;
+/// Returns the format of the audio supplied to readers
+@property (nonatomic, readonly) AVAudioFormat *processingFormat;
+
+/// Adds a reader
+/// @param delay The number of frames of silence preceding the decoded audio
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A reader or \c nil on failure
+- (nullable SFBFanOutReader *)addReaderWithDelay:(AVAudioFrameCount)delay error:(NSError **)error NS_SWIFT_NAME(addReader(delay:));
+
+/// Returns the number of attached readers
+@property (nonatomic, readonly) NSUInteger readerCount;
+/// Returns the number of readers dropped for stalling decoding
+@property (nonatomic, readonly) NSUInteger droppedReaderCount;
+
+/// The policy for handling a reader that stops reading
+/// @note The default value is \c SFBFanOutDecoderStallPolicyDrop
+@property (nonatomic) SFBFanOutDecoderStallPolicy stallPolicy;
+/// The time decoding may be prevented by a reader before the reader is dropped, in seconds
+/// @note The default value is \c 2
+@property (nonatomic) NSTimeInterval stallTimeout;
+
+@end
+
+#pragma mark - Error Information
+
+/// The \c NSErrorDomain used by \c SFBFanOutDecoder and \c SFBFanOutReader
+extern NSErrorDomain const SFBFanOutDecoderErrorDomain NS_SWIFT_NAME(FanOutDecoder.ErrorDomain);
+
+/// Possible \c NSError error codes used by \c SFBFanOutDecoder and \c SFBFanOutReader
+typedef NS_ERROR_ENUM(SFBFanOutDecoderErrorDomain, SFBFanOutDecoderErrorCode) {
+	/// Format not supported
+	SFBFanOutDecoderErrorFormatNotSupported	= 0,
+	/// The maximum number of readers are attached
+	SFBFanOutDecoderErrorTooManyReaders		= 1,
+	/// The reader was dropped for stalling decoding
+	SFBFanOutDecoderErrorReaderDropped		= 2
+} NS_SWIFT_NAME(FanOutDecoder.ErrorCode);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,546 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <algorithm>
+#import <chrono>
+#import <condition_variable>
+#import <memory>
+#import <mutex>
+#import <thread>
+#import <vector>
+
+#import <os/log.h>
+
+#import "SFBFanOutDecoder.h"
+
+#import "SFBAudioDecoder.h"
+#import "SFBAudioDecoder+Internal.h"
+#import "SFBMultiReaderRingBuffer.hpp"
+#import "SFBPCMConverter.hpp"
+
+NSErrorDomain const SFBFanOutDecoderErrorDomain = @"org.sbooth.AudioEngine.FanOutDecoder";
+
+namespace {
+
+/// The default ring buffer size, in frames
+constexpr uint32_t kDefaultRingBufferSize = 65536;
+/// The default maximum number of simultaneous readers
+constexpr NSUInteger kDefaultMaximumReaderCount = 8;
+/// The maximum number of frames decoded at once
+constexpr AVAudioFrameCount kDecodingChunkSize = 4096;
+/// The interval at which a stalled decoding thread checks the stall timeout
+constexpr std::chrono::milliseconds kStallCheckInterval{100};
+
+/// State shared between a fan-out decoder, its readers, and its decoding thread
+///
+/// Readers and the decoding thread hold a reference to this state so readers remain usable after the fan-out decoder
+/// is deallocated; in that case they supply the audio already decoded and then end.
+struct FanOutState
+{
+	/// The lock protecting all members
+	std::mutex mLock;
+	/// Signaled when space may have become available for writing or decoding may begin
+	std::condition_variable mWriterCondition;
+	/// Signaled when audio may have become available for reading
+	std::condition_variable mReaderCondition;
+
+	/// The decoded audio
+	SFB::MultiReaderRingBuffer mRingBuffer;
+	/// The generation of each reader index, incremented when a reader is attached or detached
+	///
+	/// A reader whose generation differs from the current generation of its index has been dropped.
+	std::vector<uint64_t> mGenerations;
+
+	/// The decoder supplying the audio
+	id <SFBPCMDecoding> mDecoder;
+	/// Converts audio from the decoder to deinterleaved 32-bit floating point
+	SFB::PCMConverter mConverter;
+	/// The buffer receiving audio from the decoder
+	AVAudioPCMBuffer *mDecodeBuffer;
+	/// The buffer receiving converted audio
+	AVAudioPCMBuffer *mConvertedBuffer;
+
+	/// The policy for handling stalled readers
+	SFBFanOutDecoderStallPolicy mStallPolicy;
+	/// The time decoding may be stalled before a reader is dropped
+	NSTimeInterval mStallTimeout;
+	/// The number of readers dropped for stalling decoding
+	NSUInteger mDroppedReaderCount;
+
+	/// Set when a reader first requests audio
+	bool mStarted;
+	/// Set when the decoder has no more audio
+	bool mFinished;
+	/// Set to stop the decoding thread
+	bool mStop;
+	/// The error that ended decoding, if any
+	NSError *mError;
+};
+
+/// Drops attached readers whose read position has not advanced since decoding stalled
+/// @param stallPositions The read position of each reader when decoding stalled
+void DropStalledReaders(FanOutState& state, const std::vector<uint64_t>& stallPositions) noexcept
+{
+	auto& ringBuffer = state.mRingBuffer;
+	const auto readerCount = static_cast<int>(ringBuffer.MaximumReaderCount());
+
+	// Only the readers holding back the writer are dropped
+	uint64_t minimumReadPosition = ringBuffer.WritePosition();
+	for(int i = 0; i < readerCount; ++i) {
+		if(ringBuffer.IsAttached(i))
+			minimumReadPosition = std::min(minimumReadPosition, ringBuffer.ReadPosition(i));
+	}
+
+	for(int i = 0; i < readerCount; ++i) {
+		if(ringBuffer.IsAttached(i) && ringBuffer.ReadPosition(i) == minimumReadPosition && ringBuffer.ReadPosition(i) == stallPositions[i]) {
+			os_log_info(gSFBAudioDecoderLog, "Dropping stalled fan-out reader %d", i);
+			ringBuffer.DetachReader(i);
+			++state.mGenerations[i];
+			++state.mDroppedReaderCount;
+		}
+	}
+
+	state.mReaderCondition.notify_all();
+}
+
+void DecodingThreadEntry(std::shared_ptr<FanOutState> state)
+{
+	pthread_setname_np("org.sbooth.AudioEngine.FanOutDecoder.DecodingThread");
+	pthread_set_qos_class_self_np(QOS_CLASS_USER_INITIATED, 0);
+
+	os_log_debug(gSFBAudioDecoderLog, "Fan-out decoding thread starting");
+
+	auto& ringBuffer = state->mRingBuffer;
+	const auto chunkSize = std::min(kDecodingChunkSize, ringBuffer.CapacityFrames() / 2);
+
+	std::vector<uint64_t> stallPositions(ringBuffer.MaximumReaderCount());
+	auto stallStart = std::chrono::steady_clock::time_point::max();
+
+	std::unique_lock<std::mutex> lock(state->mLock);
+	while(!state->mStop) {
+		// Wait for a reader to request audio
+		if(!state->mStarted || ringBuffer.AttachedReaderCount() == 0) {
+			stallStart = std::chrono::steady_clock::time_point::max();
+			state->mWriterCondition.wait(lock);
+			continue;
+		}
+
+		// Wait for the slowest reader to make space available
+		const auto framesAvailableToWrite = ringBuffer.FramesAvailableToWrite();
+		if(framesAvailableToWrite < chunkSize) {
+			const auto now = std::chrono::steady_clock::now();
+			if(stallStart == std::chrono::steady_clock::time_point::max()) {
+				stallStart = now;
+				for(size_t i = 0; i < stallPositions.size(); ++i)
+					stallPositions[i] = ringBuffer.ReadPosition(static_cast<int>(i));
+			}
+			else if(state->mStallPolicy == SFBFanOutDecoderStallPolicyDrop && std::chrono::duration<double>(now - stallStart).count() >= state->mStallTimeout) {
+				DropStalledReaders(*state, stallPositions);
+				stallStart = std::chrono::steady_clock::time_point::max();
+				continue;
+			}
+
+			state->mWriterCondition.wait_for(lock, kStallCheckInterval);
+			continue;
+		}
+
+		stallStart = std::chrono::steady_clock::time_point::max();
+
+		// Decode without holding the lock so readers may continue reading
+		lock.unlock();
+
+		NSError *error = nil;
+		AVAudioFrameCount framesDecoded = 0;
+		@autoreleasepool {
+			if([state->mDecoder decodeIntoBuffer:state->mDecodeBuffer frameLength:std::min(framesAvailableToWrite, chunkSize) error:&error]) {
+				framesDecoded = state->mDecodeBuffer.frameLength;
+				state->mConvertedBuffer.frameLength = state->mConverter.Convert(state->mDecodeBuffer.audioBufferList, state->mConvertedBuffer.mutableAudioBufferList, framesDecoded);
+			}
+			else
+				os_log_error(gSFBAudioDecoderLog, "Error decoding audio for fan-out: %{public}@", error);
+		}
+
+		lock.lock();
+
+		if(framesDecoded == 0) {
+			state->mFinished = true;
+			state->mError = error;
+			state->mReaderCondition.notify_all();
+			break;
+		}
+
+		// Space only increases while the lock is not held so the decoded audio fits
+		ringBuffer.Write(state->mConvertedBuffer.floatChannelData, state->mConvertedBuffer.frameLength);
+		state->mReaderCondition.notify_all();
+	}
+
+	os_log_debug(gSFBAudioDecoderLog, "Fan-out decoding thread terminating");
+}
+
+} // namespace
+
+#pragma mark - SFBFanOutReader
+
+@interface SFBFanOutReader ()
+{
+@private
+	/// The shared state
+	std::shared_ptr<FanOutState> _state;
+	/// The index of this reader in the ring buffer or \c -1 if closed
+	int _reader;
+	/// The generation of \c _reader when this reader was attached
+	uint64_t _generation;
+	/// The format of the decoded audio
+	AVAudioFormat *_processingFormat;
+	/// The current frame position
+	AVAudioFramePosition _framePosition;
+	/// The total number of frames or \c SFBUnknownFrameLength
+	AVAudioFramePosition _frameLength;
+}
+- (instancetype)initWithState:(std::shared_ptr<FanOutState>)state reader:(int)reader generation:(uint64_t)generation processingFormat:(AVAudioFormat *)processingFormat delay:(AVAudioFrameCount)delay;
+@end
+
+@implementation SFBFanOutReader
+
+- (instancetype)initWithState:(std::shared_ptr<FanOutState>)state reader:(int)reader generation:(uint64_t)generation processingFormat:(AVAudioFormat *)processingFormat delay:(AVAudioFrameCount)delay
+{
+	NSParameterAssert(state != nullptr);
+
+	if((self = [super init])) {
+		_state = state;
+		_reader = reader;
+		_generation = generation;
+		_processingFormat = processingFormat;
+		_delay = delay;
+		const auto frameLength = _state->mDecoder.frameLength;
+		_frameLength = frameLength == SFBUnknownFrameLength ? SFBUnknownFrameLength : frameLength + delay;
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	[self closeReturningError:nil];
+}
+
+- (SFBInputSource *)inputSource
+{
+	return _state->mDecoder.inputSource;
+}
+
+- (AVAudioFormat *)sourceFormat
+{
+	return _state->mDecoder.sourceFormat;
+}
+
+- (AVAudioFormat *)processingFormat
+{
+	return _processingFormat;
+}
+
+- (BOOL)decodingIsLossless
+{
+	return _state->mDecoder.decodingIsLossless;
+}
+
+- (BOOL)openReturningError:(NSError **)error
+{
+	// Readers are attached when created
+	return YES;
+}
+
+- (BOOL)closeReturningError:(NSError **)error
+{
+	if(!_state || _reader < 0)
+		return YES;
+
+	std::lock_guard<std::mutex> lock(_state->mLock);
+	// A dropped reader's index may have been reused
+	if(_state->mGenerations[_reader] == _generation) {
+		_state->mRingBuffer.DetachReader(_reader);
+		++_state->mGenerations[_reader];
+		_state->mWriterCondition.notify_all();
+	}
+	_reader = -1;
+
+	return YES;
+}
+
+- (BOOL)isOpen
+{
+	return _reader >= 0;
+}
+
+- (AVAudioFramePosition)framePosition
+{
+	return _framePosition;
+}
+
+- (AVAudioFramePosition)frameLength
+{
+	return _frameLength;
+}
+
+- (BOOL)wasDropped
+{
+	std::lock_guard<std::mutex> lock(_state->mLock);
+	return _reader >= 0 && _state->mGenerations[_reader] != _generation ? YES : NO;
+}
+
+- (BOOL)decodeIntoBuffer:(AVAudioBuffer *)buffer error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer isKindOfClass:[AVAudioPCMBuffer class]]);
+	return [self decodeIntoBuffer:(AVAudioPCMBuffer *)buffer frameLength:((AVAudioPCMBuffer *)buffer).frameCapacity error:error];
+}
+
+- (BOOL)decodeIntoBuffer:(AVAudioPCMBuffer *)buffer frameLength:(AVAudioFrameCount)frameLength error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer.format isEqual:_processingFormat]);
+
+	// Reset output buffer data size
+	buffer.frameLength = 0;
+
+	if(frameLength > buffer.frameCapacity)
+		frameLength = buffer.frameCapacity;
+
+	if(frameLength == 0 || _reader < 0)
+		return YES;
+
+	float * const *floatChannelData = buffer.floatChannelData;
+	const auto channelCount = buffer.format.channelCount;
+
+	// Supply the leading silence
+	AVAudioFrameCount framesRead = 0;
+	if(_framePosition < _delay) {
+		framesRead = static_cast<AVAudioFrameCount>(std::min(static_cast<AVAudioFramePosition>(frameLength), _delay - _framePosition));
+		for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel)
+			std::fill_n(floatChannelData[channel], framesRead, 0.f);
+	}
+
+	if(framesRead < frameLength) {
+		auto& state = *_state;
+		std::unique_lock<std::mutex> lock(state.mLock);
+
+		if(!state.mStarted) {
+			state.mStarted = true;
+			state.mWriterCondition.notify_all();
+		}
+
+		// Wait for audio only if no silence was supplied
+		if(framesRead == 0)
+			state.mReaderCondition.wait(lock, [&state, reader = _reader, generation = _generation] {
+				return state.mGenerations[reader] != generation || state.mRingBuffer.FramesAvailableToRead(reader) > 0 || state.mFinished || state.mStop;
+			});
+
+		if(state.mGenerations[_reader] != _generation) {
+			if(error)
+				*error = [NSError errorWithDomain:SFBFanOutDecoderErrorDomain code:SFBFanOutDecoderErrorReaderDropped userInfo:nil];
+			return NO;
+		}
+
+		const auto framesAvailable = state.mRingBuffer.FramesAvailableToRead(_reader);
+		if(framesAvailable == 0 && framesRead == 0 && state.mError) {
+			if(error)
+				*error = state.mError;
+			return NO;
+		}
+
+		framesRead += state.mRingBuffer.Read(_reader, floatChannelData, framesRead, frameLength - framesRead);
+		state.mWriterCondition.notify_all();
+	}
+
+	_framePosition += framesRead;
+	buffer.frameLength = framesRead;
+
+	return YES;
+}
+
+- (BOOL)supportsSeeking
+{
+	return NO;
+}
+
+- (BOOL)seekToFrame:(AVAudioFramePosition)frame error:(NSError **)error
+{
+	return NO;
+}
+
+@end
+
+#pragma mark - SFBFanOutDecoder
+
+@interface SFBFanOutDecoder ()
+{
+@private
+	/// State shared with the readers and the decoding thread
+	std::shared_ptr<FanOutState> _state;
+	/// The decoding thread
+	std::thread _decodingThread;
+}
+@end
+
+@implementation SFBFanOutDecoder
+
+- (instancetype)initWithURL:(NSURL *)url error:(NSError **)error
+{
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
+	if(!decoder)
+		return nil;
+	return [self initWithDecoder:decoder error:error];
+}
+
+- (instancetype)initWithDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error
+{
+	return [self initWithDecoder:decoder ringBufferSize:kDefaultRingBufferSize maximumReaderCount:kDefaultMaximumReaderCount error:error];
+}
+
+- (instancetype)initWithDecoder:(id <SFBPCMDecoding>)decoder ringBufferSize:(uint32_t)ringBufferSize maximumReaderCount:(NSUInteger)maximumReaderCount error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+	NSParameterAssert(maximumReaderCount > 0);
+
+	if((self = [super init])) {
+		if(!decoder.isOpen && ![decoder openReturningError:error])
+			return nil;
+
+		AVAudioFormat *decoderFormat = decoder.processingFormat;
+		if(decoderFormat.channelLayout)
+			_processingFormat = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:decoderFormat.sampleRate channelLayout:decoderFormat.channelLayout];
+		else
+			_processingFormat = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:decoderFormat.sampleRate channels:decoderFormat.channelCount];
+
+		try {
+			_state = std::make_shared<FanOutState>();
+			_state->mGenerations.assign(maximumReaderCount, 0);
+		}
+
+		catch(const std::exception& e) {
+			os_log_error(gSFBAudioDecoderLog, "Unable to allocate fan-out state: %{public}s", e.what());
+			if(error)
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+			return nil;
+		}
+
+		if(!_processingFormat || !_state->mConverter.Configure(*decoderFormat.streamDescription, *_processingFormat.streamDescription)) {
+			os_log_error(gSFBAudioDecoderLog, "Unsupported fan-out decoder format: %{public}@", decoderFormat);
+			if(error)
+				*error = [NSError errorWithDomain:SFBFanOutDecoderErrorDomain code:SFBFanOutDecoderErrorFormatNotSupported userInfo:nil];
+			return nil;
+		}
+
+		_state->mDecoder = decoder;
+		_state->mDecodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:decoderFormat frameCapacity:kDecodingChunkSize];
+		_state->mConvertedBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_processingFormat frameCapacity:kDecodingChunkSize];
+		if(!_state->mDecodeBuffer || !_state->mConvertedBuffer || !_state->mRingBuffer.Allocate(_processingFormat.channelCount, std::max(ringBufferSize, 2 * kDecodingChunkSize), static_cast<uint32_t>(maximumReaderCount))) {
+			os_log_error(gSFBAudioDecoderLog, "Unable to allocate fan-out buffers");
+			if(error)
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+			return nil;
+		}
+
+		_state->mStallPolicy = SFBFanOutDecoderStallPolicyDrop;
+		_state->mStallTimeout = 2;
+		_state->mDroppedReaderCount = 0;
+		_state->mStarted = false;
+		_state->mFinished = false;
+		_state->mStop = false;
+
+		try {
+			_decodingThread = std::thread(DecodingThreadEntry, _state);
+		}
+
+		catch(const std::exception& e) {
+			os_log_error(gSFBAudioDecoderLog, "Unable to create fan-out decoding thread: %{public}s", e.what());
+			if(error)
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+			return nil;
+		}
+	}
+	return self;
+}
+
+- (void)dealloc
+{
+	if(!_state)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(_state->mLock);
+		_state->mStop = true;
+		_state->mWriterCondition.notify_all();
+		_state->mReaderCondition.notify_all();
+	}
+
+	if(_decodingThread.joinable())
+		_decodingThread.join();
+}
+
+- (id <SFBPCMDecoding>)decoder
+{
+	return _state->mDecoder;
+}
+
+- (SFBFanOutReader *)addReaderWithDelay:(AVAudioFrameCount)delay error:(NSError **)error
+{
+	int reader;
+	uint64_t generation = 0;
+	{
+		std::lock_guard<std::mutex> lock(_state->mLock);
+		reader = _state->mRingBuffer.AttachReader();
+		if(reader >= 0)
+			generation = ++_state->mGenerations[reader];
+	}
+
+	if(reader < 0) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBFanOutDecoderErrorDomain code:SFBFanOutDecoderErrorTooManyReaders userInfo:nil];
+		return nil;
+	}
+
+	return [[SFBFanOutReader alloc] initWithState:_state reader:reader generation:generation processingFormat:_processingFormat delay:delay];
+}
+
+- (NSUInteger)readerCount
+{
+	std::lock_guard<std::mutex> lock(_state->mLock);
+	return _state->mRingBuffer.AttachedReaderCount();
+}
+
+- (NSUInteger)droppedReaderCount
+{
+	std::lock_guard<std::mutex> lock(_state->mLock);
+	return _state->mDroppedReaderCount;
+}
+
+- (SFBFanOutDecoderStallPolicy)stallPolicy
+{
+	std::lock_guard<std::mutex> lock(_state->mLock);
+	return _state->mStallPolicy;
+}
+
+- (void)setStallPolicy:(SFBFanOutDecoderStallPolicy)stallPolicy
+{
+	std::lock_guard<std::mutex> lock(_state->mLock);
+	_state->mStallPolicy = stallPolicy;
+	_state->mWriterCondition.notify_all();
+}
+
+- (NSTimeInterval)stallTimeout
+{
+	std::lock_guard<std::mutex> lock(_state->mLock);
+	return _state->mStallTimeout;
+}
+
+- (void)setStallTimeout:(NSTimeInterval)stallTimeout
+{
+	std::lock_guard<std::mutex> lock(_state->mLock);
+	_state->mStallTimeout = stallTimeout;
+	_state->mWriterCondition.notify_all();
+}
+
+@end
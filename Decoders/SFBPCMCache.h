@@ -0,0 +1,95 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <SFBAudioEngine/SFBPCMDecoding.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Statistics for \c SFBPCMCache
+struct SFBPCMCacheStatistics {
+	/// The number of requests satisfied with cached audio
+	uint64_t hitCount;
+	/// The number of requests requiring audio to be decoded
+	uint64_t missCount;
+	/// The number of entries removed to remain within the byte budget
+	uint64_t evictionCount;
+	/// The number of entries in the cache
+	NSUInteger entryCount;
+	/// The number of bytes used by cached audio
+	NSUInteger byteCount;
+};
+typedef struct SFBPCMCacheStatistics SFBPCMCacheStatistics;
+
+/// A decoder supplying audio held by an \c SFBPCMCache
+///
+/// Decoding copies cached audio without performing any decoding work and seeking is a constant time operation.
+NS_SWIFT_NAME(CachedDecoder) @interface SFBCachedDecoder : NSObject <SFBPCMDecoding>
+
++ (instancetype)new NS_UNAVAILABLE;
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+/// An in-memory cache of decoded audio for files played repeatedly
+///
+/// Entries are identified by URL, file identity, modification time, and processing format, so modifying or
+/// replacing a file invalidates its entry. When the audio held by the cache exceeds the byte budget the least
+/// recently used entries are removed. Decoders created from an entry remain usable after the entry is removed.
+///
+/// Audio is stored as 32-bit floating point samples in blocks of 4096 frames. If \c compressionEnabled is \c YES
+/// blocks are compressed losslessly when doing so saves space, at the cost of decompressing each block as it is read.
+///
+/// This class is thread safe.
+NS_SWIFT_NAME(PCMCache) @interface SFBPCMCache : NSObject
+
+/// Returns a shared cache with the default byte budget
+@property (class, nonatomic, readonly) SFBPCMCache *sharedCache;
+
+/// Returns an initialized \c SFBPCMCache object with a byte budget of 32 MB
+- (instancetype)init;
+/// Returns an initialized \c SFBPCMCache object
+/// @param byteBudget The maximum number of bytes of audio to retain
+/// @return An initialized \c SFBPCMCache object
+- (instancetype)initWithByteBudget:(NSUInteger)byteBudget NS_DESIGNATED_INITIALIZER;
+
+/// The maximum number of bytes of audio to retain
+/// @note Reducing the byte budget removes entries as necessary
+@property (nonatomic) NSUInteger byteBudget;
+/// Set to \c YES to compress cached audio
+/// @note The default value is \c NO
+/// @note Changes take effect for subsequently cached audio
+@property (nonatomic) BOOL compressionEnabled;
+
+/// Returns a decoder supplying the audio in \c url
+/// @note This is equivalent to \c -decoderForURL:processingFormat:error: with a \c nil processing format
+/// @param url The URL
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A decoder or \c nil on failure
+- (nullable id <SFBPCMDecoding>)decoderForURL:(NSURL *)url error:(NSError **)error NS_SWIFT_NAME(decoder(for:));
+/// Returns a decoder supplying the audio in \c url in the specified format
+///
+/// If the audio is not cached it is decoded in its entirety before this method returns. Audio that is not in a local
+/// file or that exceeds the byte budget is not cached; in that case an \c SFBAudioDecoder for \c url is returned.
+/// @param url The URL
+/// @param processingFormat The deinterleaved 32-bit floating point format of the decoded audio, or \c nil to use the
+/// decoder's sample rate and channel layout
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return A decoder or \c nil on failure
+- (nullable id <SFBPCMDecoding>)decoderForURL:(NSURL *)url processingFormat:(nullable AVAudioFormat *)processingFormat error:(NSError **)error NS_SWIFT_NAME(decoder(for:processingFormat:));
+
+/// Removes all entries for \c url
+- (void)removeAudioForURL:(NSURL *)url NS_SWIFT_NAME(removeAudio(for:));
+/// Removes all entries
+- (void)removeAllAudio;
+
+/// Returns a snapshot of the cache statistics
+@property (nonatomic, readonly) SFBPCMCacheStatistics statistics;
+/// Resets the hit, miss, and eviction counts
+- (void)resetStatistics;
+
+@end
+
+NS_ASSUME_NONNULL_END
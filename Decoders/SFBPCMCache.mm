@@ -0,0 +1,710 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <sys/stat.h>
+
+#import <algorithm>
+#import <cstring>
+#import <list>
+#import <memory>
+#import <mutex>
+#import <string>
+#import <unordered_map>
+#import <vector>
+
+#import <os/log.h>
+
+#import "SFBPCMCache.h"
+
+#import "SFBAudioDecoder+Internal.h"
+
+namespace {
+
+/// The number of frames in each cached block
+constexpr AVAudioFrameCount kBlockFrameCount = 4096;
+/// The default maximum number of bytes of audio to retain
+constexpr NSUInteger kDefaultByteBudget = 32 * 1024 * 1024;
+
+#pragma mark - Block Compression
+
+/// Compresses \c frameCount samples losslessly into \c output
+///
+/// The bytes of the samples are separated into planes, grouping the low-order mantissa bytes that are zero for audio
+/// originating as 16- or 24-bit integers, and the planes are run-length encoded. A header byte \c n from \c 0 to \c 127
+/// precedes \c n \c + \c 1 literal bytes and a header byte \c n from \c 129 to \c 255 precedes one byte repeated
+/// \c 257 \c - \c n times.
+/// @param planes Scratch space for the byte planes
+/// @return \c true if the compressed samples are smaller than the uncompressed samples
+bool CompressSamples(const float *samples, AVAudioFrameCount frameCount, std::vector<uint8_t>& planes, std::vector<uint8_t>& output)
+{
+	const size_t byteCount = frameCount * sizeof(float);
+	planes.resize(byteCount);
+	const auto bytes = reinterpret_cast<const uint8_t *>(samples);
+	for(AVAudioFrameCount frame = 0; frame < frameCount; ++frame) {
+		for(size_t plane = 0; plane < sizeof(float); ++plane)
+			planes[plane * frameCount + frame] = bytes[frame * sizeof(float) + plane];
+	}
+
+	output.clear();
+	output.reserve(byteCount);
+
+	size_t i = 0;
+	while(i < byteCount) {
+		size_t runLength = 1;
+		while(i + runLength < byteCount && runLength < 128 && planes[i + runLength] == planes[i])
+			++runLength;
+
+		if(runLength > 1) {
+			output.push_back(static_cast<uint8_t>(257 - runLength));
+			output.push_back(planes[i]);
+			i += runLength;
+		}
+		else {
+			// Literal bytes continue until a run begins
+			size_t literalCount = 1;
+			while(i + literalCount < byteCount && literalCount < 128 && !(i + literalCount + 1 < byteCount && planes[i + literalCount] == planes[i + literalCount + 1]))
+				++literalCount;
+			output.push_back(static_cast<uint8_t>(literalCount - 1));
+			output.insert(output.end(), planes.begin() + i, planes.begin() + i + literalCount);
+			i += literalCount;
+		}
+
+		if(output.size() >= byteCount)
+			return false;
+	}
+
+	return true;
+}
+
+/// Decompresses \c frameCount samples compressed by \c CompressSamples() into \c samples
+/// @param planes Scratch space for the byte planes, which must hold at least \c frameCount samples
+void DecompressSamples(const std::vector<uint8_t>& input, AVAudioFrameCount frameCount, std::vector<uint8_t>& planes, float *samples) noexcept
+{
+	const size_t byteCount = frameCount * sizeof(float);
+
+	size_t in = 0;
+	size_t out = 0;
+	while(in < input.size() && out < byteCount) {
+		const auto header = input[in++];
+		if(header < 128) {
+			const size_t count = std::min(static_cast<size_t>(header) + 1, byteCount - out);
+			std::memcpy(planes.data() + out, input.data() + in, count);
+			in += static_cast<size_t>(header) + 1;
+			out += count;
+		}
+		else {
+			const size_t count = std::min(static_cast<size_t>(257 - header), byteCount - out);
+			std::memset(planes.data() + out, input[in++], count);
+			out += count;
+		}
+	}
+
+	auto bytes = reinterpret_cast<uint8_t *>(samples);
+	for(AVAudioFrameCount frame = 0; frame < frameCount; ++frame) {
+		for(size_t plane = 0; plane < sizeof(float); ++plane)
+			bytes[frame * sizeof(float) + plane] = planes[plane * frameCount + frame];
+	}
+}
+
+#pragma mark - Cached Audio
+
+/// The samples for one channel of a block of cached audio
+struct CachedSamples
+{
+	/// Whether \c mBytes holds compressed samples
+	bool mIsCompressed;
+	/// The samples
+	std::vector<uint8_t> mBytes;
+};
+
+/// A block of cached audio
+struct CachedBlock
+{
+	/// The number of frames in the block
+	AVAudioFrameCount mFrameCount;
+	/// The samples for each channel
+	std::vector<CachedSamples> mChannels;
+};
+
+/// Decoded audio held by a cache entry
+///
+/// Instances are immutable once created and are shared by the cache and the decoders created from it
+struct CachedAudio
+{
+	/// The URL of the encoded audio
+	NSURL *mURL;
+	/// The format of the encoded audio
+	AVAudioFormat *mSourceFormat;
+	/// The format of the cached audio
+	AVAudioFormat *mProcessingFormat;
+	/// Whether the cached audio allows the original signal to be perfectly reconstructed
+	bool mIsLossless;
+	/// The number of frames of cached audio
+	AVAudioFramePosition mFrameLength;
+	/// The blocks of cached audio, each containing \c kBlockFrameCount frames except the last
+	std::vector<CachedBlock> mBlocks;
+	/// The number of bytes used by \c mBlocks
+	size_t mByteCount;
+};
+
+/// Appends the audio in \c buffer to \c audio as a new block
+void AppendBlock(CachedAudio& audio, AVAudioPCMBuffer *buffer, bool compress, std::vector<uint8_t>& planes)
+{
+	const auto channelCount = buffer.format.channelCount;
+	const auto frameCount = buffer.frameLength;
+
+	CachedBlock block{ frameCount, std::vector<CachedSamples>(channelCount) };
+	for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel) {
+		const float *samples = buffer.floatChannelData[channel];
+		auto& cachedSamples = block.mChannels[channel];
+		cachedSamples.mIsCompressed = compress && CompressSamples(samples, frameCount, planes, cachedSamples.mBytes);
+		if(cachedSamples.mIsCompressed)
+			cachedSamples.mBytes.shrink_to_fit();
+		else {
+			const auto bytes = reinterpret_cast<const uint8_t *>(samples);
+			cachedSamples.mBytes.assign(bytes, bytes + frameCount * sizeof(float));
+		}
+		audio.mByteCount += cachedSamples.mBytes.size();
+	}
+
+	audio.mBlocks.push_back(std::move(block));
+	audio.mFrameLength += frameCount;
+}
+
+/// Decodes all audio from \c decoder, converting it to \c format
+/// @param byteLimit The maximum number of bytes of audio to retain
+/// @param tooLarge Set to \c true if the audio exceeds \c byteLimit
+/// @return The decoded audio or \c nullptr on error or if the audio exceeds \c byteLimit
+std::shared_ptr<CachedAudio> DecodeAllAudio(id <SFBPCMDecoding> decoder, AVAudioFormat *format, bool compress, size_t byteLimit, bool& tooLarge, NSError **error)
+{
+	tooLarge = false;
+
+	AVAudioFormat *decoderFormat = decoder.processingFormat;
+
+	// Avoid decoding audio that won't fit
+	if(decoder.frameLength > 0) {
+		const auto estimatedFrameLength = decoder.frameLength * (format.sampleRate / decoderFormat.sampleRate);
+		if(!compress && estimatedFrameLength * format.channelCount * sizeof(float) > byteLimit) {
+			tooLarge = true;
+			return nullptr;
+		}
+	}
+
+	AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format frameCapacity:kBlockFrameCount];
+	AVAudioPCMBuffer *decodeBuffer = nil;
+	AVAudioConverter *converter = nil;
+	if(![decoderFormat isEqual:format]) {
+		decodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:decoderFormat frameCapacity:kBlockFrameCount];
+		converter = [[AVAudioConverter alloc] initFromFormat:decoderFormat toFormat:format];
+		if(!decodeBuffer || !converter) {
+			os_log_error(gSFBAudioDecoderLog, "Unable to create converter from %{public}@ to %{public}@", decoderFormat, format);
+			if(error)
+				*error = [NSError errorWithDomain:SFBAudioDecoderErrorDomain code:SFBAudioDecoderErrorCodeInvalidFormat userInfo:nil];
+			return nullptr;
+		}
+	}
+
+	if(!buffer) {
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return nullptr;
+	}
+
+	try {
+		auto audio = std::make_shared<CachedAudio>();
+		audio->mURL = decoder.inputSource.url;
+		audio->mSourceFormat = decoder.sourceFormat;
+		audio->mProcessingFormat = format;
+		audio->mIsLossless = decoder.decodingIsLossless && format.sampleRate == decoderFormat.sampleRate && format.channelCount == decoderFormat.channelCount;
+		audio->mFrameLength = 0;
+		audio->mByteCount = 0;
+
+		std::vector<uint8_t> planes;
+
+		__block NSError *decodeError = nil;
+		__block BOOL endOfInput = NO;
+
+		for(;;) {
+			if(!converter) {
+				if(![decoder decodeIntoBuffer:buffer frameLength:kBlockFrameCount error:error])
+					return nullptr;
+			}
+			else {
+				AVAudioConverterOutputStatus status = [converter convertToBuffer:buffer error:error withInputFromBlock:^AVAudioBuffer *(AVAudioPacketCount inNumberOfPackets, AVAudioConverterInputStatus *outStatus) {
+					if(endOfInput || ![decoder decodeIntoBuffer:decodeBuffer frameLength:std::min(inNumberOfPackets, kBlockFrameCount) error:&decodeError] || decodeBuffer.frameLength == 0) {
+						endOfInput = YES;
+						*outStatus = AVAudioConverterInputStatus_EndOfStream;
+						return nil;
+					}
+					*outStatus = AVAudioConverterInputStatus_HaveData;
+					return decodeBuffer;
+				}];
+
+				if(decodeError) {
+					if(error)
+						*error = decodeError;
+					return nullptr;
+				}
+
+				if(status == AVAudioConverterOutputStatus_Error)
+					return nullptr;
+			}
+
+			if(buffer.frameLength == 0)
+				break;
+
+			AppendBlock(*audio, buffer, compress, planes);
+			if(audio->mByteCount > byteLimit) {
+				tooLarge = true;
+				return nullptr;
+			}
+		}
+
+		return audio;
+	}
+
+	catch(const std::exception& e) {
+		os_log_error(gSFBAudioDecoderLog, "Error caching decoded audio: %{public}s", e.what());
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return nullptr;
+	}
+}
+
+/// Returns a string identifying the contents of the file at \c url converted to \c format or an empty string if \c url is not a local file
+std::string CacheKey(NSURL *url, AVAudioFormat *format)
+{
+	if(!url.isFileURL)
+		return {};
+
+	struct stat s;
+	if(stat(url.fileSystemRepresentation, &s) != 0)
+		return {};
+
+	NSString *formatKey = @"native";
+	if(format)
+		formatKey = [NSString stringWithFormat:@"%g:%u:%u", format.sampleRate, format.channelCount, format.channelLayout ? format.channelLayout.layoutTag : 0];
+
+	// The device, inode, modification time, and size identify a particular version of a file
+	NSString *key = [NSString stringWithFormat:@"%@|%d:%llu|%ld.%09ld|%lld|%@", url.URLByStandardizingPath.path, s.st_dev, static_cast<unsigned long long>(s.st_ino), s.st_mtimespec.tv_sec, s.st_mtimespec.tv_nsec, s.st_size, formatKey];
+	return key.UTF8String;
+}
+
+/// An entry in an \c SFBPCMCache
+struct CacheEntry
+{
+	/// The key identifying the entry
+	std::string mKey;
+	/// The cached audio
+	std::shared_ptr<const CachedAudio> mAudio;
+};
+
+using CacheEntryList = std::list<CacheEntry>;
+
+} // namespace
+
+#pragma mark - SFBCachedDecoder
+
+@interface SFBCachedDecoder ()
+{
+@private
+	/// The cached audio
+	std::shared_ptr<const CachedAudio> _audio;
+	/// The input source for the cached audio's URL
+	SFBInputSource *_inputSource;
+	/// The current frame position
+	AVAudioFramePosition _framePosition;
+	/// Whether the decoder is open
+	BOOL _isOpen;
+	/// Decompressed samples for each channel
+	std::vector<float> _decompressedSamples;
+	/// The index of the block in \c _decompressedSamples for each channel
+	std::vector<size_t> _decompressedBlocks;
+	/// Scratch space for decompression
+	std::vector<uint8_t> _planes;
+}
+- (instancetype)initWithAudio:(std::shared_ptr<const CachedAudio>)audio;
+@end
+
+@implementation SFBCachedDecoder
+
+- (instancetype)initWithAudio:(std::shared_ptr<const CachedAudio>)audio
+{
+	NSParameterAssert(audio != nullptr);
+
+	if((self = [super init])) {
+		_audio = audio;
+		if(_audio->mURL)
+			_inputSource = [SFBInputSource inputSourceForURL:_audio->mURL flags:0 error:nil];
+		if(!_inputSource)
+			_inputSource = [SFBInputSource inputSourceWithData:[NSData data]];
+	}
+	return self;
+}
+
+- (SFBInputSource *)inputSource
+{
+	return _inputSource;
+}
+
+- (AVAudioFormat *)sourceFormat
+{
+	return _audio->mSourceFormat;
+}
+
+- (AVAudioFormat *)processingFormat
+{
+	return _audio->mProcessingFormat;
+}
+
+- (BOOL)decodingIsLossless
+{
+	return _audio->mIsLossless;
+}
+
+- (BOOL)openReturningError:(NSError **)error
+{
+	const auto channelCount = _audio->mProcessingFormat.channelCount;
+
+	try {
+		_decompressedSamples.assign(channelCount * kBlockFrameCount, 0);
+		_decompressedBlocks.assign(channelCount, SIZE_MAX);
+		_planes.assign(kBlockFrameCount * sizeof(float), 0);
+	}
+
+	catch(const std::exception& e) {
+		os_log_error(gSFBAudioDecoderLog, "Unable to allocate decompression buffers: %{public}s", e.what());
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return NO;
+	}
+
+	_isOpen = YES;
+	return YES;
+}
+
+- (BOOL)closeReturningError:(NSError **)error
+{
+	_decompressedSamples.clear();
+	_decompressedBlocks.clear();
+	_planes.clear();
+	_isOpen = NO;
+	return YES;
+}
+
+- (BOOL)isOpen
+{
+	return _isOpen;
+}
+
+- (AVAudioFramePosition)framePosition
+{
+	return _framePosition;
+}
+
+- (AVAudioFramePosition)frameLength
+{
+	return _audio->mFrameLength;
+}
+
+- (BOOL)decodeIntoBuffer:(AVAudioBuffer *)buffer error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer isKindOfClass:[AVAudioPCMBuffer class]]);
+	return [self decodeIntoBuffer:(AVAudioPCMBuffer *)buffer frameLength:((AVAudioPCMBuffer *)buffer).frameCapacity error:error];
+}
+
+- (BOOL)decodeIntoBuffer:(AVAudioPCMBuffer *)buffer frameLength:(AVAudioFrameCount)frameLength error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer.format isEqual:_audio->mProcessingFormat]);
+
+	// Reset output buffer data size
+	buffer.frameLength = 0;
+
+	if(frameLength > buffer.frameCapacity)
+		frameLength = buffer.frameCapacity;
+
+	const auto framesRemaining = std::max(_audio->mFrameLength - _framePosition, 0ll);
+	frameLength = static_cast<AVAudioFrameCount>(std::min(static_cast<AVAudioFramePosition>(frameLength), framesRemaining));
+
+	if(frameLength > 0 && !_isOpen) {
+		if(error)
+			*error = [NSError errorWithDomain:SFBAudioDecoderErrorDomain code:SFBAudioDecoderErrorCodeInternalError userInfo:nil];
+		return NO;
+	}
+
+	float * const *floatChannelData = buffer.floatChannelData;
+	const auto channelCount = buffer.format.channelCount;
+
+	AVAudioFrameCount framesRead = 0;
+	while(framesRead < frameLength) {
+		const auto blockIndex = static_cast<size_t>(_framePosition / kBlockFrameCount);
+		const auto blockOffset = static_cast<AVAudioFrameCount>(_framePosition % kBlockFrameCount);
+		const auto& block = _audio->mBlocks[blockIndex];
+		const auto framesToCopy = std::min(frameLength - framesRead, block.mFrameCount - blockOffset);
+
+		for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel) {
+			const auto& samples = block.mChannels[channel];
+			const float *source = reinterpret_cast<const float *>(samples.mBytes.data());
+			if(samples.mIsCompressed) {
+				float *decompressed = _decompressedSamples.data() + channel * kBlockFrameCount;
+				if(_decompressedBlocks[channel] != blockIndex) {
+					DecompressSamples(samples.mBytes, block.mFrameCount, _planes, decompressed);
+					_decompressedBlocks[channel] = blockIndex;
+				}
+				source = decompressed;
+			}
+			std::memcpy(floatChannelData[channel] + framesRead, source + blockOffset, framesToCopy * sizeof(float));
+		}
+
+		framesRead += framesToCopy;
+		_framePosition += framesToCopy;
+	}
+
+	buffer.frameLength = framesRead;
+
+	return YES;
+}
+
+- (BOOL)supportsSeeking
+{
+	return YES;
+}
+
+- (BOOL)seekToFrame:(AVAudioFramePosition)frame error:(NSError **)error
+{
+	NSParameterAssert(frame >= 0);
+
+	if(frame > _audio->mFrameLength)
+		return NO;
+
+	_framePosition = frame;
+	return YES;
+}
+
+@end
+
+#pragma mark - SFBPCMCache
+
+@interface SFBPCMCache ()
+{
+@private
+	/// The lock protecting all instance variables
+	std::mutex _lock;
+	/// Cache entries in order of decreasing recency of use
+	CacheEntryList _entries;
+	/// Cache entries indexed by key
+	std::unordered_map<std::string, CacheEntryList::iterator> _index;
+	/// The maximum number of bytes of audio to retain
+	NSUInteger _byteBudget;
+	/// The number of bytes of audio in \c _entries
+	NSUInteger _byteCount;
+	/// Whether audio is compressed when cached
+	BOOL _compressionEnabled;
+	/// The number of requests satisfied with cached audio
+	uint64_t _hitCount;
+	/// The number of requests requiring audio to be decoded
+	uint64_t _missCount;
+	/// The number of entries removed to remain within the byte budget
+	uint64_t _evictionCount;
+}
+- (void)evictEntries;
+- (void)removeEntry:(CacheEntryList::iterator)entry;
+@end
+
+@implementation SFBPCMCache
+
++ (SFBPCMCache *)sharedCache
+{
+	static SFBPCMCache *sharedCache = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		sharedCache = [[SFBPCMCache alloc] init];
+	});
+	return sharedCache;
+}
+
+- (instancetype)init
+{
+	return [self initWithByteBudget:kDefaultByteBudget];
+}
+
+- (instancetype)initWithByteBudget:(NSUInteger)byteBudget
+{
+	if((self = [super init]))
+		_byteBudget = byteBudget;
+	return self;
+}
+
+- (NSUInteger)byteBudget
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _byteBudget;
+}
+
+- (void)setByteBudget:(NSUInteger)byteBudget
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_byteBudget = byteBudget;
+	[self evictEntries];
+}
+
+- (BOOL)compressionEnabled
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return _compressionEnabled;
+}
+
+- (void)setCompressionEnabled:(BOOL)compressionEnabled
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_compressionEnabled = compressionEnabled;
+}
+
+- (id <SFBPCMDecoding>)decoderForURL:(NSURL *)url error:(NSError **)error
+{
+	return [self decoderForURL:url processingFormat:nil error:error];
+}
+
+- (id <SFBPCMDecoding>)decoderForURL:(NSURL *)url processingFormat:(AVAudioFormat *)processingFormat error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+	NSParameterAssert(processingFormat == nil || processingFormat.isStandard);
+
+	std::string key;
+	NSUInteger byteBudget;
+	bool compress;
+
+	try {
+		key = CacheKey(url, processingFormat);
+
+		std::lock_guard<std::mutex> lock(_lock);
+		if(!key.empty()) {
+			auto iter = _index.find(key);
+			if(iter != _index.end()) {
+				++_hitCount;
+				_entries.splice(_entries.begin(), _entries, iter->second);
+				return [[SFBCachedDecoder alloc] initWithAudio:iter->second->mAudio];
+			}
+		}
+
+		++_missCount;
+		byteBudget = _byteBudget;
+		compress = _compressionEnabled;
+	}
+
+	catch(const std::exception& e) {
+		os_log_error(gSFBAudioDecoderLog, "Error looking up cached audio: %{public}s", e.what());
+		key.clear();
+	}
+
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
+	if(!decoder || key.empty())
+		return decoder;
+
+	if(![decoder openReturningError:error])
+		return nil;
+
+	if(!processingFormat) {
+		AVAudioFormat *decoderFormat = decoder.processingFormat;
+		if(decoderFormat.channelLayout)
+			processingFormat = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:decoderFormat.sampleRate channelLayout:decoderFormat.channelLayout];
+		else
+			processingFormat = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:decoderFormat.sampleRate channels:decoderFormat.channelCount];
+	}
+
+	bool tooLarge = false;
+	auto audio = DecodeAllAudio(decoder, processingFormat, compress, byteBudget, tooLarge, error);
+	[decoder closeReturningError:nil];
+
+	if(!audio) {
+		if(!tooLarge)
+			return nil;
+		os_log_info(gSFBAudioDecoderLog, "Audio for \"%{public}@\" exceeds cache byte budget", [[NSFileManager defaultManager] displayNameAtPath:url.path]);
+		return [[SFBAudioDecoder alloc] initWithURL:url error:error];
+	}
+
+	try {
+		std::lock_guard<std::mutex> lock(_lock);
+		// Another thread may have cached the same audio
+		auto iter = _index.find(key);
+		if(iter != _index.end())
+			[self removeEntry:iter->second];
+
+		_entries.push_front({ key, audio });
+		_index[key] = _entries.begin();
+		_byteCount += audio->mByteCount;
+		[self evictEntries];
+	}
+
+	catch(const std::exception& e) {
+		os_log_error(gSFBAudioDecoderLog, "Error caching decoded audio: %{public}s", e.what());
+	}
+
+	return [[SFBCachedDecoder alloc] initWithAudio:audio];
+}
+
+- (void)removeAudioForURL:(NSURL *)url
+{
+	NSParameterAssert(url != nil);
+
+	NSString *path = url.URLByStandardizingPath.path;
+
+	std::lock_guard<std::mutex> lock(_lock);
+	for(auto iter = _entries.begin(); iter != _entries.end(); ) {
+		auto entry = iter++;
+		if([entry->mAudio->mURL.URLByStandardizingPath.path isEqualToString:path])
+			[self removeEntry:entry];
+	}
+}
+
+- (void)removeAllAudio
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_index.clear();
+	_entries.clear();
+	_byteCount = 0;
+}
+
+- (SFBPCMCacheStatistics)statistics
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return {
+		.hitCount = _hitCount,
+		.missCount = _missCount,
+		.evictionCount = _evictionCount,
+		.entryCount = _entries.size(),
+		.byteCount = _byteCount
+	};
+}
+
+- (void)resetStatistics
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	_hitCount = 0;
+	_missCount = 0;
+	_evictionCount = 0;
+}
+
+- (void)evictEntries
+{
+	// _lock must be held by the caller
+	while(_byteCount > _byteBudget && !_entries.empty()) {
+		[self removeEntry:std::prev(_entries.end())];
+		++_evictionCount;
+	}
+}
+
+- (void)removeEntry:(CacheEntryList::iterator)entry
+{
+	// _lock must be held by the caller
+	_byteCount -= entry->mAudio->mByteCount;
+	_index.erase(entry->mKey);
+	_entries.erase(entry);
+}
+
+@end
@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import "SFBAudioDecodingExecutor.h"
+#import "SFBAudioPlayerNode.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The possible outcomes of a unit of decoding work
+typedef NS_ENUM(NSInteger, SFBAudioDecodingWorkResult) {
+	/// Additional decoding work may be performed immediately
+	SFBAudioDecodingWorkResultReady		= 0,
+	/// No decoding work may be performed until decoding is requested again
+	SFBAudioDecodingWorkResultWaiting	= 1
+};
+
+@interface SFBAudioDecodingExecutor ()
+/// The semaphore signaled when any node using the executor requests decoding
+@property (nonatomic, readonly) dispatch_semaphore_t semaphore;
+/// Adds \c node to the nodes scheduled by the executor
+- (void)addNode:(SFBAudioPlayerNode *)node;
+/// Removes \c node from the nodes scheduled by the executor
+/// @note This method may be called from \c -dealloc
+- (void)removeNode:(SFBAudioPlayerNode *)node;
+@end
+
+/// Decoding entry points used by \c SFBAudioDecodingExecutor
+@interface SFBAudioPlayerNode (SFBAudioDecodingExecutorScheduling)
+/// Returns \c YES if decoding was requested since the last call to \c -performDecodingWork
+@property (nonatomic, readonly) BOOL decodingRequested;
+/// Returns the host time by which decoding should be performed
+@property (nonatomic, readonly) uint64_t decodingDeadline;
+/// Records the time a node waited to be scheduled
+/// @param schedulingDelay The time between decoding being requested and decoding starting, in host ticks
+/// @param missedDeadline \c YES if decoding started after the deadline
+- (void)recordSchedulingDelay:(uint64_t)schedulingDelay missedDeadline:(BOOL)missedDeadline;
+/// Performs a bounded unit of decoding work
+/// @note This method is never called concurrently for the same node
+- (SFBAudioDecodingWorkResult)performDecodingWork;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,36 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// A pool of worker threads performing decoding for multiple \c SFBAudioPlayerNode objects
+///
+/// By default each \c SFBAudioPlayerNode decodes on a dedicated thread. Nodes created with an executor instead share
+/// the executor's worker threads, which is preferable when many nodes exist but few are decoding at any given time.
+///
+/// Decoding work is scheduled earliest deadline first. The deadline for a node that is playing is the time at which
+/// its ring buffer will be exhausted at the current fill level. Nodes that are not playing are given a later deadline
+/// so they cannot delay nodes that are. A node is decoded by at most one worker thread at a time.
+NS_SWIFT_NAME(AudioDecodingExecutor) @interface SFBAudioDecodingExecutor : NSObject
+
+/// Returns the shared executor
+@property (class, nonatomic, readonly) SFBAudioDecodingExecutor *sharedExecutor;
+
+/// Returns an initialized \c SFBAudioDecodingExecutor object with a worker count appropriate for the system
+- (instancetype)init;
+/// Returns an initialized \c SFBAudioDecodingExecutor object
+/// @param workerCount The number of worker threads, which must be greater than \c 0
+/// @return An initialized \c SFBAudioDecodingExecutor object or \c nil if a worker thread could not be created
+- (nullable instancetype)initWithWorkerCount:(NSUInteger)workerCount NS_DESIGNATED_INITIALIZER;
+
+/// Returns the number of worker threads
+@property (nonatomic, readonly) NSUInteger workerCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,254 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <algorithm>
+#import <atomic>
+#import <memory>
+#import <mutex>
+#import <thread>
+#import <vector>
+
+#import <mach/mach_time.h>
+#import <os/log.h>
+
+#import "SFBAudioDecodingExecutor+Internal.h"
+
+namespace {
+
+os_log_t _audioDecodingExecutorLog = os_log_create("org.sbooth.AudioEngine", "AudioDecodingExecutor");
+
+/// A node scheduled by an executor
+struct ScheduledNode
+{
+	/// The node
+	__weak SFBAudioPlayerNode *mNode;
+	/// \c true if a worker thread is performing decoding work for the node
+	bool mIsRunning;
+	/// The host time at which a decoding request from the node was first observed, or \c 0 if none
+	uint64_t mRequestTime;
+	/// The node's deadline when the decoding request was first observed
+	uint64_t mRequestDeadline;
+};
+
+/// State shared between an executor and its worker threads
+///
+/// Worker threads hold a reference to this state rather than to the executor so an executor may be deallocated
+/// on one of its own worker threads, which happens when a worker releases the last reference to a node that holds
+/// the last reference to the executor.
+struct ExecutorState
+{
+	/// The semaphore signaled when decoding is requested
+	dispatch_semaphore_t mSemaphore;
+	/// Nodes scheduled by the executor
+	std::vector<ScheduledNode> mNodes;
+	/// The lock protecting \c mNodes
+	std::mutex mNodesLock;
+	/// Set to \c true to stop the worker threads
+	std::atomic_bool mStop;
+};
+
+void WorkerThreadEntry(std::shared_ptr<ExecutorState> state)
+{
+	pthread_setname_np("org.sbooth.AudioEngine.AudioDecodingExecutor.WorkerThread");
+	pthread_set_qos_class_self_np(QOS_CLASS_USER_INITIATED, 0);
+
+	os_log_debug(_audioDecodingExecutorLog, "Worker thread starting");
+
+	// Strong references to nodes examined while holding mNodesLock
+	// These must not be released with the lock held because releasing the last reference to a node
+	// runs -dealloc, which calls -removeNode:
+	std::vector<SFBAudioPlayerNode *> candidates;
+
+	while(!state->mStop.load()) {
+		@autoreleasepool {
+			SFBAudioPlayerNode *node = nil;
+			uint64_t schedulingDelay = 0;
+			BOOL missedDeadline = NO;
+
+			{
+				std::lock_guard<std::mutex> lock(state->mNodesLock);
+
+				const auto now = mach_absolute_time();
+				ScheduledNode *selected = nullptr;
+				uint64_t earliestDeadline = UINT64_MAX;
+
+				// Select the requesting node with the earliest deadline
+				for(auto& entry : state->mNodes) {
+					if(entry.mIsRunning)
+						continue;
+
+					SFBAudioPlayerNode *candidate = entry.mNode;
+					if(!candidate || !candidate.decodingRequested) {
+						entry.mRequestTime = 0;
+						continue;
+					}
+
+					candidates.push_back(candidate);
+
+					const auto deadline = candidate.decodingDeadline;
+					if(!entry.mRequestTime) {
+						entry.mRequestTime = now;
+						entry.mRequestDeadline = deadline;
+					}
+
+					if(deadline < earliestDeadline) {
+						earliestDeadline = deadline;
+						selected = &entry;
+						node = candidate;
+					}
+				}
+
+				if(selected) {
+					selected->mIsRunning = true;
+					schedulingDelay = now - selected->mRequestTime;
+					missedDeadline = now > selected->mRequestDeadline;
+					selected->mRequestTime = 0;
+				}
+			}
+
+			candidates.clear();
+
+			if(!node) {
+				dispatch_semaphore_wait(state->mSemaphore, DISPATCH_TIME_FOREVER);
+				continue;
+			}
+
+			[node recordSchedulingDelay:schedulingDelay missedDeadline:missedDeadline];
+
+			// A node returning SFBAudioDecodingWorkResultReady requests decoding again so
+			// it is considered in the next selection along with any other requesting nodes
+			[node performDecodingWork];
+
+			{
+				std::lock_guard<std::mutex> lock(state->mNodesLock);
+				auto iter = std::find_if(state->mNodes.begin(), state->mNodes.end(), [node](const ScheduledNode& entry) {
+					SFBAudioPlayerNode *scheduledNode = entry.mNode;
+					return scheduledNode == node;
+				});
+				if(iter != state->mNodes.end())
+					iter->mIsRunning = false;
+			}
+		}
+	}
+
+	os_log_debug(_audioDecodingExecutorLog, "Worker thread terminating");
+}
+
+} // namespace
+
+@interface SFBAudioDecodingExecutor ()
+{
+@private
+	/// State shared with the worker threads
+	std::shared_ptr<ExecutorState> 	_state;
+	/// The worker threads
+	std::vector<std::thread> 		_workers;
+}
+@end
+
+@implementation SFBAudioDecodingExecutor
+
++ (SFBAudioDecodingExecutor *)sharedExecutor
+{
+	static SFBAudioDecodingExecutor *sharedExecutor = nil;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		sharedExecutor = [[SFBAudioDecodingExecutor alloc] init];
+	});
+	return sharedExecutor;
+}
+
+- (instancetype)init
+{
+	// Decoding is mostly I/O and integer work so a few threads suffice for many nodes
+	NSUInteger workerCount = std::max(2ul, std::min(4ul, static_cast<unsigned long>(NSProcessInfo.processInfo.activeProcessorCount / 2)));
+	return [self initWithWorkerCount:workerCount];
+}
+
+- (instancetype)initWithWorkerCount:(NSUInteger)workerCount
+{
+	NSParameterAssert(workerCount > 0);
+
+	if((self = [super init])) {
+		try {
+			_state = std::make_shared<ExecutorState>();
+		}
+
+		catch(const std::exception& e) {
+			os_log_error(_audioDecodingExecutorLog, "Unable to allocate executor state: %{public}s", e.what());
+			return nil;
+		}
+
+		_state->mSemaphore = dispatch_semaphore_create(0);
+		if(!_state->mSemaphore) {
+			os_log_error(_audioDecodingExecutorLog, "dispatch_semaphore_create failed");
+			return nil;
+		}
+
+		_state->mStop.store(false);
+
+		try {
+			for(NSUInteger i = 0; i < workerCount; ++i)
+				_workers.emplace_back(WorkerThreadEntry, _state);
+		}
+
+		catch(const std::exception& e) {
+			os_log_error(_audioDecodingExecutorLog, "Unable to create worker thread: %{public}s", e.what());
+			return nil;
+		}
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	if(!_state)
+		return;
+
+	_state->mStop.store(true);
+	for(size_t i = 0; i < _workers.size(); ++i)
+		dispatch_semaphore_signal(_state->mSemaphore);
+
+	const auto currentThread = std::this_thread::get_id();
+	for(auto& worker : _workers) {
+		// A worker thread cannot join itself; it exits after its current iteration
+		if(worker.get_id() == currentThread)
+			worker.detach();
+		else if(worker.joinable())
+			worker.join();
+	}
+}
+
+- (NSUInteger)workerCount
+{
+	return _workers.size();
+}
+
+- (dispatch_semaphore_t)semaphore
+{
+	return _state->mSemaphore;
+}
+
+- (void)addNode:(SFBAudioPlayerNode *)node
+{
+	NSParameterAssert(node != nil);
+
+	std::lock_guard<std::mutex> lock(_state->mNodesLock);
+	_state->mNodes.push_back({ node, false, 0, 0 });
+}
+
+- (void)removeNode:(SFBAudioPlayerNode *)node
+{
+	std::lock_guard<std::mutex> lock(_state->mNodesLock);
+	// The weak reference is already nil if node is deallocating
+	_state->mNodes.erase(std::remove_if(_state->mNodes.begin(), _state->mNodes.end(), [node](const ScheduledNode& entry) {
+		SFBAudioPlayerNode *scheduledNode = entry.mNode;
+		return scheduledNode == node || scheduledNode == nil;
+	}), _state->mNodes.end());
+}
+
+@end
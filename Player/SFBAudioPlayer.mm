@@ -608,8 +608,11 @@ enum eAudioPlayerFlags : unsigned int {
 
 		// If the current SFBAudioPlayerNode doesn't support the decoder's format (required for gapless join),
 		// reconfigure AVAudioEngine with a new SFBAudioPlayerNode with the correct format
+		// Immediate playback isn't gapless so the graph is reconfigured to avoid format conversion when possible
 		AVAudioFormat *format = decoder.processingFormat;
-		if(![_playerNode supportsFormat:format]) {
+		AVAudioFormat *renderingFormat = _playerNode.renderingFormat;
+		BOOL formatMatches = format.channelCount == renderingFormat.channelCount && format.sampleRate == renderingFormat.sampleRate;
+		if(forImmediatePlayback ? !formatMatches : ![_playerNode supportsFormat:format]) {
 			success = [self configureEngineForGaplessPlaybackOfFormat:format forceUpdate:NO];
 			playbackStateChanged = _engineIsRunning;
 		}
@@ -676,6 +679,10 @@ enum eAudioPlayerFlags : unsigned int {
 		}
 
 		playerNode.delegate = self;
+
+		// Preserve the configuration of the node being replaced
+		if(_playerNode)
+			[playerNode copyConfigurationFromPlayerNode:_playerNode];
 	}
 
 	AVAudioOutputNode *outputNode = _engine.outputNode;
@@ -8,6 +8,7 @@
 #import <AVFoundation/AVFoundation.h>
 
 #import <SFBAudioEngine/SFBPCMDecoding.h>
+#import <SFBAudioEngine/SFBAudioDecodingExecutor.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -33,6 +34,183 @@ struct SFBAudioPlayerNodePlaybackTime {
 } /*NS_SWIFT_UNAVAILABLE("Use AudioPlayerNode.PlaybackTime instead")*/;
 typedef struct SFBAudioPlayerNodePlaybackTime SFBAudioPlayerNodePlaybackTime;
 
+/// A snapshot of the playback position for \c SFBAudioPlayerNode
+///
+/// While \c isPlaying is \c YES the frame position at a later host time \c t may be estimated as
+/// \c framePosition \c + \c (t \c - \c hostTime) converted to seconds and multiplied by \c sampleRate
+struct SFBAudioPlayerNodePlaybackSnapshot {
+	/// The frame position at \c hostTime or \c SFBUnknownFramePosition if unknown
+	AVAudioFramePosition framePosition;
+	/// The total number of frames or \c SFBUnknownFrameLength if unknown
+	AVAudioFramePosition frameLength;
+	/// The sample rate of \c framePosition and \c frameLength
+	double sampleRate;
+	/// The host time at which \c framePosition is output
+	uint64_t hostTime;
+	/// \c YES if the frame position advances with host time
+	BOOL isPlaying;
+};
+typedef struct SFBAudioPlayerNodePlaybackSnapshot SFBAudioPlayerNodePlaybackSnapshot;
+
+#pragma mark - Gain information
+
+/// ReplayGain adjustments applied to enqueued decoders
+typedef NS_ENUM(NSUInteger, SFBAudioPlayerNodeReplayGainMode) {
+	/// ReplayGain information is ignored
+	SFBAudioPlayerNodeReplayGainModeOff		= 0,
+	/// Track gain is applied
+	SFBAudioPlayerNodeReplayGainModeTrack	= 1,
+	/// Album gain is applied, or track gain if album gain is unavailable
+	SFBAudioPlayerNodeReplayGainModeAlbum	= 2
+} NS_SWIFT_NAME(AudioPlayerNode.ReplayGainMode);
+
+#pragma mark - Crossfade information
+
+/// Gain curves for crossfades between consecutive decoders
+typedef NS_ENUM(NSUInteger, SFBAudioPlayerNodeCrossfadeCurve) {
+	/// Gains change linearly, preserving the combined amplitude of correlated audio
+	SFBAudioPlayerNodeCrossfadeCurveLinear		= 0,
+	/// Gains follow quarter sine and cosine curves, preserving the combined power of uncorrelated audio
+	SFBAudioPlayerNodeCrossfadeCurveEqualPower	= 1
+} NS_SWIFT_NAME(AudioPlayerNode.CrossfadeCurve);
+
+#pragma mark - Buffering information
+
+/// Bounds within which \c SFBAudioPlayerNode adapts its buffering
+struct SFBAudioPlayerNodeBufferingBounds {
+	/// The minimum number of frames the decoding thread keeps buffered for rendering
+	AVAudioFrameCount minimumFillTarget;
+	/// The maximum number of frames the decoding thread keeps buffered for rendering
+	AVAudioFrameCount maximumFillTarget;
+	/// The minimum number of frames decoded at once
+	AVAudioFrameCount minimumChunkSize;
+	/// The maximum number of frames decoded at once
+	AVAudioFrameCount maximumChunkSize;
+};
+typedef struct SFBAudioPlayerNodeBufferingBounds SFBAudioPlayerNodeBufferingBounds;
+
+/// Buffering statistics for \c SFBAudioPlayerNode
+struct SFBAudioPlayerNodeBufferingStatistics {
+	/// The number of render cycles for which insufficient audio was available
+	uint64_t underrunCount;
+	/// The number of frames of silence output because insufficient audio was available
+	uint64_t underrunFrameCount;
+	/// The smallest number of frames available at the start of a render cycle during playback or \c 0 if none
+	AVAudioFrameCount minimumFillLevel;
+	/// The number of frames the decoding thread is currently keeping buffered for rendering
+	AVAudioFrameCount fillTarget;
+	/// The number of frames currently decoded at once
+	AVAudioFrameCount chunkSize;
+	/// The number of decoding operations that took long enough to endanger playback
+	uint64_t stallCount;
+	/// The ratio of decoding speed to realtime for the current decoder or \c 0 if unknown
+	double decodingSpeed;
+};
+typedef struct SFBAudioPlayerNodeBufferingStatistics SFBAudioPlayerNodeBufferingStatistics;
+
+#pragma mark - Render diagnostics
+
+/// Render thread diagnostics for \c SFBAudioPlayerNode
+struct SFBAudioPlayerNodeRenderTraceStatistics {
+	/// The number of render cycles in which the ring buffer returned fewer frames than were available
+	uint64_t shortReadCount;
+	/// The number of render cycles padded with silence because insufficient audio was available
+	uint64_t silencePaddingCount;
+	/// The total number of frames of silence padding
+	uint64_t silencePaddingFrameCount;
+	/// The number of times output was muted or unmuted
+	uint64_t muteTransitionCount;
+	/// The number of times rendering moved to a different decoder
+	uint64_t sequenceNumberChangeCount;
+	/// The number of trace events discarded because the trace buffer was full
+	uint64_t droppedEventCount;
+};
+typedef struct SFBAudioPlayerNodeRenderTraceStatistics SFBAudioPlayerNodeRenderTraceStatistics;
+
+#pragma mark - Metering information
+
+/// Output levels for one channel of \c SFBAudioPlayerNode
+struct SFBAudioPlayerNodeChannelLevels {
+	/// The peak amplitude during the metering interval
+	float peak;
+	/// The RMS amplitude during the metering interval
+	float rms;
+	/// The number of samples exceeding full scale since metering was enabled
+	uint64_t clipCount;
+};
+typedef struct SFBAudioPlayerNodeChannelLevels SFBAudioPlayerNodeChannelLevels;
+
+/// Metering cost statistics for \c SFBAudioPlayerNode
+struct SFBAudioPlayerNodeMeteringStatistics {
+	/// The number of render cycles in which output levels were measured
+	uint64_t meteredCycleCount;
+	/// The average time spent measuring output levels in a render cycle
+	NSTimeInterval averageMeteringTime;
+	/// The longest time spent measuring output levels in a render cycle
+	NSTimeInterval maximumMeteringTime;
+};
+typedef struct SFBAudioPlayerNodeMeteringStatistics SFBAudioPlayerNodeMeteringStatistics;
+
+#pragma mark - Scheduling information
+
+/// Decoding executor scheduling statistics for \c SFBAudioPlayerNode
+struct SFBAudioPlayerNodeSchedulingStatistics {
+	/// The number of times decoding work was scheduled by the executor
+	uint64_t scheduledCount;
+	/// The total time spent performing decoding work on the executor's worker threads
+	NSTimeInterval decodingTime;
+	/// The average time between decoding being requested and being scheduled
+	NSTimeInterval averageSchedulingDelay;
+	/// The longest time between decoding being requested and being scheduled
+	NSTimeInterval maximumSchedulingDelay;
+	/// The number of times decoding was scheduled after the ring buffer was expected to be exhausted
+	uint64_t missedDeadlineCount;
+};
+typedef struct SFBAudioPlayerNodeSchedulingStatistics SFBAudioPlayerNodeSchedulingStatistics;
+
+#pragma mark - Seek information
+
+/// Seek statistics for \c SFBAudioPlayerNode
+struct SFBAudioPlayerNodeSeekStatistics {
+	/// The number of seeks requested
+	uint64_t requestCount;
+	/// The number of seeks completed
+	///
+	/// Seeks requested before an earlier seek completes are coalesced so this may be less than \c requestCount
+	uint64_t completedCount;
+	/// The number of seeks completed without interrupting playback
+	uint64_t stagedCount;
+	/// The time between the most recent completed seek being requested and its first audio being output
+	NSTimeInterval lastLatency;
+	/// The longest time between a seek being requested and its first audio being output
+	NSTimeInterval maximumLatency;
+	/// The number of seeks requested while scrubbing
+	uint64_t scrubRequestCount;
+	/// The number of grains of audio decoded while scrubbing
+	///
+	/// Seeks requested while scrubbing are coalesced so this may be less than \c scrubRequestCount
+	uint64_t scrubGrainCount;
+};
+typedef struct SFBAudioPlayerNodeSeekStatistics SFBAudioPlayerNodeSeekStatistics;
+
+#pragma mark - Scheduled start information
+
+/// Scheduled start statistics for \c SFBAudioPlayerNode
+struct SFBAudioPlayerNodeScheduledStartStatistics {
+	/// The number of scheduled starts performed
+	uint64_t startCount;
+	/// The number of scheduled starts performed after the requested host time had passed
+	uint64_t lateStartCount;
+	/// The number of scheduled starts performed before the decoding thread finished filling the ring buffer
+	uint64_t incompletePrefillCount;
+	/// The time between the ring buffer being filled and the most recent scheduled start
+	/// @note The value is negative if the ring buffer was filled after the requested host time
+	NSTimeInterval lastPrefillMargin;
+	/// The shortest time between the ring buffer being filled and a scheduled start
+	NSTimeInterval minimumPrefillMargin;
+};
+typedef struct SFBAudioPlayerNodeScheduledStartStatistics SFBAudioPlayerNodeScheduledStartStatistics;
+
 #pragma mark - SFBAudioPlayerNode
 
 /// An \c AVAudioSourceNode supporting gapless playback for PCM formats
@@ -87,20 +265,60 @@ NS_SWIFT_NAME(AudioPlayerNode) @interface SFBAudioPlayerNode : AVAudioSourceNode
 /// @param format The format supplied by the render block
 /// @param ringBufferSize The desired minimum ring buffer size, in frames.
 /// @return An initialized \c SFBAudioPlayerNode object or \c nil if memory or resource allocation failed
-- (instancetype)initWithFormat:(AVAudioFormat *)format ringBufferSize:(uint32_t)ringBufferSize NS_DESIGNATED_INITIALIZER;
+- (instancetype)initWithFormat:(AVAudioFormat *)format ringBufferSize:(uint32_t)ringBufferSize;
+/// Returns an initialized \c SFBAudioPlayerNode object
+/// @note \c format must be standard
+/// @param format The format supplied by the render block
+/// @param ringBufferSize The desired minimum ring buffer size, in frames.
+/// @param decodingExecutor The executor performing decoding or \c nil to decode on a dedicated thread
+/// @return An initialized \c SFBAudioPlayerNode object or \c nil if memory or resource allocation failed
+- (instancetype)initWithFormat:(AVAudioFormat *)format ringBufferSize:(uint32_t)ringBufferSize decodingExecutor:(nullable SFBAudioDecodingExecutor *)decodingExecutor NS_DESIGNATED_INITIALIZER;
 
 - (instancetype)initWithRenderBlock:(AVAudioSourceNodeRenderBlock)block NS_UNAVAILABLE;
 - (instancetype)initWithFormat:(AVAudioFormat *)format renderBlock:(AVAudioSourceNodeRenderBlock)block NS_UNAVAILABLE;
 
+#pragma mark - Configuration
+
+/// Applies the configuration of another \c SFBAudioPlayerNode to this object
+///
+/// The format conversion, look-ahead decoding, gain, crossfading, buffering, metering, spectrum analysis, seeking, and
+/// scrubbing settings are copied. The delegate, decoding executor, decoder queue, and statistics are not.
+/// @note Durations are preserved across differing sample rates but the buffering bounds, specified in frames, are not scaled
+/// @param playerNode The \c SFBAudioPlayerNode object whose configuration is copied
+- (void)copyConfigurationFromPlayerNode:(SFBAudioPlayerNode *)playerNode NS_SWIFT_NAME(copyConfiguration(from:));
+
 #pragma mark - Format Information
 
 /// Returns the format supplied by this object's render block
 @property (nonatomic, readonly) AVAudioFormat * renderingFormat;
 /// Returns \c YES if audio with \c format can be played
 /// @param format A format to test for support
-/// @return \c YES if \c format has the same number of channels and sample rate as the rendering format
+/// @return \c YES if \c format has the same number of channels and sample rate as the rendering format, or if format
+/// conversion is enabled and \c format can be converted to the rendering format
 - (BOOL)supportsFormat:(AVAudioFormat *)format;
 
+#pragma mark - Format Conversion
+
+/// Set to \c YES to play audio whose sample rate or channel count differs from the rendering format
+///
+/// When enabled, audio from decoders whose processing format differs from the rendering format in sample rate or
+/// channel count is resampled and channel mapped before it is buffered for rendering. This allows one rendering format
+/// to be used for decoders with differing formats while playback remains gapless. Channels absent from the rendering
+/// format are mixed into those present. Playback positions and times are expressed at the decoder's sample rate.
+/// @note The default value is \c NO
+/// @note Changes affect the formats accepted by \c -supportsFormat: and the enqueue methods
+@property (nonatomic) BOOL formatConversionEnabled;
+/// The quality of sample rate conversion
+/// @note Higher quality requires more processing. The default value is \c AVAudioQualityHigh
+/// @note Changes take effect for subsequently dequeued decoders
+@property (nonatomic) AVAudioQuality sampleRateConverterQuality;
+/// The sample rate conversion algorithm
+/// @note One of \c AVSampleRateConverterAlgorithm_Normal, \c AVSampleRateConverterAlgorithm_Mastering, or
+/// \c AVSampleRateConverterAlgorithm_MinimumPhase. The mastering algorithm requires the most processing.
+/// The default value is \c AVSampleRateConverterAlgorithm_Normal
+/// @note Changes take effect for subsequently dequeued decoders
+@property (nonatomic, copy) NSString *sampleRateConverterAlgorithm;
+
 #pragma mark - Queue Management
 
 /// Cancels the current decoder, clears any queued decoders, and creates and enqueues a decoder for subsequent playback
@@ -115,6 +333,17 @@ NS_SWIFT_NAME(AudioPlayerNode) @interface SFBAudioPlayerNode : AVAudioSourceNode
 /// @param error An optional pointer to an \c NSError object to receive error information
 /// @return \c YES if the decoder was enqueued successfully
 - (BOOL)resetAndEnqueueDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error NS_SWIFT_NAME(resetAndEnqueue(_:));
+/// Cancels the current decoder, clears any queued decoders, and enqueues a decoder whose first frame is output at the specified host time
+///
+/// A start time applies to the node rather than to an individual decoder, so the current and queued decoders are
+/// discarded to ensure \c decoder is the one that starts at \c hostTime. Decoders enqueued afterward follow it
+/// gaplessly.
+/// @note This is equivalent to \c -resetAndEnqueueDecoder:error: followed by \c -playAtHostTime:
+/// @param decoder The decoder to enqueue
+/// @param hostTime The host time at which the first frame of audio from \c decoder is output
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES if the decoder was enqueued successfully
+- (BOOL)resetAndEnqueueDecoder:(id <SFBPCMDecoding>)decoder startingAtHostTime:(uint64_t)hostTime error:(NSError **)error NS_SWIFT_NAME(resetAndEnqueue(_:startingAt:));
 
 /// Creates and enqueues a decoder for subsequent playback
 /// @note This is equivalent to creating an \c SFBAudioDecoder object for \c url and passing that object to \c -enqueueDecoder:error:
@@ -127,29 +356,223 @@ NS_SWIFT_NAME(AudioPlayerNode) @interface SFBAudioPlayerNode : AVAudioSourceNode
 /// @param error An optional pointer to an \c NSError object to receive error information
 /// @return \c YES if the decoder was enqueued successfully
 - (BOOL)enqueueDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error NS_SWIFT_NAME(enqueue(_:));
+/// Enqueues a decoder for subsequent playback with the specified gain
+/// @note \c gain is applied in place of any ReplayGain adjustment
+/// @param decoder The decoder to enqueue
+/// @param gain The gain to apply to audio from \c decoder, in decibels
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES if the decoder was enqueued successfully
+- (BOOL)enqueueDecoder:(id <SFBPCMDecoding>)decoder gain:(float)gain error:(NSError **)error NS_SWIFT_NAME(enqueue(_:gain:));
+
+/// Creates a decoder for \c url and enqueues it for subsequent playback once it has been opened on a background queue
+/// @note This is equivalent to creating an \c SFBAudioDecoder object for \c url and passing that object to \c -enqueueDecoderAsynchronously:
+/// @param url The URL to enqueue
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return \c YES if a decoder was created successfully
+- (BOOL)enqueueURLAsynchronously:(NSURL *)url error:(NSError **)error NS_SWIFT_NAME(enqueueAsynchronously(_:));
+/// Opens a decoder on a background queue and enqueues it for subsequent playback
+///
+/// A limited number of decoders are opened concurrently. Decoders are added to the decoder queue in the order they were
+/// passed to this method and \c -enqueueURLAsynchronously:error:, regardless of the order in which opening completes.
+/// For each decoder the delegate receives either \c -audioPlayerNode:decoderOpened:latency: or
+/// \c -audioPlayerNode:failedToEnqueueDecoder:error:
+/// @note Decoders enqueued synchronously are added to the decoder queue ahead of decoders still being opened
+/// @note Decoders still being opened are discarded by \c -clearQueue
+/// @note If opening cannot begin within ten seconds because other decoders are still being opened the delegate
+/// receives \c -audioPlayerNode:failedToEnqueueDecoder:error: with \c SFBAudioPlayerNodeErrorTimedOut
+/// @param decoder The decoder to enqueue
+- (void)enqueueDecoderAsynchronously:(id <SFBPCMDecoding>)decoder NS_SWIFT_NAME(enqueueAsynchronously(_:));
 
 /// Cancels the current decoder
 - (void)cancelCurrentDecoder;
 /// Empties the decoder queue
 - (void)clearQueue;
 
-/// Returns \c YES if the decoder queue is empty
+/// Returns \c YES if the decoder queue is empty and no decoders are being opened asynchronously
 @property (nonatomic, readonly) BOOL queueIsEmpty;
 /// Removes and returns the next decoder from the decoder queue
 /// @return The next decoder from the decoder queue or \c nil if none
 - (nullable id <SFBPCMDecoding>)dequeueDecoder;
 
+#pragma mark - Look-Ahead Decoding
+
+/// The maximum number of queued decoders decoded ahead of the current decoder
+///
+/// When greater than \c 0, queued decoders are decoded into staging buffers on a separate thread while the current
+/// decoder finishes. Staged audio is spliced into the ring buffer when the decoder becomes current. This masks slow
+/// opening or decoding at track boundaries at the cost of additional memory.
+/// @note The default value is \c 0, which disables look-ahead decoding
+/// @note Audio decoded ahead of playback is discarded by \c -dequeueDecoder; if the decoder supports seeking it is
+/// returned to the frame position it had when enqueued
+@property (nonatomic) NSUInteger lookAheadDepth;
+/// The maximum number of bytes of audio held in staging buffers for look-ahead decoding
+/// @note Changes take effect for decoders subsequently decoded ahead of playback
+@property (nonatomic) NSUInteger lookAheadMemoryLimit;
+
+#pragma mark - Gain
+
+/// The ReplayGain adjustment applied to decoders
+///
+/// ReplayGain and R128 gain tags are read from the file underlying each decoder by the decoding thread before it decodes
+/// audio from the decoder, so enqueuing a decoder doesn't perform additional I/O. Gain is applied by the decoding
+/// thread as audio is converted to the rendering format, so changes in gain coincide exactly with decoder boundaries. Unless \c peakLimiterEnabled is \c YES, gain is reduced if necessary to prevent the tagged peak from
+/// clipping.
+/// @note The default value is \c SFBAudioPlayerNodeReplayGainModeOff
+/// @note Changes take effect for decoders whose decoding has not begun
+@property (nonatomic) SFBAudioPlayerNodeReplayGainMode replayGainMode;
+/// The gain applied in addition to ReplayGain adjustments, in decibels
+/// @note The preamp is only applied to decoders with ReplayGain information. The default value is \c 0
+/// @note Changes take effect for decoders whose decoding has not begun
+@property (nonatomic) float replayGainPreamp;
+/// Set to \c YES to limit the true peak level of audio following gain adjustment to -1 dBTP
+///
+/// The limiter looks ahead a few milliseconds to reduce gain smoothly before peaks and estimates peaks between samples
+/// by oversampling.
+/// @note The default value is \c NO
+/// @note Changes take effect for subsequently dequeued decoders
+@property (nonatomic) BOOL peakLimiterEnabled;
+
+#pragma mark - Crossfading
+
+/// The duration of the crossfade between consecutive decoders
+///
+/// When greater than \c 0 the end of each decoder's audio is mixed with the beginning of the following decoder's audio.
+/// Mixing is performed by the decoding thread, which holds back the end of the current decoder's audio until the
+/// following decoder is dequeued. If no decoder follows by the time the held back audio is needed for playback, it is
+/// played without a crossfade.
+///
+/// The rendering started notification for the following decoder is delivered when the crossfade begins and the
+/// rendering complete notification for the current decoder when it ends.
+/// @note The default value is \c 0, which disables crossfading. The maximum value is 10 seconds.
+/// @note Changes take effect for audio decoded subsequently
+@property (nonatomic) NSTimeInterval crossfadeDuration;
+/// The gain curve used for crossfades
+/// @note The default value is \c SFBAudioPlayerNodeCrossfadeCurveEqualPower
+@property (nonatomic) SFBAudioPlayerNodeCrossfadeCurve crossfadeCurve;
+
+#pragma mark - Buffering
+
+/// The bounds within which the ring buffer fill target and decoding chunk size are adjusted
+///
+/// \c SFBAudioPlayerNode measures the decoding speed relative to realtime and the duration of individual decoding
+/// operations for the current decoder. The fill target and chunk size grow when decoding is slow, a decoding operation
+/// stalls, or an underrun occurs, and shrink gradually while decoding is consistently fast. Setting the minimum and
+/// maximum to the same value disables adaptation.
+/// @note The fill target is limited by the ring buffer size specified at initialization
+/// @note Changes to the chunk size bounds take effect for subsequently dequeued decoders
+@property (nonatomic) SFBAudioPlayerNodeBufferingBounds bufferingBounds;
+/// Returns a snapshot of the buffering statistics
+/// @note This property may be read from any thread without blocking rendering or decoding
+@property (nonatomic, readonly) SFBAudioPlayerNodeBufferingStatistics bufferingStatistics;
+/// Resets the underrun count, underrun frame count, minimum fill level, and stall count
+- (void)resetBufferingStatistics;
+
+#pragma mark - Notification Delivery
+
+/// The number of delegate notifications from the decoding thread delivered more than 50 msec after they were posted
+/// @note Notifications from the decoding thread are queued for delivery on a separate queue so a slow delegate does not
+/// delay decoding. This counter indicates how often the delegate falls behind.
+@property (nonatomic, readonly) uint64_t lateNotificationCount;
+/// The number of delegate notifications from the decoding thread discarded because the notification queue was full
+@property (nonatomic, readonly) uint64_t droppedNotificationCount;
+
+#pragma mark - Render Diagnostics
+
+/// Returns a snapshot of the render thread diagnostics
+/// @note The render block records events in a preallocated buffer without blocking, allocating, or logging. The
+/// events are periodically logged and counted on a background queue so the most recent events may not be reflected.
+@property (nonatomic, readonly) SFBAudioPlayerNodeRenderTraceStatistics renderTraceStatistics;
+/// The number of render events discarded because the render event queue was full
+///
+/// Render events are used for the rendering, end of audio, underrun, seek completion, and ring buffer reset delegate
+/// notifications. A discarded event means the corresponding notification was not sent.
+@property (nonatomic, readonly) uint64_t droppedRenderEventCount;
+
+#pragma mark - Metering
+
+/// Set to \c YES to measure the levels of audio output by the render block
+///
+/// The render block measures peak and RMS levels and counts clipped samples using vectorized reductions. Levels are
+/// published once per metering interval of approximately 1/60 second through a wait-free triple buffer, so reading
+/// levels never blocks rendering. At most eight channels are metered.
+/// @note The default value is \c NO
+@property (nonatomic) BOOL meteringEnabled;
+/// Copies the most recently published output levels
+/// @note Concurrent calls to this method are serialized but never block the render block
+/// @param levels An array of at least \c channelCount elements to receive the levels
+/// @param channelCount The number of elements in \c levels
+/// @param hostTime An optional pointer to receive the host time at which the end of the measured audio is output
+/// @return The number of channels copied to \c levels or \c 0 if no levels have been published
+- (AVAudioChannelCount)getMeterLevels:(SFBAudioPlayerNodeChannelLevels *)levels channelCount:(AVAudioChannelCount)channelCount hostTime:(nullable uint64_t *)hostTime NS_REFINED_FOR_SWIFT;
+/// Returns the time spent measuring output levels in the render block
+@property (nonatomic, readonly) SFBAudioPlayerNodeMeteringStatistics meteringStatistics;
+/// Resets the metering cost statistics
+- (void)resetMeteringStatistics;
+
+#pragma mark - Spectrum Analysis
+
+/// Set to \c YES to compute magnitude spectra of audio output by the render block
+///
+/// The render block copies its output to a lock-free FIFO. A background queue downmixes the output to mono and
+/// computes a Hann-windowed FFT every \c spectrumAnalysisHopSize frames. Each spectrum is stamped with the host time at
+/// which the center of its window is output, using the same clock as the delegate's rendering notifications.
+/// @note The default value is \c NO
+@property (nonatomic) BOOL spectrumAnalysisEnabled;
+/// The number of frames analyzed for each spectrum
+/// @note The value is rounded up to a power of two from 16 to 65536. The default value is \c 2048
+/// @note Changes take effect for subsequently computed spectra
+@property (nonatomic) NSUInteger spectrumAnalysisFFTSize;
+/// The number of frames between consecutive spectra
+/// @note Values greater than \c spectrumAnalysisFFTSize are treated as \c spectrumAnalysisFFTSize. The default value is \c 1024
+/// @note Changes take effect for subsequently computed spectra
+@property (nonatomic) NSUInteger spectrumAnalysisHopSize;
+/// Copies the most recent magnitude spectrum with a host time at or before \c hostTime
+///
+/// A spectrum contains \c spectrumAnalysisFFTSize \c / \c 2 \c + \c 1 magnitudes. Magnitude \c i corresponds to a
+/// frequency of \c i times the sample rate divided by \c spectrumAnalysisFFTSize and a full scale sinusoid has a
+/// magnitude of \c 1. Passing the host time at which a frame will be displayed synchronizes visualization with
+/// what the listener hears.
+/// @param magnitudes An array of at least \c count elements to receive the magnitudes
+/// @param count The number of elements in \c magnitudes
+/// @param hostTime The host time of interest or \c 0 for the most recent spectrum
+/// @param spectrumHostTime An optional pointer to receive the host time at which the center of the spectrum's window is output
+/// @return The number of magnitudes copied or \c 0 if no spectrum is available
+- (NSUInteger)getSpectrum:(float *)magnitudes count:(NSUInteger)count atHostTime:(uint64_t)hostTime spectrumHostTime:(nullable uint64_t *)spectrumHostTime NS_REFINED_FOR_SWIFT;
+
+#pragma mark - Decoding Executor
+
+/// Returns the executor performing decoding or \c nil if decoding is performed on a dedicated thread
+@property (nonatomic, nullable, readonly) SFBAudioDecodingExecutor *decodingExecutor;
+/// Returns a snapshot of the scheduling statistics
+/// @note The statistics are zero if \c decodingExecutor is \c nil
+@property (nonatomic, readonly) SFBAudioPlayerNodeSchedulingStatistics schedulingStatistics;
+
 #pragma mark - Playback Control
 
 /// Begins pushing audio from the current decoder
 - (void)play;
+/// Begins pushing audio from the current decoder at the specified host time
+///
+/// Silence is output until \c hostTime and the first frame of audio is output at the frame within the render cycle
+/// corresponding to \c hostTime. The ring buffer is filled in the interim so audio is available at the start. If
+/// \c hostTime has already passed audio is pushed immediately.
+/// @note Any audio already playing is silenced until \c hostTime
+/// @note \c -play, \c -pause, \c -stop, and \c -togglePlayPause cancel a pending start
+/// @param hostTime The host time at which the first frame of audio is output
+- (void)playAtHostTime:(uint64_t)hostTime NS_SWIFT_NAME(play(at:));
 /// Pauses audio from the current decoder and pushes silence
 - (void)pause;
 /// Cancels the current decoder, clears any queued decoders, and pushes silence
+/// @note Requests that wait for the render block, such as a seek, are abandoned once the engine is stopped or
+/// reconfigured. The node observes \c AVAudioEngineConfigurationChangeNotification; if the engine is stopped directly
+/// call \c -pause or \c -stop so the node is aware of it.
 - (void)stop;
 /// Toggles the playback state
 - (void)togglePlayPause;
 
+/// Returns a snapshot of the scheduled start statistics
+@property (nonatomic, readonly) SFBAudioPlayerNodeScheduledStartStatistics scheduledStartStatistics;
+
 #pragma mark - State
 
  /// Returns \c YES if the \c SFBAudioPlayerNode is playing
@@ -174,6 +597,11 @@ NS_SWIFT_NAME(AudioPlayerNode) @interface SFBAudioPlayerNode : AVAudioSourceNode
 /// @return \c NO if the current decoder is \c nil
 - (BOOL)getPlaybackPosition:(nullable SFBAudioPlayerNodePlaybackPosition *)playbackPosition andTime:(nullable SFBAudioPlayerNodePlaybackTime *)playbackTime NS_REFINED_FOR_SWIFT;
 
+/// Returns a snapshot of the playback position in the current decoder including the host time at which it applies
+/// @note The render block publishes the snapshot once per render cycle so reading it is inexpensive and never blocks
+/// rendering. The playback position and time properties are derived from the same snapshot.
+@property (nonatomic, readonly) SFBAudioPlayerNodePlaybackSnapshot playbackSnapshot;
+
 #pragma mark - Seeking
 
 /// Seeks forward in the current decoder by the specified number of seconds
@@ -201,6 +629,39 @@ NS_SWIFT_NAME(AudioPlayerNode) @interface SFBAudioPlayerNode : AVAudioSourceNode
 /// Returns \c YES if the current decoder supports seeking
 @property (nonatomic, readonly) BOOL supportsSeeking;
 
+/// The duration of the crossfade from the audio preceding a seek to the audio following it
+///
+/// During playback audio at a seek target is decoded while the audio preceding the seek continues to play. Once
+/// it is available the render block switches to it, optionally crossfading from the preceding audio to avoid an
+/// audible discontinuity. When a seek can't be staged, for example while paused, output is briefly muted instead.
+/// @note The default is \c 0, which switches immediately. The duration is limited to \c 4096 frames.
+@property (nonatomic) NSTimeInterval seekCrossfadeDuration;
+/// Returns a snapshot of the seek statistics
+@property (nonatomic, readonly) SFBAudioPlayerNodeSeekStatistics seekStatistics;
+
+#pragma mark - Scrubbing
+
+/// Begins scrubbing the current decoder
+///
+/// While scrubbing, seeks are not performed individually. Instead a short grain of audio is decoded at the most recent
+/// seek target whenever the previous grain has nearly finished playing, so frequent seek requests such as those from a
+/// dragged slider are coalesced. Consecutive grains are joined with brief fades. Normal decoding resumes from the most
+/// recent seek target when scrubbing ends.
+///
+/// A decoder that has been completely decoded is reopened for scrubbing. Decoders following it that have already been
+/// dequeued are then decoded again from the beginning once its decoding is complete, so they must support seeking.
+/// @note Grains are audible only while playing
+/// @return \c NO if the current decoder is \c nil, doesn't support seeking, or has been canceled, or if a decoder following it
+/// has been dequeued and doesn't support seeking
+- (BOOL)beginScrubbing;
+/// Ends scrubbing and resumes normal decoding from the most recent seek target
+- (void)endScrubbing;
+/// Returns \c YES if the \c SFBAudioPlayerNode is scrubbing
+@property (nonatomic, readonly) BOOL isScrubbing;
+/// The duration of each grain of audio decoded while scrubbing
+/// @note The default is \c 0.03. The duration is limited to the interval \c [0.01, 0.1].
+@property (nonatomic) NSTimeInterval scrubGrainDuration;
+
 #pragma mark - Delegate
 
 /// An optional delegate
@@ -248,6 +709,37 @@ NS_SWIFT_NAME(AudioPlayerNode.Delegate) @protocol SFBAudioPlayerNodeDelegate <NS
 /// Called to notify the delegate when rendering is complete for all available decoders
 /// @param audioPlayerNode The \c SFBAudioPlayerNode object
 - (void)audioPlayerNodeEndOfAudio:(SFBAudioPlayerNode *)audioPlayerNode NS_SWIFT_NAME(audioPlayerNodeEndOfAudio(_:));
+/// Called to notify the delegate that rendering ran out of audio from the current decoder and began outputting silence
+/// @param audioPlayerNode The \c SFBAudioPlayerNode object
+/// @param hostTime The host time at which the first frame of silence will reach the device
+- (void)audioPlayerNode:(SFBAudioPlayerNode *)audioPlayerNode underrunStartedAtHostTime:(uint64_t)hostTime NS_SWIFT_NAME(audioPlayerNode(_:underrunStartedAt:));
+/// Called to notify the delegate that rendering resumed after an underrun
+/// @param audioPlayerNode The \c SFBAudioPlayerNode object
+/// @param hostTime The host time at which audio from the current decoder will again reach the device
+/// @param silentFrameCount The number of frames of silence output during the underrun
+- (void)audioPlayerNode:(SFBAudioPlayerNode *)audioPlayerNode underrunEndedAtHostTime:(uint64_t)hostTime silentFrameCount:(uint64_t)silentFrameCount NS_SWIFT_NAME(audioPlayerNode(_:underrunEndedAt:silentFrameCount:));
+/// Called to notify the delegate that audio following a seek began rendering
+/// @warning Do not change any properties of \c decoder
+/// @param audioPlayerNode The \c SFBAudioPlayerNode object processing \c decoder
+/// @param decoder The decoder for which the seek completed
+/// @param frame The frame at which playback resumed, which may differ from the requested frame if the seek was inaccurate
+/// @param hostTime The host time at which audio from \c frame will reach the device
+- (void)audioPlayerNode:(SFBAudioPlayerNode *)audioPlayerNode seekCompleted:(id<SFBPCMDecoding>)decoder frame:(AVAudioFramePosition)frame hostTime:(uint64_t)hostTime NS_SWIFT_NAME(audioPlayerNode(_:seekCompleted:frame:hostTime:));
+/// Called to notify the delegate that buffered audio was discarded because of a seek or cancelation
+/// @param audioPlayerNode The \c SFBAudioPlayerNode object
+/// @param hostTime The host time of the first render cycle following the reset
+- (void)audioPlayerNode:(SFBAudioPlayerNode *)audioPlayerNode ringBufferResetAtHostTime:(uint64_t)hostTime NS_SWIFT_NAME(audioPlayerNode(_:ringBufferResetAt:));
+/// Called to notify the delegate that a decoder passed to \c -enqueueDecoderAsynchronously: was opened and enqueued
+/// @warning Do not change any properties of \c decoder
+/// @param audioPlayerNode The \c SFBAudioPlayerNode object processing \c decoder
+/// @param decoder The decoder that was enqueued
+/// @param latency The time taken to open \c decoder in seconds
+- (void)audioPlayerNode:(SFBAudioPlayerNode *)audioPlayerNode decoderOpened:(id<SFBPCMDecoding>)decoder latency:(NSTimeInterval)latency NS_SWIFT_NAME(audioPlayerNode(_:decoderOpened:latency:));
+/// Called to notify the delegate that a decoder passed to \c -enqueueDecoderAsynchronously: could not be opened or enqueued
+/// @param audioPlayerNode The \c SFBAudioPlayerNode object
+/// @param decoder The decoder that was not enqueued
+/// @param error The reason \c decoder was not enqueued
+- (void)audioPlayerNode:(SFBAudioPlayerNode *)audioPlayerNode failedToEnqueueDecoder:(id<SFBPCMDecoding>)decoder error:(NSError *)error NS_SWIFT_NAME(audioPlayerNode(_:failedToEnqueue:error:));
 /// Called to notify the delegate when an asynchronous error occurs
 /// @param audioPlayerNode The \c SFBAudioPlayerNode object
 /// @param error The error
@@ -262,7 +754,13 @@ extern NSErrorDomain const SFBAudioPlayerNodeErrorDomain NS_SWIFT_NAME(AudioPlay
 /// Possible \c NSError error codes used by \c SFBAudioPlayerNode
 typedef NS_ERROR_ENUM(SFBAudioPlayerNodeErrorDomain, SFBAudioPlayerNodeErrorCode) {
 	/// Format not supported
-	SFBAudioPlayerNodeErrorFormatNotSupported	= 0
+	SFBAudioPlayerNodeErrorFormatNotSupported	= 0,
+	/// The decoder queue is full
+	SFBAudioPlayerNodeErrorQueueFull			= 1,
+	/// The operation did not complete in time
+	SFBAudioPlayerNodeErrorTimedOut				= 2,
+	/// The decoder can't be decoded by the node's decoding executor
+	SFBAudioPlayerNodeErrorDecoderNotSupported	= 3
 } NS_SWIFT_NAME(AudioPlayerNode.ErrorCode);
 
 NS_ASSUME_NONNULL_END
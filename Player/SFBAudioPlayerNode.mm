@@ -7,27 +7,46 @@
 #import <algorithm>
 #import <atomic>
 #import <cmath>
+#import <cstring>
+#import <cstdlib>
+#import <deque>
+#import <memory>
 #import <mutex>
-#import <queue>
+#import <new>
 #import <thread>
+#import <vector>
 
+#import <Accelerate/Accelerate.h>
 #import <mach/mach_time.h>
 #import <os/log.h>
 
 #import "SFBAudioPlayerNode.h"
-
-#import "SFBAudioRingBuffer.hpp"
-#import "SFBRingBuffer.hpp"
-#import "SFBUnfairLock.hpp"
+#import "SFBAudioDecodingExecutor+Internal.h"
+
+#import "SFBBoundedMPSCQueue.hpp"
+#import "SFBEpochReclaimer.hpp"
+#import "SFBOutputMeter.hpp"
+#import "SFBPCMConverter.hpp"
+#import "SFBPCMRingBuffer.hpp"
+#import "SFBPeakLimiter.hpp"
+#import "SFBScheduledStart.hpp"
+#import "SFBSeqlock.hpp"
+#import "SFBSpectrumAnalyzer.hpp"
+#import "SFBSpectrumTap.hpp"
+#import "SFBSPSCQueue.hpp"
 
 #import "NSError+SFBURLPresentation.h"
 #import "SFBAudioDecoder.h"
+#import "SFBAudioFile.h"
+#import "SFBFanOutDecoder.h"
 
 const NSTimeInterval SFBUnknownTime = -1;
 NSErrorDomain const SFBAudioPlayerNodeErrorDomain = @"org.sbooth.AudioEngine.AudioPlayerNode";
 
 @interface SFBAudioPlayerNode ()
 - (void *)decoderThreadEntry;
+- (SFBAudioDecodingWorkResult)decodeNextChunk;
+- (void *)lookAheadThreadEntry;
 @end
 
 namespace {
@@ -42,12 +61,51 @@ enum eAudioPlayerNodeFlags : unsigned int {
 	eAudioPlayerNodeFlagMuteRequested				= 1u << 2,
 	eAudioPlayerNodeFlagRingBufferNeedsReset		= 1u << 3,
 	eAudioPlayerNodeFlagStopDecoderThread			= 1u << 4,
+	eAudioPlayerNodeFlagDecoderNeedsSpace			= 1u << 5,
+	eAudioPlayerNodeFlagDecoderNeedsSlot			= 1u << 6,
+	eAudioPlayerNodeFlagRingBufferPriming			= 1u << 7,
+	eAudioPlayerNodeFlagBufferingBoundsChanged		= 1u << 8,
+	eAudioPlayerNodeFlagRingBufferWasReset			= 1u << 9,
+	eAudioPlayerNodeFlagDecodingRequested			= 1u << 10,
+	eAudioPlayerNodeFlagSeekStaging					= 1u << 11,
+	eAudioPlayerNodeFlagSeekBufferReady				= 1u << 12,
+	eAudioPlayerNodeFlagSeekBufferActive			= 1u << 13,
+	eAudioPlayerNodeFlagScrubbing					= 1u << 14,
+	eAudioPlayerNodeFlagScrubTargetChanged			= 1u << 15,
+};
+
+/// Requests decoding and wakes the thread or executor performing it
+inline void RequestDecoding(std::atomic_uint& flags, dispatch_semaphore_t semaphore) noexcept
+{
+	flags.fetch_or(eAudioPlayerNodeFlagDecodingRequested);
+	dispatch_semaphore_signal(semaphore);
+}
+
+/// Events passed from the render block to the render events processor
+enum eAudioPlayerNodeRenderEvents : uint32_t {
+	eAudioPlayerNodeRenderEventRenderingStarted		= 1,
+	eAudioPlayerNodeRenderEventRenderingComplete	= 2,
+	eAudioPlayerNodeRenderEventEndOfAudio			= 3,
+	eAudioPlayerNodeRenderEventUnderrunStarted		= 4,
+	eAudioPlayerNodeRenderEventUnderrunEnded		= 5,
+	eAudioPlayerNodeRenderEventSeekCompleted		= 6,
+	eAudioPlayerNodeRenderEventRingBufferReset		= 7
+};
+
+/// Events recorded by the render block for diagnostics
+enum eAudioPlayerNodeRenderTraceEvents : uint32_t {
+	eAudioPlayerNodeRenderTraceEventShortRead				= 1,
+	eAudioPlayerNodeRenderTraceEventSilencePadding			= 2,
+	eAudioPlayerNodeRenderTraceEventMuteTransition			= 3,
+	eAudioPlayerNodeRenderTraceEventSequenceNumberChange	= 4
 };
 
-enum eAudioPlayerNodeRenderEventRingBufferCommands : uint32_t {
-	eAudioPlayerNodeRenderEventRingBufferCommandRenderingStarted	= 1,
-	eAudioPlayerNodeRenderEventRingBufferCommandRenderingComplete	= 2,
-	eAudioPlayerNodeRenderEventRingBufferCommandEndOfAudio			= 3
+/// Delegate notifications posted by the decoding thread
+enum eAudioPlayerNodeDecoderEvents : uint32_t {
+	eAudioPlayerNodeDecoderEventDecodingStarted		= 1,
+	eAudioPlayerNodeDecoderEventDecodingComplete	= 2,
+	eAudioPlayerNodeDecoderEventDecodingCanceled	= 3,
+	eAudioPlayerNodeDecoderEventEncounteredError	= 4
 };
 
 #pragma mark - Thread entry points
@@ -61,78 +119,613 @@ void * DecoderThreadEntry(void *arg)
 	return [playerNode decoderThreadEntry];
 }
 
+void * LookAheadThreadEntry(void *arg)
+{
+	pthread_setname_np("org.sbooth.AudioEngine.AudioPlayerNode.LookAheadThread");
+	pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+
+	SFBAudioPlayerNode *playerNode = (__bridge SFBAudioPlayerNode *)arg;
+	return [playerNode lookAheadThreadEntry];
+}
+
 #pragma mark - Constants
 
 const AVAudioFrameCount 	kRingBufferFrameCapacity 	= 16384;
 const AVAudioFrameCount 	kRingBufferChunkSize 		= 2048;
-const size_t 				kDecoderStateArraySize		= 8;
+const AVAudioFrameCount 	kDefaultMinimumChunkSize 	= 512;
+const size_t 				kDecoderStateListCapacity	= 16;
+const size_t 				kDecoderQueueCapacity		= 1024;
 const int64_t				kInvalidFramePosition 		= -1;
+const size_t 				kDefaultLookAheadMemoryLimit	= 8 * 1024 * 1024;
+const long 					kMaximumConcurrentOpens		= 4;
+const double 				kOpenSubmissionTimeout		= 10;
+const size_t 				kDecoderEventQueueCapacity	= 1024;
+const double 				kNotificationLagThreshold	= 0.05;
+const size_t 				kRenderTraceBufferCapacity	= 512;
+const size_t 				kRenderEventQueueCapacity	= 128;
+const double 				kRenderTraceDrainInterval	= 0.25;
+const double 				kIdleDecodingDeadlineDelay	= 1;
+const AVAudioFrameCount 	kSeekBufferFrameCapacity	= 4096;
+const AVAudioFrameCount 	kMaximumSeekCrossfadeFrameCount	= 4096;
+const double 				kMaximumCrossfadeDuration	= 10;
+const AVAudioFrameCount 	kCrossfadeMixFrameCapacity	= 4096;
+const float 				kPeakLimiterCeiling			= 0.891250938f; // -1 dBTP
+const uint32_t 				kDefaultSpectrumAnalysisFFTSize	= 2048;
+const double 				kReclamationRetryInterval	= 0.01;
+const double 				kDefaultScrubGrainDuration	= 0.03;
+const double 				kMinimumScrubGrainDuration	= 0.01;
+const double 				kMaximumScrubGrainDuration	= 0.1;
+const double 				kScrubGrainFadeDuration		= 0.002;
+const NSUInteger 			kConvertibleFormatCacheCapacity	= 32;
+
+// Participant slots in _reclaimer reserved for readers of _decoderStates
+const uint32_t 				kRenderBlockParticipant		= 0;
+const uint32_t 				kDecodingParticipant		= 1;
+const uint32_t 				kRenderEventsParticipant	= 2;
+
+#pragma mark - Buffer Lists
+
+/// Deleter for \c AudioBufferList objects allocated with \c std::calloc
+struct BufferListDeleter {
+	void operator()(AudioBufferList *bufferList) const noexcept
+	{
+		std::free(bufferList);
+	}
+};
+
+using unique_buffer_list_ptr = std::unique_ptr<AudioBufferList, BufferListDeleter>;
+
+/// Returns an \c AudioBufferList with \c bufferCount empty buffers or \c nullptr on error
+unique_buffer_list_ptr AllocateBufferList(UInt32 bufferCount) noexcept
+{
+	auto bufferList = static_cast<AudioBufferList *>(std::calloc(1, offsetof(AudioBufferList, mBuffers) + (sizeof(AudioBuffer) * std::max(bufferCount, 1u))));
+	if(bufferList)
+		bufferList->mNumberBuffers = bufferCount;
+	return unique_buffer_list_ptr(bufferList);
+}
+
+#pragma mark - Decoder State Pooling
+
+/// The maximum number of decoder state objects retained for reuse
+constexpr size_t kDecoderStatePoolCapacity = 8;
+/// The maximum number of sets of decoder state resources retained for reuse
+constexpr size_t kDecoderStateResourcePoolCapacity = 4;
+/// The number of region starts in each ring buffer at which ring buffer memory is wrapped in an \c AVAudioPCMBuffer
+constexpr uint32_t kRegionsPerRingBuffer = 8;
+/// The maximum number of buffers wrapping ring buffer memory retained by a set of decoder state resources
+constexpr size_t kRegionBufferCacheCapacity = 4 * kRegionsPerRingBuffer;
+
+/// Returns \c true if \c lhs and \c rhs refer to the same memory
+bool BufferListsReferToSameData(const AudioBufferList *lhs, const AudioBufferList *rhs) noexcept
+{
+	if(lhs->mNumberBuffers != rhs->mNumberBuffers)
+		return false;
+	for(UInt32 i = 0; i < lhs->mNumberBuffers; ++i) {
+		if(lhs->mBuffers[i].mData != rhs->mBuffers[i].mData)
+			return false;
+	}
+	return true;
+}
+
+/// An \c AVAudioPCMBuffer wrapping a region of ring buffer memory
+struct RegionBuffer
+{
+	/// The buffer list describing the region, which must outlive \c mBuffer
+	unique_buffer_list_ptr mBufferList;
+	/// The buffer
+	AVAudioPCMBuffer *mBuffer;
+};
+
+/// Buffers and converters used by decoder state that may be reused for audio in the same formats
+///
+/// Audio from consecutive decoders often has the same format, so reusing these objects avoids allocating them for
+/// each decoder.
+struct DecoderStateResources
+{
+	/// The decoder's processing format
+	AVAudioFormat *mProcessingFormat;
+	/// The output format
+	AVAudioFormat *mOutputFormat;
+	/// The capacity of \c mDecodeBuffer in frames
+	AVAudioFrameCount mFrameCapacity;
+
+	/// Buffer used internally for buffering during conversion
+	AVAudioPCMBuffer *mDecodeBuffer;
+	/// Buffer used when ring buffer memory can't be wrapped in an \c AVAudioPCMBuffer
+	AVAudioPCMBuffer *mOutputBuffer;
+	/// Converts audio from the processing format to the output format or \c nil if not required
+	AVAudioConverter *mConverter;
+	/// Buffer list referring to a region of ring buffer memory
+	unique_buffer_list_ptr mRegionBufferList;
+	/// The true peak limiter or \c nullptr if none
+	std::unique_ptr<SFB::PeakLimiter> mLimiter;
+	/// The staging buffer or \c nullptr if none
+	std::unique_ptr<SFB::PCMRingBuffer> mStagingBuffer;
+
+	/// Buffers wrapping regions of ring buffer memory
+	RegionBuffer mRegionBuffers [kRegionBufferCacheCapacity];
+	/// The number of valid entries in \c mRegionBuffers
+	size_t mRegionBufferCount;
+
+	DecoderStateResources(AVAudioFormat *processingFormat, AVAudioFormat *outputFormat, AVAudioFrameCount frameCapacity) noexcept
+	: mProcessingFormat(processingFormat), mOutputFormat(outputFormat), mFrameCapacity(frameCapacity), mDecodeBuffer(nil), mOutputBuffer(nil), mConverter(nil), mRegionBuffers{}, mRegionBufferCount(0)
+	{}
+
+	/// Returns \c true if these resources may be used for the specified formats and capacity
+	bool IsCompatible(AVAudioFormat *processingFormat, AVAudioFormat *outputFormat, AVAudioFrameCount frameCapacity) const noexcept
+	{
+		return mFrameCapacity == frameCapacity && [mProcessingFormat isEqual:processingFormat] && [mOutputFormat isEqual:outputFormat];
+	}
+};
+
+/// A bounded free list of storage for objects of a single size
+class StorageFreeList
+{
+
+public:
+
+	StorageFreeList() noexcept
+	: mCount(0), mSize(0)
+	{}
+
+	// This class is non-copyable
+	StorageFreeList(const StorageFreeList& rhs) = delete;
+
+	// This class is non-assignable
+	StorageFreeList& operator=(const StorageFreeList& rhs) = delete;
+
+	/// Returns storage for an object of \c size bytes or \c nullptr on error
+	void * Allocate(std::size_t size) noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			if(mCount > 0 && size == mSize)
+				return mStorage[--mCount];
+		}
+		return ::operator new(size, std::nothrow);
+	}
+
+	/// Returns storage obtained from \c Allocate() to the free list
+	void Deallocate(void *ptr, std::size_t size) noexcept
+	{
+		if(!ptr)
+			return;
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			if(mCount < kDecoderStatePoolCapacity && (mCount == 0 || size == mSize)) {
+				mSize = size;
+				mStorage[mCount++] = ptr;
+				return;
+			}
+		}
+		::operator delete(ptr);
+	}
+
+private:
+
+	/// The lock protecting all members
+	std::mutex mLock;
+	/// Storage available for reuse
+	void *mStorage [kDecoderStatePoolCapacity];
+	/// The number of valid entries in \c mStorage
+	size_t mCount;
+	/// The size of the storage in \c mStorage
+	std::size_t mSize;
+
+};
+
+/// A pool of reusable decoder state objects and resources shared by all player nodes
+///
+/// Decoder state is created on the decoding thread and destroyed during reclamation, so without pooling every
+/// track transition allocates and frees the same objects.
+class DecoderStatePool
+{
+
+public:
+
+	/// Returns the shared pool
+	static DecoderStatePool& SharedPool() noexcept
+	{
+		// The pool is never destroyed so decoder state may be released during process exit
+		static auto pool = new DecoderStatePool;
+		return *pool;
+	}
+
+	DecoderStatePool() noexcept
+	: mResourceCount(0)
+	{}
+
+	// This class is non-copyable
+	DecoderStatePool(const DecoderStatePool& rhs) = delete;
+
+	// This class is non-assignable
+	DecoderStatePool& operator=(const DecoderStatePool& rhs) = delete;
+
+	/// Returns the storage for decoder state objects
+	inline StorageFreeList& DecoderStateStorage() noexcept
+	{
+		return mDecoderStateStorage;
+	}
+
+	/// Returns the storage for decoder state lists
+	inline StorageFreeList& DecoderStateListStorage() noexcept
+	{
+		return mDecoderStateListStorage;
+	}
+
+	/// Returns resources compatible with the specified formats and capacity, which may be empty, or \c nullptr on error
+	std::unique_ptr<DecoderStateResources> AcquireResources(AVAudioFormat *processingFormat, AVAudioFormat *outputFormat, AVAudioFrameCount frameCapacity) noexcept
+	{
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			for(size_t i = 0; i < mResourceCount; ++i) {
+				if(mResources[i]->IsCompatible(processingFormat, outputFormat, frameCapacity)) {
+					auto resources = std::move(mResources[i]);
+					std::move(mResources + i + 1, mResources + mResourceCount, mResources + i);
+					--mResourceCount;
+					return resources;
+				}
+			}
+		}
+		return std::unique_ptr<DecoderStateResources>(new (std::nothrow) DecoderStateResources(processingFormat, outputFormat, frameCapacity));
+	}
+
+	/// Returns \c resources to the pool, discarding the least recently returned resources if the pool is full
+	void RecycleResources(std::unique_ptr<DecoderStateResources> resources) noexcept
+	{
+		if(!resources)
+			return;
+		std::unique_ptr<DecoderStateResources> discarded;
+		{
+			std::lock_guard<std::mutex> lock(mLock);
+			if(mResourceCount == kDecoderStateResourcePoolCapacity) {
+				discarded = std::move(mResources[0]);
+				std::move(mResources + 1, mResources + mResourceCount, mResources);
+				--mResourceCount;
+			}
+			mResources[mResourceCount++] = std::move(resources);
+		}
+		// discarded is destroyed outside the lock
+	}
+
+private:
+
+	/// Storage for decoder state objects
+	StorageFreeList mDecoderStateStorage;
+	/// Storage for decoder state lists
+	StorageFreeList mDecoderStateListStorage;
+	/// The lock protecting \c mResources and \c mResourceCount
+	std::mutex mLock;
+	/// Resources available for reuse, least recently returned first
+	std::unique_ptr<DecoderStateResources> mResources [kDecoderStateResourcePoolCapacity];
+	/// The number of valid entries in \c mResources
+	size_t mResourceCount;
+
+};
 
 #pragma mark - Decoder State
 
+/// Settings for sample rate conversion performed by \c DecoderStateData
+struct SampleRateConverterSettings
+{
+	/// The sample rate converter quality
+	AVAudioQuality mQuality;
+	/// The sample rate converter algorithm
+	NSString *mAlgorithm;
+};
+
 /// State data for tracking/syncing decoding progress
+///
+/// When the decoder's sample rate differs from the output sample rate \c mFramesConverted and \c mFramesRendered
+/// count frames at the output sample rate while all other frame counts and positions use the decoder's sample rate
 struct DecoderStateData {
-	using atomic_ptr = std::atomic<DecoderStateData *>;
-
-	static const AVAudioFrameCount kDefaultBufferSize = 1024;
-
 	enum eDecoderStateDataFlags : unsigned int {
 		eCancelDecodingFlag		= 1u << 0,
 		eDecodingStartedFlag	= 1u << 1,
 		eDecodingCompleteFlag	= 1u << 2,
 		eRenderingStartedFlag	= 1u << 3,
 		eRenderingCompleteFlag	= 1u << 4,
-		eMarkedForRemovalFlag 	= 1u << 5
+		eMarkedForRemovalFlag 	= 1u << 5,
+		eStagingStoppedFlag		= 1u << 6,
+		eReplayGainPendingFlag	= 1u << 7
 	};
 
 	/// Monotonically increasing instance counter
 	const uint64_t			mSequenceNumber;
 
+	/// The decoder's sample rate
+	const double			mSampleRate;
+
 	/// Decoder state data flags
 	std::atomic_uint 		mFlags;
 	/// The number of frames decoded
 	std::atomic_int64_t 	mFramesDecoded;
-	/// The number of frames converted
+	/// The number of frames converted, at the output sample rate
 	std::atomic_int64_t 	mFramesConverted;
-	/// The number of frames rendered
+	/// The number of frames rendered, at the output sample rate
 	std::atomic_int64_t 	mFramesRendered;
 	/// The total number of audio frames
 	std::atomic_int64_t 	mFrameLength;
 	/// The desired seek offset
 	std::atomic_int64_t 	mFrameToSeek;
+	/// The value of \c mFramesRendered at which audio from the following decoder is mixed in, or \c kInvalidFramePosition if none
+	std::atomic_int64_t 	mCrossfadeStartFrame;
+
+	/// Audio decoded ahead of playback by the look-ahead thread or \c nullptr if not staged
+	std::unique_ptr<SFB::PCMRingBuffer> mStagingBuffer;
+	/// The lock held by the look-ahead thread while decoding into \c mStagingBuffer
+	std::mutex				mStagingLock;
 
 //private:
 	/// Decodes audio from the source representation to PCM
 	id <SFBPCMDecoding> 	mDecoder;
-	/// Converts audio from the decoder's processing format to another PCM variant at the same sample rate
+	/// Converts audio from the decoder's processing format to the output format
+	/// @note This is \c nil unless conversion is required and unsupported by \c mPCMConverter
 	AVAudioConverter 		*mConverter;
+	/// The format of the audio supplied by this object
+	AVAudioFormat 			*mOutputFormat;
 private:
+	/// Converts audio from the decoder's processing format to the output format using a specialized kernel
+	SFB::PCMConverter		mPCMConverter;
 	/// Buffer used internally for buffering during conversion
 	AVAudioPCMBuffer 		*mDecodeBuffer;
+	/// Buffer used when ring buffer memory can't be wrapped in an \c AVAudioPCMBuffer
+	AVAudioPCMBuffer 		*mOutputBuffer;
+	/// The number of frames in \c mOutputBuffer already written to a ring buffer
+	AVAudioFrameCount		mOutputBufferOffset;
+	/// Buffer list referring to a region of ring buffer memory
+	unique_buffer_list_ptr	mRegionBufferList;
+	/// \c true if the decoder's processing format differs from the output format
+	bool					mRequiresConversion;
+	/// \c true if the decoder's sample rate differs from the output sample rate
+	bool					mRequiresResampling;
+	/// \c true if the decoder has no more audio to supply to \c mConverter for resampling
+	bool					mResamplerInputComplete;
+	/// \c true if all audio has been decoded and converted, although some may remain in \c mLimiter
+	bool					mEndOfStream;
+	/// The linear gain applied to converted audio
+	float					mGain;
+	/// The true peak limiter applied to converted audio or \c nullptr if none
+	std::unique_ptr<SFB::PeakLimiter> mLimiter;
+	/// The number of frames of silence remaining to be discarded from the start of \c mLimiter output
+	AVAudioFrameCount		mLimiterFramesToDiscard;
+	/// The number of frames remaining in \c mLimiter once the end of the stream is reached
+	AVAudioFrameCount		mLimiterFramesToFlush;
+	/// The ratio of the output sample rate to the decoder's sample rate
+	double					mSampleRateRatio;
+	/// The decoder's frame position when this object was created
+	AVAudioFramePosition	mInitialFramePosition;
+	/// Pooled resources holding reusable objects when they are not in use, or \c nullptr if none
+	std::unique_ptr<DecoderStateResources> mResources;
 	/// Next sequence number to use
-	static uint64_t			sSequenceNumber;
+	static std::atomic_uint64_t	sSequenceNumber;
 
 public:
-	DecoderStateData(id <SFBPCMDecoding> decoder, AVAudioFormat *format, AVAudioFrameCount frameCapacity = kDefaultBufferSize)
-	: mSequenceNumber(sSequenceNumber++), mFlags(0), mFramesDecoded(0), mFramesConverted(0), mFramesRendered(0), mFrameLength(decoder.frameLength), mFrameToSeek(kInvalidFramePosition), mDecoder(decoder), mConverter(nil), mDecodeBuffer(nil)
+	DecoderStateData(id <SFBPCMDecoding> decoder, AVAudioFormat *format, AVAudioFrameCount frameCapacity, const SampleRateConverterSettings& sampleRateConverterSettings, float gain, bool limitPeaks)
+	: mSequenceNumber(sSequenceNumber++), mSampleRate(decoder.processingFormat.sampleRate), mFlags(0), mFramesDecoded(0), mFramesConverted(0), mFramesRendered(0), mFrameLength(decoder.frameLength), mFrameToSeek(kInvalidFramePosition), mCrossfadeStartFrame(kInvalidFramePosition), mDecoder(decoder), mConverter(nil), mOutputFormat(format), mDecodeBuffer(nil), mOutputBuffer(nil), mOutputBufferOffset(0), mRequiresConversion(true), mRequiresResampling(false), mResamplerInputComplete(false), mEndOfStream(false), mGain(gain), mLimiterFramesToDiscard(0), mLimiterFramesToFlush(0), mSampleRateRatio(1), mInitialFramePosition(decoder.framePosition)
+	{
+		AVAudioFormat *processingFormat = mDecoder.processingFormat;
+
+		// Reuse the objects from an earlier decoder with the same formats if possible
+		mResources = DecoderStatePool::SharedPool().AcquireResources(processingFormat, format, frameCapacity);
+		if(mResources) {
+			mDecodeBuffer = mResources->mDecodeBuffer;
+			mOutputBuffer = mResources->mOutputBuffer;
+			mRegionBufferList = std::move(mResources->mRegionBufferList);
+		}
+
+		if(!mDecodeBuffer)
+			mDecodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:processingFormat frameCapacity:frameCapacity];
+		if(!mOutputBuffer)
+			mOutputBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format frameCapacity:frameCapacity];
+		mOutputBuffer.frameLength = 0;
+		if(!mRegionBufferList)
+			mRegionBufferList = AllocateBufferList(format.isInterleaved ? 1 : format.channelCount);
+
+		mRequiresResampling = processingFormat.sampleRate != format.sampleRate;
+		if(mRequiresResampling)
+			mSampleRateRatio = format.sampleRate / processingFormat.sampleRate;
+
+		// Decoders producing the output format directly don't require conversion
+		mRequiresConversion = ![processingFormat isEqual:format];
+		if(mRequiresConversion) {
+			// AVAudioConverter is only used for conversions without a specialized kernel, including sample rate conversion and channel mapping
+			auto channelMappingRequired = processingFormat.channelCount != format.channelCount || (processingFormat.channelLayout && format.channelLayout && ![processingFormat.channelLayout isEqual:format.channelLayout]);
+			if(mRequiresResampling || channelMappingRequired || !mPCMConverter.Configure(*(processingFormat.streamDescription), *(format.streamDescription))) {
+				if(mResources && mResources->mConverter) {
+					mConverter = mResources->mConverter;
+					[mConverter reset];
+				}
+				else
+					mConverter = [[AVAudioConverter alloc] initFromFormat:processingFormat toFormat:format];
+				// Mix channels absent from the output format into those present instead of discarding them
+				if(processingFormat.channelCount > format.channelCount)
+					mConverter.downmix = YES;
+				if(mRequiresResampling) {
+					mConverter.sampleRateConverterQuality = sampleRateConverterSettings.mQuality;
+					mConverter.sampleRateConverterAlgorithm = sampleRateConverterSettings.mAlgorithm;
+				}
+			}
+		}
+
+		if(limitPeaks) {
+			// A pooled limiter is already configured for the output format
+			if(mResources && mResources->mLimiter) {
+				mLimiter = std::move(mResources->mLimiter);
+				ResetLimiter();
+			}
+			else {
+				mLimiter = std::make_unique<SFB::PeakLimiter>();
+				if(mLimiter->Configure(format.channelCount, format.sampleRate, kPeakLimiterCeiling))
+					ResetLimiter();
+				else {
+					os_log_error(_audioPlayerNodeLog, "Unable to configure peak limiter");
+					mLimiter.reset();
+				}
+			}
+		}
+
+		if(mInitialFramePosition != 0) {
+			mFramesDecoded.store(mInitialFramePosition);
+			mFramesConverted.store(ConvertToOutputFrames(mInitialFramePosition));
+			mFramesRendered.store(ConvertToOutputFrames(mInitialFramePosition));
+		}
+	}
+
+	~DecoderStateData()
+	{
+		if(!mResources)
+			return;
+
+		// Return the reusable objects to the pool
+		mResources->mDecodeBuffer = mDecodeBuffer;
+		mResources->mOutputBuffer = mOutputBuffer;
+		mResources->mConverter = mConverter;
+		mResources->mRegionBufferList = std::move(mRegionBufferList);
+		if(mLimiter)
+			mResources->mLimiter = std::move(mLimiter);
+		if(mStagingBuffer)
+			mResources->mStagingBuffer = std::move(mStagingBuffer);
+
+		DecoderStatePool::SharedPool().RecycleResources(std::move(mResources));
+	}
+
+	// This class is non-copyable
+	DecoderStateData(const DecoderStateData& rhs) = delete;
+
+	// This class is non-assignable
+	DecoderStateData& operator=(const DecoderStateData& rhs) = delete;
+
+	/// Returns pooled storage for a \c DecoderStateData object
+	static void * operator new(std::size_t size, const std::nothrow_t&) noexcept
+	{
+		return DecoderStatePool::SharedPool().DecoderStateStorage().Allocate(size);
+	}
+
+	/// Returns storage to the pool
+	static void operator delete(void *ptr, std::size_t size) noexcept
+	{
+		DecoderStatePool::SharedPool().DecoderStateStorage().Deallocate(ptr, size);
+	}
+
+	/// Returns storage to the pool if the constructor throws
+	static void operator delete(void *ptr, const std::nothrow_t&) noexcept
+	{
+		DecoderStatePool::SharedPool().DecoderStateStorage().Deallocate(ptr, sizeof(DecoderStateData));
+	}
+
+	/// Allocates a staging buffer capable of holding at least \c frameCapacity frames
+	bool AllocateStagingBuffer(AVAudioFrameCount frameCapacity)
 	{
-		mConverter = [[AVAudioConverter alloc] initFromFormat:mDecoder.processingFormat toFormat:format];
-		// The logic in this class assumes no SRC is performed by mConverter
-		assert(mConverter.inputFormat.sampleRate == mConverter.outputFormat.sampleRate);
-		mDecodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:mConverter.inputFormat frameCapacity:frameCapacity];
+		// Reuse a pooled staging buffer if it is large enough
+		if(mResources && mResources->mStagingBuffer && mResources->mStagingBuffer->CapacityFrames() >= frameCapacity) {
+			mResources->mStagingBuffer->Reset();
+			mStagingBuffer = std::move(mResources->mStagingBuffer);
+			return true;
+		}
+
+		auto stagingBuffer = std::make_unique<SFB::PCMRingBuffer>();
+		if(!stagingBuffer->Allocate(*(mOutputFormat.streamDescription), frameCapacity))
+			return false;
+		mStagingBuffer = std::move(stagingBuffer);
+		return true;
+	}
+
+	/// Returns \c true if audio decoded ahead of playback is available
+	inline bool HasStagedAudio() const noexcept
+	{
+		return mStagingBuffer && mStagingBuffer->FramesAvailableToRead() > 0;
+	}
+
+	/// Returns \c true if all audio has been decoded and delivered to the caller
+	inline bool IsDecodingComplete() const noexcept
+	{
+		return (mFlags.load() & eDecodingCompleteFlag) && !HasStagedAudio();
+	}
+
+	/// Returns the number of frames converted and delivered to the caller, at the output sample rate
+	inline AVAudioFramePosition FramesDelivered() const noexcept
+	{
+		return mFramesConverted.load() - (mStagingBuffer ? mStagingBuffer->FramesAvailableToRead() : 0);
+	}
+
+	/// Moves at most \c frameLength frames of staged audio directly into the write region of \c ringBuffer
+	/// @return The number of frames moved
+	AVAudioFrameCount ReadStagedAudio(SFB::PCMRingBuffer& ringBuffer, AVAudioFrameCount frameLength) noexcept
+	{
+		if(!mStagingBuffer || !mRegionBufferList)
+			return 0;
+
+		auto writeVector = ringBuffer.GetWriteVector();
+		auto framesToRead = std::min({mStagingBuffer->FramesAvailableToRead(), frameLength, writeVector.mFirst.mFrameCount});
+		if(framesToRead == 0 || !ringBuffer.GetBufferList({ writeVector.mFirst.mFrameOffset, framesToRead }, mRegionBufferList.get()))
+			return 0;
+
+		auto framesRead = mStagingBuffer->Read(mRegionBufferList.get(), framesToRead);
+		ringBuffer.CommitWrite(framesRead);
+		return framesRead;
+	}
+
+	/// Delivers at most \c frameLength frames to \c ringBuffer, preferring audio decoded ahead of playback
+	/// @param framesWritten The number of frames written to \c ringBuffer
+	bool ProduceAudio(SFB::PCMRingBuffer& ringBuffer, AVAudioFrameCount frameLength, AVAudioFrameCount& framesWritten, NSError **error = nullptr)
+	{
+		framesWritten = 0;
+		if(HasStagedAudio()) {
+			framesWritten = ReadStagedAudio(ringBuffer, frameLength);
+			return true;
+		}
+		if(mFlags.load() & eDecodingCompleteFlag)
+			return true;
+		return DecodeAudio(ringBuffer, frameLength, framesWritten, error);
+	}
+
+	/// Decodes a chunk of audio into \c mStagingBuffer
+	/// @note \c mStagingLock must be held by the caller
+	/// @return \c true if audio was decoded and staged
+	bool StageAudio(NSError **error = nullptr)
+	{
+		if(!mStagingBuffer || (mFlags.load() & (eDecodingCompleteFlag | eCancelDecodingFlag)))
+			return false;
+		if(mStagingBuffer->FramesAvailableToWrite() < mDecodeBuffer.frameCapacity)
+			return false;
+
+		AVAudioFrameCount framesWritten = 0;
+		if(!DecodeAudio(*mStagingBuffer, mDecodeBuffer.frameCapacity, framesWritten, error))
+			return false;
 
-		AVAudioFramePosition framePosition = decoder.framePosition;
-		if(framePosition != 0) {
-			mFramesDecoded.store(framePosition);
-			mFramesConverted.store(framePosition);
-			mFramesRendered.store(framePosition);
+		return framesWritten > 0;
+	}
+
+	/// Attempts to restore the decoder to the frame position it had when this object was created
+	void RewindDecoder() noexcept
+	{
+		if(mDecoder.framePosition != mInitialFramePosition && mDecoder.supportsSeeking && [mDecoder seekToFrame:mInitialFramePosition error:nil]) {
+			[mConverter reset];
+			mResamplerInputComplete = false;
 		}
 	}
 
+	/// Converts \c frame from the decoder's sample rate to the output sample rate
+	inline AVAudioFramePosition ConvertToOutputFrames(AVAudioFramePosition frame) const noexcept
+	{
+		if(!mRequiresResampling || frame < 0)
+			return frame;
+		return static_cast<AVAudioFramePosition>(std::llround(frame * mSampleRateRatio));
+	}
+
+	/// Converts \c frame from the output sample rate to the decoder's sample rate
+	inline AVAudioFramePosition ConvertToDecoderFrames(AVAudioFramePosition frame) const noexcept
+	{
+		if(!mRequiresResampling || frame < 0)
+			return frame;
+		return static_cast<AVAudioFramePosition>(std::llround(frame / mSampleRateRatio));
+	}
+
 	inline AVAudioFramePosition FramePosition() const noexcept
 	{
 		int64_t seek = mFrameToSeek.load();
-		return seek == kInvalidFramePosition ? mFramesRendered.load() : seek;
+		return seek == kInvalidFramePosition ? ConvertToDecoderFrames(mFramesRendered.load()) : seek;
 	}
 
 	inline AVAudioFramePosition FrameLength() const noexcept
@@ -140,154 +733,792 @@ public:
 		return mFrameLength.load();
 	}
 
-	bool DecodeAudio(AVAudioPCMBuffer *buffer, NSError **error = nullptr)
+	/// Multiplies the linear gain applied to converted audio by \c gain
+	/// @note This must be called by the thread decoding this object before it decodes any audio
+	inline void ApplyGain(float gain) noexcept
 	{
-#if DEBUG
-		assert(buffer.frameCapacity == mDecodeBuffer.frameCapacity);
-#endif
+		mGain *= gain;
+	}
+
+	/// Returns the maximum number of frames that may be decoded at once
+	inline AVAudioFrameCount DecodeBufferCapacity() const noexcept
+	{
+		return mDecodeBuffer.frameCapacity;
+	}
 
-		if(![mDecoder decodeIntoBuffer:mDecodeBuffer frameLength:mDecodeBuffer.frameCapacity error:error])
+	/// Decodes at most \c frameLength frames directly into the write region of \c ringBuffer
+	///
+	/// Audio is decoded in place when the write region begins at a region start and copied from \c mOutputBuffer
+	/// otherwise. Copies end at the next region start so later writes may be performed in place. Resampled audio is
+	/// always copied since the resampler fills its output buffer completely; audio that doesn't fit in the write region
+	/// is retained and written first by the next call.
+	/// Fewer than \c frameLength frames are decoded if the contiguous space available in \c ringBuffer is smaller.
+	/// @param framesWritten The number of frames written to \c ringBuffer
+	bool DecodeAudio(SFB::PCMRingBuffer& ringBuffer, AVAudioFrameCount frameLength, AVAudioFrameCount& framesWritten, NSError **error = nullptr)
+	{
+		framesWritten = 0;
+
+		if(!mOutputBuffer || !mRegionBufferList) {
+			if(error)
+				*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
 			return false;
+		}
 
-		if(mDecodeBuffer.frameLength == 0) {
-			mFlags.fetch_or(eDecodingCompleteFlag);
+		auto writeVector = ringBuffer.GetWriteVector();
+		frameLength = std::min({frameLength, writeVector.mFirst.mFrameCount, mDecodeBuffer.frameCapacity});
+		if(frameLength == 0)
+			return true;
+
+		if(mOutputBufferOffset < mOutputBuffer.frameLength) {
+			framesWritten = WriteOutputBuffer(ringBuffer, frameLength);
 			return true;
 		}
 
-		this->mFramesDecoded.fetch_add(mDecodeBuffer.frameLength);
+		if(!mRequiresResampling) {
+			const auto regionFrameCount = RegionFrameCount(ringBuffer);
+			const auto frameOffset = writeVector.mFirst.mFrameOffset;
+			if(frameOffset % regionFrameCount != 0)
+				frameLength = std::min(frameLength, regionFrameCount - frameOffset % regionFrameCount);
+			else if(@available(macOS 11.0, iOS 14.0, tvOS 14.0, *)) {
+				AVAudioPCMBuffer *buffer = BufferForRegion(ringBuffer, frameOffset);
+				if(buffer) {
+					// Writing whole regions keeps the next write at a region start
+					if(frameLength > regionFrameCount)
+						frameLength -= frameLength % regionFrameCount;
+					if(!DecodeAudio(buffer, frameLength, error))
+						return false;
+					framesWritten = buffer.frameLength;
+					ringBuffer.CommitWrite(framesWritten);
+					RecordFramesWritten(framesWritten);
+					return true;
+				}
+			}
+		}
 
-		// Only PCM to PCM conversions are performed
-		if(![mConverter convertToBuffer:buffer fromBuffer:mDecodeBuffer error:error])
+		if(!DecodeAudio(mOutputBuffer, mRequiresResampling ? mOutputBuffer.frameCapacity : frameLength, error))
 			return false;
-		mFramesConverted.fetch_add(buffer.frameLength);
+		mOutputBufferOffset = 0;
 
+		framesWritten = WriteOutputBuffer(ringBuffer, frameLength);
 		return true;
 	}
 
-	/// Seeks to the frame specified by \c mFrameToSeek
-	bool PerformSeek()
+	/// Seeks the decoder to \c frame without changing \c mFrameToSeek or \c mFramesRendered
+	/// @return The frame at which the decoder is positioned or \c kInvalidFramePosition on error
+	AVAudioFramePosition SeekDecoder(AVAudioFramePosition frame)
 	{
-		AVAudioFramePosition seekOffset = mFrameToSeek.load();
-
-		os_log_debug(_audioPlayerNodeLog, "Seeking to frame %lld", seekOffset);
+		os_log_debug(_audioPlayerNodeLog, "Seeking to frame %lld", frame);
+
+		// Any audio decoded ahead of playback or held back for a crossfade is no longer valid
+		mCrossfadeStartFrame.store(kInvalidFramePosition);
+		mOutputBuffer.frameLength = 0;
+		mOutputBufferOffset = 0;
+		if(mStagingBuffer) {
+			mStagingBuffer->Reset();
+			mFlags.fetch_and(~eDecodingCompleteFlag);
+		}
 
-		if([mDecoder seekToFrame:seekOffset error:nil])
-			// Reset the converter to flush any buffers
+		if([mDecoder seekToFrame:frame error:nil]) {
+			// Reset the converter and limiter to flush any buffers
 			[mConverter reset];
+			mResamplerInputComplete = false;
+			mEndOfStream = false;
+			ResetLimiter();
+			// Decoding resumes at frame even if the decoder was exhausted
+			mFlags.fetch_and(~eDecodingCompleteFlag);
+		}
 		else
-			os_log_debug(_audioPlayerNodeLog, "Error seeking to frame %lld", seekOffset);
+			os_log_debug(_audioPlayerNodeLog, "Error seeking to frame %lld", frame);
 
 		AVAudioFramePosition newFrame = mDecoder.framePosition;
-		if(newFrame != seekOffset) {
-			os_log_debug(_audioPlayerNodeLog, "Inaccurate seek to frame %lld, got %lld", seekOffset, newFrame);
-			seekOffset = newFrame;
-		}
-
-		// Update the seek request
-		mFrameToSeek.store(kInvalidFramePosition);
+		if(newFrame != frame)
+			os_log_debug(_audioPlayerNodeLog, "Inaccurate seek to frame %lld, got %lld", frame, newFrame);
 
 		// Update the frame counters accordingly
 		// A seek is handled in essentially the same way as initial playback
 		if(newFrame != kInvalidFramePosition) {
 			mFramesDecoded.store(newFrame);
-			mFramesConverted.store(seekOffset);
-			mFramesRendered.store(seekOffset);
+			mFramesConverted.store(ConvertToOutputFrames(newFrame));
 		}
 
-		return newFrame != kInvalidFramePosition;
+		return newFrame;
 	}
 
-};
-
-uint64_t DecoderStateData::sSequenceNumber = 0;
-using DecoderQueue = std::queue<id <SFBPCMDecoding>>;
+	/// Seeks to the frame specified by \c mFrameToSeek
+	/// @return The frame at which the decoder is positioned or \c kInvalidFramePosition on error
+	AVAudioFramePosition PerformSeek()
+	{
+		AVAudioFramePosition newFrame = SeekDecoder(mFrameToSeek.load());
 
-/// Returns the element in \c decoders with the smallest sequence number that has not completed rendering and has not been marked for removal
-DecoderStateData * GetActiveDecoderStateWithSmallestSequenceNumber(const DecoderStateData::atomic_ptr *decoderStateArray, const size_t& count)
-{
-	DecoderStateData *result = nullptr;
-	for(size_t i = 0; i < count; ++i) {
-		auto decoderState = decoderStateArray[i].load();
-		if(!decoderState)
-			continue;
+		// Update the seek request
+		mFrameToSeek.store(kInvalidFramePosition);
 
-		auto flags = decoderState->mFlags.load();
-		if(flags & DecoderStateData::eMarkedForRemovalFlag || flags & DecoderStateData::eRenderingCompleteFlag)
-			continue;
+		if(newFrame != kInvalidFramePosition)
+			mFramesRendered.store(ConvertToOutputFrames(newFrame));
 
-		if(!result)
-			result = decoderState;
-		else if(decoderState->mSequenceNumber < result->mSequenceNumber)
-			result = decoderState;
+		return newFrame;
 	}
 
-	return result;
-}
-
-/// Returns the element in \c decoders with the smallest sequence number greater than \c sequenceNumber that has not completed rendering and has not been marked for removal
-DecoderStateData * GetActiveDecoderStateFollowingSequenceNumber(const DecoderStateData::atomic_ptr *decoderStateArray, const size_t& count, const uint64_t& sequenceNumber)
-{
-	DecoderStateData *result = nullptr;
-	for(size_t i = 0; i < count; ++i) {
-		auto decoderState = decoderStateArray[i].load();
-		if(!decoderState)
-			continue;
+	/// Returns this object to the state it had before decoding began so its audio may be decoded again
+	/// @return \c true on success, \c false if the decoder could not be positioned at the frame it had when this object was created
+	bool Restart()
+	{
+		if(mDecoder.framePosition != mInitialFramePosition) {
+			if(!mDecoder.supportsSeeking || SeekDecoder(mInitialFramePosition) != mInitialFramePosition)
+				return false;
+		}
 
-		auto flags = decoderState->mFlags.load();
-		if(flags & DecoderStateData::eMarkedForRemovalFlag || flags & DecoderStateData::eRenderingCompleteFlag)
-			continue;
+		mFrameToSeek.store(kInvalidFramePosition);
+		mFramesRendered.store(ConvertToOutputFrames(mInitialFramePosition));
+		mFlags.fetch_and(~(eDecodingStartedFlag | eDecodingCompleteFlag | eRenderingStartedFlag));
 
-		if(!result && decoderState->mSequenceNumber > sequenceNumber)
-			result = decoderState;
-		else if(result && decoderState->mSequenceNumber > sequenceNumber && decoderState->mSequenceNumber < result->mSequenceNumber)
-			result = decoderState;
+		return true;
 	}
 
-	return result;
-}
+private:
+	/// Returns the number of frames between region starts in \c ringBuffer
+	static uint32_t RegionFrameCount(const SFB::PCMRingBuffer& ringBuffer) noexcept
+	{
+		return std::max(ringBuffer.CapacityFrames() / kRegionsPerRingBuffer, 1u);
+	}
 
-/// Returns the element in \c decoders with the sequence number equal to \c sequenceNumber that has not been marked for removal
-DecoderStateData * GetDecoderStateWithSequenceNumber(const DecoderStateData::atomic_ptr *decoderStateArray, const size_t& count, const uint64_t& sequenceNumber)
-{
-	for(size_t i = 0; i < count; ++i) {
-		auto decoderState = decoderStateArray[i].load();
-		if(!decoderState)
-			continue;
+	/// Returns an empty buffer wrapping the ring buffer memory from the region start at \c frameOffset to the end of storage
+	///
+	/// Buffers are retained and never replaced, so decoding into a ring buffer allocates only the first time each of
+	/// its region starts is used.
+	/// @return A buffer or \c nil if none is available
+	AVAudioPCMBuffer * BufferForRegion(const SFB::PCMRingBuffer& ringBuffer, uint32_t frameOffset) noexcept API_AVAILABLE(macos(11.0), ios(14.0), tvos(14.0))
+	{
+		const auto frameCapacity = ringBuffer.CapacityFrames() - frameOffset;
+		if(!mResources || !ringBuffer.GetBufferList({ frameOffset, frameCapacity }, mRegionBufferList.get()))
+			return nil;
 
-		if(decoderState->mFlags.load() & DecoderStateData::eMarkedForRemovalFlag)
-			continue;
+		for(size_t i = 0; i < mResources->mRegionBufferCount; ++i) {
+			const auto& regionBuffer = mResources->mRegionBuffers[i];
+			if(regionBuffer.mBuffer.frameCapacity == frameCapacity && BufferListsReferToSameData(regionBuffer.mBufferList.get(), mRegionBufferList.get())) {
+				regionBuffer.mBuffer.frameLength = 0;
+				return regionBuffer.mBuffer;
+			}
+		}
 
-		if(decoderState->mSequenceNumber == sequenceNumber)
-			return decoderState;
-	}
+		if(mResources->mRegionBufferCount == kRegionBufferCacheCapacity)
+			return nil;
 
-	return nullptr;
-}
+		os_log_debug(_audioPlayerNodeLog, "Wrapping ring buffer memory at frame %u", frameOffset);
 
-#pragma mark - Time Utilities
+		// Each buffer requires its own buffer list since the buffer list is not copied
+		auto bufferList = AllocateBufferList(mRegionBufferList->mNumberBuffers);
+		if(!bufferList)
+			return nil;
+		std::copy_n(mRegionBufferList->mBuffers, mRegionBufferList->mNumberBuffers, bufferList->mBuffers);
 
-// These functions are probably unnecessarily complicated because
-// on Intel processors mach_timebase_info is always 1/1. However,
-// on PPC it is either 1000000000/33333335 or 1000000000/25000000 so
-// naively multiplying by .numer then dividing by .denom may result in
-// integer overflow. To avoid the possibility double is used here, but
-// __int128 would be an alternative.
+		AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:mOutputFormat bufferListNoCopy:bufferList.get() deallocator:nil];
+		if(!buffer)
+			return nil;
+		buffer.frameLength = 0;
 
-double HostTicksPerNano()
-{
-	mach_timebase_info_data_t timebase_info;
-	auto result = mach_timebase_info(&timebase_info);
-	assert(result == KERN_SUCCESS);
-	return static_cast<double>(timebase_info.numer) / static_cast<double>(timebase_info.denom);
-}
+		auto& regionBuffer = mResources->mRegionBuffers[mResources->mRegionBufferCount++];
+		regionBuffer.mBuffer = buffer;
+		regionBuffer.mBufferList = std::move(bufferList);
 
-double NanosPerHostTick()
-{
-	mach_timebase_info_data_t timebase_info;
-	auto result = mach_timebase_info(&timebase_info);
-	assert(result == KERN_SUCCESS);
-	return static_cast<double>(timebase_info.denom) / static_cast<double>(timebase_info.numer);
-}
+		return buffer;
+	}
+
+	/// Writes at most \c frameLength frames from \c mOutputBuffer not yet written to \c ringBuffer
+	/// @return The number of frames written
+	AVAudioFrameCount WriteOutputBuffer(SFB::PCMRingBuffer& ringBuffer, AVAudioFrameCount frameLength) noexcept
+	{
+		const auto bytesPerFrame = mOutputFormat.streamDescription->mBytesPerFrame;
+		const auto frameCount = mOutputBuffer.frameLength - mOutputBufferOffset;
+
+		const AudioBufferList *bufferList = mOutputBuffer.audioBufferList;
+		for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+			mRegionBufferList->mBuffers[i].mNumberChannels = bufferList->mBuffers[i].mNumberChannels;
+			mRegionBufferList->mBuffers[i].mData = static_cast<uint8_t *>(bufferList->mBuffers[i].mData) + mOutputBufferOffset * bytesPerFrame;
+			mRegionBufferList->mBuffers[i].mDataByteSize = frameCount * bytesPerFrame;
+		}
+
+		const auto framesWritten = ringBuffer.Write(mRegionBufferList.get(), std::min(frameLength, frameCount));
+		mOutputBufferOffset += framesWritten;
+		RecordFramesWritten(framesWritten);
+		return framesWritten;
+	}
+
+	/// Records that \c frameCount converted frames were written and marks decoding complete once all audio is written
+	void RecordFramesWritten(AVAudioFrameCount frameCount) noexcept
+	{
+		mFramesConverted.fetch_add(frameCount);
+		if(mEndOfStream && (!mLimiter || mLimiterFramesToFlush == 0) && mOutputBufferOffset == mOutputBuffer.frameLength)
+			mFlags.fetch_or(eDecodingCompleteFlag);
+	}
+
+	/// Discards audio in \c mLimiter and prepares it for audio following a discontinuity
+	void ResetLimiter() noexcept
+	{
+		if(!mLimiter)
+			return;
+		mLimiter->Reset();
+		mLimiterFramesToDiscard = mLimiter->Latency();
+		mLimiterFramesToFlush = mLimiter->Latency();
+	}
+
+	/// Decodes at most \c frameLength frames into \c buffer, applying gain and limiting
+	///
+	/// \c mLimiter delays audio so output lags input by its latency. The silence it produces initially is discarded and
+	/// the audio it holds once the decoder is exhausted is flushed before decoding is marked complete, so the number of
+	/// frames produced is unchanged.
+	/// @note The caller must pass the number of frames it writes to a ring buffer to \c RecordFramesWritten()
+	bool DecodeAudio(AVAudioPCMBuffer *buffer, AVAudioFrameCount frameLength, NSError **error = nullptr)
+	{
+		if(!mEndOfStream) {
+			if(!ConvertAudio(buffer, frameLength, mEndOfStream, error))
+				return false;
+		}
+		else
+			buffer.frameLength = 0;
+
+		const auto channelCount = mOutputFormat.channelCount;
+		float * const *channelData = buffer.floatChannelData;
+
+		if(mGain != 1) {
+			for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel)
+				vDSP_vsmul(channelData[channel], 1, &mGain, channelData[channel], 1, buffer.frameLength);
+		}
+
+		if(mLimiter) {
+			// Push the audio remaining in the limiter out with silence
+			if(mEndOfStream && mLimiterFramesToFlush > 0) {
+				const auto frameOffset = buffer.frameLength;
+				const auto framesToFlush = std::min(mLimiterFramesToFlush, frameLength - frameOffset);
+				for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel)
+					vDSP_vclr(channelData[channel] + frameOffset, 1, framesToFlush);
+				buffer.frameLength = frameOffset + framesToFlush;
+				mLimiterFramesToFlush -= framesToFlush;
+			}
+
+			mLimiter->Process(channelData, buffer.frameLength);
+
+			if(mLimiterFramesToDiscard > 0) {
+				const auto framesToDiscard = std::min(mLimiterFramesToDiscard, buffer.frameLength);
+				const auto framesRemaining = buffer.frameLength - framesToDiscard;
+				for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel)
+					std::memmove(channelData[channel], channelData[channel] + framesToDiscard, framesRemaining * sizeof(float));
+				buffer.frameLength = framesRemaining;
+				mLimiterFramesToDiscard -= framesToDiscard;
+			}
+		}
+
+		return true;
+	}
+
+	/// Decodes at most \c frameLength frames into \c buffer, converting to the output format in the process
+	/// @param endOfStream Set to \c true if the decoder is exhausted
+	bool ConvertAudio(AVAudioPCMBuffer *buffer, AVAudioFrameCount frameLength, bool& endOfStream, NSError **error = nullptr)
+	{
+#if DEBUG
+		assert(frameLength <= mDecodeBuffer.frameCapacity);
+		assert(frameLength <= buffer.frameCapacity);
+#endif
+
+		// Decode directly into buffer if no conversion is required
+		if(!mRequiresConversion) {
+			if(![mDecoder decodeIntoBuffer:buffer frameLength:frameLength error:error])
+				return false;
+
+			if(buffer.frameLength == 0) {
+				endOfStream = true;
+				return true;
+			}
+
+			mFramesDecoded.fetch_add(buffer.frameLength);
+
+			return true;
+		}
+
+		if(mRequiresResampling)
+			return ResampleAudio(buffer, endOfStream, error);
+
+		if(![mDecoder decodeIntoBuffer:mDecodeBuffer frameLength:frameLength error:error])
+			return false;
+
+		if(mDecodeBuffer.frameLength == 0) {
+			endOfStream = true;
+			buffer.frameLength = 0;
+			return true;
+		}
+
+		this->mFramesDecoded.fetch_add(mDecodeBuffer.frameLength);
+
+		// Only PCM to PCM conversions are performed
+		if(mPCMConverter.IsConfigured())
+			buffer.frameLength = mPCMConverter.Convert(mDecodeBuffer.audioBufferList, buffer.mutableAudioBufferList, mDecodeBuffer.frameLength);
+		else if(![mConverter convertToBuffer:buffer fromBuffer:mDecodeBuffer error:error])
+			return false;
+
+		return true;
+	}
+
+	/// Decodes and resamples audio to fill \c buffer
+	///
+	/// \c mConverter requests decoded audio as needed and retains its filter state between calls, so resampling is
+	/// continuous across calls. Once the decoder is exhausted the remaining resampler output is flushed.
+	/// @param endOfStream Set to \c true once the resampler output is flushed
+	bool ResampleAudio(AVAudioPCMBuffer *buffer, bool& endOfStream, NSError **error = nullptr)
+	{
+		__block NSError *decodeError = nil;
+		AVAudioConverterOutputStatus status = [mConverter convertToBuffer:buffer error:error withInputFromBlock:^AVAudioBuffer *(AVAudioPacketCount inNumberOfPackets, AVAudioConverterInputStatus *outStatus) {
+			if(this->mResamplerInputComplete) {
+				*outStatus = AVAudioConverterInputStatus_EndOfStream;
+				return nil;
+			}
+
+			NSError *err = nil;
+			if(![this->mDecoder decodeIntoBuffer:this->mDecodeBuffer frameLength:std::min(inNumberOfPackets, this->mDecodeBuffer.frameCapacity) error:&err]) {
+				decodeError = err;
+				*outStatus = AVAudioConverterInputStatus_NoDataNow;
+				return nil;
+			}
+
+			if(this->mDecodeBuffer.frameLength == 0) {
+				this->mResamplerInputComplete = true;
+				*outStatus = AVAudioConverterInputStatus_EndOfStream;
+				return nil;
+			}
+
+			this->mFramesDecoded.fetch_add(this->mDecodeBuffer.frameLength);
+			*outStatus = AVAudioConverterInputStatus_HaveData;
+			return this->mDecodeBuffer;
+		}];
+
+		if(status == AVAudioConverterOutputStatus_Error)
+			return false;
+
+		if(decodeError) {
+			if(error)
+				*error = decodeError;
+			return false;
+		}
+
+		if(status == AVAudioConverterOutputStatus_EndOfStream)
+			endOfStream = true;
+
+		return true;
+	}
+
+};
+
+std::atomic_uint64_t DecoderStateData::sSequenceNumber = 0;
+
+/// An immutable list of decoder states sorted by increasing sequence number
+///
+/// Readers traverse the current list without locking inside an \c SFB::EpochReclaimer critical section. Changes are
+/// made by publishing a modified copy and retiring the replaced list, so a list and the decoder states it contains
+/// remain valid for the remainder of any critical section in which the list was loaded.
+struct DecoderStateList
+{
+	/// The number of valid entries in \c mStates
+	size_t mCount;
+	/// The decoder states
+	DecoderStateData *mStates [kDecoderStateListCapacity];
+
+	/// Returns pooled storage for a \c DecoderStateList object
+	static void * operator new(std::size_t size, const std::nothrow_t&) noexcept
+	{
+		return DecoderStatePool::SharedPool().DecoderStateListStorage().Allocate(size);
+	}
+
+	/// Returns storage to the pool
+	static void operator delete(void *ptr, std::size_t size) noexcept
+	{
+		DecoderStatePool::SharedPool().DecoderStateListStorage().Deallocate(ptr, size);
+	}
+
+	/// Returns storage to the pool if the constructor throws
+	static void operator delete(void *ptr, const std::nothrow_t&) noexcept
+	{
+		DecoderStatePool::SharedPool().DecoderStateListStorage().Deallocate(ptr, sizeof(DecoderStateList));
+	}
+};
+
+/// Deletes a \c DecoderStateData object retired by \c SFB::EpochReclaimer
+void DeleteDecoderState(void *object) noexcept
+{
+	delete static_cast<DecoderStateData *>(object);
+}
+
+/// Deletes a \c DecoderStateList object retired by \c SFB::EpochReclaimer
+void DeleteDecoderStateList(void *object) noexcept
+{
+	delete static_cast<DecoderStateList *>(object);
+}
+
+/// A decoder waiting to be dequeued
+struct QueuedDecoder
+{
+	/// The decoder
+	id <SFBPCMDecoding> mDecoder;
+	/// The linear gain to apply to audio from the decoder
+	float mGain;
+	/// Whether the ReplayGain adjustment is applied in addition to \c mGain
+	bool mApplyReplayGain;
+};
+
+using DecoderQueue = SFB::BoundedMPSCQueue<QueuedDecoder>;
+using LookAheadQueue = std::deque<DecoderStateData *>;
+
+/// A decoder being opened asynchronously
+struct PendingEnqueue
+{
+	/// The position of the decoder in the order of asynchronous enqueues
+	uint64_t mTicket;
+	/// The decoder being opened
+	id <SFBPCMDecoding> mDecoder;
+	/// \c true if opening the decoder has finished
+	bool mIsComplete;
+	/// The error if opening the decoder failed
+	NSError *mError;
+	/// The time taken to open the decoder in seconds
+	NSTimeInterval mLatency;
+};
+
+using PendingEnqueueQueue = std::deque<PendingEnqueue>;
+
+/// A delegate notification posted by the decoding thread
+struct DecoderEvent
+{
+	/// The notification type
+	uint32_t mType;
+	/// The decoder the notification concerns
+	///
+	/// This strong reference keeps the decoder alive until delivery even if its decoder state is collected first
+	id <SFBPCMDecoding> mDecoder;
+	/// The error for \c eAudioPlayerNodeDecoderEventEncounteredError
+	NSError *mError;
+	/// Whether any audio was rendered for \c eAudioPlayerNodeDecoderEventDecodingCanceled
+	bool mPartiallyRendered;
+	/// The host time at which the notification was posted
+	uint64_t mPostTime;
+};
+
+using DecoderEventQueue = SFB::BoundedMPSCQueue<DecoderEvent>;
+
+/// An event recorded by the render block
+///
+/// The meaning of \c mArg0 and \c mArg1 depends on \c mType:
+///  1. \c eAudioPlayerNodeRenderTraceEventShortRead: frames requested and frames read
+///  2. \c eAudioPlayerNodeRenderTraceEventSilencePadding: frames read and frames requested
+///  3. \c eAudioPlayerNodeRenderTraceEventMuteTransition: \c 1 if output was muted or \c 0 if unmuted
+///  4. \c eAudioPlayerNodeRenderTraceEventSequenceNumberChange: the previous and current sequence numbers
+struct RenderTraceEvent
+{
+	/// The event type
+	uint32_t mType;
+	/// The host time of the render cycle in which the event occurred
+	uint64_t mHostTime;
+	/// The first event argument
+	uint64_t mArg0;
+	/// The second event argument
+	uint64_t mArg1;
+};
+
+using RenderTraceBuffer = SFB::SPSCQueue<RenderTraceEvent>;
+
+/// An event passed from the render block to the render events processor
+struct RenderEvent
+{
+	/// The event type
+	uint32_t mType;
+	/// The sequence number of the decoder state the event concerns, if any
+	uint64_t mSequenceNumber;
+	/// The host time at which the event occurs
+	uint64_t mHostTime;
+	/// The frame at which playback resumed for \c eAudioPlayerNodeRenderEventSeekCompleted or the number of frames of
+	/// silence for \c eAudioPlayerNodeRenderEventUnderrunEnded
+	int64_t mFrames;
+};
+
+using RenderEventQueue = SFB::SPSCQueue<RenderEvent>;
+
+/// Appends \c event to \c queue and signals \c processor
+/// @note This function is safe to call from the render block
+inline void PostRenderEvent(RenderEventQueue& queue, dispatch_source_t processor, const RenderEvent& event) noexcept
+{
+	if(queue.TryPush(event))
+		dispatch_source_merge_data(processor, 1);
+}
+
+/// The playback position published by the render block
+struct PlaybackSnapshot
+{
+	/// The value of the snapshot generation when the snapshot was computed
+	uint64_t mGeneration;
+	/// The host time at which \c mFramePosition is output
+	uint64_t mHostTime;
+	/// The frame position in the current decoder
+	int64_t mFramePosition;
+	/// The frame length of the current decoder
+	int64_t mFrameLength;
+	/// The sample rate of \c mFramePosition and \c mFrameLength
+	double mSampleRate;
+	/// Whether there is a current decoder
+	bool mHasDecoder;
+	/// Whether the frame position advances with host time
+	bool mIsPlaying;
+
+	/// Returns a snapshot with generation \c generation computed at \c hostTime when there is no current decoder
+	static PlaybackSnapshot Empty(uint64_t generation, uint64_t hostTime) noexcept
+	{
+		PlaybackSnapshot snapshot;
+		snapshot.mGeneration = generation;
+		snapshot.mHostTime = hostTime;
+		snapshot.mFramePosition = SFBUnknownFramePosition;
+		snapshot.mFrameLength = SFBUnknownFrameLength;
+		snapshot.mSampleRate = 0;
+		snapshot.mHasDecoder = false;
+		snapshot.mIsPlaying = false;
+		return snapshot;
+	}
+};
+
+/// The snapshot of the playback position published by the render block
+using PlaybackSnapshotLock = SFB::Seqlock<PlaybackSnapshot>;
+
+/// Returns the element in \c pendingEnqueues with \c ticket or \c nullptr if none
+PendingEnqueue * FindPendingEnqueue(PendingEnqueueQueue& pendingEnqueues, uint64_t ticket) noexcept
+{
+	// Tickets are assigned in increasing order
+	if(pendingEnqueues.empty() || ticket < pendingEnqueues.front().mTicket)
+		return nullptr;
+	auto index = ticket - pendingEnqueues.front().mTicket;
+	if(index >= pendingEnqueues.size() || pendingEnqueues[index].mTicket != ticket)
+		return nullptr;
+	return &pendingEnqueues[index];
+}
+
+/// Returns \c true if \c decoderState has not completed rendering and has not been marked for removal
+inline bool DecoderStateIsActive(const DecoderStateData *decoderState) noexcept
+{
+	auto flags = decoderState->mFlags.load();
+	return !(flags & DecoderStateData::eMarkedForRemovalFlag) && !(flags & DecoderStateData::eRenderingCompleteFlag);
+}
+
+/// Returns the element in \c decoderStates with the smallest sequence number that has not completed rendering and has not been marked for removal
+DecoderStateData * GetActiveDecoderStateWithSmallestSequenceNumber(const DecoderStateList *decoderStates) noexcept
+{
+	if(!decoderStates)
+		return nullptr;
+
+	// The list is sorted so the first active element has the smallest sequence number
+	for(size_t i = 0; i < decoderStates->mCount; ++i) {
+		auto decoderState = decoderStates->mStates[i];
+		if(DecoderStateIsActive(decoderState))
+			return decoderState;
+	}
+
+	return nullptr;
+}
+
+/// Returns the element in \c decoderStates with the smallest sequence number greater than \c sequenceNumber that has not completed rendering and has not been marked for removal
+DecoderStateData * GetActiveDecoderStateFollowingSequenceNumber(const DecoderStateList *decoderStates, uint64_t sequenceNumber) noexcept
+{
+	if(!decoderStates)
+		return nullptr;
+
+	for(size_t i = 0; i < decoderStates->mCount; ++i) {
+		auto decoderState = decoderStates->mStates[i];
+		if(decoderState->mSequenceNumber > sequenceNumber && DecoderStateIsActive(decoderState))
+			return decoderState;
+	}
+
+	return nullptr;
+}
+
+/// Returns the element in \c decoderStates with the sequence number equal to \c sequenceNumber that has not been marked for removal
+DecoderStateData * GetDecoderStateWithSequenceNumber(const DecoderStateList *decoderStates, uint64_t sequenceNumber) noexcept
+{
+	if(!decoderStates)
+		return nullptr;
+
+	for(size_t i = 0; i < decoderStates->mCount; ++i) {
+		auto decoderState = decoderStates->mStates[i];
+		if(decoderState->mSequenceNumber < sequenceNumber)
+			continue;
+		if(decoderState->mSequenceNumber > sequenceNumber || (decoderState->mFlags.load() & DecoderStateData::eMarkedForRemovalFlag))
+			break;
+		return decoderState;
+	}
+
+	return nullptr;
+}
+
+/// Returns the playback position of the element in \c decoderStates with the smallest sequence number that has not completed rendering and has not been marked for removal
+PlaybackSnapshot MakePlaybackSnapshot(const DecoderStateList *decoderStates, uint64_t generation, uint64_t hostTime, bool isPlaying) noexcept
+{
+	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(decoderStates);
+	if(!decoderState)
+		return PlaybackSnapshot::Empty(generation, hostTime);
+	return { generation, hostTime, decoderState->FramePosition(), decoderState->FrameLength(), decoderState->mSampleRate, true, isPlaying };
+}
+
+/// Updates the seek statistics for a seek requested at \c requestHostTime whose audio is output at \c hostTime
+inline void RecordSeekCompletion(std::atomic_uint64_t& seekCount, std::atomic_uint64_t& lastSeekLatency, std::atomic_uint64_t& maximumSeekLatency, uint64_t requestHostTime, uint64_t hostTime) noexcept
+{
+	const uint64_t latency = hostTime > requestHostTime ? hostTime - requestHostTime : 0;
+	seekCount.fetch_add(1);
+	lastSeekLatency.store(latency);
+	// Only the render block updates the maximum
+	if(latency > maximumSeekLatency.load())
+		maximumSeekLatency.store(latency);
+}
+
+/// Mixes audio from \c crossfadeBuffer into the first \c frameCount frames of \c bufferList, fading \c crossfadeBuffer out
+///
+/// \c bufferList and \c crossfadeBuffer must contain deinterleaved 32-bit floating point audio.
+/// @param position The number of frames of the crossfade already mixed, updated on return
+/// @param length The total number of frames in the crossfade
+void MixCrossfade(SFB::PCMRingBuffer& crossfadeBuffer, AudioBufferList *bufferList, AudioBufferList *regionBufferList, AVAudioFrameCount frameCount, AVAudioFrameCount& position, AVAudioFrameCount length) noexcept
+{
+	auto readVector = crossfadeBuffer.GetReadVector();
+	AVAudioFrameCount framesMixed = 0;
+	for(const auto& region : { readVector.mFirst, readVector.mSecond }) {
+		auto framesToMix = std::min(region.mFrameCount, frameCount - framesMixed);
+		if(framesToMix == 0 || !crossfadeBuffer.GetBufferList({ region.mFrameOffset, framesToMix }, regionBufferList))
+			break;
+
+		// The fade-in gain for frame j is (position + j + 1) / (length + 1) and the fade-out gain is its complement
+		const float fadeInStart = static_cast<float>(position + 1) / static_cast<float>(length + 1);
+		const float step = 1 / static_cast<float>(length + 1);
+		const float negativeStep = -step;
+		for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+			auto output = static_cast<float *>(bufferList->mBuffers[i].mData) + framesMixed;
+			const auto fading = static_cast<const float *>(regionBufferList->mBuffers[i].mData);
+			// vDSP_vrampmul and vDSP_vrampmuladd advance the start value so each channel begins with a copy
+			float fadeInGain = fadeInStart;
+			vDSP_vrampmul(output, 1, &fadeInGain, &step, output, 1, framesToMix);
+			float fadeOutGain = 1 - fadeInStart;
+			vDSP_vrampmuladd(fading, 1, &fadeOutGain, &negativeStep, output, 1, framesToMix);
+		}
+
+		framesMixed += framesToMix;
+		position += framesToMix;
+	}
+
+	crossfadeBuffer.CommitRead(framesMixed);
+}
+
+/// Moves at most \c frameCount frames from \c source to the write region of \c destination
+/// @return The number of frames moved
+AVAudioFrameCount MoveFrames(SFB::PCMRingBuffer& source, SFB::PCMRingBuffer& destination, AudioBufferList *regionBufferList, AVAudioFrameCount frameCount) noexcept
+{
+	AVAudioFrameCount framesMoved = 0;
+	auto writeVector = destination.GetWriteVector();
+	for(const auto& region : { writeVector.mFirst, writeVector.mSecond }) {
+		auto framesToMove = std::min({region.mFrameCount, frameCount - framesMoved, source.FramesAvailableToRead()});
+		if(framesToMove == 0 || !destination.GetBufferList({ region.mFrameOffset, framesToMove }, regionBufferList))
+			break;
+		framesToMove = source.Read(regionBufferList, framesToMove);
+		destination.CommitWrite(framesToMove);
+		framesMoved += framesToMove;
+	}
+	return framesMoved;
+}
+
+/// Computes \c frameCount crossfade gains starting at \c position in a crossfade of \c length frames
+void ComputeCrossfadeGains(SFBAudioPlayerNodeCrossfadeCurve curve, AVAudioFrameCount position, AVAudioFrameCount length, float *fadeInGains, float *fadeOutGains, AVAudioFrameCount frameCount) noexcept
+{
+	// The fade-in ramp excludes 0 and 1 so neither decoder is silent within the crossfade
+	float start = static_cast<float>(position + 1) / static_cast<float>(length + 1);
+	float step = 1 / static_cast<float>(length + 1);
+	vDSP_vramp(&start, &step, fadeInGains, 1, frameCount);
+
+	if(curve == SFBAudioPlayerNodeCrossfadeCurveEqualPower) {
+		float scale = static_cast<float>(M_PI_2);
+		vDSP_vsmul(fadeInGains, 1, &scale, fadeOutGains, 1, frameCount);
+		int count = static_cast<int>(frameCount);
+		vvsinf(fadeInGains, fadeOutGains, &count);
+		vvcosf(fadeOutGains, fadeOutGains, &count);
+	}
+	else {
+		float negativeOne = -1;
+		float one = 1;
+		vDSP_vsmsa(fadeInGains, 1, &negativeOne, &one, fadeOutGains, 1, frameCount);
+	}
+}
+
+/// Returns the linear gain specified by the ReplayGain or R128 information in \c metadata
+/// @param preamp The gain in decibels applied in addition to the ReplayGain adjustment
+/// @param preventClipping Whether to limit the gain so the tagged peak does not exceed full scale
+/// @return The linear gain or \c 1 if \c metadata contains no gain information for \c mode
+float ReplayGainForMetadata(SFBAudioMetadata *metadata, SFBAudioPlayerNodeReplayGainMode mode, float preamp, bool preventClipping) noexcept
+{
+	if(mode == SFBAudioPlayerNodeReplayGainModeOff)
+		return 1;
+
+	NSNumber *gain = nil;
+	NSNumber *peak = nil;
+	if(mode == SFBAudioPlayerNodeReplayGainModeAlbum) {
+		gain = metadata.replayGainAlbumGain;
+		peak = metadata.replayGainAlbumPeak;
+	}
+	if(!gain) {
+		gain = metadata.replayGainTrackGain;
+		peak = metadata.replayGainTrackPeak;
+	}
+
+	// R128 gains are Q7.8 fixed point relative to -23 LUFS while ReplayGain 2.0 gains are relative to -18 LUFS
+	if(!gain) {
+		NSString *r128Gain = nil;
+		if(mode == SFBAudioPlayerNodeReplayGainModeAlbum)
+			r128Gain = metadata.additionalMetadata[@"R128_ALBUM_GAIN"];
+		if(!r128Gain)
+			r128Gain = metadata.additionalMetadata[@"R128_TRACK_GAIN"];
+		if([r128Gain isKindOfClass:[NSString class]])
+			gain = @(r128Gain.doubleValue / 256 + 5);
+	}
+
+	if(!gain)
+		return 1;
+
+	auto linearGain = std::pow(10.f, (gain.floatValue + preamp) / 20);
+	if(preventClipping && peak.floatValue > 0)
+		linearGain = std::min(linearGain, 1 / peak.floatValue);
+	return linearGain;
+}
+
+/// Returns \c bounds adjusted to be internally consistent and usable with a ring buffer holding \c ringBufferCapacity frames
+SFBAudioPlayerNodeBufferingBounds ClampBufferingBounds(SFBAudioPlayerNodeBufferingBounds bounds, AVAudioFrameCount ringBufferCapacity) noexcept
+{
+	bounds.maximumFillTarget = std::min(std::max(bounds.maximumFillTarget, 2u), std::max(ringBufferCapacity, 2u));
+	bounds.minimumFillTarget = std::min(std::max(bounds.minimumFillTarget, 2u), bounds.maximumFillTarget);
+	bounds.maximumChunkSize = std::min(std::max(bounds.maximumChunkSize, 1u), bounds.maximumFillTarget / 2);
+	bounds.minimumChunkSize = std::min(std::max(bounds.minimumChunkSize, 1u), bounds.maximumChunkSize);
+	return bounds;
+}
+
+#pragma mark - Time Utilities
+
+// These functions are probably unnecessarily complicated because
+// on Intel processors mach_timebase_info is always 1/1. However,
+// on PPC it is either 1000000000/33333335 or 1000000000/25000000 so
+// naively multiplying by .numer then dividing by .denom may result in
+// integer overflow. To avoid the possibility double is used here, but
+// __int128 would be an alternative.
+
+double HostTicksPerNano()
+{
+	mach_timebase_info_data_t timebase_info;
+	auto result = mach_timebase_info(&timebase_info);
+	assert(result == KERN_SUCCESS);
+	return static_cast<double>(timebase_info.numer) / static_cast<double>(timebase_info.denom);
+}
+
+double NanosPerHostTick()
+{
+	mach_timebase_info_data_t timebase_info;
+	auto result = mach_timebase_info(&timebase_info);
+	assert(result == KERN_SUCCESS);
+	return static_cast<double>(timebase_info.denom) / static_cast<double>(timebase_info.numer);
+}
 
 const double kHostTicksPerNano = HostTicksPerNano();
 const double kNanosPerHostTick = NanosPerHostTick();
@@ -307,935 +1538,3508 @@ inline double ConvertHostTicksToNanos(uint64_t t) noexcept
 	return static_cast<double>(t) * kHostTicksPerNano;
 }
 
+/// Converts a possibly negative interval in host ticks to seconds
+inline double ConvertSignedHostTicksToSeconds(int64_t t) noexcept
+{
+	const auto seconds = ConvertHostTicksToNanos(static_cast<uint64_t>(t < 0 ? -t : t)) / NSEC_PER_SEC;
+	return t < 0 ? -seconds : seconds;
 }
 
-#pragma mark -
+#pragma mark - Adaptive Buffering
 
-@interface SFBAudioPlayerNode ()
-{
-@private
-	/// The lock used to protect access to \c _queuedDecoders
-	SFB::UnfairLock					_queueLock;
-	/// Decoders enqueued for playback
-	DecoderQueue 					_queuedDecoders;
+/// Adjusts the ring buffer fill target and decoding chunk size in response to decoding performance
+///
+/// All methods except the accessors must be called from the decoding thread
+class BufferingController {
 
-	// Decoding thread variables
-	std::thread 					_decodingThread;
-	dispatch_semaphore_t			_decodingSemaphore;
+public:
 
-	/// Queue used for sending delegate messages
-	dispatch_queue_t				_notificationQueue;
+	/// Decoding speeds at or above this multiple of realtime permit the fill target to shrink
+	static constexpr double kFastDecodingSpeed 			= 8;
+	/// Decoding speeds below this multiple of realtime cause the fill target to grow
+	static constexpr double kSlowDecodingSpeed 			= 2;
+	/// The weight given to the most recent decoding speed measurement
+	static constexpr double kDecodingSpeedSmoothing 	= 0.2;
+	/// The number of seconds of audio that must be decoded quickly without incident before the fill target shrinks
+	static constexpr double kShrinkInterval 			= 10;
+	/// The fraction of buffered audio a single decoding operation may consume before it is considered a stall
+	static constexpr double kStallThreshold 			= 0.5;
+
+	BufferingController() noexcept
+	: mBounds{}, mSampleRate(0), mSecondsSinceAdjustment(0), mFillTarget(0), mChunkSize(0), mStallCount(0), mDecodingSpeed(0)
+	{}
+
+	/// Sets the bounds within which the fill target and chunk size are adjusted
+	void SetBounds(const SFBAudioPlayerNodeBufferingBounds& bounds) noexcept
+	{
+		mBounds = bounds;
+		auto fillTarget = mFillTarget.load();
+		// Start conservatively and shrink as decoding proves fast
+		if(fillTarget == 0)
+			fillTarget = mBounds.maximumFillTarget;
+		SetFillTarget(fillTarget);
+	}
 
-	/// Dispatch source processing render events from \c _renderEventsRingBuffer
-	dispatch_source_t				_renderEventsProcessor;
+	/// Prepares to measure a new decoder's performance
+	void DecoderChanged(double sampleRate) noexcept
+	{
+		mSampleRate = sampleRate;
+		mSecondsSinceAdjustment = 0;
+		mDecodingSpeed.store(0);
+	}
 
-	/// Dispatch source deleting decoder state data with \c eMarkedForRemovalFlag
-	dispatch_source_t				_collector;
+	/// Updates the decoding speed estimate and adjusts the fill target if necessary
+	/// @param frameCount The number of frames decoded
+	/// @param elapsedNanos The time required to decode \c frameCount frames
+	/// @param fillLevel The number of frames available for rendering when decoding began or \c 0 if not rendering
+	void DecodeCompleted(AVAudioFrameCount frameCount, double elapsedNanos, AVAudioFrameCount fillLevel) noexcept
+	{
+		if(frameCount == 0 || mSampleRate <= 0)
+			return;
+
+		auto audioSeconds = frameCount / mSampleRate;
+		auto elapsedSeconds = std::max(elapsedNanos / NSEC_PER_SEC, 1e-9);
+
+		auto speed = audioSeconds / elapsedSeconds;
+		auto decodingSpeed = mDecodingSpeed.load();
+		decodingSpeed = decodingSpeed == 0 ? speed : (kDecodingSpeedSmoothing * speed) + ((1 - kDecodingSpeedSmoothing) * decodingSpeed);
+		mDecodingSpeed.store(decodingSpeed);
+
+		// A decoding operation consuming a significant portion of the buffered audio, typically due to I/O, is a stall
+		if(fillLevel > 0 && elapsedSeconds > kStallThreshold * (fillLevel / mSampleRate)) {
+			mStallCount.fetch_add(1);
+			os_log_debug(_audioPlayerNodeLog, "Decoding stalled for %.2f msec with %u frames buffered", elapsedSeconds * 1000, fillLevel);
+			Grow();
+			return;
+		}
 
-	// Shared state accessed from multiple threads/queues
-	std::atomic_uint 				_flags;
-	SFB::AudioRingBuffer			_audioRingBuffer;
-	SFB::RingBuffer					_renderEventsRingBuffer;
-	DecoderStateData::atomic_ptr 	_decoderStateArray [kDecoderStateArraySize];
-}
-- (BOOL)performEnqueue:(id <SFBPCMDecoding>)decoder reset:(BOOL)reset error:(NSError **)error;
-@end
+		if(decodingSpeed < kSlowDecodingSpeed) {
+			Grow();
+			return;
+		}
 
-@implementation SFBAudioPlayerNode
+		mSecondsSinceAdjustment += audioSeconds;
+		if(decodingSpeed >= kFastDecodingSpeed && mSecondsSinceAdjustment >= kShrinkInterval)
+			Shrink();
+	}
+
+	/// Grows the fill target in response to an underrun
+	void UnderrunOccurred() noexcept
+	{
+		Grow();
+	}
+
+	/// Returns the number of frames to keep buffered for rendering
+	inline AVAudioFrameCount FillTarget() const noexcept
+	{
+		return mFillTarget.load();
+	}
+
+	/// Returns the number of frames to decode at once
+	inline AVAudioFrameCount ChunkSize() const noexcept
+	{
+		return mChunkSize.load();
+	}
+
+	/// Returns the number of decoding operations that stalled
+	inline uint64_t StallCount() const noexcept
+	{
+		return mStallCount.load();
+	}
+
+	/// Returns the ratio of decoding speed to realtime for the current decoder or \c 0 if unknown
+	inline double DecodingSpeed() const noexcept
+	{
+		return mDecodingSpeed.load();
+	}
+
+	/// Resets the stall count
+	void ResetStatistics() noexcept
+	{
+		mStallCount.store(0);
+	}
+
+private:
+
+	void Grow() noexcept
+	{
+		mSecondsSinceAdjustment = 0;
+		auto fillTarget = mFillTarget.load();
+		if(fillTarget < mBounds.maximumFillTarget) {
+			SetFillTarget(fillTarget * 2);
+			os_log_debug(_audioPlayerNodeLog, "Increased buffer fill target to %u frames", mFillTarget.load());
+		}
+	}
+
+	void Shrink() noexcept
+	{
+		mSecondsSinceAdjustment = 0;
+		auto fillTarget = mFillTarget.load();
+		if(fillTarget > mBounds.minimumFillTarget) {
+			SetFillTarget(fillTarget - (fillTarget / 4));
+			os_log_debug(_audioPlayerNodeLog, "Decreased buffer fill target to %u frames", mFillTarget.load());
+		}
+	}
+
+	/// Sets the fill target and derives a chunk size allowing several decoding operations per fill target
+	void SetFillTarget(AVAudioFrameCount fillTarget) noexcept
+	{
+		fillTarget = std::min(std::max(fillTarget, mBounds.minimumFillTarget), mBounds.maximumFillTarget);
+		auto chunkSize = std::min(std::max(fillTarget / 8, mBounds.minimumChunkSize), mBounds.maximumChunkSize);
+		// At least two chunks must fit within the fill target
+		chunkSize = std::max(std::min(chunkSize, fillTarget / 2), 1u);
+		mChunkSize.store(chunkSize);
+		mFillTarget.store(fillTarget);
+	}
+
+	/// The current bounds
+	SFBAudioPlayerNodeBufferingBounds mBounds;
+	/// The sample rate of the current decoder
+	double mSampleRate;
+	/// The number of seconds of audio decoded since the fill target was last adjusted
+	double mSecondsSinceAdjustment;
+
+	/// The number of frames to keep buffered for rendering
+	std::atomic<AVAudioFrameCount> mFillTarget;
+	/// The number of frames to decode at once
+	std::atomic<AVAudioFrameCount> mChunkSize;
+	/// The number of decoding operations that stalled
+	std::atomic_uint64_t mStallCount;
+	/// The smoothed ratio of decoding speed to realtime
+	std::atomic<double> mDecodingSpeed;
+
+};
+
+}
+
+#pragma mark -
+
+@interface SFBAudioPlayerNode ()
+{
+@private
+	/// Decoders enqueued for playback
+	DecoderQueue 					_queuedDecoders;
+
+	// Decoding thread variables
+	std::thread 					_decodingThread;
+	dispatch_semaphore_t			_decodingSemaphore;
+
+	/// The executor performing decoding, or \c nil if decoding is performed by \c _decodingThread
+	SFBAudioDecodingExecutor		*_decodingExecutor;
+	/// The decoder state being decoded, accessed only from \c -decodeNextChunk
+	DecoderStateData 				*_decodingDecoderState;
+	/// A dequeued decoder state waiting for space in \c _decoderStates, accessed only from \c -decodeNextChunk
+	DecoderStateData 				*_unstoredDecoderState;
+	/// Decoder states in \c _decoderStates to be decoded again after the decoder state reopened for scrubbing, accessed only from \c -decodeNextChunk
+	LookAheadQueue					_suspendedDecoderStates;
+	/// The underrun count when the buffering controller was last informed, accessed only from \c -decodeNextChunk
+	uint64_t						_observedUnderrunCount;
+	/// Whether a ring buffer reset is waiting for the render block to mute output, accessed only from the decoding thread or executor
+	bool							_awaitingMute;
+	/// Whether reopening the decoder state being rendered is waiting for the render block to mute output, accessed only from \c -decodeNextChunk
+	bool							_reopeningDecoderState;
+	/// The observer of \c AVAudioEngineConfigurationChangeNotification
+	id								_engineConfigurationObserver;
+
+	// Scheduling statistics updated by _decodingExecutor
+	std::atomic_uint64_t			_scheduledCount;
+	std::atomic_uint64_t			_decodingTime;
+	std::atomic_uint64_t			_totalSchedulingDelay;
+	std::atomic_uint64_t			_maximumSchedulingDelay;
+	std::atomic_uint64_t			_missedDeadlineCount;
+
+	/// The lock serializing removal of decoders from \c _queuedDecoders and protecting access to \c _lookAheadStates
+	std::mutex						_dequeueLock;
+	/// Decoder state for queued decoders being decoded ahead of playback
+	LookAheadQueue					_lookAheadStates;
+	/// The maximum number of decoders in \c _lookAheadStates
+	std::atomic_uint				_lookAheadDepth;
+	/// The maximum number of bytes used by staging buffers in \c _lookAheadStates
+	std::atomic_size_t				_lookAheadMemoryLimit;
+
+	/// \c true if audio with a sample rate or channel count differing from \c _renderingFormat may be enqueued
+	std::atomic_bool				_formatConversionEnabled;
+	/// The ReplayGain adjustment applied to enqueued decoders
+	std::atomic<SFBAudioPlayerNodeReplayGainMode>	_replayGainMode;
+	/// The gain in decibels applied in addition to ReplayGain adjustments
+	std::atomic<float>				_replayGainPreamp;
+	/// Whether a true peak limiter is applied to dequeued decoders
+	std::atomic_bool				_peakLimiterEnabled;
+	/// Sample rate conversion settings for subsequently dequeued decoders
+	SampleRateConverterSettings		_sampleRateConverterSettings;
+	/// The lock protecting \c _sampleRateConverterSettings
+	std::mutex						_sampleRateConverterSettingsLock;
+	/// Whether audio in a format may be converted to the rendering format, keyed by format
+	NSMapTable<AVAudioFormat *, NSNumber *> *_convertibleFormats;
+	/// The lock protecting \c _convertibleFormats
+	std::mutex						_convertibleFormatsLock;
+
+	// Look-ahead thread variables
+	std::thread 					_lookAheadThread;
+	std::once_flag					_lookAheadThreadLaunched;
+	dispatch_semaphore_t			_lookAheadSemaphore;
+
+	/// Decoders being opened asynchronously in the order they were enqueued
+	PendingEnqueueQueue				_pendingEnqueues;
+	/// The lock protecting \c _pendingEnqueues
+	std::mutex						_pendingEnqueuesLock;
+	/// The lock serializing transfers from \c _pendingEnqueues to \c _queuedDecoders, acquired before \c _pendingEnqueuesLock
+	std::mutex						_pendingEnqueuesTransferLock;
+	/// The ticket for the next asynchronous enqueue
+	uint64_t						_nextEnqueueTicket;
+	/// Concurrent queue used for opening decoders
+	dispatch_queue_t				_openQueue;
+	/// Serial queue submitting work to \c _openQueue
+	dispatch_queue_t				_openSubmissionQueue;
+	/// Semaphore limiting the number of decoders opened concurrently
+	dispatch_semaphore_t			_openSemaphore;
+
+	/// Queue used for sending delegate messages
+	dispatch_queue_t				_notificationQueue;
+
+	/// Delegate notifications posted by the decoding thread awaiting delivery
+	DecoderEventQueue				_decoderEvents;
+	/// Dispatch source delivering notifications from \c _decoderEvents on \c _notificationQueue
+	dispatch_source_t				_decoderEventsProcessor;
+	/// The number of notifications from \c _decoderEvents delivered later than \c kNotificationLagThreshold
+	std::atomic_uint64_t			_lateNotificationCount;
+	/// The number of notifications discarded because \c _decoderEvents was full
+	std::atomic_uint64_t			_droppedNotificationCount;
+
+	/// Whether the render block measures output levels
+	std::atomic_bool				_meteringEnabled;
+	/// Output levels measured by the render block
+	SFB::OutputMeter				_outputMeter;
+
+	/// The host time at which rendering is scheduled to start
+	SFB::ScheduledStart				_scheduledStart;
+	/// Buffer list referring to the part of the render block's output following a scheduled start, accessed only from the render block
+	unique_buffer_list_ptr			_renderScheduledStartBufferList;
+
+	/// Whether the render block copies output to \c _spectrumTap
+	std::atomic_bool				_spectrumAnalysisEnabled;
+	/// The number of frames analyzed for each spectrum
+	std::atomic_uint32_t			_spectrumAnalysisFFTSize;
+	/// The number of frames between consecutive spectra
+	std::atomic_uint32_t			_spectrumAnalysisHopSize;
+	/// Output copied by the render block for spectrum analysis
+	SFB::SpectrumTap				_spectrumTap;
+	/// The lock protecting allocation of \c _spectrumTap
+	std::mutex						_spectrumTapLock;
+	/// Dispatch source analyzing output copied to \c _spectrumTap
+	dispatch_source_t				_spectrumAnalysisProcessor;
+
+	/// Events recorded by the render block for diagnostics
+	RenderTraceBuffer				_renderTrace;
+	/// Dispatch source logging and counting events from \c _renderTrace periodically while playing
+	dispatch_source_t				_renderTraceDrain;
+	/// Whether output was muted during the previous render cycle, accessed only from the render block
+	bool							_renderOutputWasMuted;
+	/// The sequence number of the decoder that most recently started rendering, accessed only from the render block
+	uint64_t						_renderSequenceNumber;
+
+	/// Whether an underrun was in progress during the previous render cycle, accessed only from the render block
+	bool							_renderUnderrunInProgress;
+	/// The number of frames of silence output during the current underrun, accessed only from the render block
+	uint64_t						_renderUnderrunFrameCount;
+	/// The frame at which playback resumes after a seek, accessed only from the render block
+	int64_t							_renderPendingSeekFrame;
+	/// The sequence number of the decoder for \c _renderPendingSeekFrame, accessed only from the render block
+	uint64_t						_renderPendingSeekSequenceNumber;
+	/// The frame at which the decoder landed for the seek accompanying the most recent ring buffer reset
+	std::atomic_int64_t				_resetSeekFrame;
+	/// The sequence number of the decoder for \c _resetSeekFrame
+	std::atomic_uint64_t			_resetSeekSequenceNumber;
+
+	// Render trace statistics updated by _renderTraceDrain
+	std::atomic_uint64_t			_shortReadCount;
+	std::atomic_uint64_t			_silencePaddingCount;
+	std::atomic_uint64_t			_silencePaddingFrameCount;
+	std::atomic_uint64_t			_muteTransitionCount;
+	std::atomic_uint64_t			_sequenceNumberChangeCount;
+
+	/// Dispatch source processing render events from \c _renderEvents
+	dispatch_source_t				_renderEventsProcessor;
+
+	/// Dispatch source removing decoder state data with \c eMarkedForRemovalFlag from \c _decoderStates and reclaiming it
+	dispatch_source_t				_collector;
+
+	/// The number of frames \c _audioRingBuffer can hold
+	AVAudioFrameCount				_ringBufferCapacity;
+	/// The buffering bounds requested by the client
+	std::atomic<SFBAudioPlayerNodeBufferingBounds>	_bufferingBounds;
+	/// Adjusts the fill target and chunk size based on decoding performance
+	BufferingController				_bufferingController;
+
+	// Buffering statistics updated by the render block
+	std::atomic_uint64_t			_underrunCount;
+	std::atomic_uint64_t			_underrunFrameCount;
+	std::atomic<AVAudioFrameCount>	_minimumFillLevel;
+
+	// Shared state accessed from multiple threads/queues
+	std::atomic_uint 				_flags;
+	/// The largest number of frames in \c _audioRingBuffer permitting the decoding thread to write another chunk
+	std::atomic<AVAudioFrameCount>	_decodingThreshold;
+	SFB::PCMRingBuffer				_audioRingBuffer;
+	RenderEventQueue				_renderEvents;
+	/// The playback position published by the render block
+	PlaybackSnapshotLock			_playbackSnapshot;
+
+	/// Audio decoded at a seek target, written by the decoding thread before the render block switches to it
+	SFB::PCMRingBuffer				_seekBuffer;
+	/// The requested frame for the audio in \c _seekBuffer
+	std::atomic_int64_t				_stagedSeekTarget;
+	/// The frame at which the decoder landed for the audio in \c _seekBuffer
+	std::atomic_int64_t				_stagedSeekFrame;
+	/// The sequence number of the decoder for \c _stagedSeekFrame
+	std::atomic_uint64_t			_stagedSeekSequenceNumber;
+	/// The number of frames of audio preceding a staged seek crossfaded with the audio following it
+	std::atomic<AVAudioFrameCount>	_seekCrossfadeFrameCount;
+	/// Audio preceding a staged seek being faded out, accessed only from the render block
+	SFB::PCMRingBuffer				_crossfadeBuffer;
+	/// The number of frames of the current crossfade already mixed, accessed only from the render block
+	AVAudioFrameCount				_renderCrossfadePosition;
+	/// The length of the current crossfade in frames, accessed only from the render block
+	AVAudioFrameCount				_renderCrossfadeLength;
+	/// Buffer list referring to regions of \c _crossfadeBuffer, accessed only from the render block
+	unique_buffer_list_ptr			_renderCrossfadeBufferList;
+	/// Buffer list referring to part of the render block's output, accessed only from the render block
+	unique_buffer_list_ptr			_renderOutputBufferList;
+
+	// Seek statistics
+	std::atomic_uint64_t			_seekRequestCount;
+	std::atomic_uint64_t			_seekCount;
+	std::atomic_uint64_t			_stagedSeekCount;
+	/// The host time of the most recent seek request
+	std::atomic_uint64_t			_seekRequestHostTime;
+	std::atomic_uint64_t			_lastSeekLatency;
+	std::atomic_uint64_t			_maximumSeekLatency;
+
+	// Scrubbing variables
+	/// The most recent seek target while scrubbing
+	std::atomic_int64_t				_scrubTarget;
+	/// The number of frames in each grain of audio decoded while scrubbing
+	std::atomic<AVAudioFrameCount>	_scrubGrainFrameCount;
+	/// A grain of audio decoded at a scrub target, accessed only from \c -decodeNextChunk
+	SFB::PCMRingBuffer				_scrubGrainBuffer;
+	/// Buffer list referring to \c _scrubGrainBuffer, accessed only from \c -decodeNextChunk
+	unique_buffer_list_ptr			_scrubGrainBufferList;
+	std::atomic_uint64_t			_scrubRequestCount;
+	std::atomic_uint64_t			_scrubGrainCount;
+
+	// Crossfade variables
+	/// The number of frames over which consecutive decoders are crossfaded
+	std::atomic<AVAudioFrameCount>	_crossfadeFrameCount;
+	/// The gain curve used for crossfades
+	std::atomic<SFBAudioPlayerNodeCrossfadeCurve>	_crossfadeCurve;
+	/// The end of the audio from \c _crossfadeTailDecoderState, accessed only from \c -decodeNextChunk
+	SFB::PCMRingBuffer				_crossfadeTailBuffer;
+	/// The beginning of the audio from \c _crossfadeHeadDecoderState, accessed only from \c -decodeNextChunk
+	SFB::PCMRingBuffer				_crossfadeHeadBuffer;
+	/// The decoder state whose audio is held back in \c _crossfadeTailBuffer or \c nullptr if none
+	DecoderStateData				*_crossfadeTailDecoderState;
+	/// The decoder state whose audio is mixed into \c _crossfadeTailBuffer or \c nullptr if none
+	DecoderStateData				*_crossfadeHeadDecoderState;
+	/// The number of frames held back from \c _crossfadeTailDecoderState
+	AVAudioFrameCount				_crossfadeHoldbackFrameCount;
+	/// The number of frames in the crossfade in progress or \c 0 if none
+	AVAudioFrameCount				_crossfadeOverlapLength;
+	/// The number of frames of the crossfade in progress written to the ring buffer
+	AVAudioFrameCount				_crossfadeOverlapPosition;
+	/// Buffer receiving crossfaded audio before it is written to the ring buffer
+	AVAudioPCMBuffer				*_crossfadeMixBuffer;
+	/// Buffer holding audio from \c _crossfadeHeadBuffer while it is mixed
+	AVAudioPCMBuffer				*_crossfadeHeadMixBuffer;
+	/// Fade-in gains followed by fade-out gains for \c kCrossfadeMixFrameCapacity frames
+	std::vector<float>				_crossfadeGains;
+	/// Buffer list referring to a region of ring buffer memory, accessed only from \c -decodeNextChunk
+	unique_buffer_list_ptr			_crossfadeRegionBufferList;
+
+	/// Incremented after changes to decoder state outside the render block invalidating \c _playbackSnapshot
+	std::atomic_uint64_t			_playbackSnapshotGeneration;
+	/// The decoder states being decoded or rendered, replaced as a whole by \c -insertDecoderState: and the collector
+	std::atomic<DecoderStateList *>	_decoderStates;
+	/// The lock serializing changes to \c _decoderStates
+	std::mutex						_decoderStatesLock;
+	/// Reclaims decoder states and lists once no reader may refer to them
+	SFB::EpochReclaimer				_reclaimer;
+
+	/// The block passed to \c AVAudioSourceNode, retained for offline rendering
+	AVAudioSourceNodeRenderBlock	_renderBlock;
+}
+- (BOOL)performEnqueue:(id <SFBPCMDecoding>)decoder gain:(float)gain applyReplayGain:(BOOL)applyReplayGain reset:(BOOL)reset error:(NSError **)error;
+- (float)replayGainForDecoder:(id <SFBPCMDecoding>)decoder;
+- (void)resolveReplayGainForDecoderState:(DecoderStateData *)decoderState;
+- (void)openPendingDecoder:(id <SFBPCMDecoding>)decoder ticket:(uint64_t)ticket;
+- (void)completePendingEnqueue:(uint64_t)ticket error:(NSError *)error latency:(NSTimeInterval)latency;
+- (void)postDecoderEvent:(DecoderEvent)event;
+- (void)deliverDecoderEvent:(const DecoderEvent&)event;
+- (void)drainRenderTrace;
+- (void)scheduleRenderTraceDrain;
+- (void)analyzeSpectrumTap;
+- (PlaybackSnapshot)currentPlaybackSnapshot;
+- (BOOL)bufferAudioFromDecoderState:(DecoderStateData *)decoderState chunkSize:(AVAudioFrameCount)chunkSize framesWritten:(AVAudioFrameCount *)framesWritten error:(NSError **)error;
+- (BOOL)continueCrossfadeWithDecoderState:(DecoderStateData *)decoderState chunkSize:(AVAudioFrameCount)chunkSize framesWritten:(AVAudioFrameCount *)framesWritten error:(NSError **)error;
+- (AVAudioFrameCount)releaseCrossfadeTailExcess;
+- (SFBAudioDecodingWorkResult)flushCrossfade;
+- (void)finishCrossfade;
+- (void)discardCrossfade;
+- (SampleRateConverterSettings)currentSampleRateConverterSettings;
+- (BOOL)canStageSeekForDecoderState:(DecoderStateData *)decoderState;
+- (SFBAudioDecodingWorkResult)stageSeekForDecoderState:(DecoderStateData *)decoderState chunkSize:(AVAudioFrameCount)chunkSize;
+- (SFBAudioDecodingWorkResult)decodeScrubGrainFromDecoderState:(DecoderStateData *)decoderState;
+- (BOOL)reopenRenderedDecoderState;
+- (BOOL)muteOutput;
+- (QueuedDecoder)popQueuedDecoder;
+- (DecoderStateData *)createLookAheadDecoderState;
+- (BOOL)insertDecoderState:(DecoderStateData *)decoderState;
+- (void)collectDecoderStates;
+- (BOOL)stageAudioFromQueuedDecoders;
+@end
+
+@implementation SFBAudioPlayerNode
+
+- (instancetype)init
+{
+	return [self initWithSampleRate:44100 channels:2];
+}
+
+- (instancetype)initWithSampleRate:(double)sampleRate channels:(AVAudioChannelCount)channels
+{
+	return [self initWithFormat:[[AVAudioFormat alloc] initStandardFormatWithSampleRate:sampleRate channels:channels]];
+}
+
+- (instancetype)initWithFormat:(AVAudioFormat *)format
+{
+	return [self initWithFormat:format ringBufferSize:kRingBufferFrameCapacity];
+}
+
+- (instancetype)initWithFormat:(AVAudioFormat *)format ringBufferSize:(uint32_t)ringBufferSize
+{
+	return [self initWithFormat:format ringBufferSize:ringBufferSize decodingExecutor:nil];
+}
+
+- (instancetype)initWithFormat:(AVAudioFormat *)format ringBufferSize:(uint32_t)ringBufferSize decodingExecutor:(SFBAudioDecodingExecutor *)decodingExecutor
+{
+	NSParameterAssert(format != nil);
+	NSParameterAssert(format.isStandard);
+
+	AVAudioSourceNodeRenderBlock renderBlock = ^OSStatus(BOOL *isSilence, const AudioTimeStamp *timestamp, AVAudioFrameCount frameCount, AudioBufferList *outputData) {
+		// Decoder states loaded from _decoderStates remain valid until the block returns
+		SFB::EpochReclaimer::Guard epochGuard(self->_reclaimer, kRenderBlockParticipant);
+
+
+		// ========================================
+		// Pre-rendering actions
+
+		// The snapshot generation must be read before any decoder state contributing to the playback snapshot
+		const auto playbackSnapshotGeneration = self->_playbackSnapshotGeneration.load();
+
+		// ========================================
+		// 0. Mute output if requested
+		if(self->_flags.load() & eAudioPlayerNodeFlagMuteRequested) {
+			self->_flags.fetch_or(eAudioPlayerNodeFlagOutputIsMuted);
+			self->_flags.fetch_and(~eAudioPlayerNodeFlagMuteRequested);
+			RequestDecoding(self->_flags, self->_decodingSemaphore);
+		}
+
+		const bool outputIsMuted = self->_flags.load() & eAudioPlayerNodeFlagOutputIsMuted;
+		if(outputIsMuted != self->_renderOutputWasMuted) {
+			self->_renderOutputWasMuted = outputIsMuted;
+			self->_renderTrace.TryPush({ eAudioPlayerNodeRenderTraceEventMuteTransition, timestamp->mHostTime, outputIsMuted, 0 });
+		}
+
+		// Report ring buffer resets performed by the decoding thread and note the frame at which a seek landed
+		if(self->_flags.load() & eAudioPlayerNodeFlagRingBufferWasReset) {
+			self->_flags.fetch_and(~eAudioPlayerNodeFlagRingBufferWasReset);
+			PostRenderEvent(self->_renderEvents, self->_renderEventsProcessor, { eAudioPlayerNodeRenderEventRingBufferReset, 0, timestamp->mHostTime, 0 });
+			self->_renderPendingSeekSequenceNumber = self->_resetSeekSequenceNumber.load();
+			self->_renderPendingSeekFrame = self->_resetSeekFrame.exchange(kInvalidFramePosition);
+
+			// Audio preceding the reset must not be faded out after it
+			self->_crossfadeBuffer.CommitRead(self->_crossfadeBuffer.FramesAvailableToRead());
+			self->_renderCrossfadeLength = 0;
+		}
+
+		// Switch to audio staged by the decoding thread at a seek target, discarding the audio buffered before the seek
+		//
+		// The decoding thread doesn't write to the ring buffer or the seek buffer while the seek buffer is ready,
+		// so the read position of the ring buffer may be advanced past the discarded audio without a reset
+		if(!outputIsMuted && (self->_flags.fetch_and(~eAudioPlayerNodeFlagSeekBufferReady) & eAudioPlayerNodeFlagSeekBufferReady)) {
+			// Keep the beginning of the discarded audio to fade out
+			self->_crossfadeBuffer.CommitRead(self->_crossfadeBuffer.FramesAvailableToRead());
+			self->_renderCrossfadePosition = 0;
+			self->_renderCrossfadeLength = 0;
+
+			if(self->_flags.load() & eAudioPlayerNodeFlagIsPlaying) {
+				auto crossfadeFrameCount = std::min(self->_seekCrossfadeFrameCount.load(), static_cast<AVAudioFrameCount>(self->_audioRingBuffer.FramesAvailableToRead()));
+				auto writeVector = self->_crossfadeBuffer.GetWriteVector();
+				for(const auto& region : { writeVector.mFirst, writeVector.mSecond }) {
+					auto framesToCopy = std::min(region.mFrameCount, crossfadeFrameCount - self->_renderCrossfadeLength);
+					if(framesToCopy == 0 || !self->_crossfadeBuffer.GetBufferList({ region.mFrameOffset, framesToCopy }, self->_renderCrossfadeBufferList.get()))
+						break;
+					auto framesCopied = self->_audioRingBuffer.Read(self->_renderCrossfadeBufferList.get(), framesToCopy);
+					self->_crossfadeBuffer.CommitWrite(framesCopied);
+					self->_renderCrossfadeLength += framesCopied;
+				}
+			}
+
+			self->_audioRingBuffer.CommitRead(static_cast<uint32_t>(self->_audioRingBuffer.FramesAvailableToRead()));
+
+			// Playback resumes at the frame where the decoder landed
+			const auto seekSequenceNumber = self->_stagedSeekSequenceNumber.load();
+			const auto seekFrame = self->_stagedSeekFrame.load();
+			auto decoderState = GetDecoderStateWithSequenceNumber(self->_decoderStates.load(), seekSequenceNumber);
+			if(decoderState) {
+				// A seek requested after staging began remains pending
+				auto seekTarget = self->_stagedSeekTarget.load();
+				decoderState->mFrameToSeek.compare_exchange_strong(seekTarget, kInvalidFramePosition);
+				decoderState->mFramesRendered.store(decoderState->ConvertToOutputFrames(seekFrame));
+			}
+
+			self->_flags.fetch_or(eAudioPlayerNodeFlagSeekBufferActive);
+			self->_flags.fetch_and(~eAudioPlayerNodeFlagSeekStaging);
+
+			self->_stagedSeekCount.fetch_add(1);
+			RecordSeekCompletion(self->_seekCount, self->_lastSeekLatency, self->_maximumSeekLatency, self->_seekRequestHostTime.load(), timestamp->mHostTime);
+			PostRenderEvent(self->_renderEvents, self->_renderEventsProcessor, { eAudioPlayerNodeRenderEventSeekCompleted, seekSequenceNumber, timestamp->mHostTime, seekFrame });
+
+			// The decoding thread may write to the ring buffer again
+			RequestDecoding(self->_flags, self->_decodingSemaphore);
+		}
+
+		// ========================================
+		// Output silence preceding a scheduled start
+		//
+		// Audio is rendered into the part of the output following the scheduled start
+		AudioBufferList *renderData = outputData;
+		AVAudioFrameCount renderFrameCount = frameCount;
+		uint64_t renderHostTime = timestamp->mHostTime;
+		bool awaitingScheduledStart = false;
+		const auto scheduledStartHostTime = self->_scheduledStart.HostTime();
+		if(scheduledStartHostTime != 0 && (self->_flags.load() & eAudioPlayerNodeFlagIsPlaying)) {
+			const auto sampleRate = self->_audioRingBuffer.Format().mSampleRate;
+			const double frameOffset = scheduledStartHostTime > timestamp->mHostTime ? std::round(ConvertHostTicksToNanos(scheduledStartHostTime - timestamp->mHostTime) * sampleRate / NSEC_PER_SEC) : 0;
+			// A start isn't performed while muted so the first frame following it is not lost
+			if(frameOffset >= frameCount || outputIsMuted || !self->_scheduledStart.TryStart(scheduledStartHostTime, timestamp->mHostTime))
+				awaitingScheduledStart = true;
+			else if(frameOffset > 0) {
+				const auto frameCountToZero = static_cast<AVAudioFrameCount>(frameOffset);
+				const auto byteCountToZero = self->_audioRingBuffer.Format().FrameCountToByteSize(frameCountToZero);
+				const auto byteCountRemaining = self->_audioRingBuffer.Format().FrameCountToByteSize(frameCount - frameCountToZero);
+				renderData = self->_renderScheduledStartBufferList.get();
+				for(UInt32 i = 0; i < outputData->mNumberBuffers; ++i) {
+					std::memset(outputData->mBuffers[i].mData, 0, byteCountToZero);
+					renderData->mBuffers[i].mNumberChannels = outputData->mBuffers[i].mNumberChannels;
+					renderData->mBuffers[i].mData = static_cast<int8_t *>(outputData->mBuffers[i].mData) + byteCountToZero;
+					renderData->mBuffers[i].mDataByteSize = static_cast<UInt32>(byteCountRemaining);
+				}
+				renderFrameCount = frameCount - frameCountToZero;
+				renderHostTime = timestamp->mHostTime + ConvertSecondsToHostTicks(frameCountToZero / sampleRate);
+			}
+		}
+
+		// ========================================
+		// Rendering
+
+		// ========================================
+		// 1. Determine how many audio frames are available to read in the seek buffer and the ring buffer
+		const bool seekBufferActive = self->_flags.load() & eAudioPlayerNodeFlagSeekBufferActive;
+		AVAudioFrameCount framesAvailableToRead = static_cast<AVAudioFrameCount>(self->_audioRingBuffer.FramesAvailableToRead());
+		if(seekBufferActive)
+			framesAvailableToRead += static_cast<AVAudioFrameCount>(self->_seekBuffer.FramesAvailableToRead());
+
+		// ========================================
+		// 2. Update buffering statistics if audio is expected from the current decoder
+		//
+		// Audio is expected when playing unmuted after the current decoder has started rendering and until its decoding is complete
+		// Gaps between grains decoded while scrubbing are expected
+		bool underrun = false;
+		if(!awaitingScheduledStart && (self->_flags.load() & eAudioPlayerNodeFlagIsPlaying) && !(self->_flags.load() & (eAudioPlayerNodeFlagOutputIsMuted | eAudioPlayerNodeFlagRingBufferPriming | eAudioPlayerNodeFlagScrubbing))) {
+			auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(self->_decoderStates.load());
+			if(decoderState && (decoderState->mFlags.load() & (DecoderStateData::eRenderingStartedFlag | DecoderStateData::eDecodingCompleteFlag)) == DecoderStateData::eRenderingStartedFlag) {
+				if(framesAvailableToRead < self->_minimumFillLevel.load())
+					self->_minimumFillLevel.store(framesAvailableToRead);
+
+				if(framesAvailableToRead < renderFrameCount) {
+					self->_underrunCount.fetch_add(1);
+					self->_underrunFrameCount.fetch_add(renderFrameCount - framesAvailableToRead);
+					underrun = true;
+				}
+			}
+		}
+
+		// Report the beginning and end of each run of consecutive underruns
+		if(underrun != self->_renderUnderrunInProgress) {
+			self->_renderUnderrunInProgress = underrun;
+			if(underrun) {
+				self->_renderUnderrunFrameCount = 0;
+				const uint64_t hostTime = renderHostTime + ConvertSecondsToHostTicks(framesAvailableToRead / self->_audioRingBuffer.Format().mSampleRate);
+				PostRenderEvent(self->_renderEvents, self->_renderEventsProcessor, { eAudioPlayerNodeRenderEventUnderrunStarted, 0, hostTime, 0 });
+			}
+			else
+				PostRenderEvent(self->_renderEvents, self->_renderEventsProcessor, { eAudioPlayerNodeRenderEventUnderrunEnded, 0, renderHostTime, static_cast<int64_t>(self->_renderUnderrunFrameCount) });
+		}
+		if(underrun)
+			self->_renderUnderrunFrameCount += renderFrameCount - framesAvailableToRead;
+
+		// ========================================
+		// 3. Output silence if a) the node isn't playing, b) the node is muted, c) the ring buffer is empty, or d) a scheduled start is pending
+		if(!(self->_flags.load() & eAudioPlayerNodeFlagIsPlaying) || self->_flags.load() & eAudioPlayerNodeFlagOutputIsMuted || framesAvailableToRead == 0 || awaitingScheduledStart) {
+			size_t byteCountToZero = self->_audioRingBuffer.Format().FrameCountToByteSize(frameCount);
+			for(UInt32 i = 0; i < outputData->mNumberBuffers; ++i) {
+				std::memset(outputData->mBuffers[i].mData, 0, byteCountToZero);
+				outputData->mBuffers[i].mDataByteSize = static_cast<UInt32>(byteCountToZero);
+			}
+
+			// The playback position does not advance while silence is output
+			self->_playbackSnapshot.Store(MakePlaybackSnapshot(self->_decoderStates.load(), playbackSnapshotGeneration, timestamp->mHostTime, false));
+
+			if(self->_meteringEnabled.load())
+				self->_outputMeter.Measure(outputData, frameCount, true, timestamp->mHostTime, self->_audioRingBuffer.Format().mSampleRate);
+			else
+				self->_outputMeter.Disable();
+
+			*isSilence = YES;
+			return noErr;
+		}
+
+		// ========================================
+		// 4. Read as many frames as available from the seek buffer followed by the ring buffer
+		AVAudioFrameCount framesToRead = std::min(framesAvailableToRead, renderFrameCount);
+		AVAudioFrameCount framesRead = 0;
+		if(seekBufferActive) {
+			framesRead = static_cast<AVAudioFrameCount>(self->_seekBuffer.Read(renderData, framesToRead));
+			if(self->_seekBuffer.FramesAvailableToRead() == 0) {
+				self->_flags.fetch_and(~eAudioPlayerNodeFlagSeekBufferActive);
+				// The decoding thread may stage another seek
+				RequestDecoding(self->_flags, self->_decodingSemaphore);
+			}
+		}
+
+		if(framesRead == 0)
+			framesRead = static_cast<AVAudioFrameCount>(self->_audioRingBuffer.Read(renderData, framesToRead));
+		else if(framesRead < framesToRead) {
+			// Read the remainder following the audio from the seek buffer
+			auto byteCountToSkip = self->_audioRingBuffer.Format().FrameCountToByteSize(framesRead);
+			auto byteCountRemaining = self->_audioRingBuffer.Format().FrameCountToByteSize(renderFrameCount - framesRead);
+			auto bufferList = self->_renderOutputBufferList.get();
+			for(UInt32 i = 0; i < renderData->mNumberBuffers; ++i) {
+				bufferList->mBuffers[i].mNumberChannels = renderData->mBuffers[i].mNumberChannels;
+				bufferList->mBuffers[i].mData = static_cast<int8_t *>(renderData->mBuffers[i].mData) + byteCountToSkip;
+				bufferList->mBuffers[i].mDataByteSize = static_cast<UInt32>(byteCountRemaining);
+			}
+
+			framesRead += static_cast<AVAudioFrameCount>(self->_audioRingBuffer.Read(bufferList, framesToRead - framesRead));
+
+			auto byteCount = static_cast<UInt32>(self->_audioRingBuffer.Format().FrameCountToByteSize(framesRead));
+			for(UInt32 i = 0; i < renderData->mNumberBuffers; ++i)
+				renderData->mBuffers[i].mDataByteSize = byteCount;
+		}
+
+		if(framesRead != framesToRead)
+			self->_renderTrace.TryPush({ eAudioPlayerNodeRenderTraceEventShortRead, renderHostTime, framesToRead, framesRead });
+
+		// Fade out audio preceding a staged seek
+		if(self->_renderCrossfadeLength > 0) {
+			MixCrossfade(self->_crossfadeBuffer, renderData, self->_renderCrossfadeBufferList.get(), framesRead, self->_renderCrossfadePosition, self->_renderCrossfadeLength);
+			if(self->_crossfadeBuffer.FramesAvailableToRead() == 0)
+				self->_renderCrossfadeLength = 0;
+		}
+
+		// ========================================
+		// 5. If the ring buffer didn't contain as many frames as requested fill the remainder with silence
+		if(framesRead != renderFrameCount) {
+			self->_renderTrace.TryPush({ eAudioPlayerNodeRenderTraceEventSilencePadding, renderHostTime, framesRead, renderFrameCount });
+
+			auto framesOfSilence = renderFrameCount - framesRead;
+			auto byteCountToSkip = self->_audioRingBuffer.Format().FrameCountToByteSize(framesRead);
+			auto byteCountToZero = self->_audioRingBuffer.Format().FrameCountToByteSize(framesOfSilence);
+			for(UInt32 i = 0; i < renderData->mNumberBuffers; ++i) {
+				std::memset(static_cast<int8_t *>(renderData->mBuffers[i].mData) + byteCountToSkip, 0, byteCountToZero);
+				renderData->mBuffers[i].mDataByteSize = static_cast<UInt32>(byteCountToSkip + byteCountToZero);
+			}
+		}
+
+		// The output includes the silence preceding a scheduled start
+		if(renderData != outputData) {
+			const auto byteCount = static_cast<UInt32>(self->_audioRingBuffer.Format().FrameCountToByteSize(frameCount));
+			for(UInt32 i = 0; i < outputData->mNumberBuffers; ++i)
+				outputData->mBuffers[i].mDataByteSize = byteCount;
+		}
+
+		// ========================================
+		// 6. Measure output levels and copy output for spectrum analysis if requested
+		if(self->_meteringEnabled.load())
+			self->_outputMeter.Measure(outputData, frameCount, false, timestamp->mHostTime, self->_audioRingBuffer.Format().mSampleRate);
+		else
+			self->_outputMeter.Disable();
+
+		if(self->_spectrumAnalysisEnabled.load() && self->_spectrumTap.Write(outputData, frameCount, timestamp->mHostTime))
+			dispatch_source_merge_data(self->_spectrumAnalysisProcessor, 1);
+
+		// ========================================
+		// 7. If the decoding thread is waiting and the ring buffer has drained enough for another chunk signal it
+		if(self->_flags.load() & eAudioPlayerNodeFlagDecoderNeedsSpace) {
+			AVAudioFrameCount fillLevel = static_cast<AVAudioFrameCount>(self->_audioRingBuffer.FramesAvailableToRead());
+			if(fillLevel <= self->_decodingThreshold.load() && (self->_flags.fetch_and(~eAudioPlayerNodeFlagDecoderNeedsSpace) & eAudioPlayerNodeFlagDecoderNeedsSpace))
+				RequestDecoding(self->_flags, self->_decodingSemaphore);
+		}
+
+		// ========================================
+		// Post-rendering actions
+
+		// ========================================
+		// 8. There is nothing more to do if no frames were rendered, the frames rendered precede a seek being staged, or the frames rendered are grains decoded while scrubbing
+		if(framesRead == 0 || (self->_flags.load() & (eAudioPlayerNodeFlagSeekStaging | eAudioPlayerNodeFlagScrubbing))) {
+			// The playback position does not advance while no frames are rendered, a seek is pending, or scrubbing
+			self->_playbackSnapshot.Store(MakePlaybackSnapshot(self->_decoderStates.load(), playbackSnapshotGeneration, renderHostTime, false));
+			return noErr;
+		}
+
+		// ========================================
+		// 9. Perform bookkeeping to apportion the rendered frames appropriately
+		//
+		// framesRead contains the number of valid frames that were rendered
+		// However, these could have come from any number of decoders depending on buffer sizes
+		// So it is necessary to split them up here
+
+		AVAudioFrameCount framesRemainingToDistribute = framesRead;
+
+		// Audio following a seek is now rendering
+		if(self->_renderPendingSeekFrame != kInvalidFramePosition) {
+			RecordSeekCompletion(self->_seekCount, self->_lastSeekLatency, self->_maximumSeekLatency, self->_seekRequestHostTime.load(), renderHostTime);
+			PostRenderEvent(self->_renderEvents, self->_renderEventsProcessor, { eAudioPlayerNodeRenderEventSeekCompleted, self->_renderPendingSeekSequenceNumber, renderHostTime, self->_renderPendingSeekFrame });
+			self->_renderPendingSeekFrame = kInvalidFramePosition;
+		}
+
+		auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(self->_decoderStates.load());
+		while(decoderState) {
+			AVAudioFrameCount decoderFramesRemaining = static_cast<AVAudioFrameCount>(decoderState->mFramesConverted.load() - decoderState->mFramesRendered.load());
+			AVAudioFrameCount framesFromThisDecoder = std::min(decoderFramesRemaining, framesRead);
+
+			if(!(decoderState->mFlags.load() & DecoderStateData::eRenderingStartedFlag)) {
+				decoderState->mFlags.fetch_or(DecoderStateData::eRenderingStartedFlag);
+
+				self->_renderTrace.TryPush({ eAudioPlayerNodeRenderTraceEventSequenceNumberChange, renderHostTime, self->_renderSequenceNumber, decoderState->mSequenceNumber });
+				self->_renderSequenceNumber = decoderState->mSequenceNumber;
+
+				// Schedule the rendering started notification
+				const uint32_t frameOffset = framesRead - framesRemainingToDistribute;
+				const uint64_t hostTime = renderHostTime + ConvertSecondsToHostTicks(frameOffset / self->_audioRingBuffer.Format().mSampleRate);
+				PostRenderEvent(self->_renderEvents, self->_renderEventsProcessor, { eAudioPlayerNodeRenderEventRenderingStarted, decoderState->mSequenceNumber, hostTime, 0 });
+			}
+
+			// Frames mixed with the beginning of the following decoder are rendered for both decoders
+			const auto crossfadeStartFrame = decoderState->mCrossfadeStartFrame.load();
+			if(crossfadeStartFrame != kInvalidFramePosition) {
+				const auto framesRendered = decoderState->mFramesRendered.load();
+				const auto firstOverlapFrame = std::max(framesRendered, crossfadeStartFrame);
+				const auto lastOverlapFrame = framesRendered + framesFromThisDecoder;
+				auto nextDecoderState = GetActiveDecoderStateFollowingSequenceNumber(self->_decoderStates.load(), decoderState->mSequenceNumber);
+				if(nextDecoderState && lastOverlapFrame > firstOverlapFrame) {
+					const uint32_t frameOffset = framesRead - framesRemainingToDistribute + static_cast<uint32_t>(firstOverlapFrame - framesRendered);
+					if(!(nextDecoderState->mFlags.load() & DecoderStateData::eRenderingStartedFlag)) {
+						nextDecoderState->mFlags.fetch_or(DecoderStateData::eRenderingStartedFlag);
+
+						self->_renderTrace.TryPush({ eAudioPlayerNodeRenderTraceEventSequenceNumberChange, renderHostTime, self->_renderSequenceNumber, nextDecoderState->mSequenceNumber });
+						self->_renderSequenceNumber = nextDecoderState->mSequenceNumber;
+
+						// Schedule the rendering started notification for the start of the crossfade
+						const uint64_t hostTime = renderHostTime + ConvertSecondsToHostTicks(frameOffset / self->_audioRingBuffer.Format().mSampleRate);
+						PostRenderEvent(self->_renderEvents, self->_renderEventsProcessor, { eAudioPlayerNodeRenderEventRenderingStarted, nextDecoderState->mSequenceNumber, hostTime, 0 });
+					}
+
+					const auto nextDecoderFramesRemaining = nextDecoderState->mFramesConverted.load() - nextDecoderState->mFramesRendered.load();
+					nextDecoderState->mFramesRendered.fetch_add(std::min(lastOverlapFrame - firstOverlapFrame, nextDecoderFramesRemaining));
+
+					if((nextDecoderState->mFlags.load() & DecoderStateData::eDecodingCompleteFlag) && nextDecoderState->mFramesRendered.load() == nextDecoderState->mFramesConverted.load()) {
+						nextDecoderState->mFlags.fetch_or(DecoderStateData::eRenderingCompleteFlag);
+
+						// Schedule the rendering complete notification
+						const uint64_t hostTime = renderHostTime + ConvertSecondsToHostTicks((framesRead - framesRemainingToDistribute + framesFromThisDecoder) / self->_audioRingBuffer.Format().mSampleRate);
+						PostRenderEvent(self->_renderEvents, self->_renderEventsProcessor, { eAudioPlayerNodeRenderEventRenderingComplete, nextDecoderState->mSequenceNumber, hostTime, 0 });
+					}
+				}
+			}
+
+			decoderState->mFramesRendered.fetch_add(framesFromThisDecoder);
+			framesRemainingToDistribute -= framesFromThisDecoder;
+
+			if((decoderState->mFlags.load() & DecoderStateData::eDecodingCompleteFlag) && decoderState->mFramesRendered.load() == decoderState->mFramesConverted.load()) {
+				decoderState->mFlags.fetch_or(DecoderStateData::eRenderingCompleteFlag);
+
+				// Schedule the rendering complete notification
+				const uint32_t frameOffset = framesRead - framesRemainingToDistribute;
+				const uint64_t hostTime = renderHostTime + ConvertSecondsToHostTicks(frameOffset / self->_audioRingBuffer.Format().mSampleRate);
+				PostRenderEvent(self->_renderEvents, self->_renderEventsProcessor, { eAudioPlayerNodeRenderEventRenderingComplete, decoderState->mSequenceNumber, hostTime, 0 });
+			}
+
+			if(framesRemainingToDistribute == 0)
+				break;
+
+			decoderState = GetActiveDecoderStateFollowingSequenceNumber(self->_decoderStates.load(), decoderState->mSequenceNumber);
+		}
+
+		// ========================================
+		// 10. If there are no active decoders schedule the end of audio notification
+
+		decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(self->_decoderStates.load());
+		if(!decoderState) {
+			const uint64_t hostTime = renderHostTime + ConvertSecondsToHostTicks(framesRead / self->_audioRingBuffer.Format().mSampleRate);
+			PostRenderEvent(self->_renderEvents, self->_renderEventsProcessor, { eAudioPlayerNodeRenderEventEndOfAudio, 0, hostTime, 0 });
+		}
+
+		// ========================================
+		// 11. Publish the playback position as of the end of the frames rendered in this cycle
+		const uint64_t snapshotHostTime = renderHostTime + ConvertSecondsToHostTicks(framesRead / self->_audioRingBuffer.Format().mSampleRate);
+		const bool isPlaying = (self->_flags.load() & (eAudioPlayerNodeFlagIsPlaying | eAudioPlayerNodeFlagOutputIsMuted)) == eAudioPlayerNodeFlagIsPlaying;
+		self->_playbackSnapshot.Store(MakePlaybackSnapshot(self->_decoderStates.load(), playbackSnapshotGeneration, snapshotHostTime, isPlaying));
+
+		return noErr;
+	};
+
+	if((self = [super initWithFormat:format renderBlock:renderBlock])) {
+		os_log_info(_audioPlayerNodeLog, "Render block format: %{public}@", format);
+
+		_renderBlock = renderBlock;
+
+		// _flags, _decoderStates, and the buffering statistics are used in the render block so must be lock free
+		assert(_flags.is_lock_free());
+		assert(_decoderStates.is_lock_free());
+		assert(_decodingThreshold.is_lock_free());
+		assert(_underrunCount.is_lock_free());
+		assert(_minimumFillLevel.is_lock_free());
+
+		// Initialize the decoder state list
+		_decoderStates.store(new (std::nothrow) DecoderStateList{});
+		if(!_decoderStates.load()) {
+			os_log_error(_audioPlayerNodeLog, "Unable to allocate decoder state list");
+			return nil;
+		}
+
+		if(!_queuedDecoders.Allocate(kDecoderQueueCapacity)) {
+			os_log_error(_audioPlayerNodeLog, "Unable to allocate decoder queue");
+			return nil;
+		}
+
+		if(!_decoderEvents.Allocate(kDecoderEventQueueCapacity)) {
+			os_log_error(_audioPlayerNodeLog, "Unable to allocate decoder event queue");
+			return nil;
+		}
+
+		if(!_renderTrace.Allocate(kRenderTraceBufferCapacity)) {
+			os_log_error(_audioPlayerNodeLog, "Unable to allocate render trace buffer");
+			return nil;
+		}
+
+		_renderSequenceNumber = UINT64_MAX;
+
+		// No playback snapshot is valid until the render block publishes one
+		_playbackSnapshotGeneration.store(0);
+		_playbackSnapshot.Store(PlaybackSnapshot::Empty(UINT64_MAX, 0));
+
+		// Allocate the audio ring buffer and the rendering events ring buffer
+		_renderingFormat = format;
+		if(!_audioRingBuffer.Allocate(*(_renderingFormat.streamDescription), ringBufferSize)) {
+			os_log_error(_audioPlayerNodeLog, "SFB::PCMRingBuffer::Allocate() failed");
+			return nil;
+		}
+
+		// The fill target is limited by the capacity of the ring buffer
+		_ringBufferCapacity = _audioRingBuffer.CapacityFrames();
+
+		SFBAudioPlayerNodeBufferingBounds bufferingBounds = {
+			.minimumFillTarget = _ringBufferCapacity / 4,
+			.maximumFillTarget = _ringBufferCapacity,
+			.minimumChunkSize = kDefaultMinimumChunkSize,
+			.maximumChunkSize = kRingBufferChunkSize
+		};
+		bufferingBounds = ClampBufferingBounds(bufferingBounds, _ringBufferCapacity);
+		_bufferingBounds.store(bufferingBounds);
+		_bufferingController.SetBounds(bufferingBounds);
+		_decodingThreshold.store(_bufferingController.FillTarget() - _bufferingController.ChunkSize());
+
+		_underrunCount.store(0);
+		_underrunFrameCount.store(0);
+		_minimumFillLevel.store(UINT32_MAX);
+
+		if(!_renderEvents.Allocate(kRenderEventQueueCapacity)) {
+			os_log_error(_audioPlayerNodeLog, "Unable to allocate render event queue");
+			return nil;
+		}
+
+		_renderPendingSeekFrame = kInvalidFramePosition;
+		_resetSeekFrame.store(kInvalidFramePosition);
+
+		// Allocate the buffers used for staged seeks
+		if(!_seekBuffer.Allocate(*(_renderingFormat.streamDescription), kSeekBufferFrameCapacity) || !_crossfadeBuffer.Allocate(*(_renderingFormat.streamDescription), kMaximumSeekCrossfadeFrameCount)) {
+			os_log_error(_audioPlayerNodeLog, "SFB::PCMRingBuffer::Allocate() failed");
+			return nil;
+		}
+
+		_renderCrossfadeBufferList = AllocateBufferList(_renderingFormat.channelCount);
+		_renderOutputBufferList = AllocateBufferList(_renderingFormat.channelCount);
+		_crossfadeRegionBufferList = AllocateBufferList(_renderingFormat.channelCount);
+		_renderScheduledStartBufferList = AllocateBufferList(_renderingFormat.channelCount);
+		_scrubGrainBufferList = AllocateBufferList(_renderingFormat.channelCount);
+		if(!_renderCrossfadeBufferList || !_renderOutputBufferList || !_crossfadeRegionBufferList || !_renderScheduledStartBufferList || !_scrubGrainBufferList) {
+			os_log_error(_audioPlayerNodeLog, "Unable to allocate buffer list");
+			return nil;
+		}
+
+		// The crossfade tail and head buffers are allocated when a crossfade is first needed
+		_crossfadeMixBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_renderingFormat frameCapacity:kCrossfadeMixFrameCapacity];
+		_crossfadeHeadMixBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:_renderingFormat frameCapacity:kCrossfadeMixFrameCapacity];
+		if(!_crossfadeMixBuffer || !_crossfadeHeadMixBuffer) {
+			os_log_error(_audioPlayerNodeLog, "Unable to allocate crossfade buffers");
+			return nil;
+		}
+
+		try {
+			_crossfadeGains.resize(2 * kCrossfadeMixFrameCapacity);
+		}
+
+		catch(const std::exception& e) {
+			os_log_error(_audioPlayerNodeLog, "Unable to allocate crossfade gains: %{public}s", e.what());
+			return nil;
+		}
+
+		_crossfadeFrameCount.store(0);
+		_crossfadeCurve.store(SFBAudioPlayerNodeCrossfadeCurveEqualPower);
+		_crossfadeTailDecoderState = nullptr;
+		_crossfadeHeadDecoderState = nullptr;
+		_crossfadeHoldbackFrameCount = 0;
+		_crossfadeOverlapLength = 0;
+		_crossfadeOverlapPosition = 0;
+
+		_stagedSeekTarget.store(kInvalidFramePosition);
+		_stagedSeekFrame.store(kInvalidFramePosition);
+		_stagedSeekSequenceNumber.store(0);
+		_seekCrossfadeFrameCount.store(0);
+		_renderCrossfadePosition = 0;
+		_renderCrossfadeLength = 0;
+
+		_formatConversionEnabled.store(false);
+		_meteringEnabled.store(false);
+		_spectrumAnalysisEnabled.store(false);
+		_spectrumAnalysisFFTSize.store(kDefaultSpectrumAnalysisFFTSize);
+		_spectrumAnalysisHopSize.store(kDefaultSpectrumAnalysisFFTSize / 2);
+		_replayGainMode.store(SFBAudioPlayerNodeReplayGainModeOff);
+		_replayGainPreamp.store(0);
+		_peakLimiterEnabled.store(false);
+		_sampleRateConverterSettings = { AVAudioQualityHigh, AVSampleRateConverterAlgorithm_Normal };
+
+		_seekRequestCount.store(0);
+		_seekCount.store(0);
+		_stagedSeekCount.store(0);
+		_seekRequestHostTime.store(0);
+		_lastSeekLatency.store(0);
+		_maximumSeekLatency.store(0);
+
+		_scrubTarget.store(kInvalidFramePosition);
+		_scrubGrainFrameCount.store(static_cast<AVAudioFrameCount>(std::round(kDefaultScrubGrainDuration * format.sampleRate)));
+		_scrubRequestCount.store(0);
+		_scrubGrainCount.store(0);
+
+#if 0
+		// See the comments in SFBAudioPlayer -configureEngineForGaplessPlaybackOfFormat:
+		// 512 is the nominal "standard" value for kAudioUnitProperty_MaximumFramesPerSlice while 1156 is AVAudioSourceNode's default
+		AVAudioFrameCount maximumFramesToRender = static_cast<AVAudioFrameCount>(ceil(512 * (format.sampleRate / 44100)));
+		if(self.AUAudioUnit.maximumFramesToRender < maximumFramesToRender) {
+			os_log_debug(_audioPlayerNodeLog, "Setting maximumFramesToRender to %u", maximumFramesToRender);
+			self.AUAudioUnit.maximumFramesToRender = maximumFramesToRender;
+		}
+#endif
+
+		// Create the dispatch queue used for sending delegate messages
+		dispatch_queue_attr_t attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INITIATED, 0);
+		_notificationQueue = dispatch_queue_create_with_target("org.sbooth.AudioEngine.AudioPlayerNode.NotificationQueue", attr, DISPATCH_TARGET_QUEUE_DEFAULT);
+		if(!_notificationQueue) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_queue_create_with_target failed");
+			return nil;
+		}
+
+		// AVAudioFormat doesn't conform to NSCopying so it can't be used as a dictionary key
+		_convertibleFormats = [NSMapTable strongToStrongObjectsMapTable];
+
+		// Create the dispatch queues used for opening decoders asynchronously
+		attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_CONCURRENT, QOS_CLASS_UTILITY, 0);
+		_openQueue = dispatch_queue_create_with_target("org.sbooth.AudioEngine.AudioPlayerNode.OpenQueue", attr, DISPATCH_TARGET_QUEUE_DEFAULT);
+		if(!_openQueue) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_queue_create_with_target failed");
+			return nil;
+		}
+
+		attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0);
+		_openSubmissionQueue = dispatch_queue_create_with_target("org.sbooth.AudioEngine.AudioPlayerNode.OpenSubmissionQueue", attr, DISPATCH_TARGET_QUEUE_DEFAULT);
+		if(!_openSubmissionQueue) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_queue_create_with_target failed");
+			return nil;
+		}
+
+		_openSemaphore = dispatch_semaphore_create(kMaximumConcurrentOpens);
+		if(!_openSemaphore) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_semaphore_create failed");
+			return nil;
+		}
+
+		// Nodes using an executor share its semaphore so any request wakes a worker thread
+		_decodingExecutor = decodingExecutor;
+		_decodingSemaphore = decodingExecutor ? decodingExecutor.semaphore : dispatch_semaphore_create(0);
+		if(!_decodingSemaphore) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_semaphore_create failed");
+			return nil;
+		}
+
+		_observedUnderrunCount = 0;
+		_awaitingMute = false;
+		_reopeningDecoderState = false;
+		_decodingDecoderState = nullptr;
+		_unstoredDecoderState = nullptr;
+
+		_scheduledCount.store(0);
+		_decodingTime.store(0);
+		_totalSchedulingDelay.store(0);
+		_maximumSchedulingDelay.store(0);
+		_missedDeadlineCount.store(0);
+
+		_lookAheadSemaphore = dispatch_semaphore_create(0);
+		if(!_lookAheadSemaphore) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_semaphore_create failed");
+			return nil;
+		}
+
+		_lookAheadDepth.store(0);
+		_lookAheadMemoryLimit.store(kDefaultLookAheadMemoryLimit);
+
+		// Set up render events processing for delegate notifications
+		_renderEventsProcessor = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_OR, 0, 0, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0));
+		if(!_renderEventsProcessor) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_source_create failed");
+			return nil;
+		}
+
+		dispatch_source_set_event_handler(_renderEventsProcessor, ^{
+			SFB::EpochReclaimer::Guard epochGuard(self->_reclaimer, kRenderEventsParticipant);
+
+			RenderEvent event;
+			while(self->_renderEvents.TryPop(event)) {
+				const uint64_t hostTime = event.mHostTime;
+
+				switch(event.mType) {
+					case eAudioPlayerNodeRenderEventRenderingStarted:
+					{
+						auto decoderState = GetDecoderStateWithSequenceNumber(self->_decoderStates.load(), event.mSequenceNumber);
+						if(!decoderState) {
+							os_log_error(_audioPlayerNodeLog, "Decoder state with sequence number %llu missing", event.mSequenceNumber);
+							break;
+						}
+
+						os_log_debug(_audioPlayerNodeLog, "Rendering will start in %.2f msec for \"%{public}@\"", (ConvertHostTicksToNanos(hostTime) - ConvertHostTicksToNanos(mach_absolute_time())) / NSEC_PER_MSEC, [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
+
+						if([self->_delegate respondsToSelector:@selector(audioPlayerNode:renderingWillStart:atHostTime:)])
+							dispatch_async_and_wait(self->_notificationQueue, ^{
+								[self->_delegate audioPlayerNode:self renderingWillStart:decoderState->mDecoder atHostTime:hostTime];
+							});
+
+						if([self->_delegate respondsToSelector:@selector(audioPlayerNode:renderingStarted:)]) {
+							id<SFBPCMDecoding> decoder = decoderState->mDecoder;
+							dispatch_time_t notificationTime = hostTime;
+							dispatch_after(notificationTime, self->_notificationQueue, ^{
+#if DEBUG
+								double delta = (ConvertHostTicksToNanos(mach_absolute_time()) - ConvertHostTicksToNanos(notificationTime)) / NSEC_PER_MSEC;
+								double tolerance = 1000 / self->_audioRingBuffer.Format().mSampleRate;
+								if(abs(delta) > tolerance)
+									os_log_debug(_audioPlayerNodeLog, "Rendering started notification for \"%{public}@\" arrived %.2f msec %s", [[NSFileManager defaultManager] displayNameAtPath:decoder.inputSource.url.path], delta, delta > 0 ? "late" : "early");
+#endif
+
+								[self->_delegate audioPlayerNode:self renderingStarted:decoder];
+							});
+						}
+						break;
+					}
+
+					case eAudioPlayerNodeRenderEventRenderingComplete:
+					{
+						auto decoderState = GetDecoderStateWithSequenceNumber(self->_decoderStates.load(), event.mSequenceNumber);
+						if(!decoderState) {
+							os_log_error(_audioPlayerNodeLog, "Decoder state with sequence number %llu missing", event.mSequenceNumber);
+							break;
+						}
+
+						os_log_debug(_audioPlayerNodeLog, "Rendering will complete in %.2f msec for \"%{public}@\"", (ConvertHostTicksToNanos(hostTime) - ConvertHostTicksToNanos(mach_absolute_time())) / NSEC_PER_MSEC, [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
+
+						if([self->_delegate respondsToSelector:@selector(audioPlayerNode:renderingComplete:)]) {
+							// Store a strong reference to `decoderState->mDecoder` for use in the notification block
+							// Otherwise the collector could collect `decoderState` before the block is invoked
+							// resulting in a `nil` decoder being passed in -audioPlayerNode:renderingComplete:
+							// with a possible subsequent EXC_BAD_ACCESS from messaging a non-optional `nil` object
+							id<SFBPCMDecoding> decoder = decoderState->mDecoder;
+							dispatch_time_t notificationTime = hostTime;
+							dispatch_after(notificationTime, self->_notificationQueue, ^{
+#if DEBUG
+								double delta = (ConvertHostTicksToNanos(mach_absolute_time()) - ConvertHostTicksToNanos(notificationTime)) / NSEC_PER_MSEC;
+								double tolerance = 1000 / self->_audioRingBuffer.Format().mSampleRate;
+								if(abs(delta) > tolerance)
+									os_log_debug(_audioPlayerNodeLog, "Rendering complete notification for \"%{public}@\" arrived %.2f msec %s", [[NSFileManager defaultManager] displayNameAtPath:decoder.inputSource.url.path], delta, delta > 0 ? "late" : "early");
+#endif
+
+								[self->_delegate audioPlayerNode:self renderingComplete:decoder];
+							});
+						}
+
+						// The last action performed with a decoder that has completed rendering is this notification
+						decoderState->mFlags.fetch_or(DecoderStateData::eMarkedForRemovalFlag);
+						dispatch_source_merge_data(self->_collector, 1);
+						break;
+					}
+
+					case eAudioPlayerNodeRenderEventEndOfAudio:
+						os_log_debug(_audioPlayerNodeLog, "End of audio in %.2f msec", (ConvertHostTicksToNanos(hostTime) - ConvertHostTicksToNanos(mach_absolute_time())) / NSEC_PER_MSEC);
+
+						if([self->_delegate respondsToSelector:@selector(audioPlayerNodeEndOfAudio:)]) {
+							dispatch_time_t notificationTime = hostTime;
+							dispatch_after(notificationTime, self->_notificationQueue, ^{
+#if DEBUG
+								double delta = (ConvertHostTicksToNanos(mach_absolute_time()) - ConvertHostTicksToNanos(notificationTime)) / NSEC_PER_MSEC;
+								double tolerance = 1000 / self->_audioRingBuffer.Format().mSampleRate;
+								if(abs(delta) > tolerance)
+									os_log_debug(_audioPlayerNodeLog, "End of audio notification arrived %.2f msec %s", delta, delta > 0 ? "late" : "early");
+#endif
+
+								[self->_delegate audioPlayerNodeEndOfAudio:self];
+							});
+						}
+						break;
+
+					case eAudioPlayerNodeRenderEventUnderrunStarted:
+						os_log_debug(_audioPlayerNodeLog, "Underrun will start in %.2f msec", (ConvertHostTicksToNanos(hostTime) - ConvertHostTicksToNanos(mach_absolute_time())) / NSEC_PER_MSEC);
+
+						if([self->_delegate respondsToSelector:@selector(audioPlayerNode:underrunStartedAtHostTime:)])
+							dispatch_after(hostTime, self->_notificationQueue, ^{
+								[self->_delegate audioPlayerNode:self underrunStartedAtHostTime:hostTime];
+							});
+						break;
+
+					case eAudioPlayerNodeRenderEventUnderrunEnded:
+					{
+						const uint64_t frameCount = static_cast<uint64_t>(event.mFrames);
+						os_log_debug(_audioPlayerNodeLog, "Underrun ends in %.2f msec after %llu frames of silence", (ConvertHostTicksToNanos(hostTime) - ConvertHostTicksToNanos(mach_absolute_time())) / NSEC_PER_MSEC, frameCount);
+
+						if([self->_delegate respondsToSelector:@selector(audioPlayerNode:underrunEndedAtHostTime:silentFrameCount:)])
+							dispatch_after(hostTime, self->_notificationQueue, ^{
+								[self->_delegate audioPlayerNode:self underrunEndedAtHostTime:hostTime silentFrameCount:frameCount];
+							});
+						break;
+					}
+
+					case eAudioPlayerNodeRenderEventSeekCompleted:
+					{
+						const AVAudioFramePosition frame = event.mFrames;
+						auto decoderState = GetDecoderStateWithSequenceNumber(self->_decoderStates.load(), event.mSequenceNumber);
+						if(!decoderState) {
+							os_log_error(_audioPlayerNodeLog, "Decoder state with sequence number %llu missing", event.mSequenceNumber);
+							break;
+						}
+
+						os_log_debug(_audioPlayerNodeLog, "Audio from seek to frame %lld will render in %.2f msec", frame, (ConvertHostTicksToNanos(hostTime) - ConvertHostTicksToNanos(mach_absolute_time())) / NSEC_PER_MSEC);
+
+						if([self->_delegate respondsToSelector:@selector(audioPlayerNode:seekCompleted:frame:hostTime:)]) {
+							id<SFBPCMDecoding> decoder = decoderState->mDecoder;
+							dispatch_after(hostTime, self->_notificationQueue, ^{
+								[self->_delegate audioPlayerNode:self seekCompleted:decoder frame:frame hostTime:hostTime];
+							});
+						}
+						break;
+					}
+
+					case eAudioPlayerNodeRenderEventRingBufferReset:
+						os_log_debug(_audioPlayerNodeLog, "Ring buffer reset observed %.2f msec ago", (ConvertHostTicksToNanos(mach_absolute_time()) - ConvertHostTicksToNanos(hostTime)) / NSEC_PER_MSEC);
+
+						if([self->_delegate respondsToSelector:@selector(audioPlayerNode:ringBufferResetAtHostTime:)])
+							dispatch_async(self->_notificationQueue, ^{
+								[self->_delegate audioPlayerNode:self ringBufferResetAtHostTime:hostTime];
+							});
+						break;
+				}
+			}
+		});
+
+		// Start processing render events
+		dispatch_activate(_renderEventsProcessor);
+
+		// Set up delivery of notifications posted by the decoding thread
+		_decoderEventsProcessor = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, _notificationQueue);
+		if(!_decoderEventsProcessor) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_source_create failed");
+			return nil;
+		}
+
+		dispatch_source_set_event_handler(_decoderEventsProcessor, ^{
+			DecoderEvent event;
+			while(self->_decoderEvents.TryPop(event))
+				[self deliverDecoderEvent:event];
+		});
+
+		dispatch_activate(_decoderEventsProcessor);
+
+		// Set up processing of render trace events, which is scheduled by -scheduleRenderTraceDrain while playing
+		_renderTraceDrain = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+		if(!_renderTraceDrain) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_source_create failed");
+			return nil;
+		}
+
+		dispatch_source_set_timer(_renderTraceDrain, DISPATCH_TIME_FOREVER, DISPATCH_TIME_FOREVER, 0);
+
+		__weak SFBAudioPlayerNode *weakSelf = self;
+		dispatch_source_set_event_handler(_renderTraceDrain, ^{
+			[weakSelf drainRenderTrace];
+		});
+
+		dispatch_activate(_renderTraceDrain);
+
+		// Set up spectrum analysis of output copied by the render block
+		_spectrumAnalysisProcessor = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0));
+		if(!_spectrumAnalysisProcessor) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_source_create failed");
+			return nil;
+		}
+
+		dispatch_source_set_event_handler(_spectrumAnalysisProcessor, ^{
+			[weakSelf analyzeSpectrumTap];
+		});
+
+		dispatch_activate(_spectrumAnalysisProcessor);
+
+		// Set up the collector
+		_collector = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_OR, 0, 0, dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0));
+		if(!_collector) {
+			os_log_error(_audioPlayerNodeLog, "dispatch_source_create failed");
+			return nil;
+		}
+
+		dispatch_source_set_event_handler(_collector, ^{
+			[self collectDecoderStates];
+		});
+
+		// Start collecting
+		dispatch_activate(_collector);
+
+		// A stopped or reconfigured engine never acknowledges a pending mute or staged seek, so allow the decoding
+		// thread to reevaluate them
+		_engineConfigurationObserver = [[NSNotificationCenter defaultCenter] addObserverForName:AVAudioEngineConfigurationChangeNotification object:nil queue:nil usingBlock:^(NSNotification *notification) {
+			SFBAudioPlayerNode *strongSelf = weakSelf;
+			if(strongSelf && notification.object == strongSelf.engine)
+				RequestDecoding(strongSelf->_flags, strongSelf->_decodingSemaphore);
+		}];
+
+		// Launch the decoding thread unless decoding is performed by an executor
+		if(_decodingExecutor)
+			[_decodingExecutor addNode:self];
+		else {
+			try {
+				_decodingThread = std::thread(DecoderThreadEntry, (__bridge void *)self);
+			}
+
+			catch(const std::exception& e) {
+				os_log_error(_audioPlayerNodeLog, "Unable to create decoding thread: %{public}s", e.what());
+				return nil;
+			}
+		}
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	if(_engineConfigurationObserver)
+		[[NSNotificationCenter defaultCenter] removeObserver:_engineConfigurationObserver];
+	if(_renderTraceDrain)
+		dispatch_source_cancel(_renderTraceDrain);
+	if(_spectrumAnalysisProcessor)
+		dispatch_source_cancel(_spectrumAnalysisProcessor);
+
+	_flags.fetch_or(eAudioPlayerNodeFlagStopDecoderThread);
+	dispatch_semaphore_signal(_lookAheadSemaphore);
+	// An executor retains a node while performing its decoding work so none is in progress
+	if(_decodingExecutor)
+		[_decodingExecutor removeNode:self];
+	else {
+		dispatch_semaphore_signal(_decodingSemaphore);
+		if(_decodingThread.joinable())
+			_decodingThread.join();
+	}
+	if(_lookAheadThread.joinable())
+		_lookAheadThread.join();
+	_queuedDecoders.Clear();
+
+	for(auto decoderState : _lookAheadStates)
+		delete decoderState;
+	_lookAheadStates.clear();
+
+	delete _unstoredDecoderState;
+
+	// Force any decoders left hanging by the collector to end
+	auto decoderStates = _decoderStates.exchange(nullptr);
+	if(decoderStates) {
+		for(size_t i = 0; i < decoderStates->mCount; ++i)
+			delete decoderStates->mStates[i];
+		delete decoderStates;
+	}
+	_reclaimer.ReclaimAll();
+}
+
+#pragma mark - Configuration
+
+- (void)copyConfigurationFromPlayerNode:(SFBAudioPlayerNode *)playerNode
+{
+	NSParameterAssert(playerNode != nil);
+
+	self.formatConversionEnabled = playerNode.formatConversionEnabled;
+	self.sampleRateConverterQuality = playerNode.sampleRateConverterQuality;
+	self.sampleRateConverterAlgorithm = playerNode.sampleRateConverterAlgorithm;
+
+	self.lookAheadDepth = playerNode.lookAheadDepth;
+	self.lookAheadMemoryLimit = playerNode.lookAheadMemoryLimit;
+
+	self.replayGainMode = playerNode.replayGainMode;
+	self.replayGainPreamp = playerNode.replayGainPreamp;
+	self.peakLimiterEnabled = playerNode.peakLimiterEnabled;
+
+	self.crossfadeDuration = playerNode.crossfadeDuration;
+	self.crossfadeCurve = playerNode.crossfadeCurve;
+
+	self.bufferingBounds = playerNode.bufferingBounds;
+
+	self.meteringEnabled = playerNode.meteringEnabled;
+
+	self.spectrumAnalysisFFTSize = playerNode.spectrumAnalysisFFTSize;
+	self.spectrumAnalysisHopSize = playerNode.spectrumAnalysisHopSize;
+	self.spectrumAnalysisEnabled = playerNode.spectrumAnalysisEnabled;
+
+	self.seekCrossfadeDuration = playerNode.seekCrossfadeDuration;
+	self.scrubGrainDuration = playerNode.scrubGrainDuration;
+}
+
+#pragma mark - Format Information
+
+- (BOOL)supportsFormat:(AVAudioFormat *)format
+{
+	// Gapless playback requires the same number of channels at the same sample rate unless the node converts formats
+	if(format.channelCount == _renderingFormat.channelCount && format.sampleRate == _renderingFormat.sampleRate)
+		return YES;
+	if(!_formatConversionEnabled.load() || format.streamDescription->mFormatID != kAudioFormatLinearPCM || format.channelCount == 0 || format.sampleRate <= 0)
+		return NO;
+
+	// Creating a converter is expensive, and consecutive decoders usually share a format
+	std::lock_guard<std::mutex> lock(_convertibleFormatsLock);
+	NSNumber *convertible = [_convertibleFormats objectForKey:format];
+	if(!convertible) {
+		convertible = @([[AVAudioConverter alloc] initFromFormat:format toFormat:_renderingFormat] != nil);
+		if(_convertibleFormats.count >= kConvertibleFormatCacheCapacity)
+			[_convertibleFormats removeAllObjects];
+		[_convertibleFormats setObject:convertible forKey:format];
+	}
+	return convertible.boolValue;
+}
+
+#pragma mark - Format Conversion
+
+- (BOOL)formatConversionEnabled
+{
+	return _formatConversionEnabled.load();
+}
+
+- (void)setFormatConversionEnabled:(BOOL)formatConversionEnabled
+{
+	_formatConversionEnabled.store(formatConversionEnabled == YES);
+}
+
+- (AVAudioQuality)sampleRateConverterQuality
+{
+	std::lock_guard<std::mutex> lock(_sampleRateConverterSettingsLock);
+	return _sampleRateConverterSettings.mQuality;
+}
+
+- (void)setSampleRateConverterQuality:(AVAudioQuality)sampleRateConverterQuality
+{
+	std::lock_guard<std::mutex> lock(_sampleRateConverterSettingsLock);
+	_sampleRateConverterSettings.mQuality = sampleRateConverterQuality;
+}
+
+- (NSString *)sampleRateConverterAlgorithm
+{
+	std::lock_guard<std::mutex> lock(_sampleRateConverterSettingsLock);
+	return _sampleRateConverterSettings.mAlgorithm;
+}
+
+- (void)setSampleRateConverterAlgorithm:(NSString *)sampleRateConverterAlgorithm
+{
+	NSParameterAssert(sampleRateConverterAlgorithm != nil);
+	std::lock_guard<std::mutex> lock(_sampleRateConverterSettingsLock);
+	_sampleRateConverterSettings.mAlgorithm = [sampleRateConverterAlgorithm copy];
+}
+
+- (SampleRateConverterSettings)currentSampleRateConverterSettings
+{
+	std::lock_guard<std::mutex> lock(_sampleRateConverterSettingsLock);
+	return _sampleRateConverterSettings;
+}
+
+#pragma mark - Queue Management
+
+- (BOOL)resetAndEnqueueURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
+	if(!decoder)
+		return NO;
+
+	return [self resetAndEnqueueDecoder:decoder error:error];
+}
+
+- (BOOL)resetAndEnqueueDecoder:(id<SFBPCMDecoding>)decoder error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+	return [self performEnqueue:decoder gain:1 applyReplayGain:YES reset:YES error:error];
+}
+
+- (BOOL)resetAndEnqueueDecoder:(id <SFBPCMDecoding>)decoder startingAtHostTime:(uint64_t)hostTime error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+	if(![self performEnqueue:decoder gain:1 applyReplayGain:YES reset:YES error:error])
+		return NO;
+	[self playAtHostTime:hostTime];
+	return YES;
+}
+
+- (BOOL)enqueueURL:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
+	if(!decoder)
+		return NO;
+
+	return [self enqueueDecoder:decoder error:error];
+}
+
+- (BOOL)enqueueDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+	return [self performEnqueue:decoder gain:1 applyReplayGain:YES reset:NO error:error];
+}
+
+- (BOOL)enqueueDecoder:(id <SFBPCMDecoding>)decoder gain:(float)gain error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+	return [self performEnqueue:decoder gain:std::pow(10.f, gain / 20) applyReplayGain:NO reset:NO error:error];
+}
+
+- (BOOL)enqueueURLAsynchronously:(NSURL *)url error:(NSError **)error
+{
+	NSParameterAssert(url != nil);
+
+	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
+	if(!decoder)
+		return NO;
+
+	[self enqueueDecoderAsynchronously:decoder];
+	return YES;
+}
+
+- (void)enqueueDecoderAsynchronously:(id<SFBPCMDecoding>)decoder
+{
+	NSParameterAssert(decoder != nil);
+
+	uint64_t ticket;
+	{
+		std::lock_guard<std::mutex> lock(_pendingEnqueuesLock);
+		ticket = _nextEnqueueTicket++;
+		_pendingEnqueues.push_back({ ticket, decoder, false, nil, 0 });
+	}
+
+	// Submission is serialized so decoders begin opening in the order they were enqueued
+	// and no more than kMaximumConcurrentOpens blocks occupy _openQueue at once
+	dispatch_semaphore_t openSemaphore = _openSemaphore;
+	dispatch_queue_t openQueue = _openQueue;
+	__weak SFBAudioPlayerNode *weakSelf = self;
+	dispatch_async(_openSubmissionQueue, ^{
+		// Decoders stuck opening must not block submission indefinitely
+		if(dispatch_semaphore_wait(openSemaphore, dispatch_time(DISPATCH_TIME_NOW, static_cast<int64_t>(kOpenSubmissionTimeout * NSEC_PER_SEC)))) {
+			os_log_error(_audioPlayerNodeLog, "Timed out waiting to open \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoder.inputSource.url.path]);
+			NSError *error = [NSError SFB_errorWithDomain:SFBAudioPlayerNodeErrorDomain
+													 code:SFBAudioPlayerNodeErrorTimedOut
+							descriptionFormatStringForURL:NSLocalizedString(@"The file “%@” could not be opened in time.", @"")
+													  url:decoder.inputSource.url
+											failureReason:NSLocalizedString(@"Timed out", @"")
+									   recoverySuggestion:NSLocalizedString(@"Other files are taking too long to open. Try again later.", @"")];
+			[weakSelf completePendingEnqueue:ticket error:error latency:0];
+			return;
+		}
+		dispatch_async(openQueue, ^{
+			[weakSelf openPendingDecoder:decoder ticket:ticket];
+			dispatch_semaphore_signal(openSemaphore);
+		});
+	});
+}
+
+- (void)cancelCurrentDecoder
+{
+	SFB::EpochReclaimer::Guard epochGuard(_reclaimer);
+	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStates.load());
+	if(decoderState) {
+		decoderState->mFlags.fetch_or(DecoderStateData::eCancelDecodingFlag);
+		RequestDecoding(_flags, _decodingSemaphore);
+	}
+}
+
+- (void)clearQueue
+{
+	// Pending enqueues are cleared first so none are transferred to _queuedDecoders after it is cleared
+	PendingEnqueueQueue pendingEnqueues;
+	{
+		// Wait for a transfer in progress to finish
+		std::lock_guard<std::mutex> transferLock(_pendingEnqueuesTransferLock);
+		std::lock_guard<std::mutex> lock(_pendingEnqueuesLock);
+		pendingEnqueues.swap(_pendingEnqueues);
+	}
+
+	LookAheadQueue lookAheadStates;
+	{
+		std::lock_guard<std::mutex> dequeueLock(_dequeueLock);
+		lookAheadStates.swap(_lookAheadStates);
+		_queuedDecoders.Clear();
+	}
+
+	for(auto decoderState : lookAheadStates) {
+		decoderState->mFlags.fetch_or(DecoderStateData::eCancelDecodingFlag);
+		// Wait for the look-ahead thread to finish with the decoder state
+		{
+			std::lock_guard<std::mutex> stagingLock(decoderState->mStagingLock);
+		}
+		delete decoderState;
+	}
+
+	if(!lookAheadStates.empty())
+		dispatch_semaphore_signal(_lookAheadSemaphore);
+}
+
+- (BOOL)queueIsEmpty
+{
+	// Decoders are added to _queuedDecoders before being removed from _pendingEnqueues
+	// so _pendingEnqueues must be checked first
+	{
+		std::lock_guard<std::mutex> lock(_pendingEnqueuesLock);
+		if(!_pendingEnqueues.empty())
+			return NO;
+	}
+
+	std::lock_guard<std::mutex> dequeueLock(_dequeueLock);
+	return _lookAheadStates.empty() && _queuedDecoders.IsEmpty();
+}
+
+- (id <SFBPCMDecoding>)dequeueDecoder
+{
+	DecoderStateData *decoderState = nullptr;
+	{
+		std::lock_guard<std::mutex> dequeueLock(_dequeueLock);
+		if(_lookAheadStates.empty())
+			return [self popQueuedDecoder].mDecoder;
+
+		decoderState = _lookAheadStates.front();
+		_lookAheadStates.pop_front();
+	}
+
+	// Wait for the look-ahead thread to finish with the decoder state
+	{
+		std::lock_guard<std::mutex> stagingLock(decoderState->mStagingLock);
+	}
+
+	dispatch_semaphore_signal(_lookAheadSemaphore);
+
+	// Audio decoded ahead of playback is discarded so attempt to leave the decoder as it was enqueued
+	id <SFBPCMDecoding> decoder = decoderState->mDecoder;
+	decoderState->RewindDecoder();
+	delete decoderState;
+
+	return decoder;
+}
+
+- (void)reset
+{
+	[super reset];
+	[self clearQueue];
+	[self cancelCurrentDecoder];
+}
+
+#pragma mark - Look-Ahead Decoding
+
+- (NSUInteger)lookAheadDepth
+{
+	return _lookAheadDepth.load();
+}
+
+- (void)setLookAheadDepth:(NSUInteger)lookAheadDepth
+{
+	lookAheadDepth = std::min(lookAheadDepth, static_cast<NSUInteger>(kDecoderStateListCapacity));
+	_lookAheadDepth.store(static_cast<unsigned int>(lookAheadDepth));
+
+	if(lookAheadDepth > 0) {
+		// The look-ahead thread is launched on demand
+		std::call_once(_lookAheadThreadLaunched, [self] {
+			try {
+				self->_lookAheadThread = std::thread(LookAheadThreadEntry, (__bridge void *)self);
+			}
+
+			catch(const std::exception& e) {
+				os_log_error(_audioPlayerNodeLog, "Unable to create look-ahead thread: %{public}s", e.what());
+			}
+		});
+	}
+
+	dispatch_semaphore_signal(_lookAheadSemaphore);
+}
+
+- (NSUInteger)lookAheadMemoryLimit
+{
+	return _lookAheadMemoryLimit.load();
+}
+
+- (void)setLookAheadMemoryLimit:(NSUInteger)lookAheadMemoryLimit
+{
+	_lookAheadMemoryLimit.store(lookAheadMemoryLimit);
+}
+
+#pragma mark - Gain
+
+- (SFBAudioPlayerNodeReplayGainMode)replayGainMode
+{
+	return _replayGainMode.load();
+}
+
+- (void)setReplayGainMode:(SFBAudioPlayerNodeReplayGainMode)replayGainMode
+{
+	_replayGainMode.store(replayGainMode);
+}
+
+- (float)replayGainPreamp
+{
+	return _replayGainPreamp.load();
+}
+
+- (void)setReplayGainPreamp:(float)replayGainPreamp
+{
+	_replayGainPreamp.store(replayGainPreamp);
+}
+
+- (BOOL)peakLimiterEnabled
+{
+	return _peakLimiterEnabled.load();
+}
+
+- (void)setPeakLimiterEnabled:(BOOL)peakLimiterEnabled
+{
+	_peakLimiterEnabled.store(peakLimiterEnabled == YES);
+}
+
+#pragma mark - Crossfading
+
+- (NSTimeInterval)crossfadeDuration
+{
+	return _crossfadeFrameCount.load() / _audioRingBuffer.Format().mSampleRate;
+}
+
+- (void)setCrossfadeDuration:(NSTimeInterval)crossfadeDuration
+{
+	auto frameCount = std::max(0.0, std::round(std::min(crossfadeDuration, kMaximumCrossfadeDuration) * _audioRingBuffer.Format().mSampleRate));
+	_crossfadeFrameCount.store(static_cast<AVAudioFrameCount>(frameCount));
+}
+
+- (SFBAudioPlayerNodeCrossfadeCurve)crossfadeCurve
+{
+	return _crossfadeCurve.load();
+}
+
+- (void)setCrossfadeCurve:(SFBAudioPlayerNodeCrossfadeCurve)crossfadeCurve
+{
+	_crossfadeCurve.store(crossfadeCurve);
+}
+
+#pragma mark - Buffering
+
+- (SFBAudioPlayerNodeBufferingBounds)bufferingBounds
+{
+	return _bufferingBounds.load();
+}
+
+- (void)setBufferingBounds:(SFBAudioPlayerNodeBufferingBounds)bufferingBounds
+{
+	_bufferingBounds.store(ClampBufferingBounds(bufferingBounds, _ringBufferCapacity));
+	// The decoding thread applies the new bounds
+	_flags.fetch_or(eAudioPlayerNodeFlagBufferingBoundsChanged);
+	RequestDecoding(_flags, _decodingSemaphore);
+}
+
+- (SFBAudioPlayerNodeBufferingStatistics)bufferingStatistics
+{
+	auto minimumFillLevel = _minimumFillLevel.load();
+	return {
+		.underrunCount = _underrunCount.load(),
+		.underrunFrameCount = _underrunFrameCount.load(),
+		.minimumFillLevel = minimumFillLevel == UINT32_MAX ? 0 : minimumFillLevel,
+		.fillTarget = _bufferingController.FillTarget(),
+		.chunkSize = _bufferingController.ChunkSize(),
+		.stallCount = _bufferingController.StallCount(),
+		.decodingSpeed = _bufferingController.DecodingSpeed()
+	};
+}
+
+- (void)resetBufferingStatistics
+{
+	_underrunCount.store(0);
+	_underrunFrameCount.store(0);
+	_minimumFillLevel.store(UINT32_MAX);
+	_bufferingController.ResetStatistics();
+}
+
+#pragma mark - Notification Delivery
+
+- (uint64_t)lateNotificationCount
+{
+	return _lateNotificationCount.load();
+}
+
+- (uint64_t)droppedNotificationCount
+{
+	return _droppedNotificationCount.load();
+}
+
+#pragma mark - Render Diagnostics
+
+- (SFBAudioPlayerNodeRenderTraceStatistics)renderTraceStatistics
+{
+	return {
+		.shortReadCount = _shortReadCount.load(),
+		.silencePaddingCount = _silencePaddingCount.load(),
+		.silencePaddingFrameCount = _silencePaddingFrameCount.load(),
+		.muteTransitionCount = _muteTransitionCount.load(),
+		.sequenceNumberChangeCount = _sequenceNumberChangeCount.load(),
+		.droppedEventCount = _renderTrace.OverflowCount()
+	};
+}
+
+- (uint64_t)droppedRenderEventCount
+{
+	return _renderEvents.OverflowCount();
+}
+
+#pragma mark - Metering
+
+- (BOOL)meteringEnabled
+{
+	return _meteringEnabled.load();
+}
+
+- (void)setMeteringEnabled:(BOOL)meteringEnabled
+{
+	_meteringEnabled.store(meteringEnabled == YES);
+}
+
+- (AVAudioChannelCount)getMeterLevels:(SFBAudioPlayerNodeChannelLevels *)levels channelCount:(AVAudioChannelCount)channelCount hostTime:(uint64_t *)hostTime
+{
+	NSParameterAssert(levels != nullptr);
+	if(!_meteringEnabled.load())
+		return 0;
+
+	SFB::OutputMeter::ChannelLevels channelLevels [SFB::OutputMeter::kMaximumChannelCount];
+	channelCount = _outputMeter.Read(channelLevels, std::min(channelCount, SFB::OutputMeter::kMaximumChannelCount), hostTime);
+	for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel)
+		levels[channel] = { channelLevels[channel].mPeak, channelLevels[channel].mRMS, channelLevels[channel].mClipCount };
+	return channelCount;
+}
+
+- (SFBAudioPlayerNodeMeteringStatistics)meteringStatistics
+{
+	const auto statistics = _outputMeter.GetStatistics();
+	return {
+		.meteredCycleCount = statistics.mMeteredCycleCount,
+		.averageMeteringTime = statistics.mMeteredCycleCount ? ConvertHostTicksToNanos(statistics.mMeteringTime / statistics.mMeteredCycleCount) / NSEC_PER_SEC : 0,
+		.maximumMeteringTime = ConvertHostTicksToNanos(statistics.mMaximumMeteringTime) / NSEC_PER_SEC
+	};
+}
+
+- (void)resetMeteringStatistics
+{
+	_outputMeter.ResetStatistics();
+}
+
+#pragma mark - Spectrum Analysis
+
+- (BOOL)spectrumAnalysisEnabled
+{
+	return _spectrumAnalysisEnabled.load();
+}
+
+- (void)setSpectrumAnalysisEnabled:(BOOL)spectrumAnalysisEnabled
+{
+	if(spectrumAnalysisEnabled) {
+		// The tap is allocated on first use and retained so the render block never observes it changing
+		std::lock_guard<std::mutex> lock(_spectrumTapLock);
+		if(!_spectrumTap.IsAllocated() && !_spectrumTap.Allocate(_audioRingBuffer.Format())) {
+			os_log_error(_audioPlayerNodeLog, "Unable to allocate spectrum analysis tap");
+			return;
+		}
+	}
+
+	_spectrumAnalysisEnabled.store(spectrumAnalysisEnabled == YES);
+}
+
+- (NSUInteger)spectrumAnalysisFFTSize
+{
+	return _spectrumAnalysisFFTSize.load();
+}
+
+- (void)setSpectrumAnalysisFFTSize:(NSUInteger)spectrumAnalysisFFTSize
+{
+	uint32_t fftSize = SFB::SpectrumAnalyzer::kMinimumFFTSize;
+	while(fftSize < spectrumAnalysisFFTSize && fftSize < SFB::SpectrumAnalyzer::kMaximumFFTSize)
+		fftSize *= 2;
+	_spectrumAnalysisFFTSize.store(fftSize);
+}
+
+- (NSUInteger)spectrumAnalysisHopSize
+{
+	return _spectrumAnalysisHopSize.load();
+}
+
+- (void)setSpectrumAnalysisHopSize:(NSUInteger)spectrumAnalysisHopSize
+{
+	_spectrumAnalysisHopSize.store(static_cast<uint32_t>(std::min(std::max(spectrumAnalysisHopSize, 1ul), static_cast<NSUInteger>(SFB::SpectrumAnalyzer::kMaximumFFTSize))));
+}
+
+- (NSUInteger)getSpectrum:(float *)magnitudes count:(NSUInteger)count atHostTime:(uint64_t)hostTime spectrumHostTime:(uint64_t *)spectrumHostTime
+{
+	NSParameterAssert(magnitudes != nullptr);
+	if(!_spectrumAnalysisEnabled.load())
+		return 0;
+	return _spectrumTap.Read(magnitudes, count, hostTime, spectrumHostTime);
+}
+
+#pragma mark - Decoding Executor
+
+- (SFBAudioDecodingExecutor *)decodingExecutor
+{
+	return _decodingExecutor;
+}
+
+- (SFBAudioPlayerNodeSchedulingStatistics)schedulingStatistics
+{
+	auto scheduledCount = _scheduledCount.load();
+	return {
+		.scheduledCount = scheduledCount,
+		.decodingTime = ConvertHostTicksToNanos(_decodingTime.load()) / NSEC_PER_SEC,
+		.averageSchedulingDelay = scheduledCount ? ConvertHostTicksToNanos(_totalSchedulingDelay.load() / scheduledCount) / NSEC_PER_SEC : 0,
+		.maximumSchedulingDelay = ConvertHostTicksToNanos(_maximumSchedulingDelay.load()) / NSEC_PER_SEC,
+		.missedDeadlineCount = _missedDeadlineCount.load()
+	};
+}
+
+#pragma mark - Playback Control
+
+- (void)play
+{
+	_scheduledStart.Cancel();
+	_flags.fetch_or(eAudioPlayerNodeFlagIsPlaying);
+	[self scheduleRenderTraceDrain];
+}
+
+- (void)playAtHostTime:(uint64_t)hostTime
+{
+	_scheduledStart.Schedule(hostTime);
+	_flags.fetch_or(eAudioPlayerNodeFlagIsPlaying);
+	[self scheduleRenderTraceDrain];
+	// The decoding thread notes when the ring buffer is filled for the start
+	RequestDecoding(_flags, _decodingSemaphore);
+}
+
+- (SFBAudioPlayerNodeScheduledStartStatistics)scheduledStartStatistics
+{
+	const auto statistics = _scheduledStart.GetStatistics();
+	return {
+		.startCount = statistics.mStartCount,
+		.lateStartCount = statistics.mLateStartCount,
+		.incompletePrefillCount = statistics.mIncompletePrefillCount,
+		.lastPrefillMargin = ConvertSignedHostTicksToSeconds(statistics.mLastPrefillMargin),
+		.minimumPrefillMargin = ConvertSignedHostTicksToSeconds(statistics.mMinimumPrefillMargin)
+	};
+}
+
+- (void)pause
+{
+	_scheduledStart.Cancel();
+	_flags.fetch_and(~eAudioPlayerNodeFlagIsPlaying);
+	[self scheduleRenderTraceDrain];
+	// The playback position stops advancing immediately, even if the render block isn't running
+	_playbackSnapshotGeneration.fetch_add(1);
+	// The engine may have been stopped so allow the decoding thread to reevaluate a pending mute request
+	RequestDecoding(_flags, _decodingSemaphore);
+}
+
+- (void)stop
+{
+	_scheduledStart.Cancel();
+	_flags.fetch_and(~(eAudioPlayerNodeFlagIsPlaying | eAudioPlayerNodeFlagScrubbing | eAudioPlayerNodeFlagScrubTargetChanged));
+	[self scheduleRenderTraceDrain];
+	_playbackSnapshotGeneration.fetch_add(1);
+	[self reset];
+	// The engine may have been stopped so allow the decoding thread to reevaluate a pending mute request or staged seek
+	RequestDecoding(_flags, _decodingSemaphore);
+}
+
+- (void)togglePlayPause
+{
+	_scheduledStart.Cancel();
+	_flags.fetch_xor(eAudioPlayerNodeFlagIsPlaying);
+	[self scheduleRenderTraceDrain];
+}
+
+#pragma mark - Player State
+
+- (BOOL)isPlaying
+{
+	return (_flags.load() & eAudioPlayerNodeFlagIsPlaying) != 0;
+}
+
+- (BOOL)isReady
+{
+	SFB::EpochReclaimer::Guard epochGuard(_reclaimer);
+	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStates.load());
+	return decoderState ? YES : NO;
+}
+
+- (id<SFBPCMDecoding>)currentDecoder
+{
+	SFB::EpochReclaimer::Guard epochGuard(_reclaimer);
+	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStates.load());
+	return decoderState ? decoderState->mDecoder : nil;
+}
+
+#pragma mark - Playback Properties
+
+- (SFBAudioPlayerNodePlaybackPosition)playbackPosition
+{
+	auto snapshot = [self currentPlaybackSnapshot];
+	return { .framePosition = snapshot.mFramePosition, .frameLength = snapshot.mFrameLength };
+}
+
+- (SFBAudioPlayerNodePlaybackTime)playbackTime
+{
+	auto snapshot = [self currentPlaybackSnapshot];
+
+	SFBAudioPlayerNodePlaybackTime playbackTime = { .currentTime = SFBUnknownTime, .totalTime = SFBUnknownTime };
+
+	double sampleRate = snapshot.mSampleRate;
+	if(sampleRate > 0) {
+		if(snapshot.mFramePosition != SFBUnknownFramePosition)
+			playbackTime.currentTime = snapshot.mFramePosition / sampleRate;
+		if(snapshot.mFrameLength != SFBUnknownFrameLength)
+			playbackTime.totalTime = snapshot.mFrameLength / sampleRate;
+	}
+
+	return playbackTime;
+}
+
+- (BOOL)getPlaybackPosition:(SFBAudioPlayerNodePlaybackPosition *)playbackPosition andTime:(SFBAudioPlayerNodePlaybackTime *)playbackTime
+{
+	auto snapshot = [self currentPlaybackSnapshot];
+
+	SFBAudioPlayerNodePlaybackPosition currentPlaybackPosition = { .framePosition = snapshot.mFramePosition, .frameLength = snapshot.mFrameLength };
+	if(playbackPosition)
+		*playbackPosition = currentPlaybackPosition;
+
+	if(playbackTime) {
+		SFBAudioPlayerNodePlaybackTime currentPlaybackTime = { .currentTime = SFBUnknownTime, .totalTime = SFBUnknownTime };
+		double sampleRate = snapshot.mSampleRate;
+		if(sampleRate > 0) {
+			if(currentPlaybackPosition.framePosition != SFBUnknownFramePosition)
+				currentPlaybackTime.currentTime = currentPlaybackPosition.framePosition / sampleRate;
+			if(currentPlaybackPosition.frameLength != SFBUnknownFrameLength)
+				currentPlaybackTime.totalTime = currentPlaybackPosition.frameLength / sampleRate;
+		}
+		*playbackTime = currentPlaybackTime;
+	}
+
+	return snapshot.mHasDecoder;
+}
+
+- (SFBAudioPlayerNodePlaybackSnapshot)playbackSnapshot
+{
+	auto snapshot = [self currentPlaybackSnapshot];
+	return {
+		.framePosition = snapshot.mFramePosition,
+		.frameLength = snapshot.mFrameLength,
+		.sampleRate = snapshot.mSampleRate,
+		.hostTime = snapshot.mHostTime,
+		.isPlaying = snapshot.mIsPlaying
+	};
+}
+
+#pragma mark - Seeking
+
+- (BOOL)seekForward:(NSTimeInterval)secondsToSkip
+{
+	if(secondsToSkip < 0)
+		secondsToSkip = 0;
+
+	auto snapshot = [self currentPlaybackSnapshot];
+	if(!snapshot.mHasDecoder)
+		return NO;
+
+	double sampleRate = snapshot.mSampleRate;
+	AVAudioFramePosition targetFrame = snapshot.mFramePosition + (AVAudioFramePosition)(secondsToSkip * sampleRate);
+
+	if(targetFrame >= snapshot.mFrameLength)
+		targetFrame = std::max(snapshot.mFrameLength - 1, 0ll);
+
+	return [self seekToFrame:targetFrame];
+}
+
+- (BOOL)seekBackward:(NSTimeInterval)secondsToSkip
+{
+	if(secondsToSkip < 0)
+		secondsToSkip = 0;
+
+	auto snapshot = [self currentPlaybackSnapshot];
+	if(!snapshot.mHasDecoder)
+		return NO;
+
+	double sampleRate = snapshot.mSampleRate;
+	AVAudioFramePosition targetFrame = snapshot.mFramePosition - (AVAudioFramePosition)(secondsToSkip * sampleRate);
+
+	if(targetFrame < 0)
+		targetFrame = 0;
+
+	return [self seekToFrame:targetFrame];
+}
+
+- (BOOL)seekToTime:(NSTimeInterval)timeInSeconds
+{
+	if(timeInSeconds < 0)
+		timeInSeconds = 0;
+
+	auto snapshot = [self currentPlaybackSnapshot];
+	if(!snapshot.mHasDecoder)
+		return NO;
+
+	double sampleRate = snapshot.mSampleRate;
+	AVAudioFramePosition targetFrame = (AVAudioFramePosition)(timeInSeconds * sampleRate);
+
+	if(targetFrame >= snapshot.mFrameLength)
+		targetFrame = std::max(snapshot.mFrameLength - 1, 0ll);
+
+	return [self seekToFrame:targetFrame];
+}
+
+- (BOOL)seekToPosition:(double)position
+{
+	if(position < 0)
+		position = 0;
+	else if(position >= 1)
+		position = std::nextafter(1.0, 0.0);
+
+	auto snapshot = [self currentPlaybackSnapshot];
+	if(!snapshot.mHasDecoder)
+		return NO;
+
+	return [self seekToFrame:(AVAudioFramePosition)(snapshot.mFrameLength * position)];
+}
+
+- (BOOL)seekToFrame:(AVAudioFramePosition)frame
+{
+	if(frame < 0)
+		frame = 0;
+
+	SFB::EpochReclaimer::Guard epochGuard(_reclaimer);
+	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStates.load());
+	if(!decoderState || !decoderState->mDecoder.supportsSeeking)
+		return NO;
+
+	if(frame >= decoderState->FrameLength())
+		frame = std::max(decoderState->FrameLength() - 1, 0ll);
+
+	// While scrubbing only the most recent target is decoded, as a short grain
+	if(_flags.load() & eAudioPlayerNodeFlagScrubbing) {
+		_scrubTarget.store(frame);
+		_scrubRequestCount.fetch_add(1);
+		_flags.fetch_or(eAudioPlayerNodeFlagScrubTargetChanged);
+		RequestDecoding(_flags, _decodingSemaphore);
+		return YES;
+	}
+
+	decoderState->mFrameToSeek.store(frame);
+	_playbackSnapshotGeneration.fetch_add(1);
+
+	_seekRequestCount.fetch_add(1);
+	_seekRequestHostTime.store(mach_absolute_time());
+	RequestDecoding(_flags, _decodingSemaphore);
+
+	return YES;
+}
+
+- (BOOL)supportsSeeking
+{
+	SFB::EpochReclaimer::Guard epochGuard(_reclaimer);
+	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStates.load());
+	return decoderState ? decoderState->mDecoder.supportsSeeking : NO;
+}
+
+- (NSTimeInterval)seekCrossfadeDuration
+{
+	return _seekCrossfadeFrameCount.load() / _audioRingBuffer.Format().mSampleRate;
+}
+
+- (void)setSeekCrossfadeDuration:(NSTimeInterval)seekCrossfadeDuration
+{
+	auto frameCount = std::max(0.0, std::round(seekCrossfadeDuration * _audioRingBuffer.Format().mSampleRate));
+	_seekCrossfadeFrameCount.store(static_cast<AVAudioFrameCount>(std::min(frameCount, static_cast<double>(kMaximumSeekCrossfadeFrameCount))));
+}
+
+- (SFBAudioPlayerNodeSeekStatistics)seekStatistics
+{
+	return {
+		.requestCount = _seekRequestCount.load(),
+		.completedCount = _seekCount.load(),
+		.stagedCount = _stagedSeekCount.load(),
+		.lastLatency = ConvertHostTicksToNanos(_lastSeekLatency.load()) / NSEC_PER_SEC,
+		.maximumLatency = ConvertHostTicksToNanos(_maximumSeekLatency.load()) / NSEC_PER_SEC,
+		.scrubRequestCount = _scrubRequestCount.load(),
+		.scrubGrainCount = _scrubGrainCount.load()
+	};
+}
+
+#pragma mark - Scrubbing
+
+- (BOOL)beginScrubbing
+{
+	SFB::EpochReclaimer::Guard epochGuard(_reclaimer);
+	const auto decoderStates = _decoderStates.load();
+	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(decoderStates);
+	if(!decoderState || !decoderState->mDecoder.supportsSeeking)
+		return NO;
+
+	if(_flags.load() & eAudioPlayerNodeFlagScrubbing)
+		return YES;
+
+	if(decoderState->mFlags.load() & DecoderStateData::eCancelDecodingFlag)
+		return NO;
+
+	// Grains are decoded from the decoder state being decoded, so if decoding of decoderState is complete the decoding
+	// thread reopens it and decodes the decoder states following it again afterward
+	for(auto nextDecoderState = GetActiveDecoderStateFollowingSequenceNumber(decoderStates, decoderState->mSequenceNumber); nextDecoderState; nextDecoderState = GetActiveDecoderStateFollowingSequenceNumber(decoderStates, nextDecoderState->mSequenceNumber)) {
+		if(!nextDecoderState->mDecoder.supportsSeeking)
+			return NO;
+	}
+
+	// Decoding resumes from the current position if no seek is requested while scrubbing
+	_scrubTarget.store(decoderState->FramePosition());
+	_flags.fetch_or(eAudioPlayerNodeFlagScrubbing);
+
+	// Discard the buffered audio so the first grain is heard without delay
+	_flags.fetch_or(eAudioPlayerNodeFlagRingBufferNeedsReset);
+	RequestDecoding(_flags, _decodingSemaphore);
+
+	return YES;
+}
+
+- (void)endScrubbing
+{
+	if(!(_flags.load() & eAudioPlayerNodeFlagScrubbing))
+		return;
+
+	// The seek is requested before scrubbing ends so no audio is decoded following the final grain
+	{
+		SFB::EpochReclaimer::Guard epochGuard(_reclaimer);
+		auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStates.load());
+		const auto frame = _scrubTarget.exchange(kInvalidFramePosition);
+		if(decoderState && frame != kInvalidFramePosition) {
+			decoderState->mFrameToSeek.store(frame);
+			_playbackSnapshotGeneration.fetch_add(1);
+
+			_seekRequestCount.fetch_add(1);
+			_seekRequestHostTime.store(mach_absolute_time());
+		}
+	}
+
+	_flags.fetch_and(~(eAudioPlayerNodeFlagScrubbing | eAudioPlayerNodeFlagScrubTargetChanged));
+	RequestDecoding(_flags, _decodingSemaphore);
+}
+
+- (BOOL)isScrubbing
+{
+	return (_flags.load() & eAudioPlayerNodeFlagScrubbing) != 0;
+}
+
+- (NSTimeInterval)scrubGrainDuration
+{
+	return _scrubGrainFrameCount.load() / _audioRingBuffer.Format().mSampleRate;
+}
+
+- (void)setScrubGrainDuration:(NSTimeInterval)scrubGrainDuration
+{
+	const auto duration = std::min(std::max(scrubGrainDuration, kMinimumScrubGrainDuration), kMaximumScrubGrainDuration);
+	_scrubGrainFrameCount.store(static_cast<AVAudioFrameCount>(std::round(duration * _audioRingBuffer.Format().mSampleRate)));
+}
+
+#pragma mark - Internals
+
+- (BOOL)performEnqueue:(id <SFBPCMDecoding>)decoder gain:(float)gain applyReplayGain:(BOOL)applyReplayGain reset:(BOOL)reset error:(NSError **)error
+{
+	os_log_info(_audioPlayerNodeLog, "Enqueuing \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoder.inputSource.url.path]);
+
+	if(!decoder.isOpen && ![decoder openReturningError:error])
+		return NO;
+
+	if(![self supportsFormat:decoder.processingFormat]) {
+		os_log_error(_audioPlayerNodeLog, "Unsupported decoder processing format: %{public}@", decoder.processingFormat);
+
+		if(error)
+			*error = [NSError SFB_errorWithDomain:SFBAudioPlayerNodeErrorDomain
+											 code:SFBAudioPlayerNodeErrorFormatNotSupported
+					descriptionFormatStringForURL:NSLocalizedString(@"The format of the file “%@” is not supported.", @"")
+											  url:decoder.inputSource.url
+									failureReason:NSLocalizedString(@"Unsupported file format", @"")
+							   recoverySuggestion:NSLocalizedString(@"The file's format is not supported by this player.", @"")];
+
+		return NO;
+	}
+
+	// A fan-out reader blocks until audio is decoded for its slowest sibling, which may be waiting for a worker thread
+	// the reader occupies
+	if(_decodingExecutor && [decoder isKindOfClass:[SFBFanOutReader class]]) {
+		os_log_error(_audioPlayerNodeLog, "Fan-out readers can't be decoded by a decoding executor");
+
+		if(error)
+			*error = [NSError SFB_errorWithDomain:SFBAudioPlayerNodeErrorDomain
+											 code:SFBAudioPlayerNodeErrorDecoderNotSupported
+					descriptionFormatStringForURL:NSLocalizedString(@"The file “%@” can't be played by this player.", @"")
+											  url:decoder.inputSource.url
+									failureReason:NSLocalizedString(@"Decoder not supported", @"")
+							   recoverySuggestion:NSLocalizedString(@"Play the file using a player that decodes on a dedicated thread.", @"")];
+
+		return NO;
+	}
+
+	if(reset) {
+		[self clearQueue];
+		SFB::EpochReclaimer::Guard epochGuard(_reclaimer);
+		auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStates.load());
+		if(decoderState)
+			decoderState->mFlags.fetch_or(DecoderStateData::eCancelDecodingFlag);
+	}
+
+	// ReplayGain is resolved when decoding begins so enqueuing doesn't read the file's tags
+	if(!_queuedDecoders.TryPush({ decoder, gain, applyReplayGain == YES })) {
+		os_log_error(_audioPlayerNodeLog, "Decoder queue full");
+
+		if(error)
+			*error = [NSError SFB_errorWithDomain:SFBAudioPlayerNodeErrorDomain
+											 code:SFBAudioPlayerNodeErrorQueueFull
+					descriptionFormatStringForURL:NSLocalizedString(@"The file “%@” could not be added to the queue.", @"")
+											  url:decoder.inputSource.url
+									failureReason:NSLocalizedString(@"The queue is full", @"")
+							   recoverySuggestion:NSLocalizedString(@"Wait for queued files to play before adding more.", @"")];
+
+		return NO;
+	}
+
+	RequestDecoding(_flags, _decodingSemaphore);
+	dispatch_semaphore_signal(_lookAheadSemaphore);
 
-- (instancetype)init
-{
-	return [self initWithSampleRate:44100 channels:2];
+	return YES;
 }
 
-- (instancetype)initWithSampleRate:(double)sampleRate channels:(AVAudioChannelCount)channels
+- (float)replayGainForDecoder:(id <SFBPCMDecoding>)decoder
 {
-	return [self initWithFormat:[[AVAudioFormat alloc] initStandardFormatWithSampleRate:sampleRate channels:channels]];
+	const auto replayGainMode = _replayGainMode.load();
+	NSURL *url = decoder.inputSource.url;
+	if(replayGainMode == SFBAudioPlayerNodeReplayGainModeOff || !url)
+		return 1;
+
+	NSError *error = nil;
+	SFBAudioFile *audioFile = [SFBAudioFile audioFileWithURL:url error:&error];
+	if(!audioFile) {
+		os_log_info(_audioPlayerNodeLog, "Unable to read gain information for \"%{public}@\": %{public}@", [[NSFileManager defaultManager] displayNameAtPath:url.path], error);
+		return 1;
+	}
+
+	return ReplayGainForMetadata(audioFile.metadata, replayGainMode, _replayGainPreamp.load(), !_peakLimiterEnabled.load());
 }
 
-- (instancetype)initWithFormat:(AVAudioFormat *)format
+- (void)resolveReplayGainForDecoderState:(DecoderStateData *)decoderState
 {
-	return [self initWithFormat:format ringBufferSize:kRingBufferFrameCapacity];
+	// The thread that first decodes audio for the decoder state applies the adjustment, or unity gain if the tags are unreadable
+	if(decoderState->mFlags.fetch_and(~DecoderStateData::eReplayGainPendingFlag) & DecoderStateData::eReplayGainPendingFlag)
+		decoderState->ApplyGain([self replayGainForDecoder:decoderState->mDecoder]);
 }
 
-- (instancetype)initWithFormat:(AVAudioFormat *)format ringBufferSize:(uint32_t)ringBufferSize
+- (void)openPendingDecoder:(id <SFBPCMDecoding>)decoder ticket:(uint64_t)ticket
 {
-	NSParameterAssert(format != nil);
-	NSParameterAssert(format.isStandard);
+	// Skip decoders discarded by -clearQueue while waiting to be opened
+	{
+		std::lock_guard<std::mutex> lock(_pendingEnqueuesLock);
+		if(!FindPendingEnqueue(_pendingEnqueues, ticket))
+			return;
+	}
 
-	AVAudioSourceNodeRenderBlock renderBlock = ^OSStatus(BOOL *isSilence, const AudioTimeStamp *timestamp, AVAudioFrameCount frameCount, AudioBufferList *outputData) {
+	NSError *error = nil;
+	const auto startTime = mach_absolute_time();
+	if(!decoder.isOpen && ![decoder openReturningError:&error] && !error)
+		error = [NSError errorWithDomain:SFBAudioDecoderErrorDomain code:SFBAudioDecoderErrorCodeInternalError userInfo:nil];
+	const auto latency = ConvertHostTicksToNanos(mach_absolute_time() - startTime) / NSEC_PER_SEC;
 
-		// ========================================
-		// Pre-rendering actions
+	[self completePendingEnqueue:ticket error:error latency:latency];
+}
 
-		// ========================================
-		// 0. Mute output if requested
-		if(self->_flags.load() & eAudioPlayerNodeFlagMuteRequested) {
-			self->_flags.fetch_or(eAudioPlayerNodeFlagOutputIsMuted);
-			self->_flags.fetch_and(~eAudioPlayerNodeFlagMuteRequested);
-			dispatch_semaphore_signal(self->_decodingSemaphore);
-		}
+- (void)completePendingEnqueue:(uint64_t)ticket error:(NSError *)error latency:(NSTimeInterval)latency
+{
+	// Transfers are serialized so decoders are transferred to _queuedDecoders in the order they were enqueued
+	std::unique_lock<std::mutex> transferLock(_pendingEnqueuesTransferLock);
 
-		// ========================================
-		// Rendering
+	// Collect the completed decoders at the front of _pendingEnqueues, stopping at the first decoder still being opened
+	std::vector<PendingEnqueue> completedEnqueues;
+	{
+		std::lock_guard<std::mutex> lock(_pendingEnqueuesLock);
 
-		// ========================================
-		// 1. Determine how many audio frames are available to read in the ring buffer
-		AVAudioFrameCount framesAvailableToRead = static_cast<AVAudioFrameCount>(self->_audioRingBuffer.FramesAvailableToRead());
+		auto pendingEnqueue = FindPendingEnqueue(_pendingEnqueues, ticket);
+		if(!pendingEnqueue)
+			return;
 
-		// ========================================
-		// 2. Output silence if a) the node isn't playing, b) the node is muted, or c) the ring buffer is empty
-		if(!(self->_flags.load() & eAudioPlayerNodeFlagIsPlaying) || self->_flags.load() & eAudioPlayerNodeFlagOutputIsMuted || framesAvailableToRead == 0) {
-			size_t byteCountToZero = self->_audioRingBuffer.Format().FrameCountToByteSize(frameCount);
-			for(UInt32 i = 0; i < outputData->mNumberBuffers; ++i) {
-				std::memset(outputData->mBuffers[i].mData, 0, byteCountToZero);
-				outputData->mBuffers[i].mDataByteSize = static_cast<UInt32>(byteCountToZero);
-			}
+		pendingEnqueue->mIsComplete = true;
+		pendingEnqueue->mError = error;
+		pendingEnqueue->mLatency = latency;
 
-			*isSilence = YES;
-			return noErr;
+		for(const auto& front : _pendingEnqueues) {
+			if(!front.mIsComplete)
+				break;
+			completedEnqueues.push_back(front);
 		}
+	}
 
-		// ========================================
-		// 3. Read as many frames as available from the ring buffer
-		AVAudioFrameCount framesToRead = std::min(framesAvailableToRead, frameCount);
-		AVAudioFrameCount framesRead = static_cast<AVAudioFrameCount>(self->_audioRingBuffer.Read(outputData, framesToRead));
-		if(framesRead != framesToRead)
-			os_log_error(_audioPlayerNodeLog, "SFB::Audio::RingBuffer::Read failed: Requested %u frames, got %u", framesToRead, framesRead);
+	// _pendingEnqueuesLock isn't held while enqueuing so asynchronous enqueues aren't blocked by format validation
+	for(auto& completedEnqueue : completedEnqueues) {
+		// -performEnqueue:gain:applyReplayGain:reset:error: validates the processing format
+		NSError *enqueueError = nil;
+		if(!completedEnqueue.mError && ![self performEnqueue:completedEnqueue.mDecoder gain:1 applyReplayGain:YES reset:NO error:&enqueueError])
+			completedEnqueue.mError = enqueueError;
+	}
 
-		// ========================================
-		// 4. If the ring buffer didn't contain as many frames as requested fill the remainder with silence
-		if(framesRead != frameCount) {
-			os_log_debug(_audioPlayerNodeLog, "Insufficient audio in ring buffer: %u frames available, %u requested", framesRead, frameCount);
+	// Decoders are added to _queuedDecoders before being removed from _pendingEnqueues
+	// -clearQueue acquires the transfer lock so the collected decoders remain at the front
+	{
+		std::lock_guard<std::mutex> lock(_pendingEnqueuesLock);
+		_pendingEnqueues.erase(_pendingEnqueues.begin(), _pendingEnqueues.begin() + static_cast<PendingEnqueueQueue::difference_type>(completedEnqueues.size()));
+	}
 
-			auto framesOfSilence = frameCount - framesRead;
-			auto byteCountToSkip = self->_audioRingBuffer.Format().FrameCountToByteSize(framesRead);
-			auto byteCountToZero = self->_audioRingBuffer.Format().FrameCountToByteSize(framesOfSilence);
-			for(UInt32 i = 0; i < outputData->mNumberBuffers; ++i)
-				std::memset(static_cast<int8_t *>(outputData->mBuffers[i].mData) + byteCountToSkip, 0, byteCountToZero);
-		}
+	transferLock.unlock();
 
-		// ========================================
-		// 5. If there is adequate space in the ring buffer for another chunk signal the decoding thread
-		AVAudioFrameCount framesAvailableToWrite = static_cast<AVAudioFrameCount>(self->_audioRingBuffer.FramesAvailableToWrite());
-		if(framesAvailableToWrite >= kRingBufferChunkSize)
-			dispatch_semaphore_signal(self->_decodingSemaphore);
+	for(const auto& completedEnqueue : completedEnqueues) {
+		id <SFBPCMDecoding> openedDecoder = completedEnqueue.mDecoder;
+		NSError *enqueueError = completedEnqueue.mError;
+		const NSTimeInterval openLatency = completedEnqueue.mLatency;
 
-		// ========================================
-		// Post-rendering actions
+		if(enqueueError) {
+			os_log_error(_audioPlayerNodeLog, "Error enqueuing \"%{public}@\": %{public}@", [[NSFileManager defaultManager] displayNameAtPath:openedDecoder.inputSource.url.path], enqueueError);
+			if([_delegate respondsToSelector:@selector(audioPlayerNode:failedToEnqueueDecoder:error:)])
+				dispatch_async(_notificationQueue, ^{
+					[self->_delegate audioPlayerNode:self failedToEnqueueDecoder:openedDecoder error:enqueueError];
+				});
+		}
+		else {
+			os_log_debug(_audioPlayerNodeLog, "Opened \"%{public}@\" in %.2f msec", [[NSFileManager defaultManager] displayNameAtPath:openedDecoder.inputSource.url.path], openLatency * 1000);
+			if([_delegate respondsToSelector:@selector(audioPlayerNode:decoderOpened:latency:)])
+				dispatch_async(_notificationQueue, ^{
+					[self->_delegate audioPlayerNode:self decoderOpened:openedDecoder latency:openLatency];
+				});
+		}
+	}
+}
 
-		// ========================================
-		// 6. There is nothing more to do if no frames were rendered
-		if(framesRead == 0)
-			return noErr;
+- (void)postDecoderEvent:(DecoderEvent)event
+{
+	// The decoding thread never waits for the delegate; notifications are delivered in order on _notificationQueue
+	event.mPostTime = mach_absolute_time();
+	if(!_decoderEvents.TryPush(std::move(event))) {
+		os_log_error(_audioPlayerNodeLog, "Decoder event queue full; notification discarded");
+		_droppedNotificationCount.fetch_add(1);
+		return;
+	}
 
-		// ========================================
-		// 7. Perform bookkeeping to apportion the rendered frames appropriately
-		//
-		// framesRead contains the number of valid frames that were rendered
-		// However, these could have come from any number of decoders depending on buffer sizes
-		// So it is necessary to split them up here
+	dispatch_source_merge_data(_decoderEventsProcessor, 1);
+}
 
-		AVAudioFrameCount framesRemainingToDistribute = framesRead;
+- (void)deliverDecoderEvent:(const DecoderEvent&)event
+{
+	const auto now = mach_absolute_time();
+	if(now > event.mPostTime && now - event.mPostTime > ConvertSecondsToHostTicks(kNotificationLagThreshold)) {
+		os_log_debug(_audioPlayerNodeLog, "Notification delivered %.2f msec after posting", ConvertHostTicksToNanos(now - event.mPostTime) / NSEC_PER_MSEC);
+		_lateNotificationCount.fetch_add(1);
+	}
 
-		auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(self->_decoderStateArray, kDecoderStateArraySize);
-		while(decoderState) {
-			AVAudioFrameCount decoderFramesRemaining = static_cast<AVAudioFrameCount>(decoderState->mFramesConverted.load() - decoderState->mFramesRendered.load());
-			AVAudioFrameCount framesFromThisDecoder = std::min(decoderFramesRemaining, framesRead);
+	switch(event.mType) {
+		case eAudioPlayerNodeDecoderEventDecodingStarted:
+			if([_delegate respondsToSelector:@selector(audioPlayerNode:decodingStarted:)])
+				[_delegate audioPlayerNode:self decodingStarted:event.mDecoder];
+			break;
+
+		case eAudioPlayerNodeDecoderEventDecodingComplete:
+			if([_delegate respondsToSelector:@selector(audioPlayerNode:decodingComplete:)])
+				[_delegate audioPlayerNode:self decodingComplete:event.mDecoder];
+			break;
+
+		case eAudioPlayerNodeDecoderEventDecodingCanceled:
+			if([_delegate respondsToSelector:@selector(audioPlayerNode:decodingCanceled:partiallyRendered:)])
+				[_delegate audioPlayerNode:self decodingCanceled:event.mDecoder partiallyRendered:event.mPartiallyRendered];
+			break;
+
+		case eAudioPlayerNodeDecoderEventEncounteredError:
+			if([_delegate respondsToSelector:@selector(audioPlayerNode:encounteredError:)])
+				[_delegate audioPlayerNode:self encounteredError:event.mError];
+			break;
+	}
+}
 
-			if(!(decoderState->mFlags.load() & DecoderStateData::eRenderingStartedFlag)) {
-				decoderState->mFlags.fetch_or(DecoderStateData::eRenderingStartedFlag);
+- (BOOL)canStageSeekForDecoderState:(DecoderStateData *)decoderState
+{
+	// Staging is only worthwhile when audio from decoderState is audible
+	if((_flags.load() & (eAudioPlayerNodeFlagIsPlaying | eAudioPlayerNodeFlagOutputIsMuted | eAudioPlayerNodeFlagRingBufferNeedsReset)) != eAudioPlayerNodeFlagIsPlaying)
+		return NO;
+	if(!(decoderState->mFlags.load() & DecoderStateData::eRenderingStartedFlag) || (decoderState->mFlags.load() & DecoderStateData::eCancelDecodingFlag))
+		return NO;
+	// The ring buffer may only be discarded by the render block if it contains audio solely from decoderState
+	if(GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStates.load()) != decoderState)
+		return NO;
+	return self.engine.isRunning;
+}
 
-				// Schedule the rendering started notification
-				const uint32_t cmd = eAudioPlayerNodeRenderEventRingBufferCommandRenderingStarted;
-				const uint32_t frameOffset = framesRead - framesRemainingToDistribute;
-				const uint64_t hostTime = timestamp->mHostTime + ConvertSecondsToHostTicks(frameOffset / self->_audioRingBuffer.Format().mSampleRate);
-
-				uint8_t bytesToWrite [4 + 8 + 8];
-				std::memcpy(bytesToWrite, &cmd, 4);
-				std::memcpy(bytesToWrite + 4, &decoderState->mSequenceNumber, 8);
-				std::memcpy(bytesToWrite + 4 + 8, &hostTime, 8);
-				self->_renderEventsRingBuffer.Write(bytesToWrite, 4 + 8 + 8);
-				dispatch_source_merge_data(self->_renderEventsProcessor, 1);
-			}
+- (SFBAudioDecodingWorkResult)stageSeekForDecoderState:(DecoderStateData *)decoderState chunkSize:(AVAudioFrameCount)chunkSize
+{
+	// The render block credits no frames to decoderState while its frame counters are inconsistent
+	_flags.fetch_or(eAudioPlayerNodeFlagSeekStaging);
+
+	// The seek buffer is unused by the render block until it is marked ready
+	_seekBuffer.Reset();
+
+	// Audio held back for a crossfade precedes the seek target
+	if(_crossfadeTailDecoderState == decoderState)
+		[self discardCrossfade];
+
+	const auto seekTarget = decoderState->mFrameToSeek.load();
+	const auto seekFrame = decoderState->SeekDecoder(seekTarget);
+	if(seekFrame == kInvalidFramePosition) {
+		// Fall back to a ring buffer reset, where the seek is attempted again
+		_flags.fetch_or(eAudioPlayerNodeFlagRingBufferNeedsReset);
+		return SFBAudioDecodingWorkResultReady;
+	}
 
-			decoderState->mFramesRendered.fetch_add(framesFromThisDecoder);
-			framesRemainingToDistribute -= framesFromThisDecoder;
+	// Decode one chunk at the target, which plays while the decoding thread refills the ring buffer
+	NSError *error = nil;
+	AVAudioFrameCount framesWritten = 0;
+	if(!decoderState->DecodeAudio(_seekBuffer, std::min(chunkSize, static_cast<AVAudioFrameCount>(_seekBuffer.FramesAvailableToWrite())), framesWritten, &error)) {
+		os_log_error(_audioPlayerNodeLog, "Error decoding audio: %{public}@", error);
+		if(error)
+			[self postDecoderEvent:{ eAudioPlayerNodeDecoderEventEncounteredError, decoderState->mDecoder, error, false, 0 }];
+	}
 
-			if((decoderState->mFlags.load() & DecoderStateData::eDecodingCompleteFlag) && decoderState->mFramesRendered.load() == decoderState->mFramesConverted.load()) {
-				decoderState->mFlags.fetch_or(DecoderStateData::eRenderingCompleteFlag);
+	_stagedSeekTarget.store(seekTarget);
+	_stagedSeekFrame.store(seekFrame);
+	_stagedSeekSequenceNumber.store(decoderState->mSequenceNumber);
 
-				// Schedule the rendering complete notification
-				const uint32_t cmd = eAudioPlayerNodeRenderEventRingBufferCommandRenderingComplete;
-				const uint32_t frameOffset = framesRead - framesRemainingToDistribute;
-				const uint64_t hostTime = timestamp->mHostTime + ConvertSecondsToHostTicks(frameOffset / self->_audioRingBuffer.Format().mSampleRate);
-
-				uint8_t bytesToWrite [4 + 8 + 8];
-				std::memcpy(bytesToWrite, &cmd, 4);
-				std::memcpy(bytesToWrite + 4, &decoderState->mSequenceNumber, 8);
-				std::memcpy(bytesToWrite + 4 + 8, &hostTime, 8);
-				self->_renderEventsRingBuffer.Write(bytesToWrite, 4 + 8 + 8);
-				dispatch_source_merge_data(self->_renderEventsProcessor, 1);
-			}
+	os_log_debug(_audioPlayerNodeLog, "Staged %u frames at frame %lld", framesWritten, seekFrame);
 
-			if(framesRemainingToDistribute == 0)
-				break;
+	// The render block requests decoding after switching to the seek buffer
+	_flags.fetch_or(eAudioPlayerNodeFlagSeekBufferReady);
+	return SFBAudioDecodingWorkResultWaiting;
+}
 
-			decoderState = GetActiveDecoderStateFollowingSequenceNumber(self->_decoderStateArray, kDecoderStateArraySize, decoderState->mSequenceNumber);
-		}
+- (SFBAudioDecodingWorkResult)decodeScrubGrainFromDecoderState:(DecoderStateData *)decoderState
+{
+	// Half a grain remains buffered when the next grain is written so consecutive grains play without a gap
+	const auto grainFrameCount = std::min(_scrubGrainFrameCount.load(), _audioRingBuffer.CapacityFrames() / 2);
+	const auto decodingThreshold = grainFrameCount / 2;
+	_decodingThreshold.store(decodingThreshold);
+
+	// Only the decoder being rendered is scrubbed, so wait until audio from any preceding decoder is consumed
+	// Requests for seek targets arriving while a grain is playing are coalesced
+	if(GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStates.load()) != decoderState || _audioRingBuffer.FramesAvailableToRead() > decodingThreshold) {
+		// The render block clears eAudioPlayerNodeFlagDecoderNeedsSpace and requests decoding once the fill level drops
+		_flags.fetch_or(eAudioPlayerNodeFlagDecoderNeedsSpace);
+		return SFBAudioDecodingWorkResultWaiting;
+	}
 
-		// ========================================
-		// 8. If there are no active decoders schedule the end of audio notification
+	// -seekToFrame: requests decoding when the target changes
+	if(!(_flags.fetch_and(~eAudioPlayerNodeFlagScrubTargetChanged) & eAudioPlayerNodeFlagScrubTargetChanged))
+		return SFBAudioDecodingWorkResultWaiting;
 
-		decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(self->_decoderStateArray, kDecoderStateArraySize);
-		if(!decoderState) {
-			const uint32_t cmd = eAudioPlayerNodeRenderEventRingBufferCommandEndOfAudio;
-			const uint64_t hostTime = timestamp->mHostTime + ConvertSecondsToHostTicks(framesRead / self->_audioRingBuffer.Format().mSampleRate);
+	if(_scrubGrainBuffer.CapacityFrames() < grainFrameCount && !_scrubGrainBuffer.Allocate(*(_renderingFormat.streamDescription), grainFrameCount)) {
+		os_log_error(_audioPlayerNodeLog, "SFB::PCMRingBuffer::Allocate() failed");
+		return SFBAudioDecodingWorkResultWaiting;
+	}
 
-			uint8_t bytesToWrite [4 + 8];
-			std::memcpy(bytesToWrite, &cmd, 4);
-			std::memcpy(bytesToWrite + 4, &hostTime, 8);
-			self->_renderEventsRingBuffer.Write(bytesToWrite, 4 + 8);
-			dispatch_source_merge_data(self->_renderEventsProcessor, 1);
+	const auto seekFrame = decoderState->SeekDecoder(_scrubTarget.load());
+	if(seekFrame == kInvalidFramePosition)
+		return SFBAudioDecodingWorkResultReady;
+
+	// Decode the grain
+	_scrubGrainBuffer.Reset();
+	while(_scrubGrainBuffer.FramesAvailableToRead() < grainFrameCount) {
+		NSError *error = nil;
+		AVAudioFrameCount framesWritten = 0;
+		if(!decoderState->DecodeAudio(_scrubGrainBuffer, grainFrameCount - _scrubGrainBuffer.FramesAvailableToRead(), framesWritten, &error)) {
+			os_log_error(_audioPlayerNodeLog, "Error decoding audio: %{public}@", error);
+			if(error)
+				[self postDecoderEvent:{ eAudioPlayerNodeDecoderEventEncounteredError, decoderState->mDecoder, error, false, 0 }];
+			break;
 		}
+		if(framesWritten == 0)
+			break;
+	}
 
-		return noErr;
-	};
-
-	if((self = [super initWithFormat:format renderBlock:renderBlock])) {
-		os_log_info(_audioPlayerNodeLog, "Render block format: %{public}@", format);
-
-		// _flags and _decoderStateArray are used in the render block so must be lock free
-		assert(_flags.is_lock_free());
-		assert(_decoderStateArray[0].is_lock_free());
-
-		// Initialize the decoder array
-		for(size_t i = 0; i < kDecoderStateArraySize; ++i)
-			_decoderStateArray[i].store(nullptr);
-
-		// Allocate the audio ring buffer and the rendering events ring buffer
-		_renderingFormat = format;
-		if(!_audioRingBuffer.Allocate(*(_renderingFormat.streamDescription), ringBufferSize)) {
-			os_log_error(_audioPlayerNodeLog, "SFB::Audio::RingBuffer::Allocate() failed");
-			return nil;
+	// A grain at the end of the audio doesn't complete decoding since decoding resumes elsewhere
+	decoderState->mFlags.fetch_and(~DecoderStateData::eDecodingCompleteFlag);
+
+	// The playback position reflects the grain being played
+	decoderState->mFramesRendered.store(decoderState->ConvertToOutputFrames(seekFrame));
+	_playbackSnapshotGeneration.fetch_add(1);
+
+	// The grain was decoded into a single region following the reset
+	const auto frameCount = _scrubGrainBuffer.FramesAvailableToRead();
+	if(frameCount == 0 || !_scrubGrainBuffer.GetBufferList({ 0, frameCount }, _scrubGrainBufferList.get()))
+		return SFBAudioDecodingWorkResultReady;
+
+	// Fade the grain in and out to join it to the grains preceding and following it
+	const auto fadeFrameCount = std::min(static_cast<AVAudioFrameCount>(kScrubGrainFadeDuration * _renderingFormat.sampleRate), frameCount / 2);
+	if(fadeFrameCount > 0) {
+		const float step = 1.f / fadeFrameCount;
+		for(UInt32 i = 0; i < _scrubGrainBufferList->mNumberBuffers; ++i) {
+			auto samples = static_cast<float *>(_scrubGrainBufferList->mBuffers[i].mData);
+			float gain = 0;
+			vDSP_vrampmul(samples, 1, &gain, &step, samples, 1, fadeFrameCount);
+			gain = 1 - step;
+			const float negativeStep = -step;
+			vDSP_vrampmul(samples + frameCount - fadeFrameCount, 1, &gain, &negativeStep, samples + frameCount - fadeFrameCount, 1, fadeFrameCount);
 		}
+	}
 
-		_renderEventsRingBuffer.Allocate(256);
+	if(_audioRingBuffer.Write(_scrubGrainBufferList.get(), frameCount) != frameCount)
+		os_log_error(_audioPlayerNodeLog, "SFB::PCMRingBuffer::Write() failed");
 
-#if 0
-		// See the comments in SFBAudioPlayer -configureEngineForGaplessPlaybackOfFormat:
-		// 512 is the nominal "standard" value for kAudioUnitProperty_MaximumFramesPerSlice while 1156 is AVAudioSourceNode's default
-		AVAudioFrameCount maximumFramesToRender = static_cast<AVAudioFrameCount>(ceil(512 * (format.sampleRate / 44100)));
-		if(self.AUAudioUnit.maximumFramesToRender < maximumFramesToRender) {
-			os_log_debug(_audioPlayerNodeLog, "Setting maximumFramesToRender to %u", maximumFramesToRender);
-			self.AUAudioUnit.maximumFramesToRender = maximumFramesToRender;
-		}
-#endif
+	_flags.fetch_and(~eAudioPlayerNodeFlagRingBufferPriming);
+	_scrubGrainCount.fetch_add(1);
 
-		// Create the dispatch queue used for sending delegate messages
-		dispatch_queue_attr_t attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INITIATED, 0);
-		_notificationQueue = dispatch_queue_create_with_target("org.sbooth.AudioEngine.AudioPlayerNode.NotificationQueue", attr, DISPATCH_TARGET_QUEUE_DEFAULT);
-		if(!_notificationQueue) {
-			os_log_error(_audioPlayerNodeLog, "dispatch_queue_create_with_target failed");
-			return nil;
-		}
+	os_log_debug(_audioPlayerNodeLog, "Decoded %u frame scrub grain at frame %lld", frameCount, seekFrame);
 
-		_decodingSemaphore = dispatch_semaphore_create(0);
-		if(!_decodingSemaphore) {
-			os_log_error(_audioPlayerNodeLog, "dispatch_semaphore_create failed");
-			return nil;
-		}
+	return SFBAudioDecodingWorkResultReady;
+}
 
-		// Set up render events processing for delegate notifications
-		_renderEventsProcessor = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_OR, 0, 0, dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0));
-		if(!_renderEventsProcessor) {
-			os_log_error(_audioPlayerNodeLog, "dispatch_source_create failed");
-			return nil;
+- (BOOL)reopenRenderedDecoderState
+{
+	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStates.load());
+	if(!decoderState || decoderState == _decodingDecoderState) {
+		// If rendering completed before output was muted the mute is no longer needed and the buffered audio is kept
+		if(_reopeningDecoderState) {
+			if(![self muteOutput])
+				return NO;
+			_reopeningDecoderState = false;
+			_flags.fetch_and(~eAudioPlayerNodeFlagOutputIsMuted);
 		}
+		return YES;
+	}
 
-		dispatch_source_set_event_handler(_renderEventsProcessor, ^{
-			while(self->_renderEventsRingBuffer.BytesAvailableToRead() >= 4) {
-				uint32_t cmd;
-				/*auto bytesRead =*/ self->_renderEventsRingBuffer.Read(&cmd, 4);
-
-				switch(cmd) {
-					case eAudioPlayerNodeRenderEventRingBufferCommandRenderingStarted:
-						if(self->_renderEventsRingBuffer.BytesAvailableToRead() >= (8 + 8)) {
-							uint64_t sequenceNumber, hostTime;
-							/*bytesRead =*/ self->_renderEventsRingBuffer.Read(&sequenceNumber, 8);
-							/*bytesRead =*/ self->_renderEventsRingBuffer.Read(&hostTime, 8);
-
-							auto decoderState = GetDecoderStateWithSequenceNumber(self->_decoderStateArray, kDecoderStateArraySize, sequenceNumber);
-							if(!decoderState) {
-								os_log_error(_audioPlayerNodeLog, "Decoder state with sequence number %llu missing", sequenceNumber);
-								break;
-							}
-
-							os_log_debug(_audioPlayerNodeLog, "Rendering will start in %.2f msec for \"%{public}@\"", (ConvertHostTicksToNanos(hostTime) - ConvertHostTicksToNanos(mach_absolute_time())) / NSEC_PER_MSEC, [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
-
-							if([self->_delegate respondsToSelector:@selector(audioPlayerNode:renderingWillStart:atHostTime:)])
-								dispatch_async_and_wait(self->_notificationQueue, ^{
-									[self->_delegate audioPlayerNode:self renderingWillStart:decoderState->mDecoder atHostTime:hostTime];
-								});
-
-							if([self->_delegate respondsToSelector:@selector(audioPlayerNode:renderingStarted:)]) {
-								id<SFBPCMDecoding> decoder = decoderState->mDecoder;
-								dispatch_time_t notificationTime = hostTime;
-								dispatch_after(notificationTime, self->_notificationQueue, ^{
-#if DEBUG
-									double delta = (ConvertHostTicksToNanos(mach_absolute_time()) - ConvertHostTicksToNanos(notificationTime)) / NSEC_PER_MSEC;
-									double tolerance = 1000 / self->_audioRingBuffer.Format().mSampleRate;
-									if(abs(delta) > tolerance)
-										os_log_debug(_audioPlayerNodeLog, "Rendering started notification for \"%{public}@\" arrived %.2f msec %s", [[NSFileManager defaultManager] displayNameAtPath:decoder.inputSource.url.path], delta, delta > 0 ? "late" : "early");
-#endif
-
-									[self->_delegate audioPlayerNode:self renderingStarted:decoder];
-								});
-							}
-						}
-						else
-							os_log_error(_audioPlayerNodeLog, "Missing data for eAudioPlayerNodeRenderEventRingBufferCommandRenderingStarted");
-						break;
-
-					case eAudioPlayerNodeRenderEventRingBufferCommandRenderingComplete:
-						if(self->_renderEventsRingBuffer.BytesAvailableToRead() >= (8 + 8)) {
-							uint64_t sequenceNumber, hostTime;
-							/*bytesRead =*/ self->_renderEventsRingBuffer.Read(&sequenceNumber, 8);
-							/*bytesRead =*/ self->_renderEventsRingBuffer.Read(&hostTime, 8);
-
-							auto decoderState = GetDecoderStateWithSequenceNumber(self->_decoderStateArray, kDecoderStateArraySize, sequenceNumber);
-							if(!decoderState) {
-								os_log_error(_audioPlayerNodeLog, "Decoder state with sequence number %llu missing", sequenceNumber);
-								break;
-							}
-
-							os_log_debug(_audioPlayerNodeLog, "Rendering will complete in %.2f msec for \"%{public}@\"", (ConvertHostTicksToNanos(hostTime) - ConvertHostTicksToNanos(mach_absolute_time())) / NSEC_PER_MSEC, [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
-
-							if([self->_delegate respondsToSelector:@selector(audioPlayerNode:renderingComplete:)]) {
-								// Store a strong reference to `decoderState->mDecoder` for use in the notification block
-								// Otherwise the collector could collect `decoderState` before the block is invoked
-								// resulting in a `nil` decoder being passed in -audioPlayerNode:renderingComplete:
-								// with a possible subsequent EXC_BAD_ACCESS from messaging a non-optional `nil` object
-								id<SFBPCMDecoding> decoder = decoderState->mDecoder;
-								dispatch_time_t notificationTime = hostTime;
-								dispatch_after(notificationTime, self->_notificationQueue, ^{
-#if DEBUG
-									double delta = (ConvertHostTicksToNanos(mach_absolute_time()) - ConvertHostTicksToNanos(notificationTime)) / NSEC_PER_MSEC;
-									double tolerance = 1000 / self->_audioRingBuffer.Format().mSampleRate;
-									if(abs(delta) > tolerance)
-										os_log_debug(_audioPlayerNodeLog, "Rendering complete notification for \"%{public}@\" arrived %.2f msec %s", [[NSFileManager defaultManager] displayNameAtPath:decoder.inputSource.url.path], delta, delta > 0 ? "late" : "early");
-#endif
-
-									[self->_delegate audioPlayerNode:self renderingComplete:decoder];
-								});
-							}
-
-							// The last action performed with a decoder that has completed rendering is this notification
-							decoderState->mFlags.fetch_or(DecoderStateData::eMarkedForRemovalFlag);
-							dispatch_source_merge_data(self->_collector, 1);
-						}
-						else
-							os_log_error(_audioPlayerNodeLog, "Missing data for eAudioPlayerNodeRenderEventRingBufferCommandRenderingComplete");
-						break;
-
-					case eAudioPlayerNodeRenderEventRingBufferCommandEndOfAudio:
-						if(self->_renderEventsRingBuffer.BytesAvailableToRead() >= 8) {
-							uint64_t hostTime;
-							/*bytesRead =*/ self->_renderEventsRingBuffer.Read(&hostTime, 8);
+	// The decoder states following decoderState are modified so output must be muted
+	// The render block doesn't complete rendering while scrubbing, so once it acknowledges the mute the decoder states
+	// remain active. The reopen is finished even if scrubbing ends in the interim since output remains muted until
+	// the ring buffer is reset.
+	_reopeningDecoderState = true;
+	if(![self muteOutput])
+		return NO;
+	_reopeningDecoderState = false;
 
-							os_log_debug(_audioPlayerNodeLog, "End of audio in %.2f msec", (ConvertHostTicksToNanos(hostTime) - ConvertHostTicksToNanos(mach_absolute_time())) / NSEC_PER_MSEC);
+	os_log_debug(_audioPlayerNodeLog, "Reopening decoder for \"%{public}@\" for scrubbing", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
 
-							if([self->_delegate respondsToSelector:@selector(audioPlayerNodeEndOfAudio:)]) {
-								dispatch_time_t notificationTime = hostTime;
-								dispatch_after(notificationTime, self->_notificationQueue, ^{
-#if DEBUG
-									double delta = (ConvertHostTicksToNanos(mach_absolute_time()) - ConvertHostTicksToNanos(notificationTime)) / NSEC_PER_MSEC;
-									double tolerance = 1000 / self->_audioRingBuffer.Format().mSampleRate;
-									if(abs(delta) > tolerance)
-										os_log_debug(_audioPlayerNodeLog, "End of audio notification arrived %.2f msec %s", delta, delta > 0 ? "late" : "early");
-#endif
+	// Audio held back for a crossfade is discarded with the ring buffer contents
+	[self discardCrossfade];
 
-									[self->_delegate audioPlayerNodeEndOfAudio:self];
-								});
-							}
-						}
-						else
-							os_log_error(_audioPlayerNodeLog, "Missing data for eAudioPlayerNodeRenderEventRingBufferCommandEndOfAudio");
-						break;
-				}
-			}
-		});
+	// Decoder states following decoderState remain in _decoderStates and are decoded again once decoding of
+	// decoderState is complete
+	const auto decoderStates = _decoderStates.load();
+	for(auto nextDecoderState = GetActiveDecoderStateFollowingSequenceNumber(decoderStates, decoderState->mSequenceNumber); nextDecoderState; nextDecoderState = GetActiveDecoderStateFollowingSequenceNumber(decoderStates, nextDecoderState->mSequenceNumber)) {
+		// A decoder state that can't be decoded again is canceled when its decoding resumes
+		if(!(nextDecoderState->mFlags.load() & DecoderStateData::eCancelDecodingFlag) && !nextDecoderState->Restart()) {
+			os_log_error(_audioPlayerNodeLog, "Unable to rewind decoder for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:nextDecoderState->mDecoder.inputSource.url.path]);
+			nextDecoderState->mFlags.fetch_or(DecoderStateData::eCancelDecodingFlag);
+		}
+		// Its buffered audio is discarded, so rendering must not complete a canceled decoder state before the decoding thread retires it
+		if(nextDecoderState->mFlags.load() & DecoderStateData::eCancelDecodingFlag)
+			nextDecoderState->mFlags.fetch_and(~DecoderStateData::eDecodingCompleteFlag);
+		_suspendedDecoderStates.push_back(nextDecoderState);
+	}
 
-		// Start processing render events
-		dispatch_activate(_renderEventsProcessor);
+	// Decoding resumes at the scrub target with the first grain, or at the seek requested when scrubbing ends
+	decoderState->mFlags.fetch_and(~DecoderStateData::eDecodingCompleteFlag);
+	_decodingDecoderState = decoderState;
 
-		// Set up the collector
-		_collector = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_OR, 0, 0, dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0));
-		if(!_collector) {
-			os_log_error(_audioPlayerNodeLog, "dispatch_source_create failed");
-			return nil;
-		}
+	_bufferingController.DecoderChanged(decoderState->mOutputFormat.sampleRate);
+	_playbackSnapshotGeneration.fetch_add(1);
 
-		dispatch_source_set_event_handler(_collector, ^{
-			for(size_t i = 0; i < kDecoderStateArraySize; ++i) {
-				auto decoderState = self->_decoderStateArray[i].load();
-				if(!decoderState || !(decoderState->mFlags.load() & DecoderStateData::eMarkedForRemovalFlag))
-					continue;
-
-				// See comment in -decoderThreadEntry on why I believe it's safe to use store() and not a CAS loop
-				os_log_debug(_audioPlayerNodeLog, "Collecting decoder for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
-				self->_decoderStateArray[i].store(nullptr);
-				delete decoderState;
-			}
-		});
+	// The ring buffer reset unmutes output
+	_flags.fetch_or(eAudioPlayerNodeFlagRingBufferNeedsReset);
 
-		// Start collecting
-		dispatch_activate(_collector);
+	return YES;
+}
 
-		// Launch the decoding thread
-		try {
-			_decodingThread = std::thread(DecoderThreadEntry, (__bridge void *)self);
+- (BOOL)muteOutput
+{
+	if(!_awaitingMute) {
+		if(self.engine.isRunning && !(_flags.load() & eAudioPlayerNodeFlagOutputIsMuted)) {
+			_flags.fetch_or(eAudioPlayerNodeFlagMuteRequested);
+			_awaitingMute = true;
 		}
+		else
+			_flags.fetch_or(eAudioPlayerNodeFlagOutputIsMuted);
+	}
 
-		catch(const std::exception& e) {
-			os_log_error(_audioPlayerNodeLog, "Unable to create decoding thread: %{public}s", e.what());
-			return nil;
-		}
+	// The rendering thread will clear eAudioPlayerNodeFlagMuteRequested and request decoding when the current render cycle completes
+	if(_awaitingMute && (_flags.load() & eAudioPlayerNodeFlagMuteRequested)) {
+		// If the engine was stopped before the current render cycle completed the request won't be acknowledged
+		if(self.engine.isRunning)
+			return NO;
+		_flags.fetch_or(eAudioPlayerNodeFlagOutputIsMuted);
+		_flags.fetch_and(~eAudioPlayerNodeFlagMuteRequested);
 	}
 
-	return self;
+	_awaitingMute = false;
+	return YES;
 }
 
-- (void)dealloc
+- (BOOL)bufferAudioFromDecoderState:(DecoderStateData *)decoderState chunkSize:(AVAudioFrameCount)chunkSize framesWritten:(AVAudioFrameCount *)framesWritten error:(NSError **)error
 {
-	_flags.fetch_or(eAudioPlayerNodeFlagStopDecoderThread);
-	dispatch_semaphore_signal(_decodingSemaphore);
-	_decodingThread.join();
-	while(!_queuedDecoders.empty())
-		_queuedDecoders.pop();
+	*framesWritten = 0;
+
+	// Audio following a decoder whose end was held back is mixed with it
+	if(_crossfadeTailDecoderState && _crossfadeTailDecoderState != decoderState)
+		return [self continueCrossfadeWithDecoderState:decoderState chunkSize:chunkSize framesWritten:framesWritten error:error];
+
+	if(!_crossfadeTailDecoderState) {
+		const auto crossfadeFrameCount = _crossfadeFrameCount.load();
+		if(crossfadeFrameCount == 0)
+			return decoderState->ProduceAudio(_audioRingBuffer, chunkSize, *framesWritten, error);
+
+		// Audio is written directly to the ring buffer until the final frames are reached
+		// The final frames of a decoder with an unknown length are identified as decoding completes
+		const auto frameLength = decoderState->mFrameLength.load();
+		if(frameLength != SFBUnknownFrameLength) {
+			const auto holdbackFrame = decoderState->ConvertToOutputFrames(frameLength) - crossfadeFrameCount;
+			const auto framesDelivered = decoderState->FramesDelivered();
+			if(framesDelivered < holdbackFrame)
+				return decoderState->ProduceAudio(_audioRingBuffer, static_cast<AVAudioFrameCount>(std::min<AVAudioFramePosition>(chunkSize, holdbackFrame - framesDelivered)), *framesWritten, error);
+		}
 
-	// Force any decoders left hanging by the collector to end
-	for(size_t i = 0; i < kDecoderStateArraySize; ++i) {
-		if(_decoderStateArray[i])
-			delete _decoderStateArray[i].exchange(nullptr);
-	}
-}
+		// The tail buffer must hold the final frames and one chunk of audio
+		if(_crossfadeTailBuffer.CapacityFrames() < crossfadeFrameCount + chunkSize && !_crossfadeTailBuffer.Allocate(*(_renderingFormat.streamDescription), crossfadeFrameCount + chunkSize)) {
+			os_log_error(_audioPlayerNodeLog, "SFB::PCMRingBuffer::Allocate() failed; crossfade disabled for decoder");
+			return decoderState->ProduceAudio(_audioRingBuffer, chunkSize, *framesWritten, error);
+		}
+		if(_crossfadeHeadBuffer.CapacityFrames() < kCrossfadeMixFrameCapacity && !_crossfadeHeadBuffer.Allocate(*(_renderingFormat.streamDescription), kCrossfadeMixFrameCapacity)) {
+			os_log_error(_audioPlayerNodeLog, "SFB::PCMRingBuffer::Allocate() failed; crossfade disabled for decoder");
+			return decoderState->ProduceAudio(_audioRingBuffer, chunkSize, *framesWritten, error);
+		}
 
-#pragma mark - Format Information
+		_crossfadeTailDecoderState = decoderState;
+		_crossfadeHoldbackFrameCount = crossfadeFrameCount;
+	}
 
-- (BOOL)supportsFormat:(AVAudioFormat *)format
-{
-	// Gapless playback requires the same number of channels at the same sample rate
-	return format.channelCount == _renderingFormat.channelCount && format.sampleRate == _renderingFormat.sampleRate;
+	// Hold back the final frames, releasing audio preceding them to the ring buffer
+	const auto result = decoderState->ProduceAudio(_crossfadeTailBuffer, std::min(chunkSize, static_cast<AVAudioFrameCount>(_crossfadeTailBuffer.FramesAvailableToWrite())), *framesWritten, error);
+	[self releaseCrossfadeTailExcess];
+	return result;
 }
 
-#pragma mark - Queue Management
-
-- (BOOL)resetAndEnqueueURL:(NSURL *)url error:(NSError **)error
+- (BOOL)continueCrossfadeWithDecoderState:(DecoderStateData *)decoderState chunkSize:(AVAudioFrameCount)chunkSize framesWritten:(AVAudioFrameCount *)framesWritten error:(NSError **)error
 {
-	NSParameterAssert(url != nil);
+	*framesWritten = 0;
 
-	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
-	if(!decoder)
-		return NO;
+	if(_crossfadeOverlapLength == 0) {
+		// Audio beyond the final frames may have been decoded if the frame length was inaccurate or unknown
+		[self releaseCrossfadeTailExcess];
 
-	return [self resetAndEnqueueDecoder:decoder error:error];
-}
+		// Without a following decoder the final frames are played as-is
+		if(!decoderState) {
+			MoveFrames(_crossfadeTailBuffer, _audioRingBuffer, _crossfadeRegionBufferList.get(), chunkSize);
+			if(_crossfadeTailBuffer.FramesAvailableToRead() == 0)
+				[self finishCrossfade];
+			return YES;
+		}
 
-- (BOOL)resetAndEnqueueDecoder:(id<SFBPCMDecoding>)decoder error:(NSError **)error
-{
-	NSParameterAssert(decoder != nil);
-	return [self performEnqueue:decoder reset:YES error:error];
-}
+		// The crossfade spans whatever remains of the final frames
+		const auto overlapLength = static_cast<AVAudioFrameCount>(_crossfadeTailBuffer.FramesAvailableToRead());
+		if(overlapLength == 0) {
+			[self finishCrossfade];
+			return [self bufferAudioFromDecoderState:decoderState chunkSize:chunkSize framesWritten:framesWritten error:error];
+		}
 
-- (BOOL)enqueueURL:(NSURL *)url error:(NSError **)error
-{
-	NSParameterAssert(url != nil);
+		os_log_debug(_audioPlayerNodeLog, "Crossfading %u frames into \"%{public}@\"", overlapLength, [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
 
-	SFBAudioDecoder *decoder = [[SFBAudioDecoder alloc] initWithURL:url error:error];
-	if(!decoder)
-		return NO;
+		// The render block credits frames rendered after the start of the crossfade to both decoders
+		_crossfadeTailDecoderState->mCrossfadeStartFrame.store(_crossfadeTailDecoderState->mFramesConverted.load() - overlapLength);
+		_crossfadeHeadDecoderState = decoderState;
+		_crossfadeOverlapLength = overlapLength;
+		_crossfadeOverlapPosition = 0;
+	}
 
-	return [self enqueueDecoder:decoder error:error];
-}
+	const auto frameCount = std::min({ chunkSize, _crossfadeOverlapLength - _crossfadeOverlapPosition, static_cast<AVAudioFrameCount>(_audioRingBuffer.FramesAvailableToWrite()), kCrossfadeMixFrameCapacity });
+	if(frameCount == 0)
+		return YES;
+
+	// Decode the beginning of the following decoder
+	// A decoder that completes decoding within the crossfade is not itself crossfaded
+	BOOL result = YES;
+	if(auto headDecoderState = _crossfadeHeadDecoderState) {
+		while(_crossfadeHeadBuffer.FramesAvailableToRead() < frameCount) {
+			AVAudioFrameCount framesProduced = 0;
+			if(!headDecoderState->ProduceAudio(_crossfadeHeadBuffer, frameCount - static_cast<AVAudioFrameCount>(_crossfadeHeadBuffer.FramesAvailableToRead()), framesProduced, error)) {
+				result = NO;
+				break;
+			}
+			if(framesProduced == 0)
+				break;
+			*framesWritten += framesProduced;
+		}
 
-- (BOOL)enqueueDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error
-{
-	NSParameterAssert(decoder != nil);
-	return [self performEnqueue:decoder reset:NO error:error];
-}
+		if(headDecoderState->IsDecodingComplete())
+			_crossfadeHeadDecoderState = nullptr;
+	}
 
-- (void)cancelCurrentDecoder
-{
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	if(decoderState) {
-		decoderState->mFlags.fetch_or(DecoderStateData::eCancelDecodingFlag);
-		dispatch_semaphore_signal(_decodingSemaphore);
+	const auto tailFrameCount = static_cast<AVAudioFrameCount>(_crossfadeTailBuffer.Read(_crossfadeMixBuffer.mutableAudioBufferList, frameCount));
+	const auto headFrameCount = static_cast<AVAudioFrameCount>(_crossfadeHeadBuffer.Read(_crossfadeHeadMixBuffer.mutableAudioBufferList, tailFrameCount));
+
+	float *fadeInGains = _crossfadeGains.data();
+	float *fadeOutGains = fadeInGains + kCrossfadeMixFrameCapacity;
+	ComputeCrossfadeGains(_crossfadeCurve.load(), _crossfadeOverlapPosition, _crossfadeOverlapLength, fadeInGains, fadeOutGains, tailFrameCount);
+
+	const auto channelCount = _renderingFormat.channelCount;
+	for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel) {
+		float *tail = _crossfadeMixBuffer.floatChannelData[channel];
+		const float *head = _crossfadeHeadMixBuffer.floatChannelData[channel];
+		if(headFrameCount > 0)
+			vDSP_vmma(tail, 1, fadeOutGains, 1, head, 1, fadeInGains, 1, tail, 1, headFrameCount);
+		// The following decoder ended within the crossfade
+		if(tailFrameCount > headFrameCount)
+			vDSP_vmul(tail + headFrameCount, 1, fadeOutGains + headFrameCount, 1, tail + headFrameCount, 1, tailFrameCount - headFrameCount);
 	}
-}
 
-- (void)clearQueue
-{
-	std::lock_guard<SFB::UnfairLock> lock(_queueLock);
-	while(!_queuedDecoders.empty())
-		_queuedDecoders.pop();
+	_crossfadeMixBuffer.frameLength = tailFrameCount;
+	_audioRingBuffer.Write(_crossfadeMixBuffer.audioBufferList, tailFrameCount);
+
+	_crossfadeOverlapPosition += tailFrameCount;
+	if(_crossfadeOverlapPosition == _crossfadeOverlapLength || tailFrameCount == 0)
+		[self finishCrossfade];
+
+	return result;
 }
 
-- (BOOL)queueIsEmpty
+- (AVAudioFrameCount)releaseCrossfadeTailExcess
 {
-	std::lock_guard<SFB::UnfairLock> lock(_queueLock);
-	return _queuedDecoders.empty();
+	const auto framesAvailable = static_cast<AVAudioFrameCount>(_crossfadeTailBuffer.FramesAvailableToRead());
+	if(framesAvailable <= _crossfadeHoldbackFrameCount)
+		return 0;
+	return MoveFrames(_crossfadeTailBuffer, _audioRingBuffer, _crossfadeRegionBufferList.get(), framesAvailable - _crossfadeHoldbackFrameCount);
 }
 
-- (id <SFBPCMDecoding>)dequeueDecoder
+- (SFBAudioDecodingWorkResult)flushCrossfade
 {
-	std::lock_guard<SFB::UnfairLock> lock(_queueLock);
-	id <SFBPCMDecoding> decoder = nil;
-	if(!_queuedDecoders.empty()) {
-		decoder = _queuedDecoders.front();
-		_queuedDecoders.pop();
+	const auto chunkSize = _bufferingController.ChunkSize();
+	const auto decodingThreshold = _bufferingController.FillTarget() - chunkSize;
+	_decodingThreshold.store(decodingThreshold);
+
+	if(_audioRingBuffer.FramesAvailableToRead() <= decodingThreshold) {
+		AVAudioFrameCount framesWritten = 0;
+		[self continueCrossfadeWithDecoderState:nullptr chunkSize:chunkSize framesWritten:&framesWritten error:nil];
+		return SFBAudioDecodingWorkResultReady;
 	}
-	return decoder;
+
+	// Wait for additional space in the ring buffer or another decoder to be enqueued
+	_flags.fetch_or(eAudioPlayerNodeFlagDecoderNeedsSpace);
+	if(_audioRingBuffer.FramesAvailableToRead() <= decodingThreshold) {
+		_flags.fetch_and(~eAudioPlayerNodeFlagDecoderNeedsSpace);
+		return SFBAudioDecodingWorkResultReady;
+	}
+
+	return SFBAudioDecodingWorkResultWaiting;
 }
 
-- (void)reset
+- (void)finishCrossfade
 {
-	[super reset];
-	[self clearQueue];
-	[self cancelCurrentDecoder];
+	_crossfadeTailDecoderState = nullptr;
+	_crossfadeHeadDecoderState = nullptr;
+	_crossfadeHoldbackFrameCount = 0;
+	_crossfadeOverlapLength = 0;
+	_crossfadeOverlapPosition = 0;
+	_crossfadeTailBuffer.Reset();
+	_crossfadeHeadBuffer.Reset();
 }
 
-#pragma mark - Playback Control
-
-- (void)play
+- (void)discardCrossfade
 {
-	_flags.fetch_or(eAudioPlayerNodeFlagIsPlaying);
+	if(auto tailDecoderState = _crossfadeTailDecoderState) {
+		tailDecoderState->mFramesConverted.fetch_sub(_crossfadeTailBuffer.FramesAvailableToRead());
+		// Frames already mixed remain in the ring buffer and are rendered for both decoders
+		if(_crossfadeOverlapPosition == 0)
+			tailDecoderState->mCrossfadeStartFrame.store(kInvalidFramePosition);
+	}
+
+	[self finishCrossfade];
 }
 
-- (void)pause
+- (PlaybackSnapshot)currentPlaybackSnapshot
 {
-	_flags.fetch_and(~eAudioPlayerNodeFlagIsPlaying);
+	auto snapshot = _playbackSnapshot.Load();
+	auto generation = _playbackSnapshotGeneration.load();
+	if(snapshot.mGeneration == generation)
+		return snapshot;
+
+	// Decoder state changed since the render block last published the playback position,
+	// or the render block hasn't run since; the engine may be stopped
+	const bool isPlaying = (_flags.load() & (eAudioPlayerNodeFlagIsPlaying | eAudioPlayerNodeFlagOutputIsMuted)) == eAudioPlayerNodeFlagIsPlaying && self.engine.isRunning;
+	SFB::EpochReclaimer::Guard epochGuard(_reclaimer);
+	return MakePlaybackSnapshot(_decoderStates.load(), generation, mach_absolute_time(), isPlaying);
 }
 
-- (void)stop
+- (void)analyzeSpectrumTap
 {
-	_flags.fetch_and(~eAudioPlayerNodeFlagIsPlaying);
-	[self reset];
+	const auto fftSize = _spectrumAnalysisFFTSize.load();
+	if(!_spectrumTap.Analyze(fftSize, _spectrumAnalysisHopSize.load()))
+		os_log_error(_audioPlayerNodeLog, "Error analyzing spectrum with FFT size %u", fftSize);
 }
 
-- (void)togglePlayPause
+- (void)drainRenderTrace
 {
-	_flags.fetch_xor(eAudioPlayerNodeFlagIsPlaying);
-}
+	RenderTraceEvent event;
+	while(_renderTrace.TryPop(event)) {
+		switch(event.mType) {
+			case eAudioPlayerNodeRenderTraceEventShortRead:
+				os_log_error(_audioPlayerNodeLog, "SFB::PCMRingBuffer::Read failed at host time %llu: Requested %llu frames, got %llu", event.mHostTime, event.mArg0, event.mArg1);
+				_shortReadCount.fetch_add(1);
+				break;
 
-#pragma mark - Player State
+			case eAudioPlayerNodeRenderTraceEventSilencePadding:
+				os_log_debug(_audioPlayerNodeLog, "Insufficient audio in ring buffer at host time %llu: %llu frames available, %llu requested", event.mHostTime, event.mArg0, event.mArg1);
+				_silencePaddingCount.fetch_add(1);
+				_silencePaddingFrameCount.fetch_add(event.mArg1 - event.mArg0);
+				break;
 
-- (BOOL)isPlaying
-{
-	return (_flags.load() & eAudioPlayerNodeFlagIsPlaying) != 0;
-}
+			case eAudioPlayerNodeRenderTraceEventMuteTransition:
+				os_log_debug(_audioPlayerNodeLog, "Output %{public}s at host time %llu", event.mArg0 ? "muted" : "unmuted", event.mHostTime);
+				_muteTransitionCount.fetch_add(1);
+				break;
 
-- (BOOL)isReady
-{
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	return decoderState ? YES : NO;
+			case eAudioPlayerNodeRenderTraceEventSequenceNumberChange:
+				if(event.mArg0 == UINT64_MAX)
+					os_log_debug(_audioPlayerNodeLog, "Rendering decoder with sequence number %llu at host time %llu", event.mArg1, event.mHostTime);
+				else
+					os_log_debug(_audioPlayerNodeLog, "Rendering decoder with sequence number %llu following %llu at host time %llu", event.mArg1, event.mArg0, event.mHostTime);
+				_sequenceNumberChangeCount.fetch_add(1);
+				break;
+		}
+	}
 }
 
-- (id<SFBPCMDecoding>)currentDecoder
+- (void)scheduleRenderTraceDrain
 {
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	return decoderState ? decoderState->mDecoder : nil;
+	// Nearly all render trace events are recorded while playing, so an idle node doesn't wake to drain them
+	// When playback stops the trace is drained once more to pick up events from the final render cycles
+	const auto drainInterval = static_cast<uint64_t>(kRenderTraceDrainInterval * NSEC_PER_SEC);
+	const auto isPlaying = (_flags.load() & eAudioPlayerNodeFlagIsPlaying) != 0;
+	dispatch_source_set_timer(_renderTraceDrain, dispatch_time(DISPATCH_TIME_NOW, drainInterval), isPlaying ? drainInterval : DISPATCH_TIME_FOREVER, drainInterval / 2);
 }
 
-#pragma mark - Playback Properties
-
-- (SFBAudioPlayerNodePlaybackPosition)playbackPosition
+- (QueuedDecoder)popQueuedDecoder
 {
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	if(!decoderState)
-		return { .framePosition = SFBUnknownFramePosition, .frameLength = SFBUnknownFrameLength };
-
-	return { .framePosition = decoderState->FramePosition(), .frameLength = decoderState->FrameLength() };
+	// _dequeueLock must be held by the caller
+	QueuedDecoder queuedDecoder = { nil, 1, false };
+	_queuedDecoders.TryPop(queuedDecoder);
+	return queuedDecoder;
 }
 
-- (SFBAudioPlayerNodePlaybackTime)playbackTime
+- (DecoderStateData *)createLookAheadDecoderState
 {
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	if(!decoderState)
-		return { .currentTime = SFBUnknownTime, .totalTime = SFBUnknownTime };
+	// Sequence numbers must reflect queue order so decoder states are only created with _dequeueLock held
+	auto front = _queuedDecoders.Front();
+	if(!front)
+		return nullptr;
+	id <SFBPCMDecoding> decoder = front->mDecoder;
 
-	SFBAudioPlayerNodePlaybackTime playbackTime = { .currentTime = SFBUnknownTime, .totalTime = SFBUnknownTime };
-
-	int64_t framePosition = decoderState->FramePosition();
-	int64_t frameLength = decoderState->FrameLength();
-
-	double sampleRate = decoderState->mConverter.outputFormat.sampleRate;
-	if(sampleRate > 0) {
-		if(framePosition != SFBUnknownFramePosition)
-			playbackTime.currentTime = framePosition / sampleRate;
-		if(frameLength != SFBUnknownFrameLength)
-			playbackTime.totalTime = frameLength / sampleRate;
+	auto decoderState = new (std::nothrow) DecoderStateData(decoder, _renderingFormat, kRingBufferChunkSize, [self currentSampleRateConverterSettings], front->mGain, _peakLimiterEnabled.load());
+	if(!decoderState) {
+		os_log_error(_audioPlayerNodeLog, "Unable to allocate decoder state data for look-ahead decoding");
+		return nullptr;
+	}
+	if(front->mApplyReplayGain)
+		decoderState->mFlags.fetch_or(DecoderStateData::eReplayGainPendingFlag);
+
+	// Divide the available memory evenly among the staged decoders
+	auto lookAheadDepth = std::max(_lookAheadDepth.load(), 1u);
+	auto bytesPerFrame = _audioRingBuffer.Format().FrameCountToByteSize(1) * _audioRingBuffer.Format().mChannelsPerFrame;
+	auto frameCapacity = static_cast<AVAudioFrameCount>(std::min(_lookAheadMemoryLimit.load() / lookAheadDepth / bytesPerFrame, static_cast<size_t>(UINT32_MAX / 2)));
+	frameCapacity = std::max(frameCapacity, 2 * kRingBufferChunkSize);
+
+	if(!decoderState->AllocateStagingBuffer(frameCapacity)) {
+		os_log_error(_audioPlayerNodeLog, "Unable to allocate staging buffer for look-ahead decoding");
+		delete decoderState;
+		return nullptr;
 	}
 
-	return playbackTime;
+	// Only remove the decoder from the queue once the decoder state was successfully created
+	QueuedDecoder dequeuedDecoder;
+	_queuedDecoders.TryPop(dequeuedDecoder);
+	assert(dequeuedDecoder.mDecoder == decoder);
+
+	return decoderState;
 }
 
-- (BOOL)getPlaybackPosition:(SFBAudioPlayerNodePlaybackPosition *)playbackPosition andTime:(SFBAudioPlayerNodePlaybackTime *)playbackTime
+- (BOOL)insertDecoderState:(DecoderStateData *)decoderState
 {
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	if(!decoderState) {
-		if(playbackPosition)
-			*playbackPosition = { .framePosition = SFBUnknownFramePosition, .frameLength = SFBUnknownFrameLength };
-		if(playbackTime)
-			*playbackTime = { .currentTime = SFBUnknownTime, .totalTime = SFBUnknownTime };
+	std::lock_guard<std::mutex> lock(_decoderStatesLock);
+
+	auto decoderStates = _decoderStates.load();
+	if(decoderStates->mCount == kDecoderStateListCapacity)
 		return NO;
-	}
 
-	SFBAudioPlayerNodePlaybackPosition currentPlaybackPosition = { .framePosition = decoderState->FramePosition(), .frameLength = decoderState->FrameLength() };
-	if(playbackPosition)
-		*playbackPosition = currentPlaybackPosition;
+	auto newDecoderStates = new (std::nothrow) DecoderStateList{};
+	if(!newDecoderStates) {
+		os_log_error(_audioPlayerNodeLog, "Unable to allocate decoder state list");
+		return NO;
+	}
 
-	if(playbackTime) {
-		SFBAudioPlayerNodePlaybackTime currentPlaybackTime = { .currentTime = SFBUnknownTime, .totalTime = SFBUnknownTime };
-		double sampleRate = decoderState->mConverter.outputFormat.sampleRate;
-		if(sampleRate > 0) {
-			if(currentPlaybackPosition.framePosition != SFBUnknownFramePosition)
-				currentPlaybackTime.currentTime = currentPlaybackPosition.framePosition / sampleRate;
-			if(currentPlaybackPosition.frameLength != SFBUnknownFrameLength)
-				currentPlaybackTime.totalTime = currentPlaybackPosition.frameLength / sampleRate;
+	// Preserve the sort order by sequence number
+	auto inserted = false;
+	for(size_t i = 0; i < decoderStates->mCount; ++i) {
+		if(!inserted && decoderStates->mStates[i]->mSequenceNumber > decoderState->mSequenceNumber) {
+			newDecoderStates->mStates[newDecoderStates->mCount++] = decoderState;
+			inserted = true;
 		}
-		*playbackTime = currentPlaybackTime;
+		newDecoderStates->mStates[newDecoderStates->mCount++] = decoderStates->mStates[i];
 	}
+	if(!inserted)
+		newDecoderStates->mStates[newDecoderStates->mCount++] = decoderState;
+
+	_decoderStates.store(newDecoderStates);
+	_reclaimer.Retire(decoderStates, DeleteDecoderStateList);
 
 	return YES;
 }
 
-#pragma mark - Seeking
-
-- (BOOL)seekForward:(NSTimeInterval)secondsToSkip
+- (void)collectDecoderStates
 {
-	if(secondsToSkip < 0)
-		secondsToSkip = 0;
-
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	if(!decoderState)
-		return NO;
+	auto collected = false;
 
-	double sampleRate = decoderState->mConverter.outputFormat.sampleRate;
-	AVAudioFramePosition framePosition = decoderState->FramePosition();
-	AVAudioFramePosition targetFrame = framePosition + (AVAudioFramePosition)(secondsToSkip * sampleRate);
+	{
+		std::lock_guard<std::mutex> lock(_decoderStatesLock);
 
-	if(targetFrame >= decoderState->FrameLength())
-		targetFrame = std::max(decoderState->FrameLength() - 1, 0ll);
+		auto decoderStates = _decoderStates.load();
+		if(!decoderStates)
+			return;
 
-	return [self seekToFrame:targetFrame];
-}
+		auto newDecoderStates = new (std::nothrow) DecoderStateList{};
+		if(!newDecoderStates) {
+			os_log_error(_audioPlayerNodeLog, "Unable to allocate decoder state list");
+			return;
+		}
 
-- (BOOL)seekBackward:(NSTimeInterval)secondsToSkip
-{
-	if(secondsToSkip < 0)
-		secondsToSkip = 0;
+		for(size_t i = 0; i < decoderStates->mCount; ++i) {
+			auto decoderState = decoderStates->mStates[i];
+			if(decoderState->mFlags.load() & DecoderStateData::eMarkedForRemovalFlag)
+				collected = true;
+			else
+				newDecoderStates->mStates[newDecoderStates->mCount++] = decoderState;
+		}
 
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	if(!decoderState)
-		return NO;
+		if(collected) {
+			_decoderStates.store(newDecoderStates);
 
-	double sampleRate = decoderState->mConverter.outputFormat.sampleRate;
-	AVAudioFramePosition framePosition = decoderState->FramePosition();
-	AVAudioFramePosition targetFrame = framePosition - (AVAudioFramePosition)(secondsToSkip * sampleRate);
+			// Readers may still refer to the removed decoder states so deletion is deferred
+			for(size_t i = 0; i < decoderStates->mCount; ++i) {
+				auto decoderState = decoderStates->mStates[i];
+				if(decoderState->mFlags.load() & DecoderStateData::eMarkedForRemovalFlag) {
+					os_log_debug(_audioPlayerNodeLog, "Collecting decoder for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
+					_reclaimer.Retire(decoderState, DeleteDecoderState);
+				}
+			}
+			_reclaimer.Retire(decoderStates, DeleteDecoderStateList);
+		}
+		else
+			delete newDecoderStates;
+	}
 
-	if(targetFrame < 0)
-		targetFrame = 0;
+	// Wake the decoding thread if it is waiting for space in _decoderStates
+	if(collected && (_flags.fetch_and(~eAudioPlayerNodeFlagDecoderNeedsSlot) & eAudioPlayerNodeFlagDecoderNeedsSlot))
+		RequestDecoding(_flags, _decodingSemaphore);
 
-	return [self seekToFrame:targetFrame];
+	// Retry later if readers prevented reclamation
+	if(_reclaimer.Reclaim() > 0) {
+		// Capture the source and not self so the retry doesn't extend the lifetime of the node
+		dispatch_source_t collector = _collector;
+		dispatch_after(dispatch_time(DISPATCH_TIME_NOW, static_cast<int64_t>(kReclamationRetryInterval * NSEC_PER_SEC)), dispatch_get_global_queue(QOS_CLASS_BACKGROUND, 0), ^{
+			dispatch_source_merge_data(collector, 1);
+		});
+	}
 }
 
-- (BOOL)seekToTime:(NSTimeInterval)timeInSeconds
+- (BOOL)stageAudioFromQueuedDecoders
 {
-	if(timeInSeconds < 0)
-		timeInSeconds = 0;
-
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	if(!decoderState)
+	auto lookAheadDepth = _lookAheadDepth.load();
+	if(lookAheadDepth == 0)
 		return NO;
 
-	double sampleRate = decoderState->mConverter.outputFormat.sampleRate;
-	AVAudioFramePosition targetFrame = (AVAudioFramePosition)(timeInSeconds * sampleRate);
-
-	if(targetFrame >= decoderState->FrameLength())
-		targetFrame = std::max(decoderState->FrameLength() - 1, 0ll);
+	DecoderStateData *decoderState = nullptr;
+	{
+		std::lock_guard<std::mutex> dequeueLock(_dequeueLock);
+
+		// Begin decoding the next queued decoder if the look-ahead depth permits
+		if(_lookAheadStates.size() < lookAheadDepth) {
+			auto lookAheadState = [self createLookAheadDecoderState];
+			if(lookAheadState) {
+				os_log_debug(_audioPlayerNodeLog, "Decoding ahead for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:lookAheadState->mDecoder.inputSource.url.path]);
+				_lookAheadStates.push_back(lookAheadState);
+			}
+		}
 
-	return [self seekToFrame:targetFrame];
-}
+		// Select the earliest staged decoder with space available in its staging buffer
+		// The decoding thread acquires mStagingLock before taking ownership so it is
+		// locked here, before _dequeueLock is released, to prevent a race
+		for(auto lookAheadState : _lookAheadStates) {
+			if(lookAheadState->mFlags.load() & (DecoderStateData::eDecodingCompleteFlag | DecoderStateData::eCancelDecodingFlag | DecoderStateData::eStagingStoppedFlag))
+				continue;
+			if(lookAheadState->mStagingBuffer->FramesAvailableToWrite() < lookAheadState->DecodeBufferCapacity())
+				continue;
 
-- (BOOL)seekToPosition:(double)position
-{
-	if(position < 0)
-		position = 0;
-	else if(position >= 1)
-		position = std::nextafter(1.0, 0.0);
+			decoderState = lookAheadState;
+			decoderState->mStagingLock.lock();
+			break;
+		}
+	}
 
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
 	if(!decoderState)
 		return NO;
 
-	AVAudioFramePosition frameLength = decoderState->FrameLength();
-	return [self seekToFrame:(AVAudioFramePosition)(frameLength * position)];
+	std::lock_guard<std::mutex> stagingLock(decoderState->mStagingLock, std::adopt_lock);
+
+	// Reading gain information may require I/O so it is performed outside _dequeueLock
+	[self resolveReplayGainForDecoderState:decoderState];
+
+	NSError *error = nil;
+	if(!decoderState->StageAudio(&error) && error) {
+		os_log_error(_audioPlayerNodeLog, "Error decoding audio ahead of playback: %{public}@", error);
+		// The decoding thread will resume decoding when it takes ownership of the decoder state
+		decoderState->mFlags.fetch_or(DecoderStateData::eStagingStoppedFlag);
+	}
+
+	return YES;
 }
 
-- (BOOL)seekToFrame:(AVAudioFramePosition)frame
+- (void *)decoderThreadEntry
 {
-	if(frame < 0)
-		frame = 0;
-
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	if(!decoderState || !decoderState->mDecoder.supportsSeeking)
-		return NO;
+	os_log_debug(_audioPlayerNodeLog, "Decoder thread starting");
 
-	if(frame >= decoderState->FrameLength())
-		frame = std::max(decoderState->FrameLength() - 1, 0ll);
+	while(!(_flags.load() & eAudioPlayerNodeFlagStopDecoderThread)) {
+		// Requests made after -decodeNextChunk clears eAudioPlayerNodeFlagDecodingRequested signal the semaphore,
+		// so no wakeup is lost between returning SFBAudioDecodingWorkResultWaiting and waiting
+		if([self decodeNextChunk] == SFBAudioDecodingWorkResultWaiting) {
+			// Nothing more can be buffered for a scheduled start
+			_scheduledStart.PrefillComplete();
+			dispatch_semaphore_wait(_decodingSemaphore, DISPATCH_TIME_FOREVER);
+		}
+	}
 
-	decoderState->mFrameToSeek.store(frame);
-	dispatch_semaphore_signal(_decodingSemaphore);
+	os_log_debug(_audioPlayerNodeLog, "Decoder thread terminating");
 
-	return YES;
+	return nullptr;
 }
 
-- (BOOL)supportsSeeking
+- (SFBAudioDecodingWorkResult)decodeNextChunk
 {
-	auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-	return decoderState ? decoderState->mDecoder.supportsSeeking : NO;
-}
+	SFB::EpochReclaimer::Guard epochGuard(_reclaimer, kDecodingParticipant);
 
-#pragma mark - Internals
+	_flags.fetch_and(~eAudioPlayerNodeFlagDecodingRequested);
 
-- (BOOL)performEnqueue:(id <SFBPCMDecoding>)decoder reset:(BOOL)reset error:(NSError **)error
-{
-	os_log_info(_audioPlayerNodeLog, "Enqueuing \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoder.inputSource.url.path]);
+	if(_flags.load() & eAudioPlayerNodeFlagStopDecoderThread)
+		return SFBAudioDecodingWorkResultWaiting;
 
-	if(!decoder.isOpen && ![decoder openReturningError:error])
-		return NO;
+	// Audio held back for a crossfade from a canceled decoder whose decoding is complete is discarded
+	if(_crossfadeTailDecoderState && _crossfadeTailDecoderState != _decodingDecoderState && (_crossfadeTailDecoderState->mFlags.load() & DecoderStateData::eCancelDecodingFlag)) {
+		BOOL partiallyRendered = (_crossfadeTailDecoderState->mFlags.load() & DecoderStateData::eRenderingStartedFlag) ? YES : NO;
+		id<SFBPCMDecoding> canceledDecoder = _crossfadeTailDecoderState->mDecoder;
 
-	if(![self supportsFormat:decoder.processingFormat]) {
-		os_log_error(_audioPlayerNodeLog, "Unsupported decoder processing format: %{public}@", decoder.processingFormat);
+		os_log_debug(_audioPlayerNodeLog, "Discarding audio held back for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:canceledDecoder.inputSource.url.path]);
 
-		if(error)
-			*error = [NSError SFB_errorWithDomain:SFBAudioPlayerNodeErrorDomain
-											 code:SFBAudioPlayerNodeErrorFormatNotSupported
-					descriptionFormatStringForURL:NSLocalizedString(@"The format of the file “%@” is not supported.", @"")
-											  url:decoder.inputSource.url
-									failureReason:NSLocalizedString(@"Unsupported file format", @"")
-							   recoverySuggestion:NSLocalizedString(@"The file's format is not supported by this player.", @"")];
+		[self discardCrossfade];
+		_playbackSnapshotGeneration.fetch_add(1);
 
-		return NO;
+		// Perform the decoding cancelled notification
+		[self postDecoderEvent:{ eAudioPlayerNodeDecoderEventDecodingCanceled, canceledDecoder, nil, partiallyRendered == YES, 0 }];
 	}
 
-	if(reset) {
-		[self clearQueue];
-		auto decoderState = GetActiveDecoderStateWithSmallestSequenceNumber(_decoderStateArray, kDecoderStateArraySize);
-		if(decoderState)
-			decoderState->mFlags.fetch_or(DecoderStateData::eCancelDecodingFlag);
-	}
+	// Grains are decoded from the decoder state being decoded, so one whose decoding is complete is reopened for scrubbing
+	if(((_flags.load() & eAudioPlayerNodeFlagScrubbing) || _reopeningDecoderState) && ![self reopenRenderedDecoderState])
+		return SFBAudioDecodingWorkResultWaiting;
 
-	{
-		std::lock_guard<SFB::UnfairLock> lock(_queueLock);
-		_queuedDecoders.push(decoder);
+	// Decoder states suspended while a preceding decoder state was reopened are decoded again in order
+	if(!_decodingDecoderState && !_suspendedDecoderStates.empty()) {
+		_decodingDecoderState = _suspendedDecoderStates.front();
+		_suspendedDecoderStates.pop_front();
+
+		_bufferingController.DecoderChanged(_decodingDecoderState->mOutputFormat.sampleRate);
+		_playbackSnapshotGeneration.fetch_add(1);
 	}
 
-	dispatch_semaphore_signal(_decodingSemaphore);
+	if(!_decodingDecoderState) {
+		// Resume storing a decoder state that was waiting for a slot
+		DecoderStateData *decoderState = _unstoredDecoderState;
+		_unstoredDecoderState = nullptr;
 
-	return YES;
-}
+		if(!decoderState) {
+			// Dequeue and process the next decoder, preferring one that was decoded ahead of playback
+			id <SFBPCMDecoding> decoder = nil;
+			{
+				std::lock_guard<std::mutex> dequeueLock(_dequeueLock);
+				if(!_lookAheadStates.empty()) {
+					decoderState = _lookAheadStates.front();
+					_lookAheadStates.pop_front();
+				}
+				else {
+					auto queuedDecoder = [self popQueuedDecoder];
+					decoder = queuedDecoder.mDecoder;
+					// Create the decoder state
+					if(decoder) {
+						decoderState = new (std::nothrow) DecoderStateData(decoder, self->_renderingFormat, _bufferingBounds.load().maximumChunkSize, [self currentSampleRateConverterSettings], queuedDecoder.mGain, _peakLimiterEnabled.load());
+						if(decoderState && queuedDecoder.mApplyReplayGain)
+							decoderState->mFlags.fetch_or(DecoderStateData::eReplayGainPendingFlag);
+					}
+				}
+			}
 
-- (void *)decoderThreadEntry
-{
-	os_log_debug(_audioPlayerNodeLog, "Decoder thread starting");
+			// Wait for another decoder to be enqueued, playing audio held back for a crossfade as it is needed
+			if(!decoder && !decoderState) {
+				if(_crossfadeTailDecoderState)
+					return [self flushCrossfade];
+				return SFBAudioDecodingWorkResultWaiting;
+			}
 
-	while(!(_flags.load() & eAudioPlayerNodeFlagStopDecoderThread)) {
-		// Dequeue and process the next decoder
-		id <SFBPCMDecoding> decoder = [self dequeueDecoder];
-		if(decoder) {
-			// Create the decoder state
-			auto decoderState = new (std::nothrow) DecoderStateData(decoder, self->_renderingFormat, kRingBufferChunkSize);
 			if(!decoderState) {
 				os_log_error(_audioPlayerNodeLog, "Unable to allocate decoder state data");
-				if([_delegate respondsToSelector:@selector(audioPlayerNode:encounteredError:)])
-					dispatch_async_and_wait(_notificationQueue, ^{
-						[_delegate audioPlayerNode:self encounteredError:[NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil]];
-					});
-				continue;
+				[self postDecoderEvent:{ eAudioPlayerNodeDecoderEventEncounteredError, nil, [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil], false, 0 }];
+				return SFBAudioDecodingWorkResultReady;
 			}
 
-			// Add the decoder state to the list of active decoders
-			auto stored = false;
-			do {
-				for(size_t i = 0; i < kDecoderStateArraySize; ++i) {
-					auto current = _decoderStateArray[i].load();
-					if(current)
-						continue;
-
-					// In essence _decoderStateArray is an SPSC queue with this thread as producer
-					// and the collector as consumer, with the stored values used in between production
-					// and consumption by any number of other threads/queues including the IOProc.
-					//
-					// Slots in _decoderStateArray are assigned values in two places: here and the
-					// collector. The collector assigns nullptr to slots holding existing non-null
-					// values marked for removal while this code assigns non-null values to slots
-					// holding nullptr.
-					// Since _decoderStateArray[i] was atomically loaded and has been verified not null,
-					// it is safe to use store() instead of compare_exchange_strong() because this is the
-					// only code that could have changed the slot to a non-null value and it is called solely
-					// from the decoding thread.
-					// There is the possibility that a non-null value was collected from the slot and the slot
-					// was assigned nullptr in between load() and the check for null. If this happens the
-					// assignment could have taken place but didn't.
-					//
-					// When _decoderStateArray is full this code either needs to wait for a slot to open up or fail.
-					//
-					// _decoderStateArray may be full when the capacity of _audioRingBuffer exceeds the
-					// total number of audio frames for all the decoders in _decoderStateArray and audio is not
-					// being consumed by the IOProc.
-					// The default frame capacity for _audioRingBuffer is 16384. With 8 slots available in
-					// _decoderStateArray, the average number of frames a decoder needs to contain for
-					// all slots to be full is 2048. For audio at 8000 Hz that equates to 0.26 sec and at
-					// 44,100 Hz 2048 frames equates to 0.05 sec.
-					// This code elects to wait for a slot to open up instead of failing.
-					// This isn't a concern in practice since the main use case for this class is music, not
-					// sequential buffers of 0.05 sec. In normal use it's expected that slots 0 and 1 will
-					// be the only ones used.
-					_decoderStateArray[i].store(decoderState);
-					stored = true;
-					break;
+			if(decoderState->mStagingBuffer) {
+				// Wait for the look-ahead thread to finish with the decoder state
+				{
+					std::lock_guard<std::mutex> stagingLock(decoderState->mStagingLock);
 				}
+				dispatch_semaphore_signal(_lookAheadSemaphore);
+				os_log_debug(_audioPlayerNodeLog, "Splicing %u frames decoded ahead of playback", decoderState->mStagingBuffer->FramesAvailableToRead());
+			}
+		}
 
-				if(!stored) {
-					os_log_debug(_audioPlayerNodeLog, "No open slots in _decoderStateArray");
-					struct timespec sleepyTime = {
-						.tv_sec = 0,
-						.tv_nsec = NSEC_PER_SEC / 20
-					};
-					nanosleep(&sleepyTime, nullptr);
-				}
-			} while(!stored);
+		// Add the decoder state to the list of active decoders
+		//
+		// _decoderStates may be full when the capacity of _audioRingBuffer exceeds the total number of audio frames
+		// for all the decoders in _decoderStates and audio is not being consumed by the render block.
+		// This code elects to wait for the collector to remove a decoder state instead of failing.
+		// This isn't a concern in practice since the main use case for this class is music, not
+		// sequential buffers of a few milliseconds. In normal use it's expected that only two decoder states
+		// will be present.
+		auto stored = false;
+		do {
+			stored = [self insertDecoderState:decoderState];
+			// Request a wakeup from the collector when space becomes available, trying once more
+			// before waiting in case a decoder state was removed in the interim
+		} while(!stored && !(_flags.fetch_or(eAudioPlayerNodeFlagDecoderNeedsSlot) & eAudioPlayerNodeFlagDecoderNeedsSlot));
+
+		if(!stored) {
+			os_log_debug(_audioPlayerNodeLog, "No space in _decoderStates");
+			_unstoredDecoderState = decoderState;
+			return SFBAudioDecodingWorkResultWaiting;
+		}
 
-			// In the event the render block output format and decoder processing
-			// format don't match, conversion will be performed in DecoderStateData::DecodeAudio()
+		_flags.fetch_and(~eAudioPlayerNodeFlagDecoderNeedsSlot);
 
-			os_log_debug(_audioPlayerNodeLog, "Dequeued decoder for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
-			os_log_debug(_audioPlayerNodeLog, "Processing format: %{public}@", decoderState->mDecoder.processingFormat);
+		// In the event the render block output format and decoder processing
+		// format don't match, conversion will be performed in DecoderStateData::DecodeAudio()
 
-			AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:self->_renderingFormat frameCapacity:kRingBufferChunkSize];
+		os_log_debug(_audioPlayerNodeLog, "Dequeued decoder for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
+		os_log_debug(_audioPlayerNodeLog, "Processing format: %{public}@", decoderState->mDecoder.processingFormat);
 
-			while(!(_flags.load() & eAudioPlayerNodeFlagStopDecoderThread)) {
-				// If a seek is pending reset the ring buffer
-				if(decoderState->mFrameToSeek.load() != kInvalidFramePosition)
-					_flags.fetch_or(eAudioPlayerNodeFlagRingBufferNeedsReset);
+		// Decoding performance is measured separately for each decoder
+		_bufferingController.DecoderChanged(decoderState->mOutputFormat.sampleRate);
 
-				// Reset the ring buffer if required, to prevent audible artifacts
-				if(_flags.load() & eAudioPlayerNodeFlagRingBufferNeedsReset) {
-					_flags.fetch_and(~eAudioPlayerNodeFlagRingBufferNeedsReset);
+		// Reading gain information may require I/O so it is performed outside _dequeueLock
+		[self resolveReplayGainForDecoderState:decoderState];
 
-					// Ensure output is muted before performing operations that aren't thread safe
-					if(self.engine.isRunning) {
-						_flags.fetch_or(eAudioPlayerNodeFlagMuteRequested);
+		_decodingDecoderState = decoderState;
+		_playbackSnapshotGeneration.fetch_add(1);
+	}
 
-						// The rendering thread will clear eAudioPlayerFlagRequestMute when the current render cycle completes
-						while(_flags.load() & eAudioPlayerNodeFlagMuteRequested)
-							dispatch_semaphore_wait(_decodingSemaphore, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC / 100));
-					}
-					else
-						_flags.fetch_or(eAudioPlayerNodeFlagOutputIsMuted);
+	DecoderStateData *decoderState = _decodingDecoderState;
 
-					// Perform seek if one is pending
-					if(decoderState->mFrameToSeek.load() != kInvalidFramePosition)
-						decoderState->PerformSeek();
+	// Apply any changes to the buffering bounds
+	if(_flags.fetch_and(~eAudioPlayerNodeFlagBufferingBoundsChanged) & eAudioPlayerNodeFlagBufferingBoundsChanged)
+		_bufferingController.SetBounds(_bufferingBounds.load());
 
-					// Reset() is not thread safe but the rendering thread is outputting silence
-					_audioRingBuffer.Reset();
+	// Allow additional headroom after an underrun
+	auto currentUnderrunCount = _underrunCount.load();
+	if(currentUnderrunCount > _observedUnderrunCount)
+		_bufferingController.UnderrunOccurred();
+	_observedUnderrunCount = currentUnderrunCount;
 
-					// Clear the mute flag
-					_flags.fetch_and(~eAudioPlayerNodeFlagOutputIsMuted);
-				}
+	// Decoder state created by the look-ahead thread may have a smaller decode buffer
+	auto chunkSize = std::min(_bufferingController.ChunkSize(), decoderState->DecodeBufferCapacity());
+	auto decodingThreshold = _bufferingController.FillTarget() - chunkSize;
+	_decodingThreshold.store(decodingThreshold);
 
-				// Determine how many frames are available in the ring buffer
-				auto framesAvailableToWrite = _audioRingBuffer.FramesAvailableToWrite();
+	// Nothing may be written while the render block switches to a staged seek
+	if(_flags.load() & eAudioPlayerNodeFlagSeekBufferReady) {
+		const bool abandonStagedSeek = (_flags.load() & (eAudioPlayerNodeFlagRingBufferNeedsReset | eAudioPlayerNodeFlagIsPlaying)) != eAudioPlayerNodeFlagIsPlaying || (decoderState->mFlags.load() & DecoderStateData::eCancelDecodingFlag) || !self.engine.isRunning;
+		if(!abandonStagedSeek)
+			return SFBAudioDecodingWorkResultWaiting;
 
-				// Force writes to the ring buffer to be at least kRingBufferChunkSize
-				if(framesAvailableToWrite >= kRingBufferChunkSize && !(decoderState->mFlags.load() & DecoderStateData::eCancelDecodingFlag)) {
-					if(!(decoderState->mFlags.load() & DecoderStateData::eDecodingStartedFlag)) {
-						os_log_debug(_audioPlayerNodeLog, "Decoding started for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
+		// The seek is performed again after a ring buffer reset if the render block didn't switch to it
+		if(_flags.fetch_and(~eAudioPlayerNodeFlagSeekBufferReady) & eAudioPlayerNodeFlagSeekBufferReady)
+			_flags.fetch_or(eAudioPlayerNodeFlagRingBufferNeedsReset);
+	}
 
-						decoderState->mFlags.fetch_or(DecoderStateData::eDecodingStartedFlag);
+	// If a seek is pending stage audio at the target so playback continues until the render block switches to it,
+	// or reset the ring buffer if that isn't possible
+	// Audio is staged for the most recent target only, so repeated seeks are coalesced
+	// Seeks requested while scrubbing are played as grains, and the seek requested when scrubbing ends is performed afterward
+	if(decoderState->mFrameToSeek.load() != kInvalidFramePosition && !(_flags.load() & (eAudioPlayerNodeFlagSeekBufferActive | eAudioPlayerNodeFlagScrubbing))) {
+		if([self canStageSeekForDecoderState:decoderState])
+			return [self stageSeekForDecoderState:decoderState chunkSize:chunkSize];
+		_flags.fetch_or(eAudioPlayerNodeFlagRingBufferNeedsReset);
+	}
 
-						// Perform the decoding started notification
-						if([_delegate respondsToSelector:@selector(audioPlayerNode:decodingStarted:)])
-							dispatch_async_and_wait(_notificationQueue, ^{
-								[_delegate audioPlayerNode:self decodingStarted:decoderState->mDecoder];
-							});
-					}
+	// Reset the ring buffer if required, to prevent audible artifacts
+	if(_awaitingMute || (_flags.load() & eAudioPlayerNodeFlagRingBufferNeedsReset)) {
+		if(!_awaitingMute)
+			_flags.fetch_and(~eAudioPlayerNodeFlagRingBufferNeedsReset);
+
+		// Ensure output is muted before performing operations that aren't thread safe
+		if(![self muteOutput])
+			return SFBAudioDecodingWorkResultWaiting;
+
+		// Audio from a preceding decoder held back for a crossfade or in the ring buffer is discarded along with
+		// the ring buffer contents
+		DecoderStateData *crossfadeTailDecoderState = _crossfadeTailDecoderState != decoderState ? _crossfadeTailDecoderState : nullptr;
+		[self discardCrossfade];
+		if(crossfadeTailDecoderState) {
+			crossfadeTailDecoderState->mCrossfadeStartFrame.store(kInvalidFramePosition);
+			crossfadeTailDecoderState->mFramesConverted.store(crossfadeTailDecoderState->mFramesRendered.load());
+		}
 
-					// Decode audio into the buffer, converting to the bus format in the process
-					NSError *error = nil;
-					if(!decoderState->DecodeAudio(buffer, &error)) {
-						os_log_error(_audioPlayerNodeLog, "Error decoding audio: %{public}@", error);
-						if(error && [_delegate respondsToSelector:@selector(audioPlayerNode:encounteredError:)])
-							dispatch_async_and_wait(_notificationQueue, ^{
-								[_delegate audioPlayerNode:self encounteredError:error];
-							});
-					}
+		// Perform seek if one is pending
+		AVAudioFramePosition seekFrame = kInvalidFramePosition;
+		if(decoderState->mFrameToSeek.load() != kInvalidFramePosition)
+			seekFrame = decoderState->PerformSeek();
 
-					// Write the decoded audio to the ring buffer for rendering
-					auto framesWritten = _audioRingBuffer.Write(buffer.audioBufferList, buffer.frameLength);
-					if(framesWritten != buffer.frameLength)
-						os_log_error(_audioPlayerNodeLog, "SFB::Audio::RingBuffer::Write() failed");
+		// Reset() is not thread safe but the rendering thread is outputting silence
+		_audioRingBuffer.Reset();
 
-					if(decoderState->mFlags.load() & DecoderStateData::eDecodingCompleteFlag) {
-						// Some formats (MP3) may not know the exact number of frames in advance
-						// without processing the entire file, which is a potentially slow operation
-						decoderState->mFrameLength.store(decoderState->mDecoder.frameLength);
+		// Discard any staged seek, which was superseded by the seek performed above if one was pending
+		_seekBuffer.Reset();
+		_flags.fetch_and(~(eAudioPlayerNodeFlagSeekStaging | eAudioPlayerNodeFlagSeekBufferReady | eAudioPlayerNodeFlagSeekBufferActive));
 
-						// Perform the decoding complete notification
-						if([_delegate respondsToSelector:@selector(audioPlayerNode:decodingComplete:)])
-							dispatch_async_and_wait(_notificationQueue, ^{
-								[_delegate audioPlayerNode:self decodingComplete:decoderState->mDecoder];
-							});
+		// The rendering thread reports the reset and the frame at which the seek landed
+		_resetSeekSequenceNumber.store(decoderState->mSequenceNumber);
+		_resetSeekFrame.store(seekFrame);
+		_flags.fetch_or(eAudioPlayerNodeFlagRingBufferWasReset);
 
-						os_log_debug(_audioPlayerNodeLog, "Decoding complete for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
+		// The ring buffer is empty until the next write so this isn't considered an underrun
+		_flags.fetch_or(eAudioPlayerNodeFlagRingBufferPriming);
 
-						break;
-					}
-				}
-				else if(decoderState->mFlags.load() & DecoderStateData::eCancelDecodingFlag) {
-					os_log_debug(_audioPlayerNodeLog, "Canceling decoding for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
+		// The seek changed the playback position
+		_playbackSnapshotGeneration.fetch_add(1);
+
+		// Clear the mute flag
+		_flags.fetch_and(~eAudioPlayerNodeFlagOutputIsMuted);
+	}
 
-					BOOL partiallyRendered = (decoderState->mFlags.load() & DecoderStateData::eRenderingStartedFlag) ? YES : NO;
-					id<SFBPCMDecoding> canceledDecoder = decoderState->mDecoder;
+	// While scrubbing decode grains at the most recent seek target instead of decoding continuously
+	if(_flags.load() & eAudioPlayerNodeFlagScrubbing)
+		return [self decodeScrubGrainFromDecoderState:decoderState];
 
-					_flags.fetch_or(eAudioPlayerNodeFlagRingBufferNeedsReset);
-					decoderState->mFlags.fetch_or(DecoderStateData::eMarkedForRemovalFlag);
-					dispatch_source_merge_data(_collector, 1);
+	// Determine how many frames are buffered for rendering
+	auto fillLevel = static_cast<AVAudioFrameCount>(_audioRingBuffer.FramesAvailableToRead());
 
-					// Perform the decoding cancelled notification
-					if([_delegate respondsToSelector:@selector(audioPlayerNode:decodingCanceled:partiallyRendered:)])
-						dispatch_async_and_wait(_notificationQueue, ^{
-							[_delegate audioPlayerNode:self decodingCanceled:canceledDecoder partiallyRendered:partiallyRendered];
-						});
+	// Keep the ring buffer filled to the fill target, writing a full chunk at a time
+	if(fillLevel <= decodingThreshold && !(decoderState->mFlags.load() & DecoderStateData::eCancelDecodingFlag)) {
+		if(!(decoderState->mFlags.load() & DecoderStateData::eDecodingStartedFlag)) {
+			os_log_debug(_audioPlayerNodeLog, "Decoding started for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
 
-					break;
-				}
-				// Wait for additional space in the ring buffer
-				else
-					dispatch_semaphore_wait(_decodingSemaphore, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC / 10));
+			decoderState->mFlags.fetch_or(DecoderStateData::eDecodingStartedFlag);
+
+			// Perform the decoding started notification
+			[self postDecoderEvent:{ eAudioPlayerNodeDecoderEventDecodingStarted, decoderState->mDecoder, nil, false, 0 }];
+		}
+
+		// Splice in any audio decoded ahead of playback before decoding directly
+		if(decoderState->HasStagedAudio()) {
+			AVAudioFrameCount framesWritten = 0;
+			[self bufferAudioFromDecoderState:decoderState chunkSize:chunkSize framesWritten:&framesWritten error:nil];
+		}
+		else if(!(decoderState->mFlags.load() & DecoderStateData::eDecodingCompleteFlag)) {
+			// Decode audio into the ring buffer, converting to the bus format in the process
+			NSError *error = nil;
+			AVAudioFrameCount framesWritten = 0;
+			auto decodeStartTime = mach_absolute_time();
+			if([self bufferAudioFromDecoderState:decoderState chunkSize:chunkSize framesWritten:&framesWritten error:&error]) {
+				// Stalls only endanger playback when rendering
+				auto decodeTime = ConvertHostTicksToNanos(mach_absolute_time() - decodeStartTime);
+				_bufferingController.DecodeCompleted(framesWritten, decodeTime, (_flags.load() & eAudioPlayerNodeFlagIsPlaying) ? fillLevel : 0);
+			}
+			else {
+				os_log_error(_audioPlayerNodeLog, "Error decoding audio: %{public}@", error);
+				if(error)
+					[self postDecoderEvent:{ eAudioPlayerNodeDecoderEventEncounteredError, decoderState->mDecoder, error, false, 0 }];
 			}
 		}
-		// Wait for another decoder to be enqueued
-		else
-			dispatch_semaphore_wait(_decodingSemaphore, dispatch_time(DISPATCH_TIME_NOW, NSEC_PER_SEC * 5));
+
+		_flags.fetch_and(~eAudioPlayerNodeFlagRingBufferPriming);
+
+		if(decoderState->IsDecodingComplete()) {
+			// Grains are decoded from decoderState while scrubbing so it remains the decoder state being decoded
+			if(_flags.load() & eAudioPlayerNodeFlagScrubbing)
+				return SFBAudioDecodingWorkResultReady;
+
+			// Some formats (MP3) may not know the exact number of frames in advance
+			// without processing the entire file, which is a potentially slow operation
+			decoderState->mFrameLength.store(decoderState->mDecoder.frameLength);
+			_playbackSnapshotGeneration.fetch_add(1);
+
+			// Perform the decoding complete notification
+			[self postDecoderEvent:{ eAudioPlayerNodeDecoderEventDecodingComplete, decoderState->mDecoder, nil, false, 0 }];
+
+			os_log_debug(_audioPlayerNodeLog, "Decoding complete for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
+
+			_decodingDecoderState = nullptr;
+		}
+
+		return SFBAudioDecodingWorkResultReady;
 	}
+	else if(decoderState->mFlags.load() & DecoderStateData::eCancelDecodingFlag) {
+		os_log_debug(_audioPlayerNodeLog, "Canceling decoding for \"%{public}@\"", [[NSFileManager defaultManager] displayNameAtPath:decoderState->mDecoder.inputSource.url.path]);
 
-	os_log_debug(_audioPlayerNodeLog, "Decoder thread terminating");
+		BOOL partiallyRendered = (decoderState->mFlags.load() & DecoderStateData::eRenderingStartedFlag) ? YES : NO;
+		id<SFBPCMDecoding> canceledDecoder = decoderState->mDecoder;
+
+		_decodingDecoderState = nullptr;
+
+		// Audio held back for a crossfade is discarded with the ring buffer contents
+		// A crossfade into decoderState continues after the ring buffer reset so it must be stopped now
+		if(_crossfadeTailDecoderState == decoderState)
+			[self discardCrossfade];
+		else if(_crossfadeHeadDecoderState == decoderState)
+			_crossfadeHeadDecoderState = nullptr;
+
+		_flags.fetch_or(eAudioPlayerNodeFlagRingBufferNeedsReset);
+		decoderState->mFlags.fetch_or(DecoderStateData::eMarkedForRemovalFlag);
+		_playbackSnapshotGeneration.fetch_add(1);
+		dispatch_source_merge_data(_collector, 1);
+
+		// Perform the decoding cancelled notification
+		[self postDecoderEvent:{ eAudioPlayerNodeDecoderEventDecodingCanceled, canceledDecoder, nil, partiallyRendered == YES, 0 }];
+
+		return SFBAudioDecodingWorkResultReady;
+	}
+
+	// Wait for additional space in the ring buffer
+	// The render block clears eAudioPlayerNodeFlagDecoderNeedsSpace and requests decoding once a chunk can be written
+	_flags.fetch_or(eAudioPlayerNodeFlagDecoderNeedsSpace);
+	if(_audioRingBuffer.FramesAvailableToRead() <= decodingThreshold) {
+		_flags.fetch_and(~eAudioPlayerNodeFlagDecoderNeedsSpace);
+		return SFBAudioDecodingWorkResultReady;
+	}
+
+	return SFBAudioDecodingWorkResultWaiting;
+}
+
+- (void *)lookAheadThreadEntry
+{
+	os_log_debug(_audioPlayerNodeLog, "Look-ahead thread starting");
+
+	while(!(_flags.load() & eAudioPlayerNodeFlagStopDecoderThread)) {
+		// Wait for a decoder to be enqueued, staging buffer space to become available, or the look-ahead depth to change
+		if(![self stageAudioFromQueuedDecoders])
+			dispatch_semaphore_wait(_lookAheadSemaphore, DISPATCH_TIME_FOREVER);
+	}
+
+	os_log_debug(_audioPlayerNodeLog, "Look-ahead thread terminating");
 
 	return nullptr;
 }
 
 @end
+
+@implementation SFBAudioPlayerNode (SFBAudioDecodingExecutorScheduling)
+
+- (BOOL)decodingRequested
+{
+	return (_flags.load() & eAudioPlayerNodeFlagDecodingRequested) ? YES : NO;
+}
+
+- (uint64_t)decodingDeadline
+{
+	// The deadline is the time at which the ring buffer will be exhausted at the current fill level
+	auto timeRemaining = _audioRingBuffer.FramesAvailableToRead() / _renderingFormat.sampleRate;
+	// Nodes that aren't rendering can't underrun so they yield to those that can
+	if(!(_flags.load() & eAudioPlayerNodeFlagIsPlaying))
+		timeRemaining += kIdleDecodingDeadlineDelay;
+	// Audio isn't consumed before a scheduled start
+	const auto now = mach_absolute_time();
+	const auto scheduledStartHostTime = _scheduledStart.HostTime();
+	return std::max(now, scheduledStartHostTime) + ConvertSecondsToHostTicks(timeRemaining);
+}
+
+- (void)recordSchedulingDelay:(uint64_t)schedulingDelay missedDeadline:(BOOL)missedDeadline
+{
+	_scheduledCount.fetch_add(1);
+	_totalSchedulingDelay.fetch_add(schedulingDelay);
+	if(missedDeadline)
+		_missedDeadlineCount.fetch_add(1);
+
+	// Only worker threads update the maximum but more than one may do so concurrently
+	auto maximumSchedulingDelay = _maximumSchedulingDelay.load();
+	while(schedulingDelay > maximumSchedulingDelay && !_maximumSchedulingDelay.compare_exchange_weak(maximumSchedulingDelay, schedulingDelay))
+		;
+}
+
+- (SFBAudioDecodingWorkResult)performDecodingWork
+{
+	auto startTime = mach_absolute_time();
+	auto result = [self decodeNextChunk];
+	_decodingTime.fetch_add(mach_absolute_time() - startTime);
+
+	// Request further work so the executor selects this node again, possibly after nodes with earlier deadlines
+	if(result == SFBAudioDecodingWorkResultReady)
+		_flags.fetch_or(eAudioPlayerNodeFlagDecodingRequested);
+	// Nothing more can be buffered for a scheduled start
+	else
+		_scheduledStart.PrefillComplete();
+
+	return result;
+}
+
+@end
@@ -50,6 +50,29 @@ extension AudioPlayerNode {
 		}
 		return (position: PlaybackPosition(position), time: PlaybackTime(time))
 	}
+
+	/// Returns the most recently published output levels for each metered channel or `nil` if none are available
+	public var meterLevels: [SFBAudioPlayerNodeChannelLevels]? {
+		var levels = [SFBAudioPlayerNodeChannelLevels](repeating: SFBAudioPlayerNodeChannelLevels(), count: Int(outputFormat(forBus: 0).channelCount))
+		let channelCount = __getMeterLevels(&levels, channelCount: AVAudioChannelCount(levels.count), hostTime: nil)
+		guard channelCount > 0 else {
+			return nil
+		}
+		return Array(levels.prefix(Int(channelCount)))
+	}
+
+	/// Returns the most recent magnitude spectrum with a host time at or before `hostTime` and the host time at which
+	/// the center of its window is output, or `nil` if none is available
+	/// - parameter hostTime: The host time of interest or `0` for the most recent spectrum
+	public func spectrum(at hostTime: UInt64 = 0) -> (magnitudes: [Float], hostTime: UInt64)? {
+		var magnitudes = [Float](repeating: 0, count: spectrumAnalysisFFTSize / 2 + 1)
+		var spectrumHostTime: UInt64 = 0
+		let count = __getSpectrum(&magnitudes, count: magnitudes.count, atHostTime: hostTime, spectrumHostTime: &spectrumHostTime)
+		guard count > 0 else {
+			return nil
+		}
+		return (magnitudes: Array(magnitudes.prefix(count)), hostTime: spectrumHostTime)
+	}
 }
 
 extension AudioPlayerNode.PlaybackPosition {
@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <Foundation/Foundation.h>
+#import <AVFoundation/AVFoundation.h>
+
+#import <SFBAudioEngine/SFBPCMDecoding.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol SFBAudioVoicePoolNodeDelegate;
+
+/// An identifier for a voice played by \c SFBAudioVoicePoolNode
+typedef uint64_t SFBAudioVoiceIdentifier NS_SWIFT_NAME(AudioVoiceIdentifier);
+
+/// The identifier returned when a voice could not be started
+extern const SFBAudioVoiceIdentifier SFBAudioVoiceIdentifierInvalid NS_SWIFT_NAME(invalidAudioVoiceIdentifier);
+
+/// Policies for choosing a voice to stop when a voice is started and all voices are in use
+typedef NS_ENUM(NSUInteger, SFBAudioVoicePoolNodeStealingPolicy) {
+	/// No voice is stopped and the new voice is not started
+	SFBAudioVoicePoolNodeStealingPolicyNone		= 0,
+	/// The voice started least recently is stopped
+	SFBAudioVoicePoolNodeStealingPolicyOldest	= 1,
+	/// The voice with the lowest gain is stopped
+	SFBAudioVoicePoolNodeStealingPolicyQuietest	= 2
+} NS_SWIFT_NAME(AudioVoicePoolNode.StealingPolicy);
+
+/// Statistics for \c SFBAudioVoicePoolNode
+struct SFBAudioVoicePoolNodeStatistics {
+	/// The number of voices started
+	uint64_t startedVoiceCount;
+	/// The number of voices stopped to start another voice
+	uint64_t stolenVoiceCount;
+	/// The number of render cycles in which a streaming voice had insufficient audio available
+	uint64_t underrunCount;
+};
+typedef struct SFBAudioVoicePoolNodeStatistics SFBAudioVoicePoolNodeStatistics;
+
+/// An \c AVAudioSourceNode mixing many simultaneous voices
+///
+/// Each voice plays either a PCM buffer or the audio supplied by a decoder. All voices are mixed in the render block,
+/// so a single node and render callback serve any number of simultaneous sounds. Buffer voices are mixed directly from
+/// the buffer while streaming voices are mixed from a small per-voice ring buffer that one decoding thread shared by
+/// all voices keeps filled. The render block performs no allocations, locking, or Objective-C messaging.
+///
+/// Voices may be started and stopped at a specific host time with sample accuracy. Gain and pan changes are applied
+/// with a linear ramp over one render cycle to avoid discontinuities.
+///
+/// Pan is applied only when the rendering format has two channels. Mono voices are panned with an equal power law and
+/// stereo voices are balanced.
+NS_SWIFT_NAME(AudioVoicePoolNode) @interface SFBAudioVoicePoolNode : AVAudioSourceNode
+
+/// Returns an initialized \c SFBAudioVoicePoolNode object for 64 stereo voices at 44,100 Hz
+- (instancetype)init;
+/// Returns an initialized \c SFBAudioVoicePoolNode object
+/// @note \c format must be standard
+/// @param format The format supplied by the render block
+/// @param voiceCount The maximum number of simultaneous voices, from \c 1 to \c 1024
+/// @return An initialized \c SFBAudioVoicePoolNode object or \c nil if memory or resource allocation failed
+- (nullable instancetype)initWithFormat:(AVAudioFormat *)format voiceCount:(NSUInteger)voiceCount NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)initWithRenderBlock:(AVAudioSourceNodeRenderBlock)block NS_UNAVAILABLE;
+- (instancetype)initWithFormat:(AVAudioFormat *)format renderBlock:(AVAudioSourceNodeRenderBlock)block NS_UNAVAILABLE;
+
+#pragma mark - Format Information
+
+/// Returns the format supplied by this object's render block
+@property (nonatomic, readonly) AVAudioFormat * renderingFormat;
+/// Returns the maximum number of simultaneous voices
+@property (nonatomic, readonly) NSUInteger voiceCount;
+
+/// Returns \c YES if audio with \c format can be played
+/// @param format A format to test for support
+/// @return \c YES if \c format has the same sample rate as the rendering format and either one channel or the same
+/// number of channels as the rendering format
+- (BOOL)supportsFormat:(AVAudioFormat *)format;
+
+#pragma mark - Voice Management
+
+/// The policy used to choose a voice to stop when all voices are in use
+/// @note The default value is \c SFBAudioVoicePoolNodeStealingPolicyOldest
+@property (nonatomic) SFBAudioVoicePoolNodeStealingPolicy stealingPolicy;
+
+/// Starts a voice playing \c buffer as soon as possible with unity gain and centered pan
+/// @param buffer The buffer to play
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return The identifier of the voice or \c SFBAudioVoiceIdentifierInvalid on error
+- (SFBAudioVoiceIdentifier)playBuffer:(AVAudioPCMBuffer *)buffer error:(NSError **)error NS_SWIFT_NAME(play(_:));
+/// Starts a voice playing \c buffer
+/// @note The contents of \c buffer must not be modified while the voice is playing
+/// @param buffer A standard format buffer to play
+/// @param gain The linear gain of the voice
+/// @param pan The pan position of the voice from \c -1 (left) to \c 1 (right)
+/// @param hostTime The host time at which the first frame of \c buffer is rendered or \c 0 for as soon as possible
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return The identifier of the voice or \c SFBAudioVoiceIdentifierInvalid on error
+- (SFBAudioVoiceIdentifier)playBuffer:(AVAudioPCMBuffer *)buffer gain:(float)gain pan:(float)pan atHostTime:(uint64_t)hostTime error:(NSError **)error NS_SWIFT_NAME(play(_:gain:pan:atHostTime:));
+
+/// Starts a voice playing the audio supplied by \c decoder as soon as possible with unity gain and centered pan
+/// @param decoder The decoder supplying the audio to play
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return The identifier of the voice or \c SFBAudioVoiceIdentifierInvalid on error
+- (SFBAudioVoiceIdentifier)playDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error NS_SWIFT_NAME(play(_:));
+/// Starts a voice playing the audio supplied by \c decoder
+///
+/// \c decoder is opened if necessary and the voice's ring buffer is filled before this method returns.
+/// @note \c decoder must not be used by the caller while the voice is playing
+/// @param decoder The decoder supplying the audio to play
+/// @param gain The linear gain of the voice
+/// @param pan The pan position of the voice from \c -1 (left) to \c 1 (right)
+/// @param hostTime The host time at which the first frame of audio is rendered or \c 0 for as soon as possible
+/// @param error An optional pointer to an \c NSError object to receive error information
+/// @return The identifier of the voice or \c SFBAudioVoiceIdentifierInvalid on error
+- (SFBAudioVoiceIdentifier)playDecoder:(id <SFBPCMDecoding>)decoder gain:(float)gain pan:(float)pan atHostTime:(uint64_t)hostTime error:(NSError **)error NS_SWIFT_NAME(play(_:gain:pan:atHostTime:));
+
+/// Changes the gain and pan of a voice
+/// @note This method has no effect if \c voice is not playing
+/// @param gain The linear gain of the voice
+/// @param pan The pan position of the voice from \c -1 (left) to \c 1 (right)
+/// @param voice The identifier of the voice
+- (void)setGain:(float)gain pan:(float)pan forVoice:(SFBAudioVoiceIdentifier)voice NS_SWIFT_NAME(setGain(_:pan:for:));
+
+/// Stops a voice as soon as possible
+/// @param voice The identifier of the voice
+- (void)stopVoice:(SFBAudioVoiceIdentifier)voice NS_SWIFT_NAME(stop(_:));
+/// Stops a voice
+/// @param voice The identifier of the voice
+/// @param hostTime The host time at which rendering of the voice stops or \c 0 for as soon as possible
+- (void)stopVoice:(SFBAudioVoiceIdentifier)voice atHostTime:(uint64_t)hostTime NS_SWIFT_NAME(stop(_:atHostTime:));
+/// Stops all voices as soon as possible
+- (void)stopAllVoices;
+
+/// Returns \c YES if \c voice has been started and has not finished
+- (BOOL)voiceIsPlaying:(SFBAudioVoiceIdentifier)voice NS_SWIFT_NAME(isPlaying(_:));
+/// Returns the number of voices that have been started and have not finished
+@property (nonatomic, readonly) NSUInteger activeVoiceCount;
+
+#pragma mark - Statistics
+
+/// Returns a snapshot of the voice statistics
+@property (nonatomic, readonly) SFBAudioVoicePoolNodeStatistics statistics;
+
+#pragma mark - Delegate
+
+/// An optional delegate
+@property (nonatomic, nullable, weak) id<SFBAudioVoicePoolNodeDelegate> delegate;
+
+@end
+
+#pragma mark - Delegate Methods
+
+/// Delegate methods supported by \c SFBAudioVoicePoolNode
+NS_SWIFT_NAME(AudioVoicePoolNode.Delegate) @protocol SFBAudioVoicePoolNodeDelegate <NSObject>
+@optional
+/// Called to notify the delegate when a voice finishes playing
+/// @warning Do not change any properties of \c audioVoicePoolNode from this method
+/// @param audioVoicePoolNode The \c SFBAudioVoicePoolNode object
+/// @param voice The identifier of the voice that finished
+- (void)audioVoicePoolNode:(SFBAudioVoicePoolNode *)audioVoicePoolNode voiceFinished:(SFBAudioVoiceIdentifier)voice NS_SWIFT_NAME(audioVoicePoolNode(_:voiceFinished:));
+@end
+
+#pragma mark - Error Information
+
+/// The \c NSErrorDomain used by \c SFBAudioVoicePoolNode
+extern NSErrorDomain const SFBAudioVoicePoolNodeErrorDomain NS_SWIFT_NAME(AudioVoicePoolNode.ErrorDomain);
+
+/// Possible \c NSError error codes used by \c SFBAudioVoicePoolNode
+typedef NS_ERROR_ENUM(SFBAudioVoicePoolNodeErrorDomain, SFBAudioVoicePoolNodeErrorCode) {
+	/// Format not supported
+	SFBAudioVoicePoolNodeErrorFormatNotSupported	= 0,
+	/// All voices are in use
+	SFBAudioVoicePoolNodeErrorNoVoiceAvailable		= 1,
+	/// Too many voice requests are waiting to be processed by the render block
+	SFBAudioVoicePoolNodeErrorCommandQueueFull		= 2
+} NS_SWIFT_NAME(AudioVoicePoolNode.ErrorCode);
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,961 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <algorithm>
+#import <atomic>
+#import <cmath>
+#import <cstdlib>
+#import <memory>
+#import <mutex>
+#import <thread>
+#import <utility>
+#import <vector>
+
+#import <Accelerate/Accelerate.h>
+#import <mach/mach_time.h>
+#import <os/log.h>
+
+#import "SFBAudioVoicePoolNode.h"
+
+#import "SFBPCMConverter.hpp"
+#import "SFBPCMRingBuffer.hpp"
+#import "SFBSPSCQueue.hpp"
+
+#import "NSError+SFBURLPresentation.h"
+
+const SFBAudioVoiceIdentifier SFBAudioVoiceIdentifierInvalid = 0;
+NSErrorDomain const SFBAudioVoicePoolNodeErrorDomain = @"org.sbooth.AudioEngine.AudioVoicePoolNode";
+
+@interface SFBAudioVoicePoolNode ()
+- (void *)decodingThreadEntry;
+- (void)processVoiceEvents;
+@end
+
+namespace {
+
+os_log_t _audioVoicePoolNodeLog = os_log_create("org.sbooth.AudioEngine", "AudioVoicePoolNode");
+
+#pragma mark - Constants
+
+const NSUInteger 			kDefaultVoiceCount 					= 64;
+const NSUInteger 			kMaximumVoiceCount 					= 1024;
+const size_t 				kCommandQueueCapacity 				= 1024;
+const size_t 				kVoiceEventQueueCapacity 			= 4096;
+const AVAudioFrameCount 	kStreamingRingBufferFrameCapacity 	= 8192;
+const AVAudioFrameCount 	kStreamingChunkSize 				= 2048;
+
+#pragma mark - Thread entry point
+
+void * DecodingThreadEntry(void *arg)
+{
+	pthread_setname_np("org.sbooth.AudioEngine.AudioVoicePoolNode.DecodingThread");
+	pthread_set_qos_class_self_np(QOS_CLASS_USER_INITIATED, 0);
+
+	SFBAudioVoicePoolNode *voicePoolNode = (__bridge SFBAudioVoicePoolNode *)arg;
+	return [voicePoolNode decodingThreadEntry];
+}
+
+#pragma mark - Buffer Lists
+
+/// Deleter for \c AudioBufferList objects allocated with \c std::calloc
+struct BufferListDeleter {
+	void operator()(AudioBufferList *bufferList) const noexcept
+	{
+		std::free(bufferList);
+	}
+};
+
+using unique_buffer_list_ptr = std::unique_ptr<AudioBufferList, BufferListDeleter>;
+
+/// Returns an \c AudioBufferList with \c bufferCount empty buffers or \c nullptr on error
+unique_buffer_list_ptr AllocateBufferList(UInt32 bufferCount) noexcept
+{
+	auto bufferList = static_cast<AudioBufferList *>(std::calloc(1, offsetof(AudioBufferList, mBuffers) + (sizeof(AudioBuffer) * std::max(bufferCount, 1u))));
+	if(bufferList)
+		bufferList->mNumberBuffers = bufferCount;
+	return unique_buffer_list_ptr(bufferList);
+}
+
+#pragma mark - Time Utilities
+
+double HostTicksPerNano()
+{
+	mach_timebase_info_data_t timebase_info;
+	auto result = mach_timebase_info(&timebase_info);
+	assert(result == KERN_SUCCESS);
+	return static_cast<double>(timebase_info.numer) / static_cast<double>(timebase_info.denom);
+}
+
+const double kHostTicksPerNano = HostTicksPerNano();
+
+inline double ConvertHostTicksToNanos(uint64_t t) noexcept
+{
+	return static_cast<double>(t) * kHostTicksPerNano;
+}
+
+#pragma mark - Voice Sources
+
+/// The audio played by a voice
+///
+/// Sources are created when a voice is started and destroyed once neither the render block nor the decoding thread
+/// refers to them.
+struct VoiceSource
+{
+	/// \c true if audio is supplied by \c mDecoder, \c false if by \c mBuffer
+	bool mIsStreaming;
+	/// The number of channels of audio
+	AVAudioChannelCount mChannelCount;
+
+	/// The buffer for a buffer voice
+	AVAudioPCMBuffer *mBuffer;
+	/// The buffer list of \c mBuffer, cached for the render block
+	const AudioBufferList *mBufferList;
+	/// The number of frames in \c mBuffer
+	AVAudioFrameCount mFrameLength;
+
+	/// The decoder for a streaming voice
+	id <SFBPCMDecoding> mDecoder;
+	/// The buffer receiving audio from \c mDecoder
+	AVAudioPCMBuffer *mDecodeBuffer;
+	/// Converts audio from \c mDecodeBuffer to deinterleaved 32-bit floating point
+	SFB::PCMConverter mConverter;
+	/// Converted audio waiting to be mixed
+	SFB::PCMRingBuffer mRingBuffer;
+	/// Buffer list used by the decoding thread to write to \c mRingBuffer
+	unique_buffer_list_ptr mWriteBufferList;
+	/// Buffer list used by the render block to read from \c mRingBuffer
+	unique_buffer_list_ptr mReadBufferList;
+	/// Set when \c mDecoder has no more audio
+	std::atomic_bool mDecodingFinished;
+	/// Set when the voice no longer requires audio
+	std::atomic_bool mDecodingCanceled;
+};
+
+/// Decodes audio into the ring buffer of \c source until it is full or decoding is finished
+void FillRingBuffer(VoiceSource& source) noexcept
+{
+	while(!source.mDecodingCanceled.load() && !source.mDecodingFinished.load()) {
+		auto writeVector = source.mRingBuffer.GetWriteVector();
+		const auto frameLength = std::min(writeVector.mFirst.mFrameCount, kStreamingChunkSize);
+		if(frameLength == 0)
+			break;
+
+		NSError *error = nil;
+		if(![source.mDecoder decodeIntoBuffer:source.mDecodeBuffer frameLength:frameLength error:&error]) {
+			os_log_error(_audioVoicePoolNodeLog, "Error decoding audio for voice: %{public}@", error);
+			source.mDecodingFinished.store(true);
+			break;
+		}
+
+		const auto framesDecoded = source.mDecodeBuffer.frameLength;
+		if(framesDecoded == 0) {
+			source.mDecodingFinished.store(true);
+			break;
+		}
+
+		if(!source.mRingBuffer.GetBufferList({ writeVector.mFirst.mFrameOffset, framesDecoded }, source.mWriteBufferList.get()))
+			break;
+		const auto framesConverted = source.mConverter.Convert(source.mDecodeBuffer.audioBufferList, source.mWriteBufferList.get(), framesDecoded);
+		source.mRingBuffer.CommitWrite(framesConverted);
+	}
+}
+
+#pragma mark - Voices
+
+/// A voice as seen by the render block
+struct Voice
+{
+	/// The identifier of the voice or \c SFBAudioVoiceIdentifierInvalid if idle
+	SFBAudioVoiceIdentifier mIdentifier;
+	/// The source of audio for the voice
+	VoiceSource *mSource;
+	/// The next frame to mix from a buffer voice
+	AVAudioFrameCount mFramePosition;
+	/// The host time at which the voice starts
+	uint64_t mStartHostTime;
+	/// The host time at which the voice stops or \c UINT64_MAX if none
+	uint64_t mStopHostTime;
+	/// \c true once the first frame of the voice has been mixed
+	bool mHasStarted;
+	/// The gains applied to the left and right output channels, or to all output channels using the first value
+	float mGains [2];
+	/// The gains at the end of the next render cycle
+	float mTargetGains [2];
+};
+
+/// Computes the gains applied to each output channel for a voice
+/// @param gains An array of two values to receive the gains
+void ComputeChannelGains(float gain, float pan, AVAudioChannelCount sourceChannelCount, AVAudioChannelCount outputChannelCount, float *gains) noexcept
+{
+	pan = std::min(std::max(pan, -1.f), 1.f);
+	if(outputChannelCount != 2) {
+		gains[0] = gain;
+		gains[1] = gain;
+	}
+	// Mono audio is positioned using an equal power pan law
+	else if(sourceChannelCount == 1) {
+		const auto theta = (pan + 1) * static_cast<float>(M_PI_4);
+		gains[0] = gain * std::cos(theta);
+		gains[1] = gain * std::sin(theta);
+	}
+	// Stereo audio is balanced by attenuating the opposite channel
+	else {
+		gains[0] = gain * std::min(1.f, 1 - pan);
+		gains[1] = gain * std::min(1.f, 1 + pan);
+	}
+}
+
+/// Adds \c frameCount frames from \c source beginning at \c sourceOffset to \c output beginning at \c outputOffset
+///
+/// A mono source is added to every output channel. Gains are ramped linearly and advanced by \c frameCount steps.
+void AccumulateFrames(const AudioBufferList *source, AVAudioFrameCount sourceOffset, AudioBufferList *output, AVAudioFrameCount outputOffset, AVAudioFrameCount frameCount, float *gains, const float *gainSteps) noexcept
+{
+	const auto outputChannelCount = output->mNumberBuffers;
+	for(UInt32 channel = 0; channel < outputChannelCount; ++channel) {
+		const auto gainIndex = outputChannelCount == 2 ? channel : 0;
+		const auto input = static_cast<const float *>(source->mBuffers[source->mNumberBuffers == 1 ? 0 : channel].mData) + sourceOffset;
+		auto destination = static_cast<float *>(output->mBuffers[channel].mData) + outputOffset;
+		float gain = gains[gainIndex];
+		vDSP_vrampmuladd(input, 1, &gain, &gainSteps[gainIndex], destination, 1, frameCount);
+	}
+
+	gains[0] += gainSteps[0] * frameCount;
+	gains[1] += gainSteps[1] * frameCount;
+}
+
+/// Mixes at most \c frameCount frames from \c voice into \c outputData beginning at \c frameOffset
+/// @param isExhausted Set to \c true if the source of \c voice has no more audio
+/// @param isUnderrun Set to \c true if a streaming source had insufficient audio available
+/// @return The number of frames mixed
+AVAudioFrameCount MixVoice(Voice& voice, AudioBufferList *outputData, AVAudioFrameCount frameOffset, AVAudioFrameCount frameCount, bool& isExhausted, bool& isUnderrun) noexcept
+{
+	auto& source = *voice.mSource;
+
+	// Gain changes are ramped over the voice's frames in this render cycle
+	const float gainSteps [2] = {
+		(voice.mTargetGains[0] - voice.mGains[0]) / frameCount,
+		(voice.mTargetGains[1] - voice.mGains[1]) / frameCount
+	};
+
+	AVAudioFrameCount framesMixed = 0;
+	if(!source.mIsStreaming) {
+		framesMixed = std::min(frameCount, source.mFrameLength - voice.mFramePosition);
+		AccumulateFrames(source.mBufferList, voice.mFramePosition, outputData, frameOffset, framesMixed, voice.mGains, gainSteps);
+		voice.mFramePosition += framesMixed;
+		isExhausted = voice.mFramePosition >= source.mFrameLength;
+	}
+	else {
+		// The decoding thread sets mDecodingFinished after writing its final audio
+		const bool decodingFinished = source.mDecodingFinished.load();
+
+		auto readVector = source.mRingBuffer.GetReadVector();
+		for(const auto& region : { readVector.mFirst, readVector.mSecond }) {
+			const auto framesToMix = std::min(region.mFrameCount, frameCount - framesMixed);
+			if(framesToMix == 0 || !source.mRingBuffer.GetBufferList({ region.mFrameOffset, framesToMix }, source.mReadBufferList.get()))
+				break;
+			AccumulateFrames(source.mReadBufferList.get(), 0, outputData, frameOffset + framesMixed, framesToMix, voice.mGains, gainSteps);
+			framesMixed += framesToMix;
+		}
+		source.mRingBuffer.CommitRead(framesMixed);
+
+		if(framesMixed < frameCount) {
+			if(decodingFinished)
+				isExhausted = true;
+			else
+				isUnderrun = true;
+		}
+	}
+
+	voice.mGains[0] = voice.mTargetGains[0];
+	voice.mGains[1] = voice.mTargetGains[1];
+
+	return framesMixed;
+}
+
+#pragma mark - Commands and Events
+
+/// A request sent to the render block
+struct VoiceCommand
+{
+	/// Command types
+	enum Type : uint8_t {
+		/// Start a voice in a slot, replacing any voice already there
+		eStart,
+		/// Stop a voice at a host time
+		eStop,
+		/// Change the gains of a voice
+		eSetGains,
+		/// Stop all voices at a host time
+		eStopAll
+	};
+
+	/// The command type
+	Type mType;
+	/// The sequence number of the command
+	uint64_t mSequenceNumber;
+	/// The index of the voice
+	uint32_t mSlot;
+	/// The identifier of the voice
+	SFBAudioVoiceIdentifier mIdentifier;
+	/// The source of audio for \c eStart
+	VoiceSource *mSource;
+	/// The start host time for \c eStart or the stop host time for \c eStop and \c eStopAll
+	uint64_t mHostTime;
+	/// The channel gains for \c eStart and \c eSetGains
+	float mGains [2];
+};
+
+/// A notification from the render block that a voice finished
+struct VoiceEvent
+{
+	/// The index of the voice
+	uint32_t mSlot;
+	/// The identifier of the voice
+	SFBAudioVoiceIdentifier mIdentifier;
+};
+
+using VoiceEventQueue = SFB::SPSCQueue<VoiceEvent>;
+
+/// Appends \c event to \c queue and signals \c processor
+/// @note This function is safe to call from the render block
+inline void PostVoiceEvent(VoiceEventQueue& queue, dispatch_source_t processor, const VoiceEvent& event) noexcept
+{
+	if(queue.TryPush(event))
+		dispatch_source_merge_data(processor, 1);
+}
+
+/// A voice as seen by the caller
+struct VoiceSlot
+{
+	/// The identifier of the voice or \c SFBAudioVoiceIdentifierInvalid if free
+	SFBAudioVoiceIdentifier mIdentifier;
+	/// The sequence number of the command starting the voice, used to order voices by age
+	uint64_t mStartSequenceNumber;
+	/// The gain of the voice
+	float mGain;
+	/// The source of audio for the voice
+	std::shared_ptr<VoiceSource> mSource;
+};
+
+/// A source which may still be referenced by the render block
+struct RetiredSource
+{
+	/// The sequence number of the command after which the render block no longer refers to \c mSource
+	uint64_t mSequenceNumber;
+	/// The source
+	std::shared_ptr<VoiceSource> mSource;
+};
+
+} // namespace
+
+#pragma mark -
+
+@interface SFBAudioVoicePoolNode ()
+{
+@private
+	/// The maximum number of simultaneous voices
+	NSUInteger 						_voiceCount;
+	/// Voices owned by the render block
+	std::unique_ptr<Voice []> 		_voices;
+
+	/// The lock protecting the voice slots, retired sources, and command submission
+	std::mutex 						_lock;
+	/// Voices owned by the caller, one for each voice in \c _voices
+	std::vector<VoiceSlot> 			_slots;
+	/// Sources replaced in a slot before the render block processed the replacement
+	std::vector<RetiredSource> 		_retiredSources;
+	/// The identifier of the next voice
+	SFBAudioVoiceIdentifier 		_nextIdentifier;
+	/// The sequence number of the next command
+	uint64_t 						_nextSequenceNumber;
+
+	/// Commands sent to the render block
+	SFB::SPSCQueue<VoiceCommand> 	_commands;
+	/// The sequence number of the most recent command processed by the render block
+	std::atomic_uint64_t 			_processedSequenceNumber;
+
+	/// Voice events sent from the render block
+	VoiceEventQueue 				_voiceEvents;
+	/// Dispatch source processing voice events
+	dispatch_source_t				_voiceEventsProcessor;
+	/// Dispatch queue used for sending delegate messages
+	dispatch_queue_t				_notificationQueue;
+
+	/// Thread used for decoding streaming voices
+	std::thread 					_decodingThread;
+	/// Dispatch semaphore used for communication with the decoding thread
+	dispatch_semaphore_t			_decodingSemaphore;
+	/// Set when the render block has requested decoding since the decoding thread last checked
+	std::atomic_bool 				_decodingRequested;
+	/// Set to stop the decoding thread
+	std::atomic_bool 				_stopDecodingThread;
+	/// Streaming sources being filled by the decoding thread
+	std::vector<std::shared_ptr<VoiceSource>> _decodingSources;
+
+	/// The number of voices started
+	std::atomic_uint64_t 			_startedVoiceCount;
+	/// The number of voices stopped to start another voice
+	std::atomic_uint64_t 			_stolenVoiceCount;
+	/// The number of render cycles in which a streaming voice had insufficient audio
+	std::atomic_uint64_t 			_underrunCount;
+}
+- (SFBAudioVoiceIdentifier)startVoiceWithSource:(std::shared_ptr<VoiceSource>)source gain:(float)gain pan:(float)pan atHostTime:(uint64_t)hostTime error:(NSError **)error;
+- (BOOL)sendCommand:(VoiceCommand)command;
+- (void)releaseRetiredSources;
+@end
+
+@implementation SFBAudioVoicePoolNode
+
+- (instancetype)init
+{
+	return [self initWithFormat:[[AVAudioFormat alloc] initStandardFormatWithSampleRate:44100 channels:2] voiceCount:kDefaultVoiceCount];
+}
+
+- (instancetype)initWithFormat:(AVAudioFormat *)format voiceCount:(NSUInteger)voiceCount
+{
+	NSParameterAssert(format != nil);
+	NSParameterAssert(format.isStandard);
+	NSParameterAssert(voiceCount > 0 && voiceCount <= kMaximumVoiceCount);
+
+	const double sampleRate = format.sampleRate;
+
+	AVAudioSourceNodeRenderBlock renderBlock = ^OSStatus(BOOL *isSilence, const AudioTimeStamp *timestamp, AVAudioFrameCount frameCount, AudioBufferList *outputData) {
+		auto voices = self->_voices.get();
+		const auto voiceCount = self->_voiceCount;
+
+		// ========================================
+		// 1. Process commands
+		VoiceCommand command;
+		while(self->_commands.TryPop(command)) {
+			switch(command.mType) {
+				case VoiceCommand::eStart:
+					voices[command.mSlot] = { command.mIdentifier, command.mSource, 0, command.mHostTime, UINT64_MAX, false, { command.mGains[0], command.mGains[1] }, { command.mGains[0], command.mGains[1] } };
+					break;
+				case VoiceCommand::eStop:
+					if(voices[command.mSlot].mIdentifier == command.mIdentifier)
+						voices[command.mSlot].mStopHostTime = command.mHostTime;
+					break;
+				case VoiceCommand::eSetGains:
+					if(voices[command.mSlot].mIdentifier == command.mIdentifier) {
+						voices[command.mSlot].mTargetGains[0] = command.mGains[0];
+						voices[command.mSlot].mTargetGains[1] = command.mGains[1];
+					}
+					break;
+				case VoiceCommand::eStopAll:
+					for(size_t i = 0; i < voiceCount; ++i) {
+						if(voices[i].mIdentifier)
+							voices[i].mStopHostTime = std::min(voices[i].mStopHostTime, command.mHostTime);
+					}
+					break;
+			}
+			self->_processedSequenceNumber.store(command.mSequenceNumber);
+		}
+
+		// ========================================
+		// 2. Clear the output
+		for(UInt32 i = 0; i < outputData->mNumberBuffers; ++i)
+			vDSP_vclr(static_cast<float *>(outputData->mBuffers[i].mData), 1, frameCount);
+
+		// Converts a host time to the offset of the corresponding frame in this render cycle
+		const bool hostTimeIsValid = timestamp->mFlags & kAudioTimeStampHostTimeValid;
+		const auto frameOffsetForHostTime = [&](uint64_t hostTime) -> AVAudioFrameCount {
+			if(!hostTimeIsValid || hostTime <= timestamp->mHostTime)
+				return 0;
+			const auto frames = std::round(ConvertHostTicksToNanos(hostTime - timestamp->mHostTime) / NSEC_PER_SEC * sampleRate);
+			return frames < frameCount ? static_cast<AVAudioFrameCount>(frames) : frameCount;
+		};
+
+		// ========================================
+		// 3. Mix voices
+		bool mixedAudio = false;
+		bool underrun = false;
+		bool decodingNeeded = false;
+		for(size_t i = 0; i < voiceCount; ++i) {
+			auto& voice = voices[i];
+			if(!voice.mIdentifier)
+				continue;
+
+			AVAudioFrameCount endOffset = frameCount;
+			bool stopReached = false;
+			if(voice.mStopHostTime != UINT64_MAX) {
+				endOffset = frameOffsetForHostTime(voice.mStopHostTime);
+				stopReached = endOffset < frameCount;
+			}
+
+			AVAudioFrameCount startOffset = 0;
+			if(!voice.mHasStarted) {
+				startOffset = frameOffsetForHostTime(voice.mStartHostTime);
+				if(startOffset >= frameCount && !stopReached)
+					continue;
+				voice.mHasStarted = true;
+			}
+
+			bool exhausted = false;
+			if(endOffset > startOffset)
+				mixedAudio = MixVoice(voice, outputData, startOffset, endOffset - startOffset, exhausted, underrun) > 0 || mixedAudio;
+
+			if(exhausted || stopReached) {
+				PostVoiceEvent(self->_voiceEvents, self->_voiceEventsProcessor, { static_cast<uint32_t>(i), voice.mIdentifier });
+				voice.mIdentifier = SFBAudioVoiceIdentifierInvalid;
+				voice.mSource = nullptr;
+			}
+			else if(voice.mSource->mIsStreaming && !voice.mSource->mDecodingFinished.load() && voice.mSource->mRingBuffer.FramesAvailableToWrite() >= kStreamingRingBufferFrameCapacity / 2)
+				decodingNeeded = true;
+		}
+
+		// ========================================
+		// 4. Request decoding and update statistics
+		if(decodingNeeded && !self->_decodingRequested.exchange(true))
+			dispatch_semaphore_signal(self->_decodingSemaphore);
+
+		if(underrun)
+			self->_underrunCount.fetch_add(1);
+
+		if(!mixedAudio)
+			*isSilence = YES;
+
+		return noErr;
+	};
+
+	if((self = [super initWithFormat:format renderBlock:renderBlock])) {
+		os_log_info(_audioVoicePoolNodeLog, "Render block format: %{public}@, %lu voices", format, static_cast<unsigned long>(voiceCount));
+
+		// These are used in the render block so must be lock free
+		assert(_processedSequenceNumber.is_lock_free());
+		assert(_decodingRequested.is_lock_free());
+		assert(_underrunCount.is_lock_free());
+
+		_renderingFormat = format;
+		_voiceCount = voiceCount;
+
+		try {
+			_voices = std::make_unique<Voice []>(voiceCount);
+			_slots.resize(voiceCount);
+			_retiredSources.reserve(voiceCount);
+			_decodingSources.reserve(voiceCount);
+		}
+
+		catch(const std::exception& e) {
+			os_log_error(_audioVoicePoolNodeLog, "Unable to allocate voices: %{public}s", e.what());
+			return nil;
+		}
+
+		for(NSUInteger i = 0; i < voiceCount; ++i)
+			_voices[i] = { SFBAudioVoiceIdentifierInvalid, nullptr, 0, 0, UINT64_MAX, false, { 0, 0 }, { 0, 0 } };
+
+		if(!_commands.Allocate(kCommandQueueCapacity)) {
+			os_log_error(_audioVoicePoolNodeLog, "Unable to allocate command queue");
+			return nil;
+		}
+
+		if(!_voiceEvents.Allocate(std::max(kVoiceEventQueueCapacity, 2 * voiceCount))) {
+			os_log_error(_audioVoicePoolNodeLog, "Unable to allocate voice event queue");
+			return nil;
+		}
+
+		_nextIdentifier = 1;
+		_nextSequenceNumber = 1;
+		_processedSequenceNumber.store(0);
+		_decodingRequested.store(false);
+		_stopDecodingThread.store(false);
+		_startedVoiceCount.store(0);
+		_stolenVoiceCount.store(0);
+		_underrunCount.store(0);
+		_stealingPolicy = SFBAudioVoicePoolNodeStealingPolicyOldest;
+
+		// Create the dispatch queue used for sending delegate messages
+		dispatch_queue_attr_t attr = dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_USER_INITIATED, 0);
+		_notificationQueue = dispatch_queue_create_with_target("org.sbooth.AudioEngine.AudioVoicePoolNode.NotificationQueue", attr, DISPATCH_TARGET_QUEUE_DEFAULT);
+		if(!_notificationQueue) {
+			os_log_error(_audioVoicePoolNodeLog, "dispatch_queue_create_with_target failed");
+			return nil;
+		}
+
+		_decodingSemaphore = dispatch_semaphore_create(0);
+		if(!_decodingSemaphore) {
+			os_log_error(_audioVoicePoolNodeLog, "dispatch_semaphore_create failed");
+			return nil;
+		}
+
+		// Set up voice event processing
+		_voiceEventsProcessor = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_OR, 0, 0, _notificationQueue);
+		if(!_voiceEventsProcessor) {
+			os_log_error(_audioVoicePoolNodeLog, "dispatch_source_create failed");
+			return nil;
+		}
+
+		__weak typeof(self) weakSelf = self;
+		dispatch_source_set_event_handler(_voiceEventsProcessor, ^{
+			[weakSelf processVoiceEvents];
+		});
+
+		dispatch_activate(_voiceEventsProcessor);
+
+		try {
+			_decodingThread = std::thread(DecodingThreadEntry, (__bridge void *)self);
+		}
+
+		catch(const std::exception& e) {
+			os_log_error(_audioVoicePoolNodeLog, "Unable to create decoding thread: %{public}s", e.what());
+			return nil;
+		}
+	}
+
+	return self;
+}
+
+- (void)dealloc
+{
+	if(_voiceEventsProcessor)
+		dispatch_source_cancel(_voiceEventsProcessor);
+
+	_stopDecodingThread.store(true);
+	if(_decodingThread.joinable()) {
+		dispatch_semaphore_signal(_decodingSemaphore);
+		_decodingThread.join();
+	}
+}
+
+#pragma mark - Format Information
+
+- (BOOL)supportsFormat:(AVAudioFormat *)format
+{
+	NSParameterAssert(format != nil);
+	return format.sampleRate == _renderingFormat.sampleRate && (format.channelCount == 1 || format.channelCount == _renderingFormat.channelCount);
+}
+
+#pragma mark - Voice Management
+
+- (SFBAudioVoiceIdentifier)playBuffer:(AVAudioPCMBuffer *)buffer error:(NSError **)error
+{
+	return [self playBuffer:buffer gain:1 pan:0 atHostTime:0 error:error];
+}
+
+- (SFBAudioVoiceIdentifier)playBuffer:(AVAudioPCMBuffer *)buffer gain:(float)gain pan:(float)pan atHostTime:(uint64_t)hostTime error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+
+	if(!buffer.format.isStandard || ![self supportsFormat:buffer.format]) {
+		os_log_error(_audioVoicePoolNodeLog, "Unsupported buffer format: %{public}@", buffer.format);
+		if(error)
+			*error = [NSError errorWithDomain:SFBAudioVoicePoolNodeErrorDomain code:SFBAudioVoicePoolNodeErrorFormatNotSupported userInfo:nil];
+		return SFBAudioVoiceIdentifierInvalid;
+	}
+
+	std::shared_ptr<VoiceSource> source;
+	try {
+		source = std::make_shared<VoiceSource>();
+	}
+
+	catch(const std::exception& e) {
+		os_log_error(_audioVoicePoolNodeLog, "Unable to allocate voice source: %{public}s", e.what());
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return SFBAudioVoiceIdentifierInvalid;
+	}
+
+	source->mIsStreaming = false;
+	source->mChannelCount = buffer.format.channelCount;
+	source->mBuffer = buffer;
+	source->mBufferList = buffer.audioBufferList;
+	source->mFrameLength = buffer.frameLength;
+	source->mDecodingFinished.store(true);
+	source->mDecodingCanceled.store(false);
+
+	return [self startVoiceWithSource:source gain:gain pan:pan atHostTime:hostTime error:error];
+}
+
+- (SFBAudioVoiceIdentifier)playDecoder:(id <SFBPCMDecoding>)decoder error:(NSError **)error
+{
+	return [self playDecoder:decoder gain:1 pan:0 atHostTime:0 error:error];
+}
+
+- (SFBAudioVoiceIdentifier)playDecoder:(id <SFBPCMDecoding>)decoder gain:(float)gain pan:(float)pan atHostTime:(uint64_t)hostTime error:(NSError **)error
+{
+	NSParameterAssert(decoder != nil);
+
+	if(!decoder.isOpen && ![decoder openReturningError:error])
+		return SFBAudioVoiceIdentifierInvalid;
+
+	AVAudioFormat *decoderFormat = decoder.processingFormat;
+	AVAudioFormat *format = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:decoderFormat.sampleRate channels:decoderFormat.channelCount];
+
+	if(![self supportsFormat:decoderFormat] || !format || !SFB::PCMConverter::IsSupported(*decoderFormat.streamDescription, *format.streamDescription)) {
+		os_log_error(_audioVoicePoolNodeLog, "Unsupported decoder format: %{public}@", decoderFormat);
+		if(error)
+			*error = [NSError SFB_errorWithDomain:SFBAudioVoicePoolNodeErrorDomain
+											 code:SFBAudioVoicePoolNodeErrorFormatNotSupported
+					descriptionFormatStringForURL:NSLocalizedString(@"The format of the file “%@” is not supported.", @"")
+											  url:decoder.inputSource.url
+									failureReason:NSLocalizedString(@"Unsupported file format", @"")
+							   recoverySuggestion:NSLocalizedString(@"The file's sample rate or number of channels is not supported by this node.", @"")];
+		return SFBAudioVoiceIdentifierInvalid;
+	}
+
+	std::shared_ptr<VoiceSource> source;
+	try {
+		source = std::make_shared<VoiceSource>();
+	}
+
+	catch(const std::exception& e) {
+		os_log_error(_audioVoicePoolNodeLog, "Unable to allocate voice source: %{public}s", e.what());
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return SFBAudioVoiceIdentifierInvalid;
+	}
+
+	source->mIsStreaming = true;
+	source->mChannelCount = decoderFormat.channelCount;
+	source->mBufferList = nullptr;
+	source->mFrameLength = 0;
+	source->mDecoder = decoder;
+	source->mDecodeBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:decoderFormat frameCapacity:kStreamingChunkSize];
+	source->mWriteBufferList = AllocateBufferList(format.channelCount);
+	source->mReadBufferList = AllocateBufferList(format.channelCount);
+	source->mDecodingFinished.store(false);
+	source->mDecodingCanceled.store(false);
+
+	if(!source->mDecodeBuffer || !source->mWriteBufferList || !source->mReadBufferList || !source->mConverter.Configure(*decoderFormat.streamDescription, *format.streamDescription) || !source->mRingBuffer.Allocate(*format.streamDescription, kStreamingRingBufferFrameCapacity)) {
+		os_log_error(_audioVoicePoolNodeLog, "Unable to allocate streaming voice buffers");
+		if(error)
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:ENOMEM userInfo:nil];
+		return SFBAudioVoiceIdentifierInvalid;
+	}
+
+	// Fill the ring buffer so the voice can start without waiting for the decoding thread
+	FillRingBuffer(*source);
+
+	return [self startVoiceWithSource:source gain:gain pan:pan atHostTime:hostTime error:error];
+}
+
+- (void)setGain:(float)gain pan:(float)pan forVoice:(SFBAudioVoiceIdentifier)voice
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	for(size_t i = 0; i < _slots.size(); ++i) {
+		auto& slot = _slots[i];
+		if(slot.mIdentifier != voice || voice == SFBAudioVoiceIdentifierInvalid)
+			continue;
+
+		VoiceCommand command{ VoiceCommand::eSetGains, 0, static_cast<uint32_t>(i), voice, nullptr, 0, { 0, 0 } };
+		ComputeChannelGains(gain, pan, slot.mSource->mChannelCount, _renderingFormat.channelCount, command.mGains);
+		if([self sendCommand:command])
+			slot.mGain = gain;
+		break;
+	}
+}
+
+- (void)stopVoice:(SFBAudioVoiceIdentifier)voice
+{
+	[self stopVoice:voice atHostTime:0];
+}
+
+- (void)stopVoice:(SFBAudioVoiceIdentifier)voice atHostTime:(uint64_t)hostTime
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	for(size_t i = 0; i < _slots.size(); ++i) {
+		if(_slots[i].mIdentifier != voice || voice == SFBAudioVoiceIdentifierInvalid)
+			continue;
+		// The slot is freed when the render block reports the voice finished
+		[self sendCommand:{ VoiceCommand::eStop, 0, static_cast<uint32_t>(i), voice, nullptr, hostTime, { 0, 0 } }];
+		break;
+	}
+}
+
+- (void)stopAllVoices
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	[self sendCommand:{ VoiceCommand::eStopAll, 0, 0, SFBAudioVoiceIdentifierInvalid, nullptr, 0, { 0, 0 } }];
+}
+
+- (BOOL)voiceIsPlaying:(SFBAudioVoiceIdentifier)voice
+{
+	if(voice == SFBAudioVoiceIdentifierInvalid)
+		return NO;
+
+	std::lock_guard<std::mutex> lock(_lock);
+	return std::any_of(_slots.cbegin(), _slots.cend(), [voice](const VoiceSlot& slot) {
+		return slot.mIdentifier == voice;
+	});
+}
+
+- (NSUInteger)activeVoiceCount
+{
+	std::lock_guard<std::mutex> lock(_lock);
+	return static_cast<NSUInteger>(std::count_if(_slots.cbegin(), _slots.cend(), [](const VoiceSlot& slot) {
+		return slot.mIdentifier != SFBAudioVoiceIdentifierInvalid;
+	}));
+}
+
+#pragma mark - Statistics
+
+- (SFBAudioVoicePoolNodeStatistics)statistics
+{
+	return {
+		.startedVoiceCount = _startedVoiceCount.load(),
+		.stolenVoiceCount = _stolenVoiceCount.load(),
+		.underrunCount = _underrunCount.load()
+	};
+}
+
+#pragma mark - Internals
+
+- (SFBAudioVoiceIdentifier)startVoiceWithSource:(std::shared_ptr<VoiceSource>)source gain:(float)gain pan:(float)pan atHostTime:(uint64_t)hostTime error:(NSError **)error
+{
+	std::lock_guard<std::mutex> lock(_lock);
+
+	[self releaseRetiredSources];
+
+	// Use a free voice if possible, otherwise steal one according to the stealing policy
+	auto slot = std::find_if(_slots.begin(), _slots.end(), [](const VoiceSlot& slot) {
+		return slot.mIdentifier == SFBAudioVoiceIdentifierInvalid;
+	});
+
+	bool stealing = false;
+	if(slot == _slots.end()) {
+		switch(_stealingPolicy) {
+			case SFBAudioVoicePoolNodeStealingPolicyNone:
+				break;
+			case SFBAudioVoicePoolNodeStealingPolicyOldest:
+				slot = std::min_element(_slots.begin(), _slots.end(), [](const VoiceSlot& a, const VoiceSlot& b) {
+					return a.mStartSequenceNumber < b.mStartSequenceNumber;
+				});
+				break;
+			case SFBAudioVoicePoolNodeStealingPolicyQuietest:
+				slot = std::min_element(_slots.begin(), _slots.end(), [](const VoiceSlot& a, const VoiceSlot& b) {
+					return std::abs(a.mGain) < std::abs(b.mGain) || (std::abs(a.mGain) == std::abs(b.mGain) && a.mStartSequenceNumber < b.mStartSequenceNumber);
+				});
+				break;
+		}
+
+		if(slot == _slots.end()) {
+			if(error)
+				*error = [NSError errorWithDomain:SFBAudioVoicePoolNodeErrorDomain code:SFBAudioVoicePoolNodeErrorNoVoiceAvailable userInfo:nil];
+			return SFBAudioVoiceIdentifierInvalid;
+		}
+
+		stealing = true;
+	}
+
+	const auto index = static_cast<uint32_t>(std::distance(_slots.begin(), slot));
+	const auto identifier = _nextIdentifier;
+
+	VoiceCommand command{ VoiceCommand::eStart, 0, index, identifier, source.get(), hostTime, { 0, 0 } };
+	ComputeChannelGains(gain, pan, source->mChannelCount, _renderingFormat.channelCount, command.mGains);
+
+	if(![self sendCommand:command]) {
+		os_log_error(_audioVoicePoolNodeLog, "Voice command queue full");
+		if(error)
+			*error = [NSError errorWithDomain:SFBAudioVoicePoolNodeErrorDomain code:SFBAudioVoicePoolNodeErrorCommandQueueFull userInfo:nil];
+		return SFBAudioVoiceIdentifierInvalid;
+	}
+
+	// The render block refers to the stolen voice's source until it processes the start command
+	if(stealing) {
+		os_log_debug(_audioVoicePoolNodeLog, "Stealing voice %llu", slot->mIdentifier);
+		slot->mSource->mDecodingCanceled.store(true);
+		_retiredSources.push_back({ _nextSequenceNumber - 1, std::move(slot->mSource) });
+		_stolenVoiceCount.fetch_add(1);
+	}
+
+	*slot = { identifier, _nextSequenceNumber - 1, gain, std::move(source) };
+	++_nextIdentifier;
+	_startedVoiceCount.fetch_add(1);
+
+	return identifier;
+}
+
+- (BOOL)sendCommand:(VoiceCommand)command
+{
+	// _lock must be held by the caller so commands have a single producer
+	command.mSequenceNumber = _nextSequenceNumber;
+	if(!_commands.TryPush(command))
+		return NO;
+	++_nextSequenceNumber;
+	return YES;
+}
+
+- (void)releaseRetiredSources
+{
+	// _lock must be held by the caller
+	const auto processedSequenceNumber = _processedSequenceNumber.load();
+	_retiredSources.erase(std::remove_if(_retiredSources.begin(), _retiredSources.end(), [processedSequenceNumber](const RetiredSource& retiredSource) {
+		return retiredSource.mSequenceNumber <= processedSequenceNumber;
+	}), _retiredSources.end());
+}
+
+- (void)processVoiceEvents
+{
+	std::vector<SFBAudioVoiceIdentifier> finishedVoices;
+
+	{
+		std::lock_guard<std::mutex> lock(_lock);
+
+		VoiceEvent event;
+		while(_voiceEvents.TryPop(event)) {
+			auto& slot = _slots[event.mSlot];
+			// A voice stolen after it finished was replaced before the event was processed
+			if(slot.mIdentifier != event.mIdentifier)
+				continue;
+
+			// The render block no longer refers to the voice's source
+			slot.mSource->mDecodingCanceled.store(true);
+			slot = { SFBAudioVoiceIdentifierInvalid, 0, 0, nullptr };
+
+			try {
+				finishedVoices.push_back(event.mIdentifier);
+			}
+
+			catch(const std::exception& e) {
+				os_log_error(_audioVoicePoolNodeLog, "Unable to record finished voice: %{public}s", e.what());
+			}
+		}
+
+		[self releaseRetiredSources];
+	}
+
+	if(finishedVoices.empty() || ![_delegate respondsToSelector:@selector(audioVoicePoolNode:voiceFinished:)])
+		return;
+
+	for(auto voice : finishedVoices)
+		[_delegate audioVoicePoolNode:self voiceFinished:voice];
+}
+
+- (void *)decodingThreadEntry
+{
+	os_log_debug(_audioVoicePoolNodeLog, "Decoding thread starting");
+
+	while(!_stopDecodingThread.load()) {
+		dispatch_semaphore_wait(_decodingSemaphore, DISPATCH_TIME_FOREVER);
+
+		// Requests made after this point signal the semaphore so none are lost
+		_decodingRequested.store(false);
+
+		@autoreleasepool {
+			// _decodingSources has capacity for every voice so this does not allocate
+			{
+				std::lock_guard<std::mutex> lock(_lock);
+				for(const auto& slot : _slots) {
+					if(slot.mSource && slot.mSource->mIsStreaming && !slot.mSource->mDecodingFinished.load())
+						_decodingSources.push_back(slot.mSource);
+				}
+			}
+
+			for(const auto& source : _decodingSources) {
+				if(_stopDecodingThread.load())
+					break;
+				FillRingBuffer(*source);
+			}
+
+			_decodingSources.clear();
+		}
+	}
+
+	os_log_debug(_audioVoicePoolNodeLog, "Decoding thread terminating");
+
+	return nullptr;
+}
+
+@end
@@ -24,6 +24,8 @@ FOUNDATION_EXPORT const unsigned char SFBAudioEngineVersionString [];
 #import <SFBAudioEngine/SFBDSDPCMDecoder.h>
 #import <SFBAudioEngine/SFBDoPDecoder.h>
 #import <SFBAudioEngine/SFBLoopableRegionDecoder.h>
+#import <SFBAudioEngine/SFBPCMCache.h>
+#import <SFBAudioEngine/SFBFanOutDecoder.h>
 
 #import <SFBAudioEngine/SFBOutputSource.h>
 
@@ -31,8 +33,10 @@ FOUNDATION_EXPORT const unsigned char SFBAudioEngineVersionString [];
 #import <SFBAudioEngine/SFBPCMEncoding.h>
 #import <SFBAudioEngine/SFBAudioEncoder.h>
 
+#import <SFBAudioEngine/SFBAudioDecodingExecutor.h>
 #import <SFBAudioEngine/SFBAudioPlayerNode.h>
 #import <SFBAudioEngine/SFBAudioPlayer.h>
+#import <SFBAudioEngine/SFBAudioVoicePoolNode.h>
 
 #import <SFBAudioEngine/SFBAudioProperties.h>
 #import <SFBAudioEngine/SFBAttachedPicture.h>
@@ -0,0 +1,164 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <Foundation/Foundation.h>
+#import <AVFoundation/AVFoundation.h>
+
+#import <SFBAudioEngine/SFBAudioPlayerNode.h>
+#import <SFBAudioEngine/SFBPCMDecoding.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// The results of rendering performed by \c SFBAudioPlayerNodeRenderHarness
+struct SFBAudioPlayerNodeRenderHarnessReport {
+	/// The number of render cycles performed
+	uint64_t renderCycleCount;
+	/// The number of frames rendered
+	uint64_t frameCount;
+	/// The number of render cycles for which the node reported silence
+	uint64_t silentCycleCount;
+	/// The wall clock time spent rendering, in seconds
+	NSTimeInterval elapsedTime;
+	/// The number of frames rendered per second of wall clock time
+	double framesPerSecond;
+	/// The ratio of the duration of the rendered audio to \c elapsedTime
+	double realtimeFactor;
+	/// The median time spent in the render block per render cycle, in seconds
+	NSTimeInterval medianRenderDuration;
+	/// The 90th percentile time spent in the render block per render cycle, in seconds
+	NSTimeInterval percentile90RenderDuration;
+	/// The 99th percentile time spent in the render block per render cycle, in seconds
+	NSTimeInterval percentile99RenderDuration;
+	/// The longest time spent in the render block in a single render cycle, in seconds
+	NSTimeInterval maximumRenderDuration;
+	/// The number of render cycles for which insufficient audio was available
+	uint64_t underrunCount;
+	/// The number of frames of silence output because insufficient audio was available
+	uint64_t underrunFrameCount;
+	/// The number of decoder transitions for which event timing error was measured
+	uint64_t eventCount;
+	/// The mean absolute event timing error, in seconds
+	NSTimeInterval meanEventTimingError;
+	/// The largest absolute event timing error, in seconds
+	NSTimeInterval maximumEventTimingError;
+	/// \c YES if the node reported the end of audio
+	BOOL endOfAudio;
+};
+typedef struct SFBAudioPlayerNodeRenderHarnessReport SFBAudioPlayerNodeRenderHarnessReport;
+
+/// The results of a seek latency measurement performed by \c SFBAudioPlayerNodeRenderHarness
+struct SFBAudioPlayerNodeSeekBenchmarkReport {
+	/// The number of seeks requested
+	uint64_t seekCount;
+	/// The number of seeks followed by audio at the target within the timeout
+	uint64_t completedCount;
+	/// The median wall clock time from a seek request to the first audio rendered at the target, in seconds
+	NSTimeInterval medianLatency;
+	/// The 90th percentile wall clock time from a seek request to the first audio rendered at the target, in seconds
+	NSTimeInterval percentile90Latency;
+	/// The longest wall clock time from a seek request to the first audio rendered at the target, in seconds
+	NSTimeInterval maximumLatency;
+	/// The mean number of frames rendered from a seek request through the first audio rendered at the target
+	double meanFramesToFirstAudio;
+};
+typedef struct SFBAudioPlayerNodeSeekBenchmarkReport SFBAudioPlayerNodeSeekBenchmarkReport;
+
+/// The results of a sample format conversion measurement performed by \c SFBAudioPlayerNodeRenderHarness
+struct SFBAudioPlayerNodeConverterBenchmarkReport {
+	/// The number of frames converted by each converter
+	uint64_t frameCount;
+	/// The wall clock time spent in the vectorized kernel, in seconds
+	NSTimeInterval kernelTime;
+	/// The wall clock time spent in \c AVAudioConverter, in seconds
+	NSTimeInterval converterTime;
+	/// The ratio of \c converterTime to \c kernelTime
+	double speedup;
+	/// The largest absolute difference between corresponding samples produced by the two converters
+	float maximumDifference;
+};
+typedef struct SFBAudioPlayerNodeConverterBenchmarkReport SFBAudioPlayerNodeConverterBenchmarkReport;
+
+/// A headless driver rendering an \c SFBAudioPlayerNode faster than realtime
+///
+/// The harness calls the node's render block directly in a loop, supplying timestamps from a simulated device clock
+/// that advances by the duration of each render cycle regardless of wall clock time. Random jitter may be added to the
+/// host time of each timestamp to model an imprecise device clock. Because the node is not attached to an engine no
+/// audio device is required and rendering proceeds as fast as the node permits.
+///
+/// Event timing error is measured for each decoder after the first by comparing the interval between consecutive
+/// \c -audioPlayerNode:renderingWillStart:atHostTime: host times with the duration of the preceding decoder. This is
+/// meaningful only for gapless playback of decoders with known lengths at the rendering sample rate.
+///
+/// While rendering the harness is the node's delegate; the previous delegate is restored afterward.
+/// @warning The node must not be attached to an \c AVAudioEngine
+@interface SFBAudioPlayerNodeRenderHarness : NSObject
+
++ (instancetype)new NS_UNAVAILABLE;
+- (instancetype)init NS_UNAVAILABLE;
+
+/// Returns an initialized \c SFBAudioPlayerNodeRenderHarness object
+/// @param playerNode The player node to render
+- (instancetype)initWithPlayerNode:(SFBAudioPlayerNode *)playerNode NS_DESIGNATED_INITIALIZER;
+
+/// Returns the player node being rendered
+@property (nonatomic, readonly) SFBAudioPlayerNode *playerNode;
+
+/// The number of frames requested in each render cycle
+/// @note The default value is \c 512
+@property (nonatomic) AVAudioFrameCount framesPerCycle;
+/// The maximum random deviation added to the host time of each render cycle, in seconds
+/// @note The default value is \c 0
+@property (nonatomic) NSTimeInterval jitter;
+/// The rate at which the simulated device clock is paced relative to the wall clock, or \c 0 for no pacing
+///
+/// Without pacing the render block is called as fast as possible so underruns reflect the decoding throughput of the
+/// node rather than its behavior at a realistic rate.
+/// @note The default value is \c 0
+@property (nonatomic) double speed;
+/// The seed for the random numbers used to generate jitter
+/// @note The default value is \c 1
+@property (nonatomic) uint32_t randomSeed;
+
+/// Starts the node and renders up to \c frameCount frames
+/// @param frameCount The maximum number of frames to render
+/// @param stopAtEndOfAudio If \c YES rendering stops when the node reports the end of audio
+/// @return The results of rendering
+- (SFBAudioPlayerNodeRenderHarnessReport)renderFrames:(AVAudioFramePosition)frameCount stopAtEndOfAudio:(BOOL)stopAtEndOfAudio;
+
+/// Measures the latency from seek requests to the first audio rendered at the seek target
+///
+/// The node is reset, \c decoder is enqueued, and rendering proceeds until audio is heard. Seeks to pseudorandom frames
+/// in the first half of the audio are then requested one at a time, rendering after each until the node reports the
+/// seek complete and renders audio. Seek cost depends on the decoder, so this is run with a decoder for each format of
+/// interest to compare them.
+///
+/// Latency is wall clock time and includes seeking the decoder and refilling the node's buffers. Without pacing the
+/// render block is called continuously while waiting, so \c speed should be \c 1 to model a realistic render cadence.
+/// @param decoder The decoder to seek, which must support seeking and have a known length
+/// @param seekCount The number of seeks to request
+/// @return The results of the measurement
+- (SFBAudioPlayerNodeSeekBenchmarkReport)measureSeekLatencyWithDecoder:(id <SFBPCMDecoding>)decoder seekCount:(NSUInteger)seekCount;
+
+/// Returns a decoder supplying a sine wave for use as a synthetic decoder
+/// @param format The format of the audio, which must be standard
+/// @param frameLength The number of frames of audio
+/// @param frequency The frequency of the sine wave, in Hz
+/// @return A decoder that is already open
++ (id <SFBPCMDecoding>)sineWaveDecoderWithFormat:(AVAudioFormat *)format frameLength:(AVAudioFramePosition)frameLength frequency:(double)frequency;
+
+/// Measures the vectorized sample format conversion kernel used by the node against \c AVAudioConverter
+///
+/// Pseudorandom audio in \c format is converted to deinterleaved 32-bit floating point PCM with the same channel
+/// count and sample rate \c iterationCount times by each converter, and the results compared.
+/// @param format The source format, which must be supported by the kernel
+/// @param frameCapacity The number of frames to convert per iteration
+/// @param iterationCount The number of conversions to time
+/// @return The results of the measurement, with a \c frameCount of \c 0 on error
++ (SFBAudioPlayerNodeConverterBenchmarkReport)measureConverterWithFormat:(AVAudioFormat *)format frameCapacity:(AVAudioFrameCount)frameCapacity iterationCount:(NSUInteger)iterationCount;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,604 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <algorithm>
+#import <atomic>
+#import <cmath>
+#import <mutex>
+#import <random>
+#import <vector>
+
+#import <mach/mach_time.h>
+#import <os/log.h>
+
+#import "SFBAudioPlayerNodeRenderHarness.h"
+#import "SFBPCMConverter.hpp"
+
+namespace {
+
+/// The default number of frames requested in each render cycle
+constexpr AVAudioFrameCount kDefaultFramesPerCycle = 512;
+/// The time allowed after rendering for render events to be delivered, in seconds
+constexpr NSTimeInterval kEventDeliveryInterval = 0.1;
+/// The maximum time to wait for audio following a seek, in seconds
+constexpr NSTimeInterval kSeekTimeout = 5;
+
+/// The log for \c SFBAudioPlayerNodeRenderHarness
+os_log_t _renderHarnessLog = os_log_create("org.sbooth.AudioEngine", "AudioPlayerNodeRenderHarness");
+
+#pragma mark - Time Utilities
+
+double HostTicksPerNano()
+{
+	mach_timebase_info_data_t timebase_info;
+	auto result = mach_timebase_info(&timebase_info);
+	assert(result == KERN_SUCCESS);
+	return static_cast<double>(timebase_info.numer) / static_cast<double>(timebase_info.denom);
+}
+
+const double kHostTicksPerNano = HostTicksPerNano();
+
+inline double ConvertHostTicksToSeconds(int64_t t) noexcept
+{
+	return static_cast<double>(t) * kHostTicksPerNano / NSEC_PER_SEC;
+}
+
+inline int64_t ConvertSecondsToHostTicks(double s) noexcept
+{
+	return static_cast<int64_t>(std::llround(s * NSEC_PER_SEC / kHostTicksPerNano));
+}
+
+/// Returns the value at \c percentile in \c sortedDurations, which must be sorted in ascending order
+NSTimeInterval DurationAtPercentile(const std::vector<uint64_t>& sortedDurations, double percentile) noexcept
+{
+	if(sortedDurations.empty())
+		return 0;
+	const auto index = static_cast<size_t>(std::ceil(percentile / 100 * sortedDurations.size()));
+	return ConvertHostTicksToSeconds(static_cast<int64_t>(sortedDurations[std::min(std::max(index, size_t{1}), sortedDurations.size()) - 1]));
+}
+
+/// Returns the block performing rendering for \c playerNode
+///
+/// The block is not part of the node's interface; key-value coding reads the instance variable retaining it
+AVAudioSourceNodeRenderBlock RenderBlockForNode(SFBAudioPlayerNode *playerNode)
+{
+	return [playerNode valueForKey:@"renderBlock"];
+}
+
+/// Renders a node on a simulated device clock
+struct RenderContext
+{
+	/// The node's render block
+	AVAudioSourceNodeRenderBlock mRenderBlock;
+	/// The buffer list receiving rendered audio
+	AudioBufferList *mBufferList;
+	/// The number of bytes in each frame of \c mBufferList
+	UInt32 mBytesPerFrame;
+	/// The sample rate of the simulated device
+	double mSampleRate;
+	/// The rate at which the simulated device clock is paced relative to the wall clock, or \c 0 for no pacing
+	double mSpeed;
+	/// The host time at which the simulated device clock began
+	uint64_t mStartHostTime;
+	/// The sample time of the next render cycle
+	AVAudioFramePosition mSampleTime;
+
+	/// Renders a cycle of \c frameCount frames and advances \c mSampleTime
+	/// @param jitter The deviation added to the host time of the cycle, in host ticks
+	/// @param renderDuration Receives the time spent in the render block, in host ticks
+	/// @return \c true if the node reported silence
+	bool RenderCycle(AVAudioFrameCount frameCount, int64_t jitter, uint64_t& renderDuration) noexcept
+	{
+		const double cycleTime = mSampleTime / mSampleRate;
+
+		if(mSpeed > 0)
+			mach_wait_until(mStartHostTime + static_cast<uint64_t>(ConvertSecondsToHostTicks(cycleTime / mSpeed)));
+
+		AudioTimeStamp timestamp{};
+		timestamp.mSampleTime = mSampleTime;
+		timestamp.mHostTime = static_cast<uint64_t>(std::max(static_cast<int64_t>(mStartHostTime + ConvertSecondsToHostTicks(cycleTime)) + jitter, int64_t{0}));
+		timestamp.mRateScalar = 1;
+		timestamp.mFlags = kAudioTimeStampSampleHostTimeValid | kAudioTimeStampRateScalarValid;
+
+		// The render block may alter the buffer sizes
+		for(UInt32 i = 0; i < mBufferList->mNumberBuffers; ++i)
+			mBufferList->mBuffers[i].mDataByteSize = frameCount * mBytesPerFrame;
+
+		BOOL isSilence = NO;
+		const auto renderStartTime = mach_absolute_time();
+		const auto result = mRenderBlock(&isSilence, &timestamp, frameCount, mBufferList);
+		renderDuration = mach_absolute_time() - renderStartTime;
+
+		if(result != noErr)
+			os_log_error(_renderHarnessLog, "Render block failed: %d", result);
+
+		mSampleTime += frameCount;
+		return isSilence == YES;
+	}
+};
+
+/// A \c -audioPlayerNode:renderingWillStart:atHostTime: notification
+struct RenderingWillStartEvent
+{
+	/// The frame length of the decoder
+	AVAudioFramePosition mFrameLength;
+	/// The host time at which rendering starts
+	uint64_t mHostTime;
+};
+
+} /* namespace */
+
+#pragma mark - Synthetic Decoder
+
+/// A decoder supplying a sine wave
+@interface SFBSineWaveDecoder : NSObject <SFBPCMDecoding>
+{
+@private
+	/// The format of the audio
+	AVAudioFormat *_processingFormat;
+	/// The number of frames of audio
+	AVAudioFramePosition _frameLength;
+	/// The current frame
+	AVAudioFramePosition _framePosition;
+	/// The phase increment per frame, in radians
+	double _phaseIncrement;
+	/// \c YES if the decoder is open
+	BOOL _isOpen;
+}
+- (instancetype)initWithFormat:(AVAudioFormat *)format frameLength:(AVAudioFramePosition)frameLength frequency:(double)frequency;
+@end
+
+@implementation SFBSineWaveDecoder
+
+- (instancetype)initWithFormat:(AVAudioFormat *)format frameLength:(AVAudioFramePosition)frameLength frequency:(double)frequency
+{
+	NSParameterAssert(format != nil);
+	NSParameterAssert(format.isStandard);
+	NSParameterAssert(frameLength >= 0);
+
+	if((self = [super init])) {
+		_processingFormat = format;
+		_frameLength = frameLength;
+		_phaseIncrement = 2 * M_PI * frequency / format.sampleRate;
+		_isOpen = YES;
+	}
+	return self;
+}
+
+- (SFBInputSource *)inputSource
+{
+	return [SFBInputSource inputSourceWithData:[NSData data]];
+}
+
+- (AVAudioFormat *)sourceFormat
+{
+	return _processingFormat;
+}
+
+- (AVAudioFormat *)processingFormat
+{
+	return _processingFormat;
+}
+
+- (BOOL)decodingIsLossless
+{
+	return YES;
+}
+
+- (BOOL)openReturningError:(NSError **)error
+{
+	_isOpen = YES;
+	return YES;
+}
+
+- (BOOL)closeReturningError:(NSError **)error
+{
+	_isOpen = NO;
+	return YES;
+}
+
+- (BOOL)isOpen
+{
+	return _isOpen;
+}
+
+- (AVAudioFramePosition)framePosition
+{
+	return _framePosition;
+}
+
+- (AVAudioFramePosition)frameLength
+{
+	return _frameLength;
+}
+
+- (BOOL)decodeIntoBuffer:(AVAudioBuffer *)buffer error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer isKindOfClass:[AVAudioPCMBuffer class]]);
+	return [self decodeIntoBuffer:(AVAudioPCMBuffer *)buffer frameLength:((AVAudioPCMBuffer *)buffer).frameCapacity error:error];
+}
+
+- (BOOL)decodeIntoBuffer:(AVAudioPCMBuffer *)buffer frameLength:(AVAudioFrameCount)frameLength error:(NSError **)error
+{
+	NSParameterAssert(buffer != nil);
+	NSParameterAssert([buffer.format isEqual:_processingFormat]);
+
+	const auto framesToDecode = static_cast<AVAudioFrameCount>(std::min(static_cast<AVAudioFramePosition>(std::min(frameLength, buffer.frameCapacity)), _frameLength - _framePosition));
+	const auto channelCount = buffer.format.channelCount;
+	const auto floatChannelData = buffer.floatChannelData;
+
+	for(AVAudioFrameCount i = 0; i < framesToDecode; ++i) {
+		const auto sample = static_cast<float>(0.5 * std::sin(_phaseIncrement * static_cast<double>(_framePosition + i)));
+		for(AVAudioChannelCount channel = 0; channel < channelCount; ++channel)
+			floatChannelData[channel][i] = sample;
+	}
+
+	buffer.frameLength = framesToDecode;
+	_framePosition += framesToDecode;
+
+	return YES;
+}
+
+- (BOOL)supportsSeeking
+{
+	return YES;
+}
+
+- (BOOL)seekToFrame:(AVAudioFramePosition)frame error:(NSError **)error
+{
+	NSParameterAssert(frame >= 0);
+	_framePosition = std::min(frame, _frameLength);
+	return YES;
+}
+
+@end
+
+#pragma mark - SFBAudioPlayerNodeRenderHarness
+
+@interface SFBAudioPlayerNodeRenderHarness () <SFBAudioPlayerNodeDelegate>
+{
+@private
+	/// Set when the node reports the end of audio
+	std::atomic_bool _endOfAudio;
+	/// The lock protecting \c _renderingWillStartEvents
+	std::mutex _eventLock;
+	/// Rendering notifications received while rendering
+	std::vector<RenderingWillStartEvent> _renderingWillStartEvents;
+}
+@end
+
+@implementation SFBAudioPlayerNodeRenderHarness
+
+- (instancetype)initWithPlayerNode:(SFBAudioPlayerNode *)playerNode
+{
+	NSParameterAssert(playerNode != nil);
+
+	if((self = [super init])) {
+		_playerNode = playerNode;
+		_framesPerCycle = kDefaultFramesPerCycle;
+		_randomSeed = 1;
+	}
+	return self;
+}
+
+- (SFBAudioPlayerNodeRenderHarnessReport)renderFrames:(AVAudioFramePosition)frameCount stopAtEndOfAudio:(BOOL)stopAtEndOfAudio
+{
+	NSParameterAssert(frameCount >= 0);
+	NSParameterAssert(_framesPerCycle > 0);
+
+	SFBAudioPlayerNodeRenderHarnessReport report{};
+
+	AVAudioFormat *format = [_playerNode outputFormatForBus:0];
+	AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format frameCapacity:_framesPerCycle];
+	if(!buffer) {
+		os_log_error(_renderHarnessLog, "Unable to allocate render buffer");
+		return report;
+	}
+
+	const double sampleRate = format.sampleRate;
+
+	const auto maximumCycleCount = static_cast<size_t>((frameCount + _framesPerCycle - 1) / _framesPerCycle);
+	std::vector<uint64_t> renderDurations;
+	try {
+		renderDurations.reserve(maximumCycleCount);
+	}
+	catch(const std::exception& e) {
+		os_log_error(_renderHarnessLog, "Unable to allocate render duration storage: %{public}s", e.what());
+		return report;
+	}
+
+	std::minstd_rand engine(_randomSeed);
+	std::uniform_real_distribution<double> jitterDistribution(-_jitter, _jitter);
+
+	{
+		std::lock_guard<std::mutex> lock(_eventLock);
+		_renderingWillStartEvents.clear();
+	}
+	_endOfAudio.store(false);
+
+	id<SFBAudioPlayerNodeDelegate> delegate = _playerNode.delegate;
+	_playerNode.delegate = self;
+
+	const auto initialStatistics = _playerNode.bufferingStatistics;
+
+	[_playerNode play];
+
+	// The simulated device clock begins at the current host time so notifications scheduled at rendering host times
+	// are not delayed indefinitely
+	RenderContext context{ RenderBlockForNode(_playerNode), buffer.mutableAudioBufferList, format.streamDescription->mBytesPerFrame, sampleRate, _speed, mach_absolute_time(), 0 };
+
+	while(context.mSampleTime < frameCount) {
+		if(stopAtEndOfAudio && _endOfAudio.load())
+			break;
+
+		const auto framesToRender = static_cast<AVAudioFrameCount>(std::min(static_cast<AVAudioFramePosition>(_framesPerCycle), frameCount - context.mSampleTime));
+		const auto jitter = _jitter > 0 ? ConvertSecondsToHostTicks(jitterDistribution(engine)) : 0;
+
+		uint64_t renderDuration = 0;
+		if(context.RenderCycle(framesToRender, jitter, renderDuration))
+			++report.silentCycleCount;
+		renderDurations.push_back(renderDuration);
+
+		++report.renderCycleCount;
+		report.frameCount += framesToRender;
+	}
+
+	const auto elapsedTime = mach_absolute_time() - context.mStartHostTime;
+
+	// Allow render events posted by the final cycles to be delivered
+	[NSThread sleepForTimeInterval:kEventDeliveryInterval];
+
+	[_playerNode pause];
+	_playerNode.delegate = delegate;
+
+	report.endOfAudio = _endOfAudio.load() ? YES : NO;
+
+	const auto finalStatistics = _playerNode.bufferingStatistics;
+	// The statistics may have been reset while rendering
+	if(finalStatistics.underrunCount >= initialStatistics.underrunCount) {
+		report.underrunCount = finalStatistics.underrunCount - initialStatistics.underrunCount;
+		report.underrunFrameCount = finalStatistics.underrunFrameCount - initialStatistics.underrunFrameCount;
+	}
+
+	report.elapsedTime = ConvertHostTicksToSeconds(static_cast<int64_t>(elapsedTime));
+	if(report.elapsedTime > 0) {
+		report.framesPerSecond = report.frameCount / report.elapsedTime;
+		report.realtimeFactor = report.framesPerSecond / sampleRate;
+	}
+
+	std::sort(renderDurations.begin(), renderDurations.end());
+	report.medianRenderDuration = DurationAtPercentile(renderDurations, 50);
+	report.percentile90RenderDuration = DurationAtPercentile(renderDurations, 90);
+	report.percentile99RenderDuration = DurationAtPercentile(renderDurations, 99);
+	report.maximumRenderDuration = DurationAtPercentile(renderDurations, 100);
+
+	std::lock_guard<std::mutex> lock(_eventLock);
+	double totalEventTimingError = 0;
+	for(size_t i = 1; i < _renderingWillStartEvents.size(); ++i) {
+		const auto& previous = _renderingWillStartEvents[i - 1];
+		const auto& current = _renderingWillStartEvents[i];
+		if(previous.mFrameLength == SFBUnknownFrameLength)
+			continue;
+		const auto interval = ConvertHostTicksToSeconds(static_cast<int64_t>(current.mHostTime - previous.mHostTime));
+		const auto error = std::abs(interval - previous.mFrameLength / sampleRate);
+		totalEventTimingError += error;
+		report.maximumEventTimingError = std::max(report.maximumEventTimingError, error);
+		++report.eventCount;
+	}
+	if(report.eventCount > 0)
+		report.meanEventTimingError = totalEventTimingError / report.eventCount;
+
+	os_log_info(_renderHarnessLog, "Rendered %llu frames in %llu cycles at %.1fx realtime; p99 render duration %.3f msec, %llu underruns",
+				report.frameCount, report.renderCycleCount, report.realtimeFactor, report.percentile99RenderDuration * 1000, report.underrunCount);
+
+	return report;
+}
+
+- (SFBAudioPlayerNodeSeekBenchmarkReport)measureSeekLatencyWithDecoder:(id <SFBPCMDecoding>)decoder seekCount:(NSUInteger)seekCount
+{
+	NSParameterAssert(decoder != nil);
+	NSParameterAssert(_framesPerCycle > 0);
+
+	SFBAudioPlayerNodeSeekBenchmarkReport report{};
+
+	AVAudioFormat *format = [_playerNode outputFormatForBus:0];
+	AVAudioPCMBuffer *buffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format frameCapacity:_framesPerCycle];
+	if(!buffer) {
+		os_log_error(_renderHarnessLog, "Unable to allocate render buffer");
+		return report;
+	}
+
+	std::vector<uint64_t> latencies;
+	try {
+		latencies.reserve(seekCount);
+	}
+	catch(const std::exception& e) {
+		os_log_error(_renderHarnessLog, "Unable to allocate latency storage: %{public}s", e.what());
+		return report;
+	}
+
+	const auto frameLength = decoder.frameLength;
+	if(!decoder.supportsSeeking || frameLength <= 0) {
+		os_log_error(_renderHarnessLog, "Seek latency requires a seekable decoder with a known length");
+		return report;
+	}
+
+	NSError *error = nil;
+	if(![_playerNode resetAndEnqueueDecoder:decoder error:&error]) {
+		os_log_error(_renderHarnessLog, "Unable to enqueue decoder: %{public}@", error);
+		return report;
+	}
+
+	// Targets are confined to the first half of the audio so rendering never reaches the end
+	std::minstd_rand engine(_randomSeed);
+	std::uniform_int_distribution<AVAudioFramePosition> targetDistribution(0, std::max(frameLength / 2 - 1, AVAudioFramePosition{0}));
+
+	[_playerNode play];
+
+	RenderContext context{ RenderBlockForNode(_playerNode), buffer.mutableAudioBufferList, format.streamDescription->mBytesPerFrame, format.sampleRate, _speed, mach_absolute_time(), 0 };
+	const auto timeout = static_cast<uint64_t>(ConvertSecondsToHostTicks(kSeekTimeout));
+	uint64_t renderDuration = 0;
+
+	// Latency is measured from playback so the initial buffering of the decoder isn't attributed to the first seek
+	for(auto deadline = mach_absolute_time() + timeout; mach_absolute_time() < deadline; ) {
+		if(!context.RenderCycle(_framesPerCycle, 0, renderDuration))
+			break;
+	}
+
+	AVAudioFramePosition totalFramesToFirstAudio = 0;
+	for(NSUInteger i = 0; i < seekCount; ++i) {
+		const auto completedCount = _playerNode.seekStatistics.completedCount;
+		const auto requestTime = mach_absolute_time();
+		if(![_playerNode seekToFrame:targetDistribution(engine)]) {
+			os_log_error(_renderHarnessLog, "Seek request %lu failed", static_cast<unsigned long>(i));
+			break;
+		}
+		++report.seekCount;
+
+		// The seek's first audio is rendered in the first audible cycle after the node reports the seek complete
+		const auto startSampleTime = context.mSampleTime;
+		auto heard = false;
+		while(!heard && mach_absolute_time() - requestTime < timeout) {
+			const auto isSilence = context.RenderCycle(_framesPerCycle, 0, renderDuration);
+			heard = !isSilence && _playerNode.seekStatistics.completedCount > completedCount;
+		}
+
+		if(!heard) {
+			os_log_error(_renderHarnessLog, "No audio rendered after seek request %lu", static_cast<unsigned long>(i));
+			continue;
+		}
+
+		latencies.push_back(mach_absolute_time() - requestTime);
+		totalFramesToFirstAudio += context.mSampleTime - startSampleTime;
+		++report.completedCount;
+	}
+
+	[_playerNode pause];
+
+	std::sort(latencies.begin(), latencies.end());
+	report.medianLatency = DurationAtPercentile(latencies, 50);
+	report.percentile90Latency = DurationAtPercentile(latencies, 90);
+	report.maximumLatency = DurationAtPercentile(latencies, 100);
+	if(report.completedCount > 0)
+		report.meanFramesToFirstAudio = static_cast<double>(totalFramesToFirstAudio) / report.completedCount;
+
+	os_log_info(_renderHarnessLog, "%{public}@: %llu of %llu seeks heard; median latency %.3f msec, p90 %.3f msec, maximum %.3f msec",
+				decoder.sourceFormat, report.completedCount, report.seekCount, report.medianLatency * 1000, report.percentile90Latency * 1000, report.maximumLatency * 1000);
+
+	return report;
+}
+
++ (id <SFBPCMDecoding>)sineWaveDecoderWithFormat:(AVAudioFormat *)format frameLength:(AVAudioFramePosition)frameLength frequency:(double)frequency
+{
+	return [[SFBSineWaveDecoder alloc] initWithFormat:format frameLength:frameLength frequency:frequency];
+}
+
++ (SFBAudioPlayerNodeConverterBenchmarkReport)measureConverterWithFormat:(AVAudioFormat *)format frameCapacity:(AVAudioFrameCount)frameCapacity iterationCount:(NSUInteger)iterationCount
+{
+	NSParameterAssert(format != nil);
+	NSParameterAssert(frameCapacity > 0);
+
+	SFBAudioPlayerNodeConverterBenchmarkReport report{};
+
+	AVAudioFormat *floatFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:format.sampleRate channelLayout:format.channelLayout ?: [[AVAudioChannelLayout alloc] initWithLayoutTag:(kAudioChannelLayoutTag_DiscreteInOrder | format.channelCount)]];
+	if(!floatFormat) {
+		os_log_error(_renderHarnessLog, "Unable to create float format for %{public}@", format);
+		return report;
+	}
+
+	SFB::PCMConverter kernel;
+	if(!kernel.Configure(*(format.streamDescription), *(floatFormat.streamDescription))) {
+		os_log_error(_renderHarnessLog, "Conversion from %{public}@ is not supported by the kernel", format);
+		return report;
+	}
+
+	AVAudioConverter *converter = [[AVAudioConverter alloc] initFromFormat:format toFormat:floatFormat];
+	AVAudioConverter *sourceConverter = [[AVAudioConverter alloc] initFromFormat:floatFormat toFormat:format];
+	if(!converter || !sourceConverter) {
+		os_log_error(_renderHarnessLog, "Unable to create AVAudioConverter for %{public}@", format);
+		return report;
+	}
+
+	AVAudioPCMBuffer *noiseBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:floatFormat frameCapacity:frameCapacity];
+	AVAudioPCMBuffer *sourceBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format frameCapacity:frameCapacity];
+	AVAudioPCMBuffer *kernelBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:floatFormat frameCapacity:frameCapacity];
+	AVAudioPCMBuffer *converterBuffer = [[AVAudioPCMBuffer alloc] initWithPCMFormat:floatFormat frameCapacity:frameCapacity];
+	if(!noiseBuffer || !sourceBuffer || !kernelBuffer || !converterBuffer) {
+		os_log_error(_renderHarnessLog, "Unable to allocate conversion buffers");
+		return report;
+	}
+
+	// The source audio is produced by AVAudioConverter so both converters see identical samples in any source format
+	std::minstd_rand engine;
+	std::uniform_real_distribution<float> sampleDistribution(-1, 1);
+	for(AVAudioChannelCount channel = 0; channel < floatFormat.channelCount; ++channel)
+		std::generate_n(noiseBuffer.floatChannelData[channel], frameCapacity, [&] { return sampleDistribution(engine); });
+	noiseBuffer.frameLength = frameCapacity;
+
+	NSError *error = nil;
+	if(![sourceConverter convertToBuffer:sourceBuffer fromBuffer:noiseBuffer error:&error]) {
+		os_log_error(_renderHarnessLog, "Unable to create source audio: %{public}@", error);
+		return report;
+	}
+
+	auto startTime = mach_absolute_time();
+	for(NSUInteger i = 0; i < iterationCount; ++i)
+		kernelBuffer.frameLength = kernel.Convert(sourceBuffer.audioBufferList, kernelBuffer.mutableAudioBufferList, sourceBuffer.frameLength);
+	const auto kernelTicks = mach_absolute_time() - startTime;
+
+	startTime = mach_absolute_time();
+	for(NSUInteger i = 0; i < iterationCount; ++i) {
+		if(![converter convertToBuffer:converterBuffer fromBuffer:sourceBuffer error:&error]) {
+			os_log_error(_renderHarnessLog, "AVAudioConverter failed: %{public}@", error);
+			return report;
+		}
+	}
+	const auto converterTicks = mach_absolute_time() - startTime;
+
+	if(kernelBuffer.frameLength != converterBuffer.frameLength) {
+		os_log_error(_renderHarnessLog, "Converted frame counts differ: %u (kernel) vs %u (AVAudioConverter)", kernelBuffer.frameLength, converterBuffer.frameLength);
+		return report;
+	}
+
+	for(AVAudioChannelCount channel = 0; channel < floatFormat.channelCount; ++channel) {
+		const float *kernelSamples = kernelBuffer.floatChannelData[channel];
+		const float *converterSamples = converterBuffer.floatChannelData[channel];
+		for(AVAudioFrameCount frame = 0; frame < kernelBuffer.frameLength; ++frame)
+			report.maximumDifference = std::max(report.maximumDifference, std::abs(kernelSamples[frame] - converterSamples[frame]));
+	}
+
+	report.frameCount = static_cast<uint64_t>(sourceBuffer.frameLength) * iterationCount;
+	report.kernelTime = ConvertHostTicksToSeconds(static_cast<int64_t>(kernelTicks));
+	report.converterTime = ConvertHostTicksToSeconds(static_cast<int64_t>(converterTicks));
+	if(report.kernelTime > 0)
+		report.speedup = report.converterTime / report.kernelTime;
+
+	os_log_info(_renderHarnessLog, "%{public}@: kernel %.3f msec, AVAudioConverter %.3f msec (%.2fx), maximum difference %g",
+				format, report.kernelTime * 1000, report.converterTime * 1000, report.speedup, report.maximumDifference);
+
+	return report;
+}
+
+#pragma mark - SFBAudioPlayerNodeDelegate
+
+- (void)audioPlayerNode:(SFBAudioPlayerNode *)audioPlayerNode renderingWillStart:(id<SFBPCMDecoding>)decoder atHostTime:(uint64_t)hostTime
+{
+	std::lock_guard<std::mutex> lock(_eventLock);
+	try {
+		_renderingWillStartEvents.push_back({ decoder.frameLength, hostTime });
+	}
+	catch(const std::exception& e) {
+		os_log_error(_renderHarnessLog, "Unable to record rendering event: %{public}s", e.what());
+	}
+}
+
+- (void)audioPlayerNodeEndOfAudio:(SFBAudioPlayerNode *)audioPlayerNode
+{
+	_endOfAudio.store(true);
+}
+
+@end
@@ -0,0 +1,160 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#import <XCTest/XCTest.h>
+
+#import <SFBAudioEngine/SFBAudioPlayerNode.h>
+
+#import "SFBAudioPlayerNodeRenderHarness.h"
+
+namespace {
+
+/// The sample rate used for rendering
+constexpr double kSampleRate = 44100;
+/// The number of frames in each synthetic decoder
+constexpr AVAudioFramePosition kDecoderFrameLength = 22050;
+/// The number of synthetic decoders rendered gaplessly
+constexpr NSUInteger kDecoderCount = 4;
+/// The number of frames in each synthetic decoder scrubbed after decoding completes
+constexpr AVAudioFramePosition kScrubDecoderFrameLength = 2048;
+/// The number of render cycles performed while scrubbing
+constexpr NSUInteger kScrubCycleCount = 4;
+/// The number of seeks requested by the seek latency benchmark
+constexpr NSUInteger kSeekCount = 20;
+/// The largest acceptable median time from a seek request to audio at the target, in seconds
+constexpr NSTimeInterval kMaximumMedianSeekLatency = 0.1;
+/// The number of frames converted per iteration by the converter benchmark
+constexpr AVAudioFrameCount kConverterFrameCapacity = 4096;
+/// The number of conversions timed by the converter benchmark
+constexpr NSUInteger kConverterIterationCount = 1000;
+/// The largest acceptable difference between samples converted by the kernel and by \c AVAudioConverter
+constexpr float kConverterTolerance = 1e-6f;
+
+} /* namespace */
+
+@interface SFBAudioPlayerNodeTests : XCTestCase <SFBAudioPlayerNodeDelegate>
+{
+@private
+	/// The format of the rendered audio
+	AVAudioFormat *_format;
+	/// The player node being rendered
+	SFBAudioPlayerNode *_playerNode;
+	/// The harness rendering \c _playerNode
+	SFBAudioPlayerNodeRenderHarness *_harness;
+	/// Fulfilled when decoding is complete for a decoder
+	XCTestExpectation *_decodingComplete;
+}
+@end
+
+@implementation SFBAudioPlayerNodeTests
+
+- (void)setUp
+{
+	_format = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:kSampleRate channels:2];
+	_playerNode = [[SFBAudioPlayerNode alloc] initWithFormat:_format];
+	_harness = [[SFBAudioPlayerNodeRenderHarness alloc] initWithPlayerNode:_playerNode];
+}
+
+- (void)tearDown
+{
+	[_playerNode stop];
+	_harness = nil;
+	_playerNode = nil;
+	_decodingComplete = nil;
+}
+
+- (void)audioPlayerNode:(SFBAudioPlayerNode *)audioPlayerNode decodingComplete:(id<SFBPCMDecoding>)decoder
+{
+	[_decodingComplete fulfill];
+}
+
+- (void)testGaplessRendering
+{
+	for(NSUInteger i = 0; i < kDecoderCount; ++i) {
+		id <SFBPCMDecoding> decoder = [SFBAudioPlayerNodeRenderHarness sineWaveDecoderWithFormat:_format frameLength:kDecoderFrameLength frequency:440];
+		NSError *error = nil;
+		XCTAssertTrue([_playerNode enqueueDecoder:decoder error:&error], @"%@", error);
+	}
+
+	// Notifications are delivered at the host time of the render cycle posting them so the clock is paced at realtime
+	_harness.speed = 1;
+	const auto report = [_harness renderFrames:kDecoderFrameLength * (kDecoderCount + 1) stopAtEndOfAudio:YES];
+
+	XCTAssertGreaterThanOrEqual(report.frameCount, static_cast<uint64_t>(kDecoderFrameLength * kDecoderCount));
+	XCTAssertEqual(report.eventCount, static_cast<uint64_t>(kDecoderCount - 1));
+	XCTAssertLessThan(report.maximumEventTimingError, 0.01);
+}
+
+- (void)testSeekLatency
+{
+	id <SFBPCMDecoding> decoder = [SFBAudioPlayerNodeRenderHarness sineWaveDecoderWithFormat:_format frameLength:kDecoderFrameLength * 4 frequency:440];
+
+	// Seek latency includes refilling the node's buffers so the render cadence must be realistic
+	_harness.speed = 1;
+	const auto report = [_harness measureSeekLatencyWithDecoder:decoder seekCount:kSeekCount];
+
+	XCTAssertEqual(report.seekCount, static_cast<uint64_t>(kSeekCount));
+	XCTAssertEqual(report.completedCount, report.seekCount);
+	XCTAssertLessThan(report.medianLatency, kMaximumMedianSeekLatency);
+}
+
+- (void)testScrubbingAfterDecodingComplete
+{
+	_decodingComplete = [self expectationWithDescription:@"Decoding complete"];
+	_decodingComplete.expectedFulfillmentCount = 2;
+	_decodingComplete.assertForOverFulfill = NO;
+	_playerNode.delegate = self;
+
+	// The decoders are short enough to be completely decoded before rendering starts
+	for(NSUInteger i = 0; i < 2; ++i) {
+		id <SFBPCMDecoding> decoder = [SFBAudioPlayerNodeRenderHarness sineWaveDecoderWithFormat:_format frameLength:kScrubDecoderFrameLength frequency:440];
+		NSError *error = nil;
+		XCTAssertTrue([_playerNode enqueueDecoder:decoder error:&error], @"%@", error);
+	}
+
+	[self waitForExpectations:@[_decodingComplete] timeout:5];
+
+	XCTAssertTrue([_playerNode beginScrubbing]);
+	XCTAssertTrue([_playerNode seekToFrame:kScrubDecoderFrameLength / 2]);
+	[_harness renderFrames:_harness.framesPerCycle * kScrubCycleCount stopAtEndOfAudio:NO];
+	[_playerNode endScrubbing];
+
+	// Playback resumes at the scrub target and continues through the second decoder, which is decoded again
+	_harness.speed = 1;
+	const auto report = [_harness renderFrames:kScrubDecoderFrameLength * 4 stopAtEndOfAudio:YES];
+
+	XCTAssertTrue(report.endOfAudio);
+	XCTAssertGreaterThanOrEqual((report.renderCycleCount - report.silentCycleCount) * _harness.framesPerCycle, static_cast<uint64_t>(kScrubDecoderFrameLength / 2 + kScrubDecoderFrameLength));
+}
+
+- (void)testConverterMatchesAVAudioConverter
+{
+	AudioStreamBasicDescription packed24{};
+	packed24.mSampleRate = kSampleRate;
+	packed24.mFormatID = kAudioFormatLinearPCM;
+	packed24.mFormatFlags = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
+	packed24.mBitsPerChannel = 24;
+	packed24.mChannelsPerFrame = 2;
+	packed24.mBytesPerFrame = 6;
+	packed24.mFramesPerPacket = 1;
+	packed24.mBytesPerPacket = 6;
+
+	NSArray<AVAudioFormat *> *formats = @[
+		[[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatInt16 sampleRate:kSampleRate channels:2 interleaved:YES],
+		[[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatInt16 sampleRate:kSampleRate channels:2 interleaved:NO],
+		[[AVAudioFormat alloc] initWithStreamDescription:&packed24],
+		[[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatInt32 sampleRate:kSampleRate channels:2 interleaved:YES],
+		[[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat32 sampleRate:kSampleRate channels:2 interleaved:YES],
+	];
+
+	for(AVAudioFormat *format in formats) {
+		const auto report = [SFBAudioPlayerNodeRenderHarness measureConverterWithFormat:format frameCapacity:kConverterFrameCapacity iterationCount:kConverterIterationCount];
+		XCTAssertEqual(report.frameCount, static_cast<uint64_t>(kConverterFrameCapacity) * kConverterIterationCount, @"%@", format);
+		XCTAssertLessThanOrEqual(report.maximumDifference, kConverterTolerance, @"%@", format);
+	}
+}
+
+@end
@@ -0,0 +1,191 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace SFB {
+
+/// A bounded lock-free multiple-producer, single-consumer FIFO queue
+///
+/// Any number of threads may push values concurrently without blocking. Consumer operations
+/// (\c TryPop, \c Front, and \c Clear) must be serialized by the caller.
+///
+/// The implementation is based on Dmitry Vyukov's bounded MPMC queue with the consumer side
+/// simplified for a single consumer.
+template <typename T>
+class BoundedMPSCQueue
+{
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c BoundedMPSCQueue
+	/// @note \c Allocate() must be called before the object may be used.
+	BoundedMPSCQueue() noexcept
+	: mCapacityMask(0), mEnqueuePosition(0), mDequeuePosition(0)
+	{}
+
+	// This class is non-copyable
+	BoundedMPSCQueue(const BoundedMPSCQueue& rhs) = delete;
+
+	// This class is non-assignable
+	BoundedMPSCQueue& operator=(const BoundedMPSCQueue& rhs) = delete;
+
+	/// Destroys the \c BoundedMPSCQueue and releases all associated resources.
+	~BoundedMPSCQueue() = default;
+
+	// This class is non-movable
+	BoundedMPSCQueue(BoundedMPSCQueue&& rhs) = delete;
+
+	// This class is non-move assignable
+	BoundedMPSCQueue& operator=(BoundedMPSCQueue&& rhs) = delete;
+
+#pragma mark Buffer Management
+
+	/// Allocates space for values.
+	/// @note This method is not thread safe.
+	/// @note Capacities from 2 to 2,147,483,648 (0x80000000) values are supported
+	/// @param minimumCapacity The desired minimum capacity, in values
+	/// @return \c true on success, \c false on error
+	bool Allocate(size_t minimumCapacity) noexcept
+	{
+		if(minimumCapacity < 2 || minimumCapacity > 0x80000000)
+			return false;
+
+		// Round up to the next power of two
+		size_t capacity = 2;
+		while(capacity < minimumCapacity)
+			capacity <<= 1;
+
+		mCells.reset(new (std::nothrow) Cell [capacity]);
+		if(!mCells)
+			return false;
+
+		for(size_t i = 0; i < capacity; ++i)
+			mCells[i].mSequence.store(i, std::memory_order_relaxed);
+
+		mCapacityMask = capacity - 1;
+		mEnqueuePosition.store(0, std::memory_order_relaxed);
+		mDequeuePosition.store(0, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	/// Returns the capacity of this \c BoundedMPSCQueue in values
+	inline size_t Capacity() const noexcept
+	{
+		return mCells ? mCapacityMask + 1 : 0;
+	}
+
+#pragma mark Producer
+
+	/// Appends \c value to the end of the queue
+	/// @note This method is safe to call from multiple threads concurrently
+	/// @return \c true on success, \c false if the queue is full
+	bool TryPush(T value) noexcept
+	{
+		Cell *cell = nullptr;
+		auto position = mEnqueuePosition.load(std::memory_order_relaxed);
+		for(;;) {
+			cell = &mCells[position & mCapacityMask];
+			auto sequence = cell->mSequence.load(std::memory_order_acquire);
+			auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+			if(difference == 0) {
+				if(mEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if(difference < 0)
+				return false;
+			else
+				position = mEnqueuePosition.load(std::memory_order_relaxed);
+		}
+
+		cell->mValue = std::move(value);
+		cell->mSequence.store(position + 1, std::memory_order_release);
+
+		return true;
+	}
+
+#pragma mark Consumer
+
+	/// Removes the value at the front of the queue
+	/// @param value The value removed from the queue
+	/// @return \c true on success, \c false if the queue is empty
+	bool TryPop(T& value) noexcept
+	{
+		auto position = mDequeuePosition.load(std::memory_order_relaxed);
+		auto cell = &mCells[position & mCapacityMask];
+		auto sequence = cell->mSequence.load(std::memory_order_acquire);
+		if(static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1) < 0)
+			return false;
+
+		value = std::move(cell->mValue);
+		cell->mValue = T{};
+		cell->mSequence.store(position + mCapacityMask + 1, std::memory_order_release);
+		mDequeuePosition.store(position + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/// Returns a pointer to the value at the front of the queue or \c nullptr if the queue is empty
+	/// @note The returned pointer is valid until the next consumer operation
+	T * Front() noexcept
+	{
+		auto position = mDequeuePosition.load(std::memory_order_relaxed);
+		auto cell = &mCells[position & mCapacityMask];
+		auto sequence = cell->mSequence.load(std::memory_order_acquire);
+		if(static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1) < 0)
+			return nullptr;
+		return &cell->mValue;
+	}
+
+	/// Removes all values from the queue
+	/// @note Values pushed concurrently with this method may or may not be removed
+	void Clear() noexcept
+	{
+		T value;
+		while(TryPop(value))
+			;
+	}
+
+	/// Returns \c true if the queue contains no values
+	/// @note From threads other than the consumer the result is approximate
+	bool IsEmpty() const noexcept
+	{
+		return mEnqueuePosition.load(std::memory_order_acquire) == mDequeuePosition.load(std::memory_order_acquire);
+	}
+
+private:
+
+	/// A slot in the queue
+	struct Cell {
+		/// The sequence number controlling access to \c mValue
+		std::atomic_size_t mSequence;
+		/// The stored value
+		T mValue;
+	};
+
+	/// The slots
+	std::unique_ptr<Cell []> mCells;
+	/// The capacity minus one
+	size_t mCapacityMask;
+
+	/// The position at which the next value will be pushed
+	alignas(64) std::atomic_size_t mEnqueuePosition;
+	/// The position from which the next value will be popped
+	alignas(64) std::atomic_size_t mDequeuePosition;
+
+};
+
+} // namespace SFB
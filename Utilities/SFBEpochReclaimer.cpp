@@ -0,0 +1,113 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#include <algorithm>
+#include <new>
+#include <thread>
+
+#include "SFBEpochReclaimer.hpp"
+
+constexpr uint32_t SFB::EpochReclaimer::kParticipantCount;
+constexpr uint32_t SFB::EpochReclaimer::kDedicatedParticipantCount;
+constexpr uint64_t SFB::EpochReclaimer::kInactive;
+
+SFB::EpochReclaimer::EpochReclaimer() noexcept
+: mEpoch(1)
+{
+	for(auto& participant : mParticipants)
+		participant.mEpoch.store(kInactive);
+}
+
+SFB::EpochReclaimer::~EpochReclaimer()
+{
+	ReclaimAll();
+}
+
+#pragma mark Readers
+
+uint32_t SFB::EpochReclaimer::EnterShared() noexcept
+{
+	for(;;) {
+		for(auto i = kDedicatedParticipantCount; i < kParticipantCount; ++i) {
+			auto expected = kInactive;
+			if(mParticipants[i].mEpoch.load(std::memory_order_relaxed) == kInactive && mParticipants[i].mEpoch.compare_exchange_strong(expected, mEpoch.load()))
+				return i;
+		}
+		// All shared slots are in use
+		std::this_thread::yield();
+	}
+}
+
+#pragma mark Reclamation
+
+void SFB::EpochReclaimer::Retire(void *object, Deleter deleter) noexcept
+{
+	if(!object || !deleter)
+		return;
+
+	std::unique_lock<std::mutex> lock(mLock);
+	try {
+		mRetiredObjects.push_back({ object, deleter, mEpoch.load() });
+		return;
+	}
+
+	catch(const std::bad_alloc&) {}
+
+	// Without space to defer deletion wait until no reader may refer to the object
+	const auto epoch = mEpoch.load();
+	while(mEpoch.load() < epoch + 2) {
+		TryAdvanceEpoch();
+		if(mEpoch.load() < epoch + 2) {
+			lock.unlock();
+			std::this_thread::yield();
+			lock.lock();
+		}
+	}
+	lock.unlock();
+
+	deleter(object);
+}
+
+size_t SFB::EpochReclaimer::Reclaim() noexcept
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	if(mRetiredObjects.empty())
+		return 0;
+
+	TryAdvanceEpoch();
+
+	const auto epoch = mEpoch.load();
+	auto reclaimable = std::partition(mRetiredObjects.begin(), mRetiredObjects.end(), [epoch](const RetiredObject& retiredObject) {
+		return retiredObject.mEpoch + 2 > epoch;
+	});
+
+	for(auto iter = reclaimable; iter != mRetiredObjects.end(); ++iter)
+		iter->mDeleter(iter->mObject);
+	mRetiredObjects.erase(reclaimable, mRetiredObjects.end());
+
+	return mRetiredObjects.size();
+}
+
+void SFB::EpochReclaimer::ReclaimAll() noexcept
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	for(const auto& retiredObject : mRetiredObjects)
+		retiredObject.mDeleter(retiredObject.mObject);
+	mRetiredObjects.clear();
+}
+
+void SFB::EpochReclaimer::TryAdvanceEpoch() noexcept
+{
+	auto epoch = mEpoch.load();
+	for(const auto& participant : mParticipants) {
+		const auto participantEpoch = participant.mEpoch.load();
+		if(participantEpoch != kInactive && participantEpoch != epoch)
+			return;
+	}
+
+	// Only one thread advances the epoch since mLock is held
+	mEpoch.store(epoch + 1);
+}
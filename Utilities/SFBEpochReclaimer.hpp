@@ -0,0 +1,184 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace SFB {
+
+/// Epoch-based reclamation of objects shared with lock-free readers
+///
+/// Readers access shared objects only between \c Enter() and \c Exit(). An object that has been made unreachable is
+/// passed to \c Retire() and deleted by a later call to \c Reclaim() once every reader that might still refer to it
+/// has exited.
+///
+/// A global epoch advances only when every reader in a critical section has observed the current epoch. An object
+/// retired during epoch \c e is deleted once the epoch reaches \c e+2, by which time no reader can hold a reference
+/// obtained before the object became unreachable.
+///
+/// Readers use participant slots. The first \c kDedicatedParticipantCount slots belong to specific threads, such as a
+/// real-time thread, and entering and exiting a critical section with one is wait-free. Other readers claim one of the
+/// remaining shared slots with a compare-and-swap.
+///
+/// \c Retire() and \c Reclaim() lock a mutex and may allocate so they must not be called from a real-time thread.
+class EpochReclaimer
+{
+
+public:
+
+	/// The number of participant slots
+	static constexpr uint32_t kParticipantCount = 32;
+	/// The number of participant slots reserved for use with \c Enter()
+	static constexpr uint32_t kDedicatedParticipantCount = 4;
+
+	/// A function deleting a retired object
+	using Deleter = void (*)(void *object);
+
+	/// A critical section entered for the lifetime of the object
+	class Guard
+	{
+
+	public:
+
+		/// Enters a critical section using the dedicated slot \c participant
+		Guard(EpochReclaimer& reclaimer, uint32_t participant) noexcept
+		: mReclaimer(reclaimer), mParticipant(participant)
+		{
+			mReclaimer.Enter(mParticipant);
+		}
+
+		/// Enters a critical section using a shared slot
+		explicit Guard(EpochReclaimer& reclaimer) noexcept
+		: mReclaimer(reclaimer), mParticipant(reclaimer.EnterShared())
+		{}
+
+		/// Exits the critical section
+		~Guard()
+		{
+			mReclaimer.Exit(mParticipant);
+		}
+
+		// This class is non-copyable
+		Guard(const Guard& rhs) = delete;
+
+		// This class is non-assignable
+		Guard& operator=(const Guard& rhs) = delete;
+
+	private:
+
+		/// The reclaimer
+		EpochReclaimer& mReclaimer;
+		/// The participant slot
+		const uint32_t mParticipant;
+
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c EpochReclaimer
+	EpochReclaimer() noexcept;
+
+	// This class is non-copyable
+	EpochReclaimer(const EpochReclaimer& rhs) = delete;
+
+	// This class is non-assignable
+	EpochReclaimer& operator=(const EpochReclaimer& rhs) = delete;
+
+	/// Destroys the \c EpochReclaimer and deletes all retired objects
+	/// @note No reader may be in a critical section
+	~EpochReclaimer();
+
+	// This class is non-movable
+	EpochReclaimer(EpochReclaimer&& rhs) = delete;
+
+	// This class is non-move assignable
+	EpochReclaimer& operator=(EpochReclaimer&& rhs) = delete;
+
+#pragma mark Readers
+
+	/// Enters a critical section using the dedicated slot \c participant
+	/// @note \c participant must be less than \c kDedicatedParticipantCount and critical sections using the same slot
+	/// may not overlap
+	inline void Enter(uint32_t participant) noexcept
+	{
+		mParticipants[participant].mEpoch.store(mEpoch.load());
+	}
+
+	/// Enters a critical section using a shared slot
+	/// @return The slot to pass to \c Exit()
+	uint32_t EnterShared() noexcept;
+
+	/// Exits the critical section entered using \c participant
+	inline void Exit(uint32_t participant) noexcept
+	{
+		mParticipants[participant].mEpoch.store(kInactive);
+	}
+
+#pragma mark Reclamation
+
+	/// Schedules \c object for deletion by \c deleter once no reader may refer to it
+	/// @note \c object must already be unreachable by readers entering a critical section
+	void Retire(void *object, Deleter deleter) noexcept;
+
+	/// Advances the epoch if possible and deletes retired objects no reader may refer to
+	/// @return The number of retired objects remaining
+	size_t Reclaim() noexcept;
+
+	/// Deletes all retired objects
+	/// @note No reader may be in a critical section
+	void ReclaimAll() noexcept;
+
+private:
+
+	/// The epoch of an inactive participant
+	static constexpr uint64_t kInactive = 0;
+
+	/// A participant slot padded to occupy its own cache line
+	///
+	/// Padding is used instead of \c alignas since instances may be allocated with less than cache line alignment.
+	struct Participant
+	{
+		/// The epoch observed on entering a critical section or \c kInactive
+		std::atomic_uint64_t mEpoch;
+		/// Padding
+		char mPadding [64 - sizeof(std::atomic_uint64_t)];
+	};
+
+	/// A retired object
+	struct RetiredObject
+	{
+		/// The object
+		void *mObject;
+		/// The function deleting \c mObject
+		Deleter mDeleter;
+		/// The epoch in which \c mObject was retired
+		uint64_t mEpoch;
+	};
+
+	/// Advances the epoch if every active participant has observed it
+	/// @note \c mLock must be held
+	void TryAdvanceEpoch() noexcept;
+
+	/// The global epoch
+	std::atomic_uint64_t mEpoch;
+	/// Padding separating \c mEpoch from the participant slots
+	char mPadding [64 - sizeof(std::atomic_uint64_t)];
+	/// The participant slots
+	Participant mParticipants [kParticipantCount];
+
+	/// The lock protecting \c mRetiredObjects
+	std::mutex mLock;
+	/// Objects awaiting deletion
+	std::vector<RetiredObject> mRetiredObjects;
+
+};
+
+} // namespace SFB
@@ -0,0 +1,159 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "SFBMultiReaderRingBuffer.hpp"
+
+SFB::MultiReaderRingBuffer::MultiReaderRingBuffer() noexcept
+: mChannelCount(0), mCapacityFrames(0), mCapacityFramesMask(0), mMaximumReaderCount(0), mWritePosition(0)
+{}
+
+#pragma mark Buffer Management
+
+bool SFB::MultiReaderRingBuffer::Allocate(uint32_t channelCount, uint32_t capacityFrames, uint32_t maximumReaderCount) noexcept
+{
+	if(channelCount == 0 || maximumReaderCount == 0)
+		return false;
+
+	if(capacityFrames < 2 || capacityFrames > 0x80000000)
+		return false;
+
+	Deallocate();
+
+	// Round up to the next power of two
+	uint32_t capacity = 2;
+	while(capacity < capacityFrames)
+		capacity <<= 1;
+
+	mStorage.reset(new (std::nothrow) float [static_cast<size_t>(capacity) * channelCount]);
+	mReadPositions.reset(new (std::nothrow) uint64_t [maximumReaderCount]);
+	mAttached.reset(new (std::nothrow) bool [maximumReaderCount]);
+	if(!mStorage || !mReadPositions || !mAttached) {
+		Deallocate();
+		return false;
+	}
+
+	std::fill_n(mReadPositions.get(), maximumReaderCount, 0);
+	std::fill_n(mAttached.get(), maximumReaderCount, false);
+
+	mChannelCount = channelCount;
+	mCapacityFrames = capacity;
+	mCapacityFramesMask = capacity - 1;
+	mMaximumReaderCount = maximumReaderCount;
+	mWritePosition = 0;
+
+	return true;
+}
+
+void SFB::MultiReaderRingBuffer::Deallocate() noexcept
+{
+	mStorage.reset();
+	mReadPositions.reset();
+	mAttached.reset();
+
+	mChannelCount = 0;
+	mCapacityFrames = 0;
+	mCapacityFramesMask = 0;
+	mMaximumReaderCount = 0;
+	mWritePosition = 0;
+}
+
+#pragma mark Readers
+
+int SFB::MultiReaderRingBuffer::AttachReader() noexcept
+{
+	for(uint32_t i = 0; i < mMaximumReaderCount; ++i) {
+		if(!mAttached[i]) {
+			mAttached[i] = true;
+			mReadPositions[i] = mWritePosition;
+			return static_cast<int>(i);
+		}
+	}
+
+	return -1;
+}
+
+void SFB::MultiReaderRingBuffer::DetachReader(int reader) noexcept
+{
+	if(reader >= 0 && static_cast<uint32_t>(reader) < mMaximumReaderCount)
+		mAttached[reader] = false;
+}
+
+bool SFB::MultiReaderRingBuffer::IsAttached(int reader) const noexcept
+{
+	return reader >= 0 && static_cast<uint32_t>(reader) < mMaximumReaderCount && mAttached[reader];
+}
+
+uint32_t SFB::MultiReaderRingBuffer::AttachedReaderCount() const noexcept
+{
+	return static_cast<uint32_t>(std::count(mAttached.get(), mAttached.get() + mMaximumReaderCount, true));
+}
+
+uint64_t SFB::MultiReaderRingBuffer::ReadPosition(int reader) const noexcept
+{
+	return IsAttached(reader) ? mReadPositions[reader] : 0;
+}
+
+uint32_t SFB::MultiReaderRingBuffer::FramesAvailableToRead(int reader) const noexcept
+{
+	return IsAttached(reader) ? static_cast<uint32_t>(mWritePosition - mReadPositions[reader]) : 0;
+}
+
+uint32_t SFB::MultiReaderRingBuffer::Read(int reader, float * const *channels, uint32_t frameOffset, uint32_t frameCount) noexcept
+{
+	const auto framesToRead = std::min(FramesAvailableToRead(reader), frameCount);
+	if(framesToRead == 0)
+		return 0;
+
+	const auto readOffset = static_cast<uint32_t>(mReadPositions[reader] & mCapacityFramesMask);
+	const auto firstFrameCount = std::min(framesToRead, mCapacityFrames - readOffset);
+	for(uint32_t i = 0; i < mChannelCount; ++i) {
+		const auto channel = mStorage.get() + static_cast<size_t>(i) * mCapacityFrames;
+		std::memcpy(channels[i] + frameOffset, channel + readOffset, firstFrameCount * sizeof(float));
+		if(firstFrameCount < framesToRead)
+			std::memcpy(channels[i] + frameOffset + firstFrameCount, channel, (framesToRead - firstFrameCount) * sizeof(float));
+	}
+
+	mReadPositions[reader] += framesToRead;
+
+	return framesToRead;
+}
+
+#pragma mark Writer
+
+uint32_t SFB::MultiReaderRingBuffer::FramesAvailableToWrite() const noexcept
+{
+	uint64_t minimumReadPosition = mWritePosition;
+	for(uint32_t i = 0; i < mMaximumReaderCount; ++i) {
+		if(mAttached[i])
+			minimumReadPosition = std::min(minimumReadPosition, mReadPositions[i]);
+	}
+
+	return mCapacityFrames - static_cast<uint32_t>(mWritePosition - minimumReadPosition);
+}
+
+uint32_t SFB::MultiReaderRingBuffer::Write(const float * const *channels, uint32_t frameCount) noexcept
+{
+	const auto framesToWrite = std::min(FramesAvailableToWrite(), frameCount);
+	if(framesToWrite == 0)
+		return 0;
+
+	const auto writeOffset = static_cast<uint32_t>(mWritePosition & mCapacityFramesMask);
+	const auto firstFrameCount = std::min(framesToWrite, mCapacityFrames - writeOffset);
+	for(uint32_t i = 0; i < mChannelCount; ++i) {
+		const auto channel = mStorage.get() + static_cast<size_t>(i) * mCapacityFrames;
+		std::memcpy(channel + writeOffset, channels[i], firstFrameCount * sizeof(float));
+		if(firstFrameCount < framesToWrite)
+			std::memcpy(channel, channels[i] + firstFrameCount, (framesToWrite - firstFrameCount) * sizeof(float));
+	}
+
+	mWritePosition += framesToWrite;
+
+	return framesToWrite;
+}
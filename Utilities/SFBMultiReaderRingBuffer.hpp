@@ -0,0 +1,149 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+namespace SFB {
+
+/// A ring buffer of deinterleaved 32-bit floating point audio written once and read independently by several readers
+///
+/// Each attached reader has its own read position. Space becomes available for writing only after every attached
+/// reader has read it, so the slowest reader limits the writer. A reader attaches at the current write position and
+/// detaching a reader removes it from consideration.
+///
+/// This class is not thread safe; callers must serialize access.
+class MultiReaderRingBuffer
+{
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c MultiReaderRingBuffer
+	/// @note \c Allocate() must be called before the object may be used.
+	MultiReaderRingBuffer() noexcept;
+
+	// This class is non-copyable
+	MultiReaderRingBuffer(const MultiReaderRingBuffer& rhs) = delete;
+
+	// This class is non-assignable
+	MultiReaderRingBuffer& operator=(const MultiReaderRingBuffer& rhs) = delete;
+
+	/// Destroys the \c MultiReaderRingBuffer and releases all associated resources.
+	~MultiReaderRingBuffer() = default;
+
+	// This class is non-movable
+	MultiReaderRingBuffer(MultiReaderRingBuffer&& rhs) = delete;
+
+	// This class is non-move assignable
+	MultiReaderRingBuffer& operator=(MultiReaderRingBuffer&& rhs) = delete;
+
+#pragma mark Buffer Management
+
+	/// Allocates space for audio data and readers
+	/// @note Capacities from 2 to 2,147,483,648 (0x80000000) frames are supported
+	/// @param channelCount The number of channels of audio
+	/// @param capacityFrames The desired capacity, in frames
+	/// @param maximumReaderCount The maximum number of simultaneously attached readers
+	/// @return \c true on success, \c false on error
+	bool Allocate(uint32_t channelCount, uint32_t capacityFrames, uint32_t maximumReaderCount) noexcept;
+
+	/// Frees the resources used by this \c MultiReaderRingBuffer
+	void Deallocate() noexcept;
+
+	/// Returns the capacity of this \c MultiReaderRingBuffer in frames
+	inline uint32_t CapacityFrames() const noexcept
+	{
+		return mCapacityFrames;
+	}
+
+	/// Returns the number of channels of audio
+	inline uint32_t ChannelCount() const noexcept
+	{
+		return mChannelCount;
+	}
+
+	/// Returns the maximum number of simultaneously attached readers
+	inline uint32_t MaximumReaderCount() const noexcept
+	{
+		return mMaximumReaderCount;
+	}
+
+#pragma mark Readers
+
+	/// Attaches a reader positioned at the current write position
+	/// @return The index of the reader or \c -1 if the maximum number of readers are attached
+	int AttachReader() noexcept;
+
+	/// Detaches a reader, making the space it has not read available for writing
+	void DetachReader(int reader) noexcept;
+
+	/// Returns \c true if \c reader is attached
+	bool IsAttached(int reader) const noexcept;
+
+	/// Returns the number of attached readers
+	uint32_t AttachedReaderCount() const noexcept;
+
+	/// Returns the total number of frames read by \c reader since the buffer was allocated
+	uint64_t ReadPosition(int reader) const noexcept;
+
+	/// Returns the number of frames available for reading by \c reader
+	uint32_t FramesAvailableToRead(int reader) const noexcept;
+
+	/// Reads audio and advances the read position of \c reader
+	/// @param reader The index of the reader
+	/// @param channels The buffers to receive the audio, one per channel
+	/// @param frameOffset The offset in \c channels at which to store the audio, in frames
+	/// @param frameCount The desired number of frames to read
+	/// @return The number of frames actually read
+	uint32_t Read(int reader, float * const * _Nonnull channels, uint32_t frameOffset, uint32_t frameCount) noexcept;
+
+#pragma mark Writer
+
+	/// Returns the total number of frames written since the buffer was allocated
+	inline uint64_t WritePosition() const noexcept
+	{
+		return mWritePosition;
+	}
+
+	/// Returns the number of frames available for writing
+	///
+	/// This is limited by the attached reader with the lowest read position.
+	uint32_t FramesAvailableToWrite() const noexcept;
+
+	/// Writes audio and advances the write position
+	/// @param channels The buffers containing the audio, one per channel
+	/// @param frameCount The desired number of frames to write
+	/// @return The number of frames actually written
+	uint32_t Write(const float * const * _Nonnull channels, uint32_t frameCount) noexcept;
+
+private:
+
+	/// The storage for all channels
+	std::unique_ptr<float []> mStorage;
+	/// The number of channels
+	uint32_t mChannelCount;
+	/// The capacity of each channel in frames
+	uint32_t mCapacityFrames;
+	/// The capacity minus one
+	uint32_t mCapacityFramesMask;
+
+	/// The read positions of the readers
+	std::unique_ptr<uint64_t []> mReadPositions;
+	/// Whether each reader is attached
+	std::unique_ptr<bool []> mAttached;
+	/// The maximum number of readers
+	uint32_t mMaximumReaderCount;
+
+	/// The total number of frames written
+	uint64_t mWritePosition;
+
+};
+
+} // namespace SFB
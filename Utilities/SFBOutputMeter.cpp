@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#include <Accelerate/Accelerate.h>
+#include <mach/mach_time.h>
+
+#include "SFBOutputMeter.hpp"
+
+namespace {
+
+/// Returns the number of host ticks in \c seconds
+uint64_t ConvertSecondsToHostTicks(double seconds) noexcept
+{
+	static const auto nanosPerHostTick = [] {
+		mach_timebase_info_data_t timebase_info;
+		mach_timebase_info(&timebase_info);
+		return static_cast<double>(timebase_info.denom) / static_cast<double>(timebase_info.numer);
+	}();
+	return static_cast<uint64_t>(seconds * NSEC_PER_SEC * nanosPerHostTick);
+}
+
+} // namespace
+
+constexpr uint32_t SFB::OutputMeter::kMaximumChannelCount;
+constexpr uint32_t SFB::OutputMeter::kClipScratchCapacity;
+
+SFB::OutputMeter::OutputMeter() noexcept
+: mIsEnabled(false), mIntervalFrameCount(0), mFrameCount(0), mPeaks{}, mSumsOfSquares{}, mClipCounts{}, mMeteredCycleCount(0), mMeteringTime(0), mMaximumMeteringTime(0)
+{}
+
+void SFB::OutputMeter::Measure(const AudioBufferList *bufferList, uint32_t frameCount, bool isSilence, uint64_t hostTime, double sampleRate) noexcept
+{
+	const auto startTime = mach_absolute_time();
+
+	// Measurement restarts whenever metering is enabled
+	if(!mIsEnabled) {
+		mIsEnabled = true;
+		mIntervalFrameCount = std::max(1u, static_cast<uint32_t>(kMeteringInterval * sampleRate));
+		mFrameCount = 0;
+		std::fill(std::begin(mPeaks), std::end(mPeaks), 0.f);
+		std::fill(std::begin(mSumsOfSquares), std::end(mSumsOfSquares), 0.);
+		std::fill(std::begin(mClipCounts), std::end(mClipCounts), 0);
+	}
+
+	const auto channelCount = std::min(static_cast<uint32_t>(bufferList->mNumberBuffers), kMaximumChannelCount);
+	if(!isSilence) {
+		for(uint32_t channel = 0; channel < channelCount; ++channel) {
+			const auto samples = static_cast<const float *>(bufferList->mBuffers[channel].mData);
+			float peak = 0;
+			vDSP_maxmgv(samples, 1, &peak, frameCount);
+			float sumOfSquares = 0;
+			vDSP_svesq(samples, 1, &sumOfSquares, frameCount);
+
+			mPeaks[channel] = std::max(mPeaks[channel], peak);
+			mSumsOfSquares[channel] += sumOfSquares;
+			// Clipping is rare so samples are only examined individually when the peak indicates it occurred
+			if(peak > 1)
+				mClipCounts[channel] += CountClippedSamples(samples, frameCount);
+		}
+	}
+
+	mFrameCount += frameCount;
+	if(mFrameCount >= mIntervalFrameCount) {
+		auto& levels = mLevels.WriteBuffer();
+		levels.mHostTime = hostTime + ConvertSecondsToHostTicks(frameCount / sampleRate);
+		levels.mChannelCount = channelCount;
+		for(uint32_t channel = 0; channel < channelCount; ++channel) {
+			levels.mChannels[channel] = { mPeaks[channel], static_cast<float>(std::sqrt(mSumsOfSquares[channel] / mFrameCount)), mClipCounts[channel] };
+			mPeaks[channel] = 0;
+			mSumsOfSquares[channel] = 0;
+		}
+		mLevels.Publish();
+		mFrameCount = 0;
+	}
+
+	const auto elapsed = mach_absolute_time() - startTime;
+	mMeteredCycleCount.fetch_add(1);
+	mMeteringTime.fetch_add(elapsed);
+	// Only the measuring thread updates the maximum
+	if(elapsed > mMaximumMeteringTime.load())
+		mMaximumMeteringTime.store(elapsed);
+}
+
+uint32_t SFB::OutputMeter::Read(ChannelLevels *levels, uint32_t channelCount, uint64_t *hostTime) noexcept
+{
+	std::lock_guard<std::mutex> lock(mReadLock);
+	mLevels.Acquire();
+	const auto& published = mLevels.ReadBuffer();
+	channelCount = std::min(channelCount, published.mChannelCount);
+	std::copy(published.mChannels, published.mChannels + channelCount, levels);
+	if(hostTime)
+		*hostTime = published.mHostTime;
+	return channelCount;
+}
+
+SFB::OutputMeter::Statistics SFB::OutputMeter::GetStatistics() const noexcept
+{
+	return { mMeteredCycleCount.load(), mMeteringTime.load(), mMaximumMeteringTime.load() };
+}
+
+void SFB::OutputMeter::ResetStatistics() noexcept
+{
+	mMeteredCycleCount.store(0);
+	mMeteringTime.store(0);
+	mMaximumMeteringTime.store(0);
+}
+
+uint64_t SFB::OutputMeter::CountClippedSamples(const float *samples, uint32_t frameCount) noexcept
+{
+	const float low = -1;
+	const float high = 1;
+	uint64_t clipCount = 0;
+	for(uint32_t offset = 0; offset < frameCount; offset += kClipScratchCapacity) {
+		vDSP_Length lowCount = 0;
+		vDSP_Length highCount = 0;
+		vDSP_vclipc(samples + offset, 1, &low, &high, mClipScratch, 1, std::min(frameCount - offset, kClipScratchCapacity), &lowCount, &highCount);
+		clipCount += lowCount + highCount;
+	}
+	return clipCount;
+}
@@ -0,0 +1,158 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include <CoreAudio/CoreAudioTypes.h>
+
+#include "SFBTripleBuffer.hpp"
+
+namespace SFB {
+
+/// Measures the levels of deinterleaved 32-bit floating point audio and publishes them for readers on other threads
+///
+/// Levels are accumulated over an interval of approximately \c kMeteringInterval seconds and published through a
+/// triple buffer, so measurement is wait-free and suitable for use from a real-time thread.
+///
+/// \c Measure() and \c Disable() must be called from a single thread; \c Read() may be called from any thread.
+class OutputMeter
+{
+
+public:
+
+	/// The maximum number of channels metered
+	static constexpr uint32_t kMaximumChannelCount 	= 8;
+	/// The approximate time between published levels in seconds
+	static constexpr double kMeteringInterval 		= 1.0 / 60;
+	/// The number of samples examined at once when counting clipped samples
+	static constexpr uint32_t kClipScratchCapacity 	= 256;
+
+	/// The levels of a single channel
+	struct ChannelLevels
+	{
+		/// The peak amplitude during the metering interval
+		float mPeak;
+		/// The RMS amplitude during the metering interval
+		float mRMS;
+		/// The number of samples exceeding full scale since metering was enabled
+		uint64_t mClipCount;
+	};
+
+	/// Metering cost statistics
+	struct Statistics
+	{
+		/// The number of calls to \c Measure()
+		uint64_t mMeteredCycleCount;
+		/// The total time spent in \c Measure() in host ticks
+		uint64_t mMeteringTime;
+		/// The longest time spent in a single call to \c Measure() in host ticks
+		uint64_t mMaximumMeteringTime;
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c OutputMeter
+	OutputMeter() noexcept;
+
+	// This class is non-copyable
+	OutputMeter(const OutputMeter& rhs) = delete;
+
+	// This class is non-assignable
+	OutputMeter& operator=(const OutputMeter& rhs) = delete;
+
+	/// Destroys the \c OutputMeter
+	~OutputMeter() = default;
+
+	// This class is non-movable
+	OutputMeter(OutputMeter&& rhs) = delete;
+
+	// This class is non-move assignable
+	OutputMeter& operator=(OutputMeter&& rhs) = delete;
+
+#pragma mark Measurement
+
+	/// Measures the levels of \c frameCount frames in \c bufferList and publishes them if a metering interval has elapsed
+	///
+	/// Each channel costs two vectorized reductions, plus a third if clipping occurred, so the time required is bounded
+	/// by \c kMaximumChannelCount passes over the audio
+	/// @param bufferList The audio to measure
+	/// @param frameCount The number of frames to measure
+	/// @param isSilence Whether \c bufferList contains only silence
+	/// @param hostTime The host time at which the first frame of \c bufferList is output
+	/// @param sampleRate The sample rate of \c bufferList
+	void Measure(const AudioBufferList * const _Nonnull bufferList, uint32_t frameCount, bool isSilence, uint64_t hostTime, double sampleRate) noexcept;
+
+	/// Notes that metering is disabled so measurement restarts when it is next enabled
+	inline void Disable() noexcept
+	{
+		mIsEnabled = false;
+	}
+
+#pragma mark Reading
+
+	/// Copies the most recently published levels for at most \c channelCount channels to \c levels
+	/// @param levels A buffer of at least \c channelCount values to receive the levels
+	/// @param channelCount The maximum number of channels to copy
+	/// @param hostTime An optional pointer to receive the host time at which the end of the measured audio is output
+	/// @return The number of channels copied
+	uint32_t Read(ChannelLevels * const _Nonnull levels, uint32_t channelCount, uint64_t * const _Nullable hostTime) noexcept;
+
+	/// Returns the metering cost statistics
+	Statistics GetStatistics() const noexcept;
+
+	/// Resets the metering cost statistics
+	void ResetStatistics() noexcept;
+
+private:
+
+	/// Published output levels
+	struct Levels
+	{
+		/// The host time at which the end of the measured audio is output
+		uint64_t mHostTime;
+		/// The number of channels in \c mChannels
+		uint32_t mChannelCount;
+		/// The levels for each channel
+		ChannelLevels mChannels [kMaximumChannelCount];
+	};
+
+	/// Returns the number of samples in \c samples exceeding full scale
+	uint64_t CountClippedSamples(const float * const _Nonnull samples, uint32_t frameCount) noexcept;
+
+	/// Whether metering was enabled during the previous call to \c Measure()
+	bool mIsEnabled;
+	/// The number of frames in a metering interval
+	uint32_t mIntervalFrameCount;
+	/// The number of frames measured in the current metering interval
+	uint32_t mFrameCount;
+	/// The peak amplitude of each channel in the current metering interval
+	float mPeaks [kMaximumChannelCount];
+	/// The sum of the squared samples of each channel in the current metering interval
+	double mSumsOfSquares [kMaximumChannelCount];
+	/// The number of clipped samples in each channel since metering was enabled
+	uint64_t mClipCounts [kMaximumChannelCount];
+	/// Scratch space for \c CountClippedSamples()
+	float mClipScratch [kClipScratchCapacity];
+
+	/// The most recently published levels
+	TripleBuffer<Levels> mLevels;
+	/// The lock serializing readers of \c mLevels
+	std::mutex mReadLock;
+
+	/// The number of calls to \c Measure()
+	std::atomic_uint64_t mMeteredCycleCount;
+	/// The total time spent measuring in host ticks
+	std::atomic_uint64_t mMeteringTime;
+	/// The longest time spent measuring in host ticks
+	std::atomic_uint64_t mMaximumMeteringTime;
+
+};
+
+} // namespace SFB
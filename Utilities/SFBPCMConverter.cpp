@@ -0,0 +1,142 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#include <algorithm>
+
+#include <Accelerate/Accelerate.h>
+
+#include "SFBPCMConverter.hpp"
+
+namespace {
+
+#pragma mark Kernels
+
+// vDSP selects the SSE, AVX, or NEON implementation appropriate for the processor at runtime
+
+void ConvertInt16ToFloat(const void *source, long sourceStride, float *destination, unsigned long count) noexcept
+{
+	const float scale = 1.f / 32768.f;
+	vDSP_vflt16(static_cast<const short *>(source), sourceStride, destination, 1, count);
+	vDSP_vsmul(destination, 1, &scale, destination, 1, count);
+}
+
+void ConvertInt24ToFloat(const void *source, long sourceStride, float *destination, unsigned long count) noexcept
+{
+	const float scale = 1.f / 8388608.f;
+	vDSP_vflt24(static_cast<const vDSP_int24 *>(source), sourceStride, destination, 1, count);
+	vDSP_vsmul(destination, 1, &scale, destination, 1, count);
+}
+
+void ConvertInt32ToFloat(const void *source, long sourceStride, float *destination, unsigned long count) noexcept
+{
+	const float scale = 1.f / 2147483648.f;
+	vDSP_vflt32(static_cast<const int *>(source), sourceStride, destination, 1, count);
+	vDSP_vsmul(destination, 1, &scale, destination, 1, count);
+}
+
+void ConvertFloatToFloat(const void *source, long sourceStride, float *destination, unsigned long count) noexcept
+{
+	if(sourceStride == 1)
+		std::copy_n(static_cast<const float *>(source), count, destination);
+	else
+		cblas_scopy(static_cast<int>(count), static_cast<const float *>(source), static_cast<int>(sourceStride), destination, 1);
+}
+
+#pragma mark Format Helpers
+
+/// Returns \c true if \c format is native-endian linear PCM
+bool IsNativeEndianPCM(const AudioStreamBasicDescription& format) noexcept
+{
+	return format.mFormatID == kAudioFormatLinearPCM && (format.mFormatFlags & kAudioFormatFlagIsBigEndian) == kAudioFormatFlagsNativeEndian && format.mChannelsPerFrame > 0 && format.mFramesPerPacket == 1;
+}
+
+/// Returns the number of bytes in each sample of \c format
+uint32_t BytesPerSample(const AudioStreamBasicDescription& format) noexcept
+{
+	return (format.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? format.mBytesPerFrame : format.mBytesPerFrame / format.mChannelsPerFrame;
+}
+
+/// Returns \c true if \c format is deinterleaved native-endian 32-bit floating point PCM
+bool IsDeinterleavedFloat(const AudioStreamBasicDescription& format) noexcept
+{
+	return IsNativeEndianPCM(format) && (format.mFormatFlags & kAudioFormatFlagIsFloat) && (format.mFormatFlags & kAudioFormatFlagIsNonInterleaved) && format.mBitsPerChannel == 32 && format.mBytesPerFrame == 4;
+}
+
+} // namespace
+
+SFB::PCMConverter::PCMConverter() noexcept
+: mKernel(nullptr), mChannelCount(0), mBytesPerSample(0), mSourceIsInterleaved(false)
+{}
+
+#pragma mark Configuration
+
+bool SFB::PCMConverter::IsSupported(const AudioStreamBasicDescription& sourceFormat, const AudioStreamBasicDescription& destinationFormat) noexcept
+{
+	PCMConverter converter;
+	return converter.Configure(sourceFormat, destinationFormat);
+}
+
+bool SFB::PCMConverter::Configure(const AudioStreamBasicDescription& sourceFormat, const AudioStreamBasicDescription& destinationFormat) noexcept
+{
+	mKernel = nullptr;
+
+	if(!IsNativeEndianPCM(sourceFormat) || !IsDeinterleavedFloat(destinationFormat))
+		return false;
+	if(sourceFormat.mSampleRate != destinationFormat.mSampleRate || sourceFormat.mChannelsPerFrame != destinationFormat.mChannelsPerFrame)
+		return false;
+
+	auto bytesPerSample = BytesPerSample(sourceFormat);
+	auto isFloat = (sourceFormat.mFormatFlags & kAudioFormatFlagIsFloat) != 0;
+	auto isSignedInteger = (sourceFormat.mFormatFlags & kAudioFormatFlagIsSignedInteger) != 0;
+
+	// Integer samples must occupy the most significant bits of their container
+	auto isPackedOrAlignedHigh = (sourceFormat.mFormatFlags & (kAudioFormatFlagIsPacked | kAudioFormatFlagIsAlignedHigh)) != 0 || sourceFormat.mBitsPerChannel == 8 * bytesPerSample;
+
+	Kernel kernel = nullptr;
+	if(isFloat && sourceFormat.mBitsPerChannel == 32 && bytesPerSample == 4)
+		kernel = ConvertFloatToFloat;
+	else if(isSignedInteger && isPackedOrAlignedHigh && sourceFormat.mBitsPerChannel <= 8 * bytesPerSample) {
+		switch(bytesPerSample) {
+			case 2: 	kernel = ConvertInt16ToFloat; 	break;
+			case 3: 	kernel = ConvertInt24ToFloat; 	break;
+			case 4: 	kernel = ConvertInt32ToFloat; 	break;
+		}
+	}
+
+	if(!kernel)
+		return false;
+
+	mKernel = kernel;
+	mChannelCount = sourceFormat.mChannelsPerFrame;
+	mBytesPerSample = bytesPerSample;
+	mSourceIsInterleaved = !(sourceFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved);
+
+	return true;
+}
+
+#pragma mark Conversion
+
+uint32_t SFB::PCMConverter::Convert(const AudioBufferList * const sourceBufferList, AudioBufferList * const destinationBufferList, uint32_t frameCount) const noexcept
+{
+	if(!mKernel || !sourceBufferList || !destinationBufferList)
+		return 0;
+	if(sourceBufferList->mNumberBuffers != (mSourceIsInterleaved ? 1 : mChannelCount) || destinationBufferList->mNumberBuffers != mChannelCount)
+		return 0;
+
+	for(uint32_t channel = 0; channel < mChannelCount; ++channel) {
+		auto destination = static_cast<float *>(destinationBufferList->mBuffers[channel].mData);
+		if(mSourceIsInterleaved) {
+			auto source = static_cast<const uint8_t *>(sourceBufferList->mBuffers[0].mData) + (channel * mBytesPerSample);
+			mKernel(source, mChannelCount, destination, frameCount);
+		}
+		else
+			mKernel(sourceBufferList->mBuffers[channel].mData, 1, destination, frameCount);
+
+		destinationBufferList->mBuffers[channel].mDataByteSize = static_cast<UInt32>(frameCount * sizeof(float));
+	}
+
+	return frameCount;
+}
@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <cstdint>
+
+#include <CoreAudio/CoreAudioTypes.h>
+
+namespace SFB {
+
+/// Converts linear PCM audio to deinterleaved native-endian 32-bit floating point PCM with the same channel count
+///
+/// Conversion is performed by a vectorized kernel selected for the source sample type when the converter is configured.
+/// The following source formats are supported, both interleaved and deinterleaved:
+///
+///  1. Native-endian signed 16-bit integer
+///  2. Native-endian signed 24-bit integer, packed in three bytes
+///  3. Native-endian signed 32-bit integer
+///  4. Native-endian 32-bit floating point
+///
+/// Integer samples with fewer valid bits than their container are supported if aligned high. No sample rate conversion or
+/// channel mapping is performed.
+class PCMConverter
+{
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c PCMConverter
+	/// @note \c Configure() must be called before the object may be used.
+	PCMConverter() noexcept;
+
+	// This class is copyable
+	PCMConverter(const PCMConverter& rhs) = default;
+
+	// This class is assignable
+	PCMConverter& operator=(const PCMConverter& rhs) = default;
+
+	/// Destroys the \c PCMConverter and releases all associated resources.
+	~PCMConverter() = default;
+
+#pragma mark Configuration
+
+	/// Returns \c true if conversion from \c sourceFormat to \c destinationFormat is supported
+	static bool IsSupported(const AudioStreamBasicDescription& sourceFormat, const AudioStreamBasicDescription& destinationFormat) noexcept;
+
+	/// Selects the conversion kernel for \c sourceFormat and \c destinationFormat
+	/// @return \c true on success, \c false if the conversion is not supported
+	bool Configure(const AudioStreamBasicDescription& sourceFormat, const AudioStreamBasicDescription& destinationFormat) noexcept;
+
+	/// Returns \c true if this \c PCMConverter has been successfully configured
+	inline bool IsConfigured() const noexcept
+	{
+		return mKernel != nullptr;
+	}
+
+#pragma mark Conversion
+
+	/// Converts audio
+	/// @param sourceBufferList An \c AudioBufferList containing audio in the source format
+	/// @param destinationBufferList An \c AudioBufferList to receive audio in the destination format
+	/// @param frameCount The number of frames to convert
+	/// @return The number of frames converted
+	uint32_t Convert(const AudioBufferList * const _Nonnull sourceBufferList, AudioBufferList * const _Nonnull destinationBufferList, uint32_t frameCount) const noexcept;
+
+private:
+
+	/// A conversion kernel for a single channel
+	/// @param source The first source sample
+	/// @param sourceStride The distance between consecutive source samples, in samples
+	/// @param destination The first destination sample
+	/// @param count The number of samples to convert
+	using Kernel = void (*)(const void * _Nonnull source, long sourceStride, float * _Nonnull destination, unsigned long count);
+
+	/// The kernel for the configured source format
+	Kernel _Nullable mKernel;
+	/// The number of channels
+	uint32_t mChannelCount;
+	/// The number of bytes in each source sample
+	uint32_t mBytesPerSample;
+	/// Whether the source format is interleaved
+	bool mSourceIsInterleaved;
+
+};
+
+} // namespace SFB
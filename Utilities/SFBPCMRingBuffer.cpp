@@ -0,0 +1,190 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "SFBPCMRingBuffer.hpp"
+
+namespace {
+
+/// Copies \c byteCount bytes from \c source at \c sourceOffset to \c destination at \c destinationOffset for each buffer
+void CopyBuffers(uint8_t * const *destination, size_t destinationOffset, const AudioBufferList *source, size_t sourceOffset, size_t byteCount, uint32_t bufferCount) noexcept
+{
+	for(uint32_t i = 0; i < bufferCount; ++i)
+		std::memcpy(destination[i] + destinationOffset, static_cast<const uint8_t *>(source->mBuffers[i].mData) + sourceOffset, byteCount);
+}
+
+/// Copies \c byteCount bytes from \c source at \c sourceOffset to \c destination at \c destinationOffset for each buffer
+void CopyBuffers(AudioBufferList *destination, size_t destinationOffset, uint8_t * const *source, size_t sourceOffset, size_t byteCount, uint32_t bufferCount) noexcept
+{
+	for(uint32_t i = 0; i < bufferCount; ++i)
+		std::memcpy(static_cast<uint8_t *>(destination->mBuffers[i].mData) + destinationOffset, source[i] + sourceOffset, byteCount);
+}
+
+} // namespace
+
+SFB::PCMRingBuffer::PCMRingBuffer() noexcept
+: mBufferCount(0), mCapacityFrames(0), mCapacityFramesMask(0), mWritePosition(0), mReadPosition(0)
+{}
+
+#pragma mark Buffer Management
+
+bool SFB::PCMRingBuffer::Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames) noexcept
+{
+	// Only PCM formats with a fixed frame size are supported
+	if(format.mFormatID != kAudioFormatLinearPCM || format.mBytesPerFrame == 0 || format.mChannelsPerFrame == 0)
+		return false;
+
+	if(capacityFrames < 2 || capacityFrames > 0x80000000)
+		return false;
+
+	Deallocate();
+
+	// Round up to the next power of two
+	uint32_t capacity = 2;
+	while(capacity < capacityFrames)
+		capacity <<= 1;
+
+	uint32_t bufferCount = (format.mFormatFlags & kAudioFormatFlagIsNonInterleaved) ? format.mChannelsPerFrame : 1;
+	size_t bytesPerBuffer = static_cast<size_t>(capacity) * format.mBytesPerFrame;
+
+	mStorage.reset(new (std::nothrow) uint8_t [bytesPerBuffer * bufferCount]);
+	mBuffers.reset(new (std::nothrow) uint8_t * [bufferCount]);
+	if(!mStorage || !mBuffers) {
+		Deallocate();
+		return false;
+	}
+
+	for(uint32_t i = 0; i < bufferCount; ++i)
+		mBuffers[i] = mStorage.get() + (i * bytesPerBuffer);
+
+	mFormat = format;
+	mBufferCount = bufferCount;
+	mCapacityFrames = capacity;
+	mCapacityFramesMask = capacity - 1;
+
+	mWritePosition.store(0, std::memory_order_relaxed);
+	mReadPosition.store(0, std::memory_order_relaxed);
+
+	return true;
+}
+
+void SFB::PCMRingBuffer::Deallocate() noexcept
+{
+	mStorage.reset();
+	mBuffers.reset();
+
+	mBufferCount = 0;
+	mCapacityFrames = 0;
+	mCapacityFramesMask = 0;
+
+	mWritePosition.store(0, std::memory_order_relaxed);
+	mReadPosition.store(0, std::memory_order_relaxed);
+}
+
+void SFB::PCMRingBuffer::Reset() noexcept
+{
+	mWritePosition.store(0, std::memory_order_relaxed);
+	mReadPosition.store(0, std::memory_order_relaxed);
+}
+
+#pragma mark Buffer Usage
+
+uint32_t SFB::PCMRingBuffer::Read(AudioBufferList * const bufferList, uint32_t frameCount) noexcept
+{
+	if(!bufferList || bufferList->mNumberBuffers != mBufferCount || frameCount == 0)
+		return 0;
+
+	auto vector = GetReadVector();
+	auto framesToRead = std::min(frameCount, vector.FrameCount());
+	if(framesToRead == 0)
+		return 0;
+
+	auto firstFrames = std::min(framesToRead, vector.mFirst.mFrameCount);
+	CopyBuffers(bufferList, 0, mBuffers.get(), mFormat.FrameCountToByteSize(vector.mFirst.mFrameOffset), mFormat.FrameCountToByteSize(firstFrames), mBufferCount);
+	if(framesToRead > firstFrames)
+		CopyBuffers(bufferList, mFormat.FrameCountToByteSize(firstFrames), mBuffers.get(), 0, mFormat.FrameCountToByteSize(framesToRead - firstFrames), mBufferCount);
+
+	auto byteCount = static_cast<UInt32>(mFormat.FrameCountToByteSize(framesToRead));
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i)
+		bufferList->mBuffers[i].mDataByteSize = byteCount;
+
+	CommitRead(framesToRead);
+
+	return framesToRead;
+}
+
+uint32_t SFB::PCMRingBuffer::Write(const AudioBufferList * const bufferList, uint32_t frameCount) noexcept
+{
+	if(!bufferList || bufferList->mNumberBuffers != mBufferCount || frameCount == 0)
+		return 0;
+
+	auto vector = GetWriteVector();
+	auto framesToWrite = std::min(frameCount, vector.FrameCount());
+	if(framesToWrite == 0)
+		return 0;
+
+	auto firstFrames = std::min(framesToWrite, vector.mFirst.mFrameCount);
+	CopyBuffers(mBuffers.get(), mFormat.FrameCountToByteSize(vector.mFirst.mFrameOffset), bufferList, 0, mFormat.FrameCountToByteSize(firstFrames), mBufferCount);
+	if(framesToWrite > firstFrames)
+		CopyBuffers(mBuffers.get(), 0, bufferList, mFormat.FrameCountToByteSize(firstFrames), mFormat.FrameCountToByteSize(framesToWrite - firstFrames), mBufferCount);
+
+	CommitWrite(framesToWrite);
+
+	return framesToWrite;
+}
+
+#pragma mark Direct Access
+
+SFB::PCMRingBuffer::Vector SFB::PCMRingBuffer::GetReadVector() const noexcept
+{
+	auto readPosition = mReadPosition.load(std::memory_order_relaxed);
+	auto framesAvailable = static_cast<uint32_t>(mWritePosition.load(std::memory_order_acquire) - readPosition);
+	return MakeVector(readPosition, framesAvailable);
+}
+
+void SFB::PCMRingBuffer::CommitRead(uint32_t frameCount) noexcept
+{
+	mReadPosition.fetch_add(frameCount, std::memory_order_release);
+}
+
+SFB::PCMRingBuffer::Vector SFB::PCMRingBuffer::GetWriteVector() const noexcept
+{
+	auto writePosition = mWritePosition.load(std::memory_order_relaxed);
+	auto framesAvailable = mCapacityFrames - static_cast<uint32_t>(writePosition - mReadPosition.load(std::memory_order_acquire));
+	return MakeVector(writePosition, framesAvailable);
+}
+
+void SFB::PCMRingBuffer::CommitWrite(uint32_t frameCount) noexcept
+{
+	mWritePosition.fetch_add(frameCount, std::memory_order_release);
+}
+
+bool SFB::PCMRingBuffer::GetBufferList(const Region& region, AudioBufferList * const bufferList) const noexcept
+{
+	if(!bufferList || bufferList->mNumberBuffers != mBufferCount)
+		return false;
+
+	auto offset = mFormat.FrameCountToByteSize(region.mFrameOffset);
+	auto byteCount = static_cast<UInt32>(mFormat.FrameCountToByteSize(region.mFrameCount));
+	auto channelsPerBuffer = mBufferCount == 1 ? mFormat.mChannelsPerFrame : 1;
+	for(UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
+		bufferList->mBuffers[i].mNumberChannels = channelsPerBuffer;
+		bufferList->mBuffers[i].mData = mBuffers[i] + offset;
+		bufferList->mBuffers[i].mDataByteSize = byteCount;
+	}
+
+	return true;
+}
+
+SFB::PCMRingBuffer::Vector SFB::PCMRingBuffer::MakeVector(size_t position, uint32_t frameCount) const noexcept
+{
+	auto offset = static_cast<uint32_t>(position) & mCapacityFramesMask;
+	auto firstFrames = std::min(frameCount, mCapacityFrames - offset);
+	return { { offset, firstFrames }, { 0, frameCount - firstFrames } };
+}
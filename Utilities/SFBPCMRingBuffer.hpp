@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <CoreAudio/CoreAudioTypes.h>
+
+#include "SFBCAStreamBasicDescription.hpp"
+
+namespace SFB {
+
+/// A ring buffer supporting non-interleaved and interleaved PCM audio with direct access to its storage
+///
+/// In addition to copying reads and writes using an \c AudioBufferList, the regions of the ring buffer available for
+/// reading or writing may be obtained with \c GetReadVector() and \c GetWriteVector(). This allows audio to be
+/// produced or consumed in place, avoiding an intermediate copy.
+///
+/// This class is thread safe when used from one reader thread and one writer thread (single producer, single consumer
+/// model).
+class PCMRingBuffer
+{
+
+public:
+
+	/// A contiguous region of the ring buffer
+	struct Region {
+		/// The offset of the region from the start of each buffer, in frames
+		uint32_t mFrameOffset;
+		/// The number of frames in the region
+		uint32_t mFrameCount;
+	};
+
+	/// The regions of the ring buffer available for reading or writing
+	///
+	/// \c mSecond is empty unless the available space wraps around the end of the ring buffer
+	struct Vector {
+		/// The region beginning at the current read or write position
+		Region mFirst;
+		/// The region beginning at the start of the ring buffer
+		Region mSecond;
+
+		/// Returns the total number of frames in both regions
+		inline uint32_t FrameCount() const noexcept
+		{
+			return mFirst.mFrameCount + mSecond.mFrameCount;
+		}
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c PCMRingBuffer
+	/// @note \c Allocate() must be called before the object may be used.
+	PCMRingBuffer() noexcept;
+
+	// This class is non-copyable
+	PCMRingBuffer(const PCMRingBuffer& rhs) = delete;
+
+	// This class is non-assignable
+	PCMRingBuffer& operator=(const PCMRingBuffer& rhs) = delete;
+
+	/// Destroys the \c PCMRingBuffer and release all associated resources.
+	~PCMRingBuffer() = default;
+
+	// This class is non-movable
+	PCMRingBuffer(PCMRingBuffer&& rhs) = delete;
+
+	// This class is non-move assignable
+	PCMRingBuffer& operator=(PCMRingBuffer&& rhs) = delete;
+
+#pragma mark Buffer Management
+
+	/// Allocates space for audio data.
+	/// @note This method is not thread safe.
+	/// @note Capacities from 2 to 2,147,483,648 (0x80000000) frames are supported
+	/// @param format The format of the audio that will be written to and read from this buffer.
+	/// @param capacityFrames The desired capacity, in frames
+	/// @return \c true on success, \c false on error
+	bool Allocate(const CAStreamBasicDescription& format, uint32_t capacityFrames) noexcept;
+
+	/// Frees the resources used by this \c PCMRingBuffer
+	/// @note This method is not thread safe.
+	void Deallocate() noexcept;
+
+	/// Resets this \c PCMRingBuffer to its default state.
+	/// @note This method is not thread safe.
+	void Reset() noexcept;
+
+	/// Returns the capacity of this \c PCMRingBuffer in frames
+	inline uint32_t CapacityFrames() const noexcept
+	{
+		return mCapacityFrames;
+	}
+
+	/// Returns the format of this \c PCMRingBuffer
+	inline const CAStreamBasicDescription& Format() const noexcept
+	{
+		return mFormat;
+	}
+
+	/// Returns the number of buffers used to store audio
+	///
+	/// This is the number of channels for non-interleaved formats and \c 1 for interleaved formats
+	inline uint32_t BufferCount() const noexcept
+	{
+		return mBufferCount;
+	}
+
+#pragma mark Buffer Usage
+
+	/// Returns the number of frames available for reading
+	inline uint32_t FramesAvailableToRead() const noexcept
+	{
+		return static_cast<uint32_t>(mWritePosition.load(std::memory_order_acquire) - mReadPosition.load(std::memory_order_acquire));
+	}
+
+	/// Returns the free space available for writing in frames
+	inline uint32_t FramesAvailableToWrite() const noexcept
+	{
+		return mCapacityFrames - FramesAvailableToRead();
+	}
+
+	/// Reads audio from the \c PCMRingBuffer and advances the read pointer.
+	/// @param bufferList An \c AudioBufferList to receive the audio
+	/// @param frameCount The desired number of frames to read
+	/// @return The number of frames actually read
+	uint32_t Read(AudioBufferList * const _Nonnull bufferList, uint32_t frameCount) noexcept;
+
+	/// Writes audio to the \c PCMRingBuffer and advances the write pointer.
+	/// @param bufferList An \c AudioBufferList containing the audio to copy
+	/// @param frameCount The desired number of frames to write
+	/// @return The number of frames actually written
+	uint32_t Write(const AudioBufferList * const _Nonnull bufferList, uint32_t frameCount) noexcept;
+
+#pragma mark Direct Access
+
+	/// Returns the regions of the ring buffer containing audio available for reading
+	/// @note This method may only be called from the reader thread
+	Vector GetReadVector() const noexcept;
+
+	/// Advances the read pointer by \c frameCount frames after reading from the regions returned by \c GetReadVector()
+	/// @note This method may only be called from the reader thread
+	/// @param frameCount The number of frames consumed, which may not exceed \c FramesAvailableToRead()
+	void CommitRead(uint32_t frameCount) noexcept;
+
+	/// Returns the regions of the ring buffer available for writing
+	/// @note This method may only be called from the writer thread
+	Vector GetWriteVector() const noexcept;
+
+	/// Advances the write pointer by \c frameCount frames after writing to the regions returned by \c GetWriteVector()
+	/// @note This method may only be called from the writer thread
+	/// @param frameCount The number of frames produced, which may not exceed \c FramesAvailableToWrite()
+	void CommitWrite(uint32_t frameCount) noexcept;
+
+	/// Sets the buffers in \c bufferList to refer to the storage for \c region
+	/// @param region A region returned by \c GetReadVector() or \c GetWriteVector()
+	/// @param bufferList An \c AudioBufferList with \c mNumberBuffers equal to \c BufferCount()
+	/// @return \c true on success, \c false if \c bufferList has the wrong number of buffers
+	bool GetBufferList(const Region& region, AudioBufferList * const _Nonnull bufferList) const noexcept;
+
+private:
+
+	/// The format of the audio
+	CAStreamBasicDescription mFormat;
+
+	/// The storage for all buffers
+	std::unique_ptr<uint8_t []> mStorage;
+	/// The start of each buffer in \c mStorage
+	std::unique_ptr<uint8_t * []> mBuffers;
+	/// The number of buffers
+	uint32_t mBufferCount;
+
+	/// The capacity of each buffer in frames
+	uint32_t mCapacityFrames;
+	/// The capacity minus one
+	uint32_t mCapacityFramesMask;
+
+	/// The total number of frames written
+	alignas(64) std::atomic_size_t mWritePosition;
+	/// The total number of frames read
+	alignas(64) std::atomic_size_t mReadPosition;
+
+	/// Returns the regions starting at \c position containing \c frameCount frames
+	Vector MakeVector(size_t position, uint32_t frameCount) const noexcept;
+
+};
+
+} // namespace SFB
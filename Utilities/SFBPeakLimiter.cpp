@@ -0,0 +1,185 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#include <Accelerate/Accelerate.h>
+
+#include "SFBPeakLimiter.hpp"
+
+namespace {
+
+/// The maximum number of frames processed at once
+constexpr uint32_t kBlockSize = 1024;
+/// The number of interpolation filter taps for each fractional sample position
+constexpr uint32_t kTapCount = 16;
+/// The number of fractional sample positions interpolated between consecutive samples
+constexpr uint32_t kPhaseCount = 3;
+/// The time over which gain reduction is applied ahead of a peak, in seconds
+constexpr double kAttackTime = 0.002;
+/// The time constant for gain recovery, in seconds
+constexpr double kReleaseTime = 0.1;
+
+/// Returns the Blackman-windowed sinc interpolation coefficient for a sample \c offset samples from the interpolated position
+float InterpolationCoefficient(double offset) noexcept
+{
+	const auto u = offset / (kTapCount / 2);
+	if(std::abs(u) >= 1)
+		return 0;
+	const auto window = 0.42 + 0.5 * std::cos(M_PI * u) + 0.08 * std::cos(2 * M_PI * u);
+	const auto sinc = offset == 0 ? 1 : std::sin(M_PI * offset) / (M_PI * offset);
+	return static_cast<float>(sinc * window);
+}
+
+} // namespace
+
+SFB::PeakLimiter::PeakLimiter() noexcept
+: mChannelCount(0), mCeiling(1), mAttackFrameCount(0), mLatency(0), mReleaseCoefficient(0), mHoldHead(0), mHoldCount(0), mEnvelopeSum(0), mEnvelope(1), mPreviousPeak(0), mFrameIndex(0)
+{}
+
+bool SFB::PeakLimiter::Configure(uint32_t channelCount, double sampleRate, float ceiling) noexcept
+{
+	if(channelCount == 0 || sampleRate <= 0 || ceiling <= 0)
+		return false;
+
+	const auto attackFrameCount = std::max(1u, static_cast<uint32_t>(std::lround(kAttackTime * sampleRate)));
+	// Interpolated peaks are detected kTapCount / 2 frames after the samples they follow
+	const auto latency = attackFrameCount - 1 + kTapCount / 2;
+
+	try {
+		mCoefficients.assign(kPhaseCount * kTapCount, 0);
+		mHistory.assign(channelCount, std::vector<float>(kTapCount - 1 + kBlockSize, 0));
+		mDelayLine.assign(channelCount, std::vector<float>(latency + kBlockSize, 0));
+		mPeaks.assign(kBlockSize, 0);
+		mInterpolated.assign(kBlockSize, 0);
+		mGains.assign(kBlockSize, 1);
+		mHoldGains.assign(attackFrameCount, 1);
+		mHoldIndexes.assign(attackFrameCount, 0);
+		mEnvelopeHistory.assign(attackFrameCount, 1);
+	}
+
+	catch(const std::bad_alloc&) {
+		mChannelCount = 0;
+		return false;
+	}
+
+	// Each phase estimates the signal between the samples at kTapCount / 2 - 1 and kTapCount / 2
+	for(uint32_t phase = 0; phase < kPhaseCount; ++phase) {
+		auto coefficients = mCoefficients.data() + phase * kTapCount;
+		const auto fraction = static_cast<double>(phase + 1) / (kPhaseCount + 1);
+		float sum = 0;
+		for(uint32_t tap = 0; tap < kTapCount; ++tap) {
+			coefficients[tap] = InterpolationCoefficient(static_cast<double>(tap) - (kTapCount / 2 - 1) - fraction);
+			sum += coefficients[tap];
+		}
+		// Normalize for unity gain at DC
+		const auto scale = 1 / sum;
+		vDSP_vsmul(coefficients, 1, &scale, coefficients, 1, kTapCount);
+	}
+
+	mChannelCount = channelCount;
+	mCeiling = ceiling;
+	mAttackFrameCount = attackFrameCount;
+	mLatency = latency;
+	mReleaseCoefficient = static_cast<float>(1 - std::exp(-1 / (kReleaseTime * sampleRate)));
+
+	Reset();
+
+	return true;
+}
+
+void SFB::PeakLimiter::Reset() noexcept
+{
+	for(auto& history : mHistory)
+		std::fill(history.begin(), history.end(), 0);
+	for(auto& delayLine : mDelayLine)
+		std::fill(delayLine.begin(), delayLine.end(), 0);
+
+	std::fill(mEnvelopeHistory.begin(), mEnvelopeHistory.end(), 1);
+	mEnvelopeSum = mAttackFrameCount;
+	mEnvelope = 1;
+	mPreviousPeak = 0;
+	mHoldHead = 0;
+	mHoldCount = 0;
+	mFrameIndex = 0;
+}
+
+void SFB::PeakLimiter::Process(float * const *channels, uint32_t frameCount) noexcept
+{
+	if(!IsConfigured())
+		return;
+
+	for(uint32_t framesProcessed = 0; framesProcessed < frameCount; ) {
+		const auto blockSize = std::min(frameCount - framesProcessed, kBlockSize);
+		ProcessBlock(channels, framesProcessed, blockSize);
+		framesProcessed += blockSize;
+	}
+}
+
+void SFB::PeakLimiter::ProcessBlock(float * const *channels, uint32_t frameOffset, uint32_t frameCount) noexcept
+{
+	const auto historyLength = kTapCount - 1;
+
+	// Determine the peak amplitude of each frame, including inter-sample peaks
+	vDSP_vclr(mPeaks.data(), 1, frameCount);
+	for(uint32_t channel = 0; channel < mChannelCount; ++channel) {
+		auto history = mHistory[channel].data();
+		std::memcpy(history + historyLength, channels[channel] + frameOffset, frameCount * sizeof(float));
+		std::memcpy(mDelayLine[channel].data() + mLatency, channels[channel] + frameOffset, frameCount * sizeof(float));
+
+		vDSP_vabs(history + kTapCount / 2 - 1, 1, mInterpolated.data(), 1, frameCount);
+		vDSP_vmax(mPeaks.data(), 1, mInterpolated.data(), 1, mPeaks.data(), 1, frameCount);
+
+		for(uint32_t phase = 0; phase < kPhaseCount; ++phase) {
+			vDSP_conv(history, 1, mCoefficients.data() + phase * kTapCount, 1, mInterpolated.data(), 1, frameCount, kTapCount);
+			vDSP_vabs(mInterpolated.data(), 1, mInterpolated.data(), 1, frameCount);
+			vDSP_vmax(mPeaks.data(), 1, mInterpolated.data(), 1, mPeaks.data(), 1, frameCount);
+		}
+
+		std::memmove(history, history + frameCount, historyLength * sizeof(float));
+	}
+
+	// Compute the gain for each frame
+	// The minimum required gain is held for mAttackFrameCount frames and released exponentially, then averaged over
+	// mAttackFrameCount frames so gain reduction is complete when the peak is output
+	for(uint32_t i = 0; i < frameCount; ++i, ++mFrameIndex) {
+		// A sample is affected by inter-sample peaks on either side
+		const auto peak = std::max(mPeaks[i], mPreviousPeak);
+		mPreviousPeak = mPeaks[i];
+		const auto requiredGain = peak > mCeiling ? mCeiling / peak : 1;
+
+		// Maintain the minimum required gain over the most recent mAttackFrameCount frames
+		while(mHoldCount > 0 && mHoldGains[(mHoldHead + mHoldCount - 1) % mAttackFrameCount] >= requiredGain)
+			--mHoldCount;
+		if(mHoldCount > 0 && mHoldIndexes[mHoldHead] + mAttackFrameCount <= mFrameIndex) {
+			mHoldHead = (mHoldHead + 1) % mAttackFrameCount;
+			--mHoldCount;
+		}
+		const auto tail = (mHoldHead + mHoldCount) % mAttackFrameCount;
+		mHoldGains[tail] = requiredGain;
+		mHoldIndexes[tail] = mFrameIndex;
+		++mHoldCount;
+
+		const auto heldGain = mHoldGains[mHoldHead];
+		mEnvelope = heldGain < mEnvelope ? heldGain : mEnvelope + (heldGain - mEnvelope) * mReleaseCoefficient;
+
+		const auto position = mFrameIndex % mAttackFrameCount;
+		mEnvelopeSum += mEnvelope - mEnvelopeHistory[position];
+		mEnvelopeHistory[position] = mEnvelope;
+
+		mGains[i] = std::min(1.f, static_cast<float>(mEnvelopeSum / mAttackFrameCount));
+	}
+
+	// Apply the gains to the delayed audio
+	for(uint32_t channel = 0; channel < mChannelCount; ++channel) {
+		auto delayLine = mDelayLine[channel].data();
+		vDSP_vmul(delayLine, 1, mGains.data(), 1, channels[channel] + frameOffset, 1, frameCount);
+		std::memmove(delayLine, delayLine + frameCount, mLatency * sizeof(float));
+	}
+}
@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace SFB {
+
+/// A look-ahead true peak limiter for deinterleaved 32-bit floating point audio
+///
+/// Inter-sample peaks are estimated by interpolating between samples at four times the sample rate. Gain reduction begins
+/// ahead of each peak so the output never exceeds the ceiling, and recovers exponentially once the peak has passed.
+///
+/// Output is delayed by \c Latency() frames. The first \c Latency() frames produced after configuration or \c Reset() are
+/// silence and the final \c Latency() input frames are produced only once that many additional frames are processed.
+class PeakLimiter
+{
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c PeakLimiter
+	/// @note \c Configure() must be called before the object may be used.
+	PeakLimiter() noexcept;
+
+	// This class is non-copyable
+	PeakLimiter(const PeakLimiter& rhs) = delete;
+
+	// This class is non-assignable
+	PeakLimiter& operator=(const PeakLimiter& rhs) = delete;
+
+	/// Destroys the \c PeakLimiter and releases all associated resources.
+	~PeakLimiter() = default;
+
+	// This class is non-movable
+	PeakLimiter(PeakLimiter&& rhs) = delete;
+
+	// This class is non-move assignable
+	PeakLimiter& operator=(PeakLimiter&& rhs) = delete;
+
+#pragma mark Configuration
+
+	/// Allocates space for and configures the limiter
+	/// @note This method is not thread safe.
+	/// @param channelCount The number of audio channels
+	/// @param sampleRate The sample rate of the audio
+	/// @param ceiling The maximum output amplitude, which must be greater than \c 0
+	/// @return \c true on success, \c false on error
+	bool Configure(uint32_t channelCount, double sampleRate, float ceiling) noexcept;
+
+	/// Returns \c true if this \c PeakLimiter has been successfully configured
+	inline bool IsConfigured() const noexcept
+	{
+		return mChannelCount > 0;
+	}
+
+	/// Returns the delay between input and output, in frames
+	inline uint32_t Latency() const noexcept
+	{
+		return mLatency;
+	}
+
+	/// Discards delayed audio and resets the gain reduction
+	void Reset() noexcept;
+
+#pragma mark Processing
+
+	/// Limits audio in place
+	/// @param channels An array of \c channelCount pointers to the audio to limit
+	/// @param frameCount The number of frames to limit
+	void Process(float * const _Nonnull * const _Nonnull channels, uint32_t frameCount) noexcept;
+
+private:
+
+	/// Limits at most \c kBlockSize frames in place starting \c frameOffset frames into \c channels
+	void ProcessBlock(float * const _Nonnull * const _Nonnull channels, uint32_t frameOffset, uint32_t frameCount) noexcept;
+
+	/// The number of channels
+	uint32_t mChannelCount;
+	/// The maximum output amplitude
+	float mCeiling;
+	/// The number of frames over which gain reduction is applied ahead of a peak
+	uint32_t mAttackFrameCount;
+	/// The delay between input and output, in frames
+	uint32_t mLatency;
+	/// The coefficient controlling the rate of gain recovery
+	float mReleaseCoefficient;
+
+	/// Interpolation filter coefficients for each fractional sample position
+	std::vector<float> mCoefficients;
+	/// Per-channel interpolation history followed by the current block
+	std::vector<std::vector<float>> mHistory;
+	/// Per-channel delayed audio followed by the current block
+	std::vector<std::vector<float>> mDelayLine;
+	/// The peak amplitude of each frame in the current block
+	std::vector<float> mPeaks;
+	/// Scratch space for interpolated samples
+	std::vector<float> mInterpolated;
+	/// The gain for each frame in the current block
+	std::vector<float> mGains;
+
+	/// The required gains for the most recent \c mAttackFrameCount frames, in order of increasing gain
+	std::vector<float> mHoldGains;
+	/// The frame indexes corresponding to \c mHoldGains
+	std::vector<uint64_t> mHoldIndexes;
+	/// The position of the first valid element in \c mHoldGains
+	uint32_t mHoldHead;
+	/// The number of valid elements in \c mHoldGains
+	uint32_t mHoldCount;
+
+	/// The most recent \c mAttackFrameCount release envelope values
+	std::vector<float> mEnvelopeHistory;
+	/// The sum of \c mEnvelopeHistory
+	double mEnvelopeSum;
+	/// The current release envelope value
+	float mEnvelope;
+	/// The peak amplitude of the interval preceding the next frame
+	float mPreviousPeak;
+	/// The index of the next frame to process
+	uint64_t mFrameIndex;
+
+};
+
+} // namespace SFB
@@ -0,0 +1,160 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace SFB {
+
+/// A bounded wait-free single-producer, single-consumer FIFO queue of fixed-size records
+///
+/// Storage is preallocated by \c Allocate() and values are copied in and out of the queue, so neither \c TryPush()
+/// nor \c TryPop() allocates memory, takes a lock, or makes a system call. This makes the queue suitable for passing
+/// events out of a real-time thread. Pushes that fail because the queue is full are counted.
+///
+/// This class is thread safe when used from one producer thread and one consumer thread.
+template <typename T>
+class SPSCQueue
+{
+
+	static_assert(std::is_trivially_copyable<T>::value, "SPSCQueue values must be trivially copyable");
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c SPSCQueue
+	/// @note \c Allocate() must be called before the object may be used.
+	SPSCQueue() noexcept
+	: mCapacityMask(0), mWritePosition(0), mReadPosition(0), mOverflowCount(0)
+	{}
+
+	// This class is non-copyable
+	SPSCQueue(const SPSCQueue& rhs) = delete;
+
+	// This class is non-assignable
+	SPSCQueue& operator=(const SPSCQueue& rhs) = delete;
+
+	/// Destroys the \c SPSCQueue and releases all associated resources.
+	~SPSCQueue() = default;
+
+	// This class is non-movable
+	SPSCQueue(SPSCQueue&& rhs) = delete;
+
+	// This class is non-move assignable
+	SPSCQueue& operator=(SPSCQueue&& rhs) = delete;
+
+#pragma mark Buffer Management
+
+	/// Allocates space for values.
+	/// @note This method is not thread safe.
+	/// @note Capacities from 2 to 2,147,483,648 (0x80000000) values are supported
+	/// @param minimumCapacity The desired minimum capacity, in values
+	/// @return \c true on success, \c false on error
+	bool Allocate(size_t minimumCapacity) noexcept
+	{
+		if(minimumCapacity < 2 || minimumCapacity > 0x80000000)
+			return false;
+
+		// Round up to the next power of two
+		size_t capacity = 2;
+		while(capacity < minimumCapacity)
+			capacity <<= 1;
+
+		mValues.reset(new (std::nothrow) T [capacity]);
+		if(!mValues)
+			return false;
+
+		mCapacityMask = capacity - 1;
+		mWritePosition.store(0, std::memory_order_relaxed);
+		mReadPosition.store(0, std::memory_order_relaxed);
+		mOverflowCount.store(0, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	/// Returns the capacity of this \c SPSCQueue in values
+	inline size_t Capacity() const noexcept
+	{
+		return mValues ? mCapacityMask + 1 : 0;
+	}
+
+#pragma mark Producer
+
+	/// Appends \c value to the end of the queue
+	/// @note This method may only be called from the producer thread
+	/// @return \c true on success, \c false if the queue is full
+	bool TryPush(const T& value) noexcept
+	{
+		auto writePosition = mWritePosition.load(std::memory_order_relaxed);
+		if(writePosition - mReadPosition.load(std::memory_order_acquire) > mCapacityMask) {
+			mOverflowCount.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		mValues[writePosition & mCapacityMask] = value;
+		mWritePosition.store(writePosition + 1, std::memory_order_release);
+
+		return true;
+	}
+
+#pragma mark Consumer
+
+	/// Removes the value at the front of the queue
+	/// @note This method may only be called from the consumer thread
+	/// @param value The value removed from the queue
+	/// @return \c true on success, \c false if the queue is empty
+	bool TryPop(T& value) noexcept
+	{
+		auto readPosition = mReadPosition.load(std::memory_order_relaxed);
+		if(readPosition == mWritePosition.load(std::memory_order_acquire))
+			return false;
+
+		value = mValues[readPosition & mCapacityMask];
+		mReadPosition.store(readPosition + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	/// Returns \c true if the queue contains no values
+	/// @note From threads other than the consumer the result is approximate
+	bool IsEmpty() const noexcept
+	{
+		return mWritePosition.load(std::memory_order_acquire) == mReadPosition.load(std::memory_order_acquire);
+	}
+
+#pragma mark Overflow Accounting
+
+	/// Returns the number of values that could not be pushed because the queue was full
+	/// @note This method is safe to call from any thread
+	inline uint64_t OverflowCount() const noexcept
+	{
+		return mOverflowCount.load(std::memory_order_relaxed);
+	}
+
+private:
+
+	/// The values
+	std::unique_ptr<T []> mValues;
+	/// The capacity minus one
+	size_t mCapacityMask;
+
+	/// The total number of values pushed
+	alignas(64) std::atomic_size_t mWritePosition;
+	/// The total number of values popped
+	alignas(64) std::atomic_size_t mReadPosition;
+	/// The number of failed pushes
+	alignas(64) std::atomic_uint64_t mOverflowCount;
+
+};
+
+} // namespace SFB
@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#include <mach/mach_time.h>
+
+#include "SFBScheduledStart.hpp"
+
+SFB::ScheduledStart::ScheduledStart() noexcept
+: mHostTime(0), mPrefillHostTime(0), mStartCount(0), mLateStartCount(0), mIncompletePrefillCount(0), mLastPrefillMargin(0), mMinimumPrefillMargin(INT64_MAX)
+{}
+
+void SFB::ScheduledStart::Schedule(uint64_t hostTime) noexcept
+{
+	mPrefillHostTime.store(0);
+	mHostTime.store(hostTime);
+}
+
+void SFB::ScheduledStart::PrefillComplete() noexcept
+{
+	if(mHostTime.load() == 0)
+		return;
+	uint64_t expected = 0;
+	mPrefillHostTime.compare_exchange_strong(expected, mach_absolute_time());
+}
+
+bool SFB::ScheduledStart::TryStart(uint64_t hostTime, uint64_t cycleHostTime) noexcept
+{
+	auto expected = hostTime;
+	if(!mHostTime.compare_exchange_strong(expected, 0))
+		return false;
+
+	mStartCount.fetch_add(1);
+	if(hostTime < cycleHostTime)
+		mLateStartCount.fetch_add(1);
+
+	const auto prefillHostTime = mPrefillHostTime.load();
+	if(prefillHostTime == 0) {
+		mIncompletePrefillCount.fetch_add(1);
+		return true;
+	}
+
+	const auto margin = static_cast<int64_t>(hostTime - prefillHostTime);
+	mLastPrefillMargin.store(margin);
+	// Only the rendering thread updates the minimum
+	if(margin < mMinimumPrefillMargin.load())
+		mMinimumPrefillMargin.store(margin);
+
+	return true;
+}
+
+SFB::ScheduledStart::Statistics SFB::ScheduledStart::GetStatistics() const noexcept
+{
+	const auto minimumPrefillMargin = mMinimumPrefillMargin.load();
+	return { mStartCount.load(), mLateStartCount.load(), mIncompletePrefillCount.load(), mLastPrefillMargin.load(), minimumPrefillMargin != INT64_MAX ? minimumPrefillMargin : 0 };
+}
@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace SFB {
+
+/// Tracks a host time at which rendering is scheduled to start and how far ahead of it audio was buffered
+///
+/// A producer thread calls \c PrefillComplete() once it has buffered all the audio it will before the start, and the
+/// rendering thread calls \c TryStart() in the render cycle containing the start. All methods are lock-free and
+/// \c TryStart() is wait-free, so it is suitable for use from a real-time thread.
+class ScheduledStart
+{
+
+public:
+
+	/// Scheduled start statistics
+	struct Statistics
+	{
+		/// The number of starts performed
+		uint64_t mStartCount;
+		/// The number of starts performed after the scheduled host time
+		uint64_t mLateStartCount;
+		/// The number of starts performed before buffering was complete
+		uint64_t mIncompletePrefillCount;
+		/// The interval between buffering completing and the most recent start in host ticks
+		int64_t mLastPrefillMargin;
+		/// The smallest interval between buffering completing and a start in host ticks, or \c 0 if none
+		int64_t mMinimumPrefillMargin;
+	};
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c ScheduledStart with no pending start
+	ScheduledStart() noexcept;
+
+	// This class is non-copyable
+	ScheduledStart(const ScheduledStart& rhs) = delete;
+
+	// This class is non-assignable
+	ScheduledStart& operator=(const ScheduledStart& rhs) = delete;
+
+	/// Destroys the \c ScheduledStart
+	~ScheduledStart() = default;
+
+	// This class is non-movable
+	ScheduledStart(ScheduledStart&& rhs) = delete;
+
+	// This class is non-move assignable
+	ScheduledStart& operator=(ScheduledStart&& rhs) = delete;
+
+#pragma mark Scheduling
+
+	/// Schedules rendering to start at \c hostTime, replacing any pending start
+	void Schedule(uint64_t hostTime) noexcept;
+
+	/// Cancels any pending start
+	inline void Cancel() noexcept
+	{
+		mHostTime.store(0);
+	}
+
+	/// Returns the host time at which rendering is scheduled to start or \c 0 if none
+	inline uint64_t HostTime() const noexcept
+	{
+		return mHostTime.load();
+	}
+
+	/// Notes that all the audio the producer will buffer before a pending start is buffered
+	void PrefillComplete() noexcept;
+
+	/// Starts rendering if \c hostTime is still the pending start and records how early buffering completed
+	/// @param hostTime The host time returned by \c HostTime()
+	/// @param cycleHostTime The host time at which the first frame of the render cycle is output
+	/// @return \c true if the start was performed
+	bool TryStart(uint64_t hostTime, uint64_t cycleHostTime) noexcept;
+
+#pragma mark Statistics
+
+	/// Returns the scheduled start statistics
+	Statistics GetStatistics() const noexcept;
+
+private:
+
+	/// The host time at which rendering is scheduled to start or \c 0 if none
+	std::atomic_uint64_t mHostTime;
+	/// The host time at which buffering completed for the pending start or \c 0 if not yet
+	std::atomic_uint64_t mPrefillHostTime;
+
+	/// The number of starts performed
+	std::atomic_uint64_t mStartCount;
+	/// The number of starts performed after the scheduled host time
+	std::atomic_uint64_t mLateStartCount;
+	/// The number of starts performed before buffering was complete
+	std::atomic_uint64_t mIncompletePrefillCount;
+	/// The interval between buffering completing and the most recent start in host ticks
+	std::atomic_int64_t mLastPrefillMargin;
+	/// The smallest interval between buffering completing and a start in host ticks
+	std::atomic_int64_t mMinimumPrefillMargin;
+
+};
+
+} // namespace SFB
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace SFB {
+
+/// A sequence lock protecting a small value written by a single thread and read by any number of threads
+///
+/// The writer never waits, so \c Store() is suitable for use from a real-time thread. Readers retry until they observe
+/// a value that was not modified while being read. The value is stored as an array of relaxed atomic words so reads
+/// concurrent with a write are well-defined.
+///
+/// This class is thread safe when used from one writer thread and any number of reader threads.
+template <typename T>
+class Seqlock
+{
+
+	static_assert(std::is_trivially_copyable<T>::value, "Seqlock values must be trivially copyable");
+	static_assert(std::is_default_constructible<T>::value, "Seqlock values must be default constructible");
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c Seqlock holding a value-initialized \c T
+	Seqlock() noexcept
+	: mSequence(0)
+	{
+		Store(T{});
+	}
+
+	// This class is non-copyable
+	Seqlock(const Seqlock& rhs) = delete;
+
+	// This class is non-assignable
+	Seqlock& operator=(const Seqlock& rhs) = delete;
+
+	/// Destroys the \c Seqlock
+	~Seqlock() = default;
+
+	// This class is non-movable
+	Seqlock(Seqlock&& rhs) = delete;
+
+	// This class is non-move assignable
+	Seqlock& operator=(Seqlock&& rhs) = delete;
+
+#pragma mark Writer
+
+	/// Replaces the protected value with \c value
+	/// @note This method may only be called from the writer thread
+	void Store(const T& value) noexcept
+	{
+		uint64_t words [kWordCount] = {};
+		std::memcpy(words, &value, sizeof(T));
+
+		// An odd sequence number marks a write in progress
+		auto sequence = mSequence.load(std::memory_order_relaxed);
+		mSequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for(size_t i = 0; i < kWordCount; ++i)
+			mWords[i].store(words[i], std::memory_order_relaxed);
+
+		mSequence.store(sequence + 2, std::memory_order_release);
+	}
+
+#pragma mark Readers
+
+	/// Returns the protected value
+	/// @note This method is safe to call from any thread but may spin while a write is in progress
+	T Load() const noexcept
+	{
+		uint64_t words [kWordCount];
+		for(;;) {
+			auto sequence = mSequence.load(std::memory_order_acquire);
+			if(sequence & 1)
+				continue;
+
+			for(size_t i = 0; i < kWordCount; ++i)
+				words[i] = mWords[i].load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(mSequence.load(std::memory_order_relaxed) == sequence)
+				break;
+		}
+
+		T value;
+		std::memcpy(&value, words, sizeof(T));
+		return value;
+	}
+
+private:
+
+	/// The number of words needed to hold a \c T
+	static constexpr size_t kWordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	/// The sequence number, incremented before and after each write
+	std::atomic_uint64_t mSequence;
+	/// The protected value
+	std::atomic_uint64_t mWords [kWordCount];
+
+};
+
+} // namespace SFB
@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#include <cmath>
+#include <new>
+
+#include "SFBSpectrumAnalyzer.hpp"
+
+SFB::SpectrumAnalyzer::SpectrumAnalyzer() noexcept
+: mFFTSize(0), mLog2FFTSize(0), mSetup(nullptr)
+{}
+
+SFB::SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+	if(mSetup)
+		vDSP_destroy_fftsetup(mSetup);
+}
+
+bool SFB::SpectrumAnalyzer::Configure(uint32_t fftSize) noexcept
+{
+	if(fftSize < kMinimumFFTSize || fftSize > kMaximumFFTSize || (fftSize & (fftSize - 1)))
+		return false;
+
+	if(mSetup) {
+		vDSP_destroy_fftsetup(mSetup);
+		mSetup = nullptr;
+	}
+
+	vDSP_Length log2FFTSize = 0;
+	while((1u << log2FFTSize) < fftSize)
+		++log2FFTSize;
+
+	try {
+		mWindow.assign(fftSize, 0);
+		mWindowed.assign(fftSize, 0);
+		mReal.assign(fftSize / 2, 0);
+		mImaginary.assign(fftSize / 2, 0);
+	}
+
+	catch(const std::bad_alloc&) {
+		return false;
+	}
+
+	mSetup = vDSP_create_fftsetup(log2FFTSize, kFFTRadix2);
+	if(!mSetup)
+		return false;
+
+	vDSP_hann_window(mWindow.data(), fftSize, vDSP_HANN_DENORM);
+
+	mFFTSize = fftSize;
+	mLog2FFTSize = log2FFTSize;
+
+	return true;
+}
+
+void SFB::SpectrumAnalyzer::Analyze(const float *samples, float *magnitudes) noexcept
+{
+	if(!IsConfigured())
+		return;
+
+	const auto halfSize = mFFTSize / 2;
+
+	vDSP_vmul(samples, 1, mWindow.data(), 1, mWindowed.data(), 1, mFFTSize);
+
+	DSPSplitComplex splitComplex = { mReal.data(), mImaginary.data() };
+	vDSP_ctoz(reinterpret_cast<const DSPComplex *>(mWindowed.data()), 2, &splitComplex, 1, halfSize);
+	vDSP_fft_zrip(mSetup, &splitComplex, 1, mLog2FFTSize, kFFTDirection_Forward);
+
+	// The packed transform holds the DC and Nyquist components in the first real and imaginary values
+	const auto nyquist = mImaginary[0];
+	mImaginary[0] = 0;
+	vDSP_zvabs(&splitComplex, 1, magnitudes, 1, halfSize);
+	magnitudes[halfSize] = std::abs(nyquist);
+
+	// The forward transform is scaled by 2 and the window has a coherent gain of 1/2
+	const auto scale = 2.f / mFFTSize;
+	vDSP_vsmul(magnitudes, 1, &scale, magnitudes, 1, halfSize + 1);
+	// The DC and Nyquist components are not split between positive and negative frequencies
+	magnitudes[0] /= 2;
+	magnitudes[halfSize] /= 2;
+}
@@ -0,0 +1,105 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Accelerate/Accelerate.h>
+
+namespace SFB {
+
+/// Computes magnitude spectra of 32-bit floating point audio
+///
+/// Each block of \c FFTSize() samples is multiplied by a Hann window and transformed with a real FFT. Magnitudes are
+/// scaled so a full scale sinusoid centered in a bin has a magnitude of \c 1.
+class SpectrumAnalyzer
+{
+
+public:
+
+	/// The smallest supported FFT size
+	static constexpr uint32_t kMinimumFFTSize = 16;
+	/// The largest supported FFT size
+	static constexpr uint32_t kMaximumFFTSize = 65536;
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c SpectrumAnalyzer
+	/// @note \c Configure() must be called before the object may be used.
+	SpectrumAnalyzer() noexcept;
+
+	// This class is non-copyable
+	SpectrumAnalyzer(const SpectrumAnalyzer& rhs) = delete;
+
+	// This class is non-assignable
+	SpectrumAnalyzer& operator=(const SpectrumAnalyzer& rhs) = delete;
+
+	/// Destroys the \c SpectrumAnalyzer and releases all associated resources.
+	~SpectrumAnalyzer();
+
+	// This class is non-movable
+	SpectrumAnalyzer(SpectrumAnalyzer&& rhs) = delete;
+
+	// This class is non-move assignable
+	SpectrumAnalyzer& operator=(SpectrumAnalyzer&& rhs) = delete;
+
+#pragma mark Configuration
+
+	/// Allocates space for and configures the analyzer
+	/// @note This method is not thread safe.
+	/// @param fftSize The number of samples in each block, which must be a power of two from \c kMinimumFFTSize to \c kMaximumFFTSize
+	/// @return \c true on success, \c false on error
+	bool Configure(uint32_t fftSize) noexcept;
+
+	/// Returns \c true if this \c SpectrumAnalyzer has been successfully configured
+	inline bool IsConfigured() const noexcept
+	{
+		return mSetup != nullptr;
+	}
+
+	/// Returns the number of samples in each block
+	inline uint32_t FFTSize() const noexcept
+	{
+		return mFFTSize;
+	}
+
+	/// Returns the number of magnitudes in each spectrum
+	///
+	/// Bin \c i corresponds to a frequency of \c i times the sample rate divided by \c FFTSize()
+	inline uint32_t BinCount() const noexcept
+	{
+		return mFFTSize / 2 + 1;
+	}
+
+#pragma mark Analysis
+
+	/// Computes the magnitude spectrum of \c FFTSize() samples
+	/// @param samples The samples to analyze
+	/// @param magnitudes A buffer of at least \c BinCount() values to receive the magnitudes
+	void Analyze(const float * const _Nonnull samples, float * const _Nonnull magnitudes) noexcept;
+
+private:
+
+	/// The number of samples in each block
+	uint32_t mFFTSize;
+	/// The base 2 logarithm of \c mFFTSize
+	vDSP_Length mLog2FFTSize;
+	/// The FFT weights
+	FFTSetup _Nullable mSetup;
+	/// The window function
+	std::vector<float> mWindow;
+	/// The windowed samples
+	std::vector<float> mWindowed;
+	/// The real parts of the transform
+	std::vector<float> mReal;
+	/// The imaginary parts of the transform
+	std::vector<float> mImaginary;
+
+};
+
+} // namespace SFB
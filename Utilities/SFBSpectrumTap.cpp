@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include <Accelerate/Accelerate.h>
+#include <mach/mach_time.h>
+
+#include "SFBSpectrumTap.hpp"
+
+namespace {
+
+/// Returns the number of host ticks in \c seconds
+uint64_t ConvertSecondsToHostTicks(double seconds) noexcept
+{
+	static const auto nanosPerHostTick = [] {
+		mach_timebase_info_data_t timebase_info;
+		mach_timebase_info(&timebase_info);
+		return static_cast<double>(timebase_info.denom) / static_cast<double>(timebase_info.numer);
+	}();
+	return static_cast<uint64_t>(seconds * NSEC_PER_SEC * nanosPerHostTick);
+}
+
+} // namespace
+
+constexpr uint32_t SFB::SpectrumTap::kFrameCapacity;
+constexpr size_t SFB::SpectrumTap::kTimestampCapacity;
+constexpr size_t SFB::SpectrumTap::kHistoryCapacity;
+
+SFB::SpectrumTap::SpectrumTap() noexcept
+: mFrameCount(0), mPendingOffset(0), mPendingStartFrame(0)
+{}
+
+bool SFB::SpectrumTap::Allocate(const CAStreamBasicDescription& format) noexcept
+{
+	if(!mFIFO.Allocate(format, kFrameCapacity) || !mTimestamps.Allocate(kTimestampCapacity))
+		return false;
+
+	const auto bufferCount = mFIFO.BufferCount();
+	auto bufferList = static_cast<AudioBufferList *>(std::calloc(1, offsetof(AudioBufferList, mBuffers) + (sizeof(AudioBuffer) * std::max(bufferCount, 1u))));
+	if(!bufferList)
+		return false;
+	bufferList->mNumberBuffers = bufferCount;
+	mRegionBufferList.reset(bufferList);
+
+	return true;
+}
+
+bool SFB::SpectrumTap::Write(const AudioBufferList *bufferList, uint32_t frameCount, uint64_t hostTime) noexcept
+{
+	// Render cycles are copied whole so each timestamp describes the frames following it
+	if(mFIFO.FramesAvailableToWrite() < frameCount)
+		return false;
+	mTimestamps.TryPush({ mFrameCount, hostTime });
+	mFIFO.Write(bufferList, frameCount);
+	mFrameCount += frameCount;
+	return true;
+}
+
+bool SFB::SpectrumTap::Analyze(uint32_t fftSize, uint32_t hopSize) noexcept
+{
+	if(mAnalyzer.FFTSize() != fftSize && !mAnalyzer.Configure(fftSize))
+		return false;
+	hopSize = std::min(std::max(hopSize, 1u), fftSize);
+
+	try {
+		Timestamp timestamp;
+		while(mTimestamps.TryPop(timestamp))
+			mPendingTimestamps.push_back(timestamp);
+
+		// Analyzed frames are discarded by advancing mPendingOffset; they are removed only once they
+		// outnumber the frames the tap holds so each frame is moved at most once
+		if(mPendingOffset >= kFrameCapacity) {
+			mPending.erase(mPending.begin(), mPending.begin() + static_cast<std::ptrdiff_t>(mPendingOffset));
+			mPendingOffset = 0;
+		}
+
+		// Downmix the copied frames to mono
+		const auto channelCount = mFIFO.BufferCount();
+		const auto scale = 1.f / channelCount;
+		const auto readVector = mFIFO.GetReadVector();
+		for(const auto& region : { readVector.mFirst, readVector.mSecond }) {
+			if(region.mFrameCount == 0 || !mFIFO.GetBufferList(region, mRegionBufferList.get()))
+				break;
+			const auto offset = mPending.size();
+			mPending.resize(offset + region.mFrameCount);
+			auto mono = mPending.data() + offset;
+			std::memcpy(mono, mRegionBufferList->mBuffers[0].mData, region.mFrameCount * sizeof(float));
+			for(uint32_t channel = 1; channel < channelCount; ++channel)
+				vDSP_vadd(mono, 1, static_cast<const float *>(mRegionBufferList->mBuffers[channel].mData), 1, mono, 1, region.mFrameCount);
+			if(channelCount > 1)
+				vDSP_vsmul(mono, 1, &scale, mono, 1, region.mFrameCount);
+		}
+		mFIFO.CommitRead(readVector.FrameCount());
+
+		const auto binCount = mAnalyzer.BinCount();
+		while(mPending.size() - mPendingOffset >= fftSize) {
+			mMagnitudes.resize(binCount);
+			mAnalyzer.Analyze(mPending.data() + mPendingOffset, mMagnitudes.data());
+			const auto hostTime = HostTimeForFrame(mPendingStartFrame + fftSize / 2);
+
+			{
+				std::lock_guard<std::mutex> lock(mHistoryLock);
+				if(mHistory.size() == kHistoryCapacity) {
+					mHistory.push_back(std::move(mHistory.front()));
+					mHistory.pop_front();
+				}
+				else
+					mHistory.emplace_back();
+				mHistory.back().mHostTime = hostTime;
+				std::swap(mHistory.back().mMagnitudes, mMagnitudes);
+			}
+
+			mPendingOffset += hopSize;
+			mPendingStartFrame += hopSize;
+		}
+	}
+
+	catch(const std::bad_alloc&) {
+		mFIFO.CommitRead(mFIFO.FramesAvailableToRead());
+		return false;
+	}
+
+	return true;
+}
+
+size_t SFB::SpectrumTap::Read(float *magnitudes, size_t count, uint64_t hostTime, uint64_t *spectrumHostTime) noexcept
+{
+	std::lock_guard<std::mutex> lock(mHistoryLock);
+	auto iter = std::find_if(mHistory.rbegin(), mHistory.rend(), [hostTime](const Spectrum& spectrum) {
+		return hostTime == 0 || spectrum.mHostTime <= hostTime;
+	});
+	if(iter == mHistory.rend())
+		return 0;
+
+	count = std::min(count, iter->mMagnitudes.size());
+	std::copy(iter->mMagnitudes.begin(), iter->mMagnitudes.begin() + static_cast<std::ptrdiff_t>(count), magnitudes);
+	if(spectrumHostTime)
+		*spectrumHostTime = iter->mHostTime;
+	return count;
+}
+
+uint64_t SFB::SpectrumTap::HostTimeForFrame(uint64_t frame) noexcept
+{
+	// Timestamps preceding the most recent one at or before frame are no longer needed
+	while(mPendingTimestamps.size() > 1 && mPendingTimestamps[1].mFrame <= frame)
+		mPendingTimestamps.pop_front();
+	if(mPendingTimestamps.empty())
+		return 0;
+
+	const auto& timestamp = mPendingTimestamps.front();
+	const auto sampleRate = mFIFO.Format().mSampleRate;
+	if(frame >= timestamp.mFrame)
+		return timestamp.mHostTime + ConvertSecondsToHostTicks((frame - timestamp.mFrame) / sampleRate);
+	return timestamp.mHostTime - ConvertSecondsToHostTicks((timestamp.mFrame - frame) / sampleRate);
+}
@@ -0,0 +1,164 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <CoreAudio/CoreAudioTypes.h>
+
+#include "SFBCAStreamBasicDescription.hpp"
+#include "SFBPCMRingBuffer.hpp"
+#include "SFBSPSCQueue.hpp"
+#include "SFBSpectrumAnalyzer.hpp"
+
+namespace SFB {
+
+/// Copies rendered audio and computes magnitude spectra of it away from the rendering thread
+///
+/// Audio is downmixed to mono and analyzed in overlapping blocks. Each spectrum is stamped with the host time at which
+/// the center of its block is output, and the most recent spectra are retained for readers.
+///
+/// \c Write() may be called from a real-time thread and \c Analyze() from a single other thread. \c Read() may be
+/// called from any thread.
+class SpectrumTap
+{
+
+public:
+
+	/// The number of frames the tap holds awaiting analysis
+	static constexpr uint32_t kFrameCapacity 		= 16384;
+	/// The number of render cycle timestamps the tap holds awaiting analysis
+	static constexpr size_t kTimestampCapacity 		= 256;
+	/// The number of spectra retained for readers
+	static constexpr size_t kHistoryCapacity 		= 32;
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c SpectrumTap
+	/// @note \c Allocate() must be called before the object may be used.
+	SpectrumTap() noexcept;
+
+	// This class is non-copyable
+	SpectrumTap(const SpectrumTap& rhs) = delete;
+
+	// This class is non-assignable
+	SpectrumTap& operator=(const SpectrumTap& rhs) = delete;
+
+	/// Destroys the \c SpectrumTap and releases all associated resources.
+	~SpectrumTap() = default;
+
+	// This class is non-movable
+	SpectrumTap(SpectrumTap&& rhs) = delete;
+
+	// This class is non-move assignable
+	SpectrumTap& operator=(SpectrumTap&& rhs) = delete;
+
+#pragma mark Configuration
+
+	/// Allocates space for audio.
+	/// @note This method is not thread safe.
+	/// @param format The format of the audio, which must be non-interleaved 32-bit floating point
+	/// @return \c true on success, \c false on error
+	bool Allocate(const CAStreamBasicDescription& format) noexcept;
+
+	/// Returns \c true if this \c SpectrumTap has been successfully allocated
+	inline bool IsAllocated() const noexcept
+	{
+		return mRegionBufferList != nullptr;
+	}
+
+#pragma mark Processing
+
+	/// Copies audio to the tap
+	/// @param bufferList The audio to copy
+	/// @param frameCount The number of frames to copy
+	/// @param hostTime The host time at which the first frame is output
+	/// @return \c true if the frames were copied, \c false if insufficient space was available
+	bool Write(const AudioBufferList * const _Nonnull bufferList, uint32_t frameCount, uint64_t hostTime) noexcept;
+
+	/// Computes the spectra of the audio copied to the tap
+	/// @param fftSize The number of frames analyzed for each spectrum
+	/// @param hopSize The number of frames between consecutive spectra
+	/// @return \c true on success, \c false on error
+	bool Analyze(uint32_t fftSize, uint32_t hopSize) noexcept;
+
+	/// Copies the most recent spectrum output at or before a host time
+	/// @param magnitudes A buffer to receive the magnitudes
+	/// @param count The maximum number of magnitudes to copy
+	/// @param hostTime The host time of interest or \c 0 for the most recent spectrum
+	/// @param spectrumHostTime An optional pointer to receive the host time of the spectrum
+	/// @return The number of magnitudes copied
+	size_t Read(float * const _Nonnull magnitudes, size_t count, uint64_t hostTime, uint64_t * const _Nullable spectrumHostTime) noexcept;
+
+private:
+
+	/// The host time at which a frame copied to the tap is output
+	struct Timestamp
+	{
+		/// The index of the frame in the tap
+		uint64_t mFrame;
+		/// The host time at which the frame is output
+		uint64_t mHostTime;
+	};
+
+	/// A magnitude spectrum
+	struct Spectrum
+	{
+		/// The host time at which the center of the analyzed frames is output
+		uint64_t mHostTime;
+		/// The magnitudes
+		std::vector<float> mMagnitudes;
+	};
+
+	/// Deleter for \c AudioBufferList objects allocated with \c std::calloc
+	struct BufferListDeleter
+	{
+		void operator()(AudioBufferList * _Nonnull bufferList) const noexcept
+		{
+			std::free(bufferList);
+		}
+	};
+
+	/// Returns the host time at which \c frame is output
+	uint64_t HostTimeForFrame(uint64_t frame) noexcept;
+
+	/// Frames copied to the tap awaiting analysis
+	PCMRingBuffer mFIFO;
+	/// Timestamps for frames in \c mFIFO
+	SPSCQueue<Timestamp> mTimestamps;
+	/// The total number of frames copied to \c mFIFO, accessed only from \c Write()
+	uint64_t mFrameCount;
+	/// \c AudioBufferList referring to regions of \c mFIFO
+	std::unique_ptr<AudioBufferList, BufferListDeleter> mRegionBufferList;
+
+	/// The spectrum analyzer
+	SpectrumAnalyzer mAnalyzer;
+	/// Timestamps removed from \c mTimestamps
+	std::deque<Timestamp> mPendingTimestamps;
+	/// Mono frames, of which those from \c mPendingOffset onward await analysis
+	std::vector<float> mPending;
+	/// The offset in \c mPending of the first frame awaiting analysis
+	size_t mPendingOffset;
+	/// The index of the frame at \c mPendingOffset
+	uint64_t mPendingStartFrame;
+	/// Scratch space for magnitudes exchanged with \c mHistory
+	std::vector<float> mMagnitudes;
+
+	/// The most recent spectra in order of increasing host time
+	std::deque<Spectrum> mHistory;
+	/// The lock protecting \c mHistory
+	std::mutex mHistoryLock;
+
+};
+
+} // namespace SFB
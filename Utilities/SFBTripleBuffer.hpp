@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2022 Stephen F. Booth <me@sbooth.org>
+// Part of https://github.com/sbooth/SFBAudioEngine
+// MIT license
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace SFB {
+
+/// A triple buffer passing the most recent value from a single writer thread to a single reader thread
+///
+/// The writer fills the write buffer and publishes it by exchanging it with the shared back buffer. The reader
+/// acquires the back buffer by exchanging it with its read buffer if a value was published since the previous
+/// acquisition. Neither side ever waits for the other, so both are wait-free and suitable for use from a real-time
+/// thread. Values published between acquisitions are overwritten; the reader always observes the most recent one.
+///
+/// This class is thread safe when used from one writer thread and one reader thread.
+template <typename T>
+class TripleBuffer
+{
+
+	static_assert(std::is_default_constructible<T>::value, "TripleBuffer values must be default constructible");
+
+public:
+
+#pragma mark Creation and Destruction
+
+	/// Creates a new \c TripleBuffer holding value-initialized values
+	TripleBuffer() noexcept
+	: mBuffers{}, mBackBuffer(1), mWriteIndex(0), mReadIndex(2)
+	{}
+
+	// This class is non-copyable
+	TripleBuffer(const TripleBuffer& rhs) = delete;
+
+	// This class is non-assignable
+	TripleBuffer& operator=(const TripleBuffer& rhs) = delete;
+
+	/// Destroys the \c TripleBuffer
+	~TripleBuffer() = default;
+
+	// This class is non-movable
+	TripleBuffer(TripleBuffer&& rhs) = delete;
+
+	// This class is non-move assignable
+	TripleBuffer& operator=(TripleBuffer&& rhs) = delete;
+
+#pragma mark Writer
+
+	/// Returns the buffer to fill before calling \c Publish()
+	/// @note This method may only be called from the writer thread
+	inline T& WriteBuffer() noexcept
+	{
+		return mBuffers[mWriteIndex];
+	}
+
+	/// Makes the contents of the write buffer available to the reader
+	/// @note This method may only be called from the writer thread
+	inline void Publish() noexcept
+	{
+		mWriteIndex = mBackBuffer.exchange(mWriteIndex | kFreshFlag, std::memory_order_acq_rel) & kIndexMask;
+	}
+
+#pragma mark Reader
+
+	/// Acquires the most recently published value if it has not already been acquired
+	/// @note This method may only be called from the reader thread
+	/// @return \c true if a new value was acquired
+	inline bool Acquire() noexcept
+	{
+		if(!(mBackBuffer.load(std::memory_order_relaxed) & kFreshFlag))
+			return false;
+		mReadIndex = mBackBuffer.exchange(mReadIndex, std::memory_order_acq_rel) & kIndexMask;
+		return true;
+	}
+
+	/// Returns the most recently acquired value
+	/// @note This method may only be called from the reader thread
+	inline const T& ReadBuffer() const noexcept
+	{
+		return mBuffers[mReadIndex];
+	}
+
+private:
+
+	/// The mask selecting the buffer index from \c mBackBuffer
+	static constexpr uint8_t kIndexMask = 0x3;
+	/// The flag set in \c mBackBuffer when it holds a value the reader has not acquired
+	static constexpr uint8_t kFreshFlag = 0x4;
+
+	/// The buffers
+	T mBuffers [3];
+	/// The index of the buffer shared between the writer and reader and whether it was published since last acquired
+	std::atomic_uint8_t mBackBuffer;
+	/// The index of the buffer owned by the writer
+	uint8_t mWriteIndex;
+	/// The index of the buffer owned by the reader
+	uint8_t mReadIndex;
+
+};
+
+} // namespace SFB